@@ -13,7 +13,7 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
 // Experiemental encoding variants, not enabled by default
 //#define COLOR_WEIGHTS
@@ -319,15 +319,12 @@ static void OptimizeRGB(_Out_ HDRColorA *pX, _Out_ HDRColorA *pY,
 
 
 //-------------------------------------------------------------------------------------
-inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
+inline static void DecodeBC1Endpoints( _Out_ XMVECTOR& clr0, _Out_ XMVECTOR& clr1, _In_ const D3DX_BC1 *pBC )
 {
-    assert( pColor && pBC );
-    static_assert( sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes" );
-
     static XMVECTORF32 s_Scale = { 1.f/31.f, 1.f/63.f, 1.f/31.f, 1.f };
 
-    XMVECTOR clr0 = XMLoadU565( reinterpret_cast<const XMU565*>(&pBC->rgb[0]) );
-    XMVECTOR clr1 = XMLoadU565( reinterpret_cast<const XMU565*>(&pBC->rgb[1]) );
+    clr0 = XMLoadU565( reinterpret_cast<const XMU565*>(&pBC->rgb[0]) );
+    clr1 = XMLoadU565( reinterpret_cast<const XMU565*>(&pBC->rgb[1]) );
 
     clr0 = XMVectorMultiply( clr0, s_Scale );
     clr1 = XMVectorMultiply( clr1, s_Scale );
@@ -337,6 +334,15 @@ inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColo
 
     clr0 = XMVectorSelect( g_XMIdentityR3, clr0, g_XMSelect1110 );
     clr1 = XMVectorSelect( g_XMIdentityR3, clr1, g_XMSelect1110 );
+}
+
+inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes" );
+
+    XMVECTOR clr0, clr1;
+    DecodeBC1Endpoints( clr0, clr1, pBC );
 
     XMVECTOR clr2, clr3;
     if ( isbc1 && (pBC->rgb[0] <= pBC->rgb[1]) )
@@ -367,6 +373,49 @@ inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColo
 }
 
 
+//-------------------------------------------------------------------------------------
+// Average of the 16 decoded texels, computed from the endpoints and index histogram
+//-------------------------------------------------------------------------------------
+inline static uint32_t CountBits( _In_ uint32_t v )
+{
+    v = v - ( ( v >> 1 ) & 0x55555555 );
+    v = ( v & 0x33333333 ) + ( ( v >> 2 ) & 0x33333333 );
+    return ( ( ( v + ( v >> 4 ) ) & 0x0F0F0F0F ) * 0x01010101 ) >> 24;
+}
+
+inline static XMVECTOR AverageBC1( _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
+{
+    assert( pBC );
+
+    XMVECTOR clr0, clr1;
+    DecodeBC1Endpoints( clr0, clr1, pBC );
+
+    // Count the 2-bit indices of each value
+    const uint32_t lo = pBC->bitmap & 0x55555555;
+    const uint32_t hi = ( pBC->bitmap >> 1 ) & 0x55555555;
+
+    const float n1 = float( CountBits( lo & ~hi ) );
+    const float n2 = float( CountBits( hi & ~lo ) );
+    const float n3 = float( CountBits( lo & hi ) );
+    const float n0 = 16.f - n1 - n2 - n3;
+
+    float w0, w1;
+    if ( isbc1 && (pBC->rgb[0] <= pBC->rgb[1]) )
+    {
+        // Index 2 is the midpoint, index 3 is transparent black
+        w0 = n0 + n2 * 0.5f;
+        w1 = n1 + n2 * 0.5f;
+    }
+    else
+    {
+        w0 = n0 + ( n2 * 2.f + n3 ) * ( 1.f / 3.f );
+        w1 = n1 + ( n2 + n3 * 2.f ) * ( 1.f / 3.f );
+    }
+
+    return XMVectorAdd( XMVectorScale( clr0, w0 * ( 1.f / 16.f ) ), XMVectorScale( clr1, w1 * ( 1.f / 16.f ) ) );
+}
+
+
 //-------------------------------------------------------------------------------------
 
 static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
@@ -725,6 +774,15 @@ void D3DXDecodeBC1(XMVECTOR *pColor, const uint8_t *pBC)
     DecodeBC1( pColor, pBC1, true );
 }
 
+_Use_decl_annotations_
+void D3DXAverageBC1(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+
+    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
+    *pColor = AverageBC1( pBC1, true );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float alphaRef, DWORD flags)
 {
@@ -816,6 +874,26 @@ void D3DXDecodeBC2(XMVECTOR *pColor, const uint8_t *pBC)
         pColor[i] = XMVectorSetW( pColor[i], (float) (dw & 0xf) * (1.0f / 15.0f) );
 }
 
+_Use_decl_annotations_
+void D3DXAverageBC2(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    // Sum the 4-bit alpha values a byte lane at a time
+    uint32_t sum = 0;
+    for(size_t i = 0; i < 2; ++i)
+    {
+        uint32_t dw = pBC2->bitmap[i];
+        dw = ( dw & 0x0F0F0F0F ) + ( ( dw >> 4 ) & 0x0F0F0F0F );
+        sum += ( dw * 0x01010101 ) >> 24;
+    }
+
+    *pColor = XMVectorSetW( AverageBC1( &pBC2->bc1, false ), (float) sum * (1.0f / (15.0f * 16.0f)) );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -935,6 +1013,52 @@ void D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
         pColor[i] = XMVectorSetW( pColor[i], fAlpha[dw & 0x7] );
 }
 
+_Use_decl_annotations_
+void D3DXAverageBC3(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
+
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    // Histogram of the 3-bit alpha indices
+    size_t counts[8] = {};
+
+    DWORD dw = pBC3->bitmap[0] | (pBC3->bitmap[1] << 8) | (pBC3->bitmap[2] << 16);
+    for(size_t i = 0; i < 8; ++i, dw >>= 3)
+        ++counts[dw & 0x7];
+
+    dw = pBC3->bitmap[3] | (pBC3->bitmap[4] << 8) | (pBC3->bitmap[5] << 16);
+    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
+        ++counts[dw & 0x7];
+
+    // Adaptive 3-bit alpha part
+    float fAlpha[8];
+
+    fAlpha[0] = ((float) pBC3->alpha[0]) * (1.0f / 255.0f);
+    fAlpha[1] = ((float) pBC3->alpha[1]) * (1.0f / 255.0f);
+
+    if(pBC3->alpha[0] > pBC3->alpha[1]) 
+    {
+        for(size_t i = 1; i < 7; ++i)
+            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
+    }
+    else 
+    {
+        for(size_t i = 1; i < 5; ++i)
+            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
+
+        fAlpha[6] = 0.0f;
+        fAlpha[7] = 1.0f;
+    }
+
+    float fSum = 0.0f;
+    for(size_t i = 0; i < 8; ++i)
+        fSum += fAlpha[i] * (float) counts[i];
+
+    *pColor = XMVectorSetW( AverageBC1( &pBC3->bc1, false ), fSum * (1.0f / 16.0f) );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -13,13 +13,16 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#if defined(_MSC_VER) && (_MSC_VER > 1000)
 #pragma once
-#endif
 
 #include <assert.h>
+#if defined(_WIN32)
 #include <directxmath.h>
 #include <directxpackedvector.h>
+#else
+#include "Compat/DirectXMath.h"
+#include "Compat/DirectXPackedVector.h"
+#endif
 
 namespace DirectX
 {
@@ -31,6 +34,7 @@ namespace DirectX
 const uint16_t F16S_MASK    = 0x8000;   // f16 sign mask
 const uint16_t F16EM_MASK   = 0x7fff;   // f16 exp & mantissa mask
 const uint16_t F16MAX       = 0x7bff;   // MAXFLT bit pattern for XMHALF
+const uint16_t F16ONE       = 0x3c00;   // 1.0 bit pattern for XMHALF
 
 #define SIGN_EXTEND(x,nb) ((((x)&(1<<((nb)-1)))?((~0)<<(nb)):0)|(x))
 
@@ -521,6 +525,7 @@ class D3DX_BC6H : private CBits< 16 >
 {
 public:
     void Decode(_In_ bool bSigned, _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
+    void DecodeHalf(_In_ bool bSigned, _Out_writes_(NUM_PIXELS_PER_BLOCK) PackedVector::XMHALF4* pOut) const;
     void Encode(_In_ bool bSigned, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
 
 private:
@@ -874,7 +879,30 @@ void D3DXDecodeBC5U(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_rea
 void D3DXDecodeBC5S(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC6HUHalf(_Out_writes_(NUM_PIXELS_PER_BLOCK) PackedVector::XMHALF4 *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC6HSHalf(_Out_writes_(NUM_PIXELS_PER_BLOCK) PackedVector::XMHALF4 *pColor, _In_reads_(16) const uint8_t *pBC);
+    // BC6H straight to half texels, the values D3DXDecodeBC6HU/S convert to float
+
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC7LDR(_Out_writes_(NUM_PIXELS_PER_BLOCK) LDRColorA *pColor, _In_reads_(16) const uint8_t *pBC);
+    // Integer BC7 decode straight to 8-bit texels (same results as D3DXDecodeBC7)
+
+typedef void (*BC_DECODE_ROW)(uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height);
+
+BC_DECODE_ROW D3DXGetDecodeRow(_In_ DXGI_FORMAT bcFormat, _In_ DXGI_FORMAT destFormat);
+    // Integer decoder for one row of blocks straight into 8-bit texels (BC1 - BC5, BC7) or R16G16B16A16_FLOAT (BC6H),
+    // height <= 4; nullptr if destFormat needs the XMVECTOR path (any conversion other than RGBA/BGRA order)
+
+typedef void (*BC_AVERAGE)(XMVECTOR *pColor, const uint8_t *pBC);
+
+void D3DXAverageBC1(_Out_ XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC);
+void D3DXAverageBC2(_Out_ XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXAverageBC3(_Out_ XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXAverageBC4U(_Out_ XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC);
+void D3DXAverageBC4S(_Out_ XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC);
+void D3DXAverageBC5U(_Out_ XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXAverageBC5S(_Out_ XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
+    // Average color of a block from its endpoints and index histogram, without decoding each texel (BC6H/BC7 have no equivalent)
 
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ float alphaRef, _In_ DWORD flags);
     // BC1 requires one additional parameter, so it doesn't match signature of BC_ENCODE above
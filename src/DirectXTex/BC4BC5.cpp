@@ -13,7 +13,7 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
 #include "BC.h"
 
@@ -362,6 +362,27 @@ static void FindClosestSNORM(_Inout_ BC4_SNORM* pBC, _In_reads_(NUM_PIXELS_PER_B
 }
 
 
+//-------------------------------------------------------------------------------------
+// Average of the 16 decoded values, computed from the index histogram
+//-------------------------------------------------------------------------------------
+template <class BC4>
+static float AverageBC4( _In_ const BC4* pBC )
+{
+    size_t counts[8] = {};
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        ++counts[ pBC->GetIndex(i) ];
+
+    float fSum = 0.0f;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        if ( counts[i] )
+            fSum += pBC->DecodeFromIndex(i) * (float) counts[i];
+    }
+
+    return fSum * (1.0f / 16.0f);
+}
+
+
 //=====================================================================================
 // Entry points
 //=====================================================================================
@@ -399,6 +420,26 @@ void D3DXDecodeBC4S(XMVECTOR *pColor, const uint8_t *pBC)
     }       
 }
 
+_Use_decl_annotations_
+void D3DXAverageBC4U( XMVECTOR *pColor, const uint8_t *pBC )
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(BC4_UNORM) == 8, "BC4_UNORM should be 8 bytes" );
+
+    auto pBC4 = reinterpret_cast<const BC4_UNORM*>(pBC);
+    *pColor = XMVectorSet( AverageBC4( pBC4 ), 0, 0, 1.0f );
+}
+
+_Use_decl_annotations_
+void D3DXAverageBC4S( XMVECTOR *pColor, const uint8_t *pBC )
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(BC4_SNORM) == 8, "BC4_SNORM should be 8 bytes" );
+
+    auto pBC4 = reinterpret_cast<const BC4_SNORM*>(pBC);
+    *pColor = XMVectorSet( AverageBC4( pBC4 ), 0, 0, 1.0f );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC4U( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
 {
@@ -477,6 +518,30 @@ void D3DXDecodeBC5S(XMVECTOR *pColor, const uint8_t *pBC)
     }       
 }
 
+_Use_decl_annotations_
+void D3DXAverageBC5U(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(BC4_UNORM) == 8, "BC4_UNORM should be 8 bytes" );
+
+    auto pBCR = reinterpret_cast<const BC4_UNORM*>(pBC);
+    auto pBCG = reinterpret_cast<const BC4_UNORM*>(pBC+sizeof(BC4_UNORM));
+
+    *pColor = XMVectorSet( AverageBC4( pBCR ), AverageBC4( pBCG ), 0, 1.0f );
+}
+
+_Use_decl_annotations_
+void D3DXAverageBC5S(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(BC4_SNORM) == 8, "BC4_SNORM should be 8 bytes" );
+
+    auto pBCR = reinterpret_cast<const BC4_SNORM*>(pBC);
+    auto pBCG = reinterpret_cast<const BC4_SNORM*>(pBC+sizeof(BC4_SNORM));
+
+    *pColor = XMVectorSet( AverageBC4( pBCR ), AverageBC4( pBCG ), 0, 1.0f );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC5U( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
 {
@@ -13,7 +13,7 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
 #include "BC.h"
 
@@ -1070,6 +1070,20 @@ inline static void FillWithErrorColors( _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRCo
     }
 }
 
+inline static void FillWithErrorColors( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMHALF4* pOut )
+{
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+#ifdef _DEBUG
+        // Use Magenta in debug as a highly-visible error color
+        pOut[i] = XMHALF4( HALF(F16ONE), HALF(0), HALF(F16ONE), HALF(F16ONE) );
+#else
+        // In production use, default to black
+        pOut[i] = XMHALF4( HALF(0), HALF(0), HALF(0), HALF(F16ONE) );
+#endif
+    }
+}
+
 
 //-------------------------------------------------------------------------------------
 // BC6H Compression
@@ -1079,6 +1093,24 @@ void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
 {
     assert(pOut );
 
+    // The halves are the exact decoded values; float is only a wider container for them
+    XMHALF4 aF16[NUM_PIXELS_PER_BLOCK];
+    DecodeHalf(bSigned, aF16);
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        pOut[i].r = XMConvertHalfToFloat( aF16[i].x );
+        pOut[i].g = XMConvertHalfToFloat( aF16[i].y );
+        pOut[i].b = XMConvertHalfToFloat( aF16[i].z );
+        pOut[i].a = XMConvertHalfToFloat( aF16[i].w );
+    }
+}
+
+_Use_decl_annotations_
+void D3DX_BC6H::DecodeHalf(bool bSigned, XMHALF4* pOut) const
+{
+    assert(pOut );
+
     size_t uStartBit = 0;
     uint8_t uMode = GetBits(uStartBit, 2);
     if(uMode != 0x00 && uMode != 0x01)
@@ -1208,10 +1240,10 @@ void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
             HALF rgb[3];
             fc.ToF16(rgb, bSigned);
 
-            pOut[i].r = XMConvertHalfToFloat( rgb[0] );
-            pOut[i].g = XMConvertHalfToFloat( rgb[1] );
-            pOut[i].b = XMConvertHalfToFloat( rgb[2] );
-            pOut[i].a = 1.0f;
+            pOut[i].x = rgb[0];
+            pOut[i].y = rgb[1];
+            pOut[i].z = rgb[2];
+            pOut[i].w = F16ONE;
         }
     }
     else
@@ -1230,7 +1262,7 @@ void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
         // Per the BC6H format spec, we must return opaque black
         for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
         {
-            pOut[i] = HDRColorA(0.0f, 0.0f, 0.0f, 1.0f);
+            pOut[i] = XMHALF4( HALF(0), HALF(0), HALF(0), HALF(F16ONE) );
         }
     }
 }
@@ -2143,6 +2175,202 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
     }
 }
 
+//-------------------------------------------------------------------------------------
+// BC7 integer decoding
+//
+// Same results as D3DX_BC7::Decode, but each mode is a separate instantiation with its
+// field widths as constants, and texels stay 8-bit all the way through. Every mode uses
+// exactly 128 bits, so the overflow checks of the generic decoder are not needed.
+//-------------------------------------------------------------------------------------
+
+// Reads the block LSB first, as CBits::GetBits does. The block is copied into a padded
+// buffer so every field is a single unaligned 64-bit load, shift and mask.
+class BC7BitReader
+{
+public:
+    explicit BC7BitReader( _In_reads_(16) const uint8_t *pBC ) : m_uStartBit( 0 )
+    {
+        memcpy( m_uBits, pBC, 16 );
+        memset( m_uBits + 16, 0, sizeof(m_uBits) - 16 );
+    }
+
+    uint8_t GetBits( _In_range_(1, 8) size_t uNumBits )
+    {
+        assert( uNumBits > 0 && uNumBits <= 8 && m_uStartBit + uNumBits <= 128 );
+        uint64_t uWindow;
+        memcpy( &uWindow, m_uBits + ( m_uStartBit >> 3 ), sizeof(uint64_t) );
+        uint8_t ret = uint8_t( ( uWindow >> ( m_uStartBit & 7 ) ) & ( ( 1u << uNumBits ) - 1 ) );
+        m_uStartBit += uNumBits;
+        return ret;
+    }
+
+private:
+    uint8_t m_uBits[24];
+    size_t m_uStartBit;
+};
+
+template< size_t PREC > inline static const int* _BC7Weights()
+{
+    static_assert( PREC >= 2 && PREC <= 4, "BC7 index precision is 2, 3 or 4 bits" );
+    return ( PREC == 2 ) ? g_aWeights2 : ( PREC == 3 ) ? g_aWeights3 : g_aWeights4;
+}
+
+// Replicates the top bits of a PREC-bit component into the low bits
+template< size_t PREC > inline static uint8_t _BC7Unquantize( _In_ uint8_t comp )
+{
+    static_assert( PREC > 0 && PREC <= 8, "BC7 component precision is 1 to 8 bits" );
+    comp = uint8_t( comp << ( 8 - PREC ) );
+    return uint8_t( comp | ( comp >> PREC ) );
+}
+
+inline static uint8_t _BC7Interpolate( _In_ uint32_t c0, _In_ uint32_t c1, _In_ int w )
+{
+    return uint8_t( ( c0 * uint32_t( BC67_WEIGHT_MAX - w ) + c1 * uint32_t( w ) + BC67_WEIGHT_ROUND ) >> BC67_WEIGHT_SHIFT );
+}
+
+// Template arguments follow D3DX_BC7::ms_aInfo: COLOR_PREC and ALPHA_PREC are the precisions before the P-bit
+template< size_t MODE, size_t PARTITIONS, size_t PARTITION_BITS, size_t PBITS, size_t ROTATION_BITS, size_t INDEX_MODE_BITS,
+          size_t INDEX_PREC, size_t INDEX_PREC2, size_t COLOR_PREC, size_t ALPHA_PREC >
+static void _DecodeBC7Mode( _Out_writes_(NUM_PIXELS_PER_BLOCK) LDRColorA *pOut, _In_reads_(16) const uint8_t *pBC )
+{
+    static const size_t NUM_END_PTS = ( PARTITIONS + 1 ) << 1;
+
+    BC7BitReader bits( pBC );
+    bits.GetBits( MODE + 1 );
+
+    const size_t uShape = PARTITION_BITS ? bits.GetBits( PARTITION_BITS ) : 0;
+    const size_t uRotation = ROTATION_BITS ? bits.GetBits( ROTATION_BITS ) : 0;
+    const size_t uIndexMode = INDEX_MODE_BITS ? bits.GetBits( INDEX_MODE_BITS ) : 0;
+
+    uint8_t c[ NUM_END_PTS ][ BC7_NUM_CHANNELS ];
+    for( size_t ch = 0; ch < 3; ++ch )
+    {
+        for( size_t i = 0; i < NUM_END_PTS; ++i )
+            c[i][ch] = bits.GetBits( COLOR_PREC );
+    }
+    for( size_t i = 0; i < NUM_END_PTS; ++i )
+        c[i][3] = ALPHA_PREC ? bits.GetBits( ALPHA_PREC ) : 255;
+
+    if ( PBITS )
+    {
+        uint8_t P[ PBITS ? PBITS : 1 ];
+        for( size_t i = 0; i < PBITS; ++i )
+            P[i] = bits.GetBits( 1 );
+
+        for( size_t i = 0; i < NUM_END_PTS; ++i )
+        {
+            const uint8_t p = P[ i * PBITS / NUM_END_PTS ];
+            for( size_t ch = 0; ch < 3; ++ch )
+                c[i][ch] = uint8_t( ( c[i][ch] << 1 ) | p );
+            if ( ALPHA_PREC )
+                c[i][3] = uint8_t( ( c[i][3] << 1 ) | p );
+        }
+    }
+
+    for( size_t i = 0; i < NUM_END_PTS; ++i )
+    {
+        for( size_t ch = 0; ch < 3; ++ch )
+            c[i][ch] = _BC7Unquantize< COLOR_PREC + ( PBITS ? 1 : 0 ) >( c[i][ch] );
+        if ( ALPHA_PREC )
+            c[i][3] = _BC7Unquantize< ALPHA_PREC ? ALPHA_PREC + ( PBITS ? 1 : 0 ) : 8 >( c[i][3] );
+    }
+
+    // Color indices; the anchor texel of each subset is stored with one bit less
+    const size_t uFixUp1 = ( PARTITIONS > 0 ) ? g_aFixUp[PARTITIONS][uShape][1] : 0;
+    const size_t uFixUp2 = ( PARTITIONS > 1 ) ? g_aFixUp[PARTITIONS][uShape][2] : 0;
+
+    uint8_t w1[NUM_PIXELS_PER_BLOCK], w2[NUM_PIXELS_PER_BLOCK];
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+    {
+        const bool bFixUp = ( i == 0 ) || ( PARTITIONS > 0 && i == uFixUp1 ) || ( PARTITIONS > 1 && i == uFixUp2 );
+        w1[i] = bits.GetBits( bFixUp ? INDEX_PREC - 1 : INDEX_PREC );
+    }
+
+    // Separate alpha indices (modes 4 and 5)
+    if ( INDEX_PREC2 )
+    {
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+            w2[i] = bits.GetBits( i ? INDEX_PREC2 : INDEX_PREC2 - 1 );
+    }
+
+    // Palettes: one per subset, or (modes 4 and 5) one for color and one for alpha
+    static const size_t NUM_INDICES = size_t(1) << INDEX_PREC;
+    static const size_t NUM_INDICES2 = size_t(1) << ( INDEX_PREC2 ? INDEX_PREC2 : INDEX_PREC );
+
+    if ( !INDEX_PREC2 )
+    {
+        const int* aWeights = _BC7Weights< INDEX_PREC >();
+
+        LDRColorA aPalette[ PARTITIONS + 1 ][ NUM_INDICES ];
+        for( size_t p = 0; p <= PARTITIONS; ++p )
+        {
+            const uint8_t* c0 = c[ p << 1 ];
+            const uint8_t* c1 = c[ ( p << 1 ) + 1 ];
+            for( size_t w = 0; w < NUM_INDICES; ++w )
+            {
+                aPalette[p][w].r = _BC7Interpolate( c0[0], c1[0], aWeights[w] );
+                aPalette[p][w].g = _BC7Interpolate( c0[1], c1[1], aWeights[w] );
+                aPalette[p][w].b = _BC7Interpolate( c0[2], c1[2], aWeights[w] );
+                aPalette[p][w].a = ALPHA_PREC ? _BC7Interpolate( c0[3], c1[3], aWeights[w] ) : 255;
+            }
+        }
+
+        const uint8_t* aPartition = g_aPartitionTable[PARTITIONS][uShape];
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+            pOut[i] = aPalette[ aPartition[i] ][ w1[i] ];
+    }
+    else
+    {
+        // Index mode 1 swaps which index set drives color and which drives alpha
+        const int* aColorWeights = uIndexMode ? _BC7Weights< INDEX_PREC2 ? INDEX_PREC2 : INDEX_PREC >() : _BC7Weights< INDEX_PREC >();
+        const int* aAlphaWeights = uIndexMode ? _BC7Weights< INDEX_PREC >() : _BC7Weights< INDEX_PREC2 ? INDEX_PREC2 : INDEX_PREC >();
+        const size_t uColorIndices = uIndexMode ? NUM_INDICES2 : NUM_INDICES;
+        const size_t uAlphaIndices = uIndexMode ? NUM_INDICES : NUM_INDICES2;
+
+        LDRColorA aColors[ NUM_INDICES > NUM_INDICES2 ? NUM_INDICES : NUM_INDICES2 ];
+        uint8_t aAlphas[ NUM_INDICES > NUM_INDICES2 ? NUM_INDICES : NUM_INDICES2 ];
+        for( size_t w = 0; w < uColorIndices; ++w )
+        {
+            aColors[w].r = _BC7Interpolate( c[0][0], c[1][0], aColorWeights[w] );
+            aColors[w].g = _BC7Interpolate( c[0][1], c[1][1], aColorWeights[w] );
+            aColors[w].b = _BC7Interpolate( c[0][2], c[1][2], aColorWeights[w] );
+        }
+        for( size_t w = 0; w < uAlphaIndices; ++w )
+            aAlphas[w] = _BC7Interpolate( c[0][3], c[1][3], aAlphaWeights[w] );
+
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+        {
+            LDRColorA outPixel = aColors[ uIndexMode ? w2[i] : w1[i] ];
+            outPixel.a = aAlphas[ uIndexMode ? w1[i] : w2[i] ];
+
+            switch( uRotation )
+            {
+            case 1: std::swap( outPixel.r, outPixel.a ); break;
+            case 2: std::swap( outPixel.g, outPixel.a ); break;
+            case 3: std::swap( outPixel.b, outPixel.a ); break;
+            }
+
+            pOut[i] = outPixel;
+        }
+    }
+}
+
+typedef void (*BC7_DECODE_MODE)( LDRColorA *pOut, const uint8_t *pBC );
+
+static const BC7_DECODE_MODE g_aBC7DecodeMode[] =
+{
+    //                MODE  P  PB PBITS ROT IM  IP IP2 RGB A
+    _DecodeBC7Mode<   0,    2, 4, 6,    0,  0,  3, 0,  4,  0 >,
+    _DecodeBC7Mode<   1,    1, 6, 2,    0,  0,  3, 0,  6,  0 >,
+    _DecodeBC7Mode<   2,    2, 6, 0,    0,  0,  2, 0,  5,  0 >,
+    _DecodeBC7Mode<   3,    1, 6, 4,    0,  0,  2, 0,  7,  0 >,
+    _DecodeBC7Mode<   4,    0, 0, 0,    2,  1,  2, 3,  5,  6 >,
+    _DecodeBC7Mode<   5,    0, 0, 0,    2,  0,  2, 2,  7,  8 >,
+    _DecodeBC7Mode<   6,    0, 0, 2,    0,  0,  4, 0,  7,  7 >,
+    _DecodeBC7Mode<   7,    1, 6, 4,    0,  0,  2, 0,  5,  5 >,
+};
+
+
 _Use_decl_annotations_
 void D3DX_BC7::Encode(const HDRColorA* const pIn)
 {
@@ -2829,6 +3057,22 @@ void D3DXDecodeBC6HS(XMVECTOR *pColor, const uint8_t *pBC)
     reinterpret_cast< const D3DX_BC6H* >( pBC )->Decode(true, reinterpret_cast<HDRColorA*>(pColor));
 }
 
+_Use_decl_annotations_
+void D3DXDecodeBC6HUHalf(XMHALF4 *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC6H) == 16, "D3DX_BC6H should be 16 bytes" );
+    reinterpret_cast< const D3DX_BC6H* >( pBC )->DecodeHalf(false, pColor);
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC6HSHalf(XMHALF4 *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC6H) == 16, "D3DX_BC6H should be 16 bytes" );
+    reinterpret_cast< const D3DX_BC6H* >( pBC )->DecodeHalf(true, pColor);
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC6HU(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -2856,7 +3100,38 @@ void D3DXDecodeBC7(XMVECTOR *pColor, const uint8_t *pBC)
 {
     assert( pColor && pBC );
     static_assert( sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes" );
-    reinterpret_cast< const D3DX_BC7* >( pBC )->Decode(reinterpret_cast<HDRColorA*>(pColor));
+
+    // The integer decoder gives the same texels as D3DX_BC7::Decode
+    LDRColorA temp[NUM_PIXELS_PER_BLOCK];
+    D3DXDecodeBC7LDR( temp, pBC );
+
+    HDRColorA* pOut = reinterpret_cast<HDRColorA*>(pColor);
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+        pOut[i] = HDRColorA( temp[i] );
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC7LDR(LDRColorA *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+
+    // The mode is the position of the lowest set bit of the first byte
+    const uint8_t uFirst = pBC[0];
+    if ( !uFirst )
+    {
+#ifdef _DEBUG
+        OutputDebugStringA( "BC7: Reserved mode 8 encountered during decoding\n" );
+#endif
+        // Per the BC7 format spec, we must return transparent black
+        memset( pColor, 0, sizeof(LDRColorA) * NUM_PIXELS_PER_BLOCK );
+        return;
+    }
+
+    size_t uMode = 0;
+    while( !( uFirst & ( 1 << uMode ) ) )
+        ++uMode;
+
+    g_aBC7DecodeMode[ uMode ]( pColor, pBC );
 }
 
 _Use_decl_annotations_
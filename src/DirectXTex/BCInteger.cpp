@@ -0,0 +1,631 @@
+//-------------------------------------------------------------------------------------
+// BCInteger.cpp
+//
+// Integer decoders for BC1 - BC5 and BC7 that write 8-bit texels directly, and for
+// BC6H that write half texels, one row of blocks per call, without going through
+// XMVECTOR / _ConvertScanline
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#include "BC.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define BC_INTEGER_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#else
+#define BC_INTEGER_X86 0
+#endif
+
+#if defined(_MSC_VER) || !BC_INTEGER_X86
+#define BC_TARGET_AVX2
+#else
+#define BC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace DirectX
+{
+
+//-------------------------------------------------------------------------------------
+// Tables
+//
+// Every palette entry is computed with the same float expression the XMVECTOR decoder
+// uses and quantized with the same store _StoreScanline uses for the destination, so the
+// integer rows are bit-identical to Decompress through the float pipeline (integer
+// rounding disagrees on halves, which XMStore*N round to even, and R8 stores truncate).
+//-------------------------------------------------------------------------------------
+
+// XMStoreUByteN4 of v, the store for R8G8B8A8 / B8G8R8A8 destinations
+inline static PackedVector::XMUBYTEN4 _QuantizeUNorm8( _In_ FXMVECTOR v )
+{
+    PackedVector::XMUBYTEN4 q;
+    PackedVector::XMStoreUByteN4( &q, v );
+    return q;
+}
+
+// UNORM8 value of every 5:6:5 endpoint and interpolant as DecodeBC1 computes it
+// (lane x is a 5-bit channel, lane y a 6-bit one), and of every BC2 alpha
+struct BCColorTables
+{
+    uint8_t expand4[16];        // BC2 alpha
+    uint8_t expand5[32];
+    uint8_t expand6[64];
+    uint8_t third5[32][32];     // lerp( a, b, 1/3 )
+    uint8_t third6[64][64];
+    uint8_t twoThirds5[32][32]; // lerp( a, b, 2/3 )
+    uint8_t twoThirds6[64][64];
+    uint8_t half5[32][32];      // lerp( a, b, 1/2 ), BC1 3-color blocks
+    uint8_t half6[64][64];
+
+    BCColorTables()
+    {
+        // As DecodeBC1Endpoints scales XMLoadU565
+        static const XMVECTORF32 s_Scale = { 1.f/31.f, 1.f/63.f, 1.f/31.f, 1.f };
+
+        for( uint32_t a = 0; a < 64; ++a )
+        {
+            const XMVECTOR c0 = XMVectorMultiply( XMVectorReplicate( static_cast<float>( a ) ), s_Scale );
+
+            PackedVector::XMUBYTEN4 q = _QuantizeUNorm8( c0 );
+            expand6[a] = q.y;
+            if ( a < 32 )
+                expand5[a] = q.x;
+
+            for( uint32_t b = 0; b < 64; ++b )
+            {
+                const XMVECTOR c1 = XMVectorMultiply( XMVectorReplicate( static_cast<float>( b ) ), s_Scale );
+                const bool both5 = ( a < 32 ) && ( b < 32 );
+
+                q = _QuantizeUNorm8( XMVectorLerp( c0, c1, 1.f/3.f ) );
+                third6[a][b] = q.y;
+                if ( both5 )
+                    third5[a][b] = q.x;
+
+                q = _QuantizeUNorm8( XMVectorLerp( c0, c1, 2.f/3.f ) );
+                twoThirds6[a][b] = q.y;
+                if ( both5 )
+                    twoThirds5[a][b] = q.x;
+
+                q = _QuantizeUNorm8( XMVectorLerp( c0, c1, 0.5f ) );
+                half6[a][b] = q.y;
+                if ( both5 )
+                    half5[a][b] = q.x;
+            }
+        }
+
+        // As D3DXDecodeBC2 scales the 4-bit alpha
+        for( uint32_t a = 0; a < 16; ++a )
+            expand4[a] = _QuantizeUNorm8( XMVectorReplicate( static_cast<float>( a ) * ( 1.0f / 15.0f ) ) ).x;
+    }
+};
+
+static const BCColorTables s_colorTables;
+
+
+//-------------------------------------------------------------------------------------
+// Palettes
+//-------------------------------------------------------------------------------------
+inline static uint32_t _PackTexel( _In_ uint32_t r, _In_ uint32_t g, _In_ uint32_t b, _In_ uint32_t a, _In_ bool bgra )
+{
+    return bgra ? ( b | ( g << 8 ) | ( r << 16 ) | ( a << 24 ) )
+                : ( r | ( g << 8 ) | ( b << 16 ) | ( a << 24 ) );
+}
+
+// Four texels in destination byte order
+static void _BuildColorPalette( _In_ const D3DX_BC1 *pBC, _In_ bool isbc1, _In_ bool bgra, _Out_writes_(4) uint32_t pal[4] )
+{
+    const BCColorTables& t = s_colorTables;
+
+    const uint32_t r0 = pBC->rgb[0] >> 11, g0 = ( pBC->rgb[0] >> 5 ) & 63, b0 = pBC->rgb[0] & 31;
+    const uint32_t r1 = pBC->rgb[1] >> 11, g1 = ( pBC->rgb[1] >> 5 ) & 63, b1 = pBC->rgb[1] & 31;
+
+    pal[0] = _PackTexel( t.expand5[r0], t.expand6[g0], t.expand5[b0], 255, bgra );
+    pal[1] = _PackTexel( t.expand5[r1], t.expand6[g1], t.expand5[b1], 255, bgra );
+
+    if ( isbc1 && ( pBC->rgb[0] <= pBC->rgb[1] ) )
+    {
+        pal[2] = _PackTexel( t.half5[r0][r1], t.half6[g0][g1], t.half5[b0][b1], 255, bgra );
+        pal[3] = 0;     // Transparent black
+    }
+    else
+    {
+        pal[2] = _PackTexel( t.third5[r0][r1], t.third6[g0][g1], t.third5[b0][b1], 255, bgra );
+        pal[3] = _PackTexel( t.twoThirds5[r0][r1], t.twoThirds6[g0][g1], t.twoThirds5[b0][b1], 255, bgra );
+    }
+}
+
+// BC3 alpha, as D3DXDecodeBC3 computes it, stored by XMStoreUByteN4
+static void _BuildAlphaPalette( _In_ uint8_t e0, _In_ uint8_t e1, _Out_writes_(8) uint8_t pal[8] )
+{
+    XMFLOAT4 f[2];
+    float* fAlpha = &f[0].x;
+
+    fAlpha[0] = ((float) e0) * (1.0f / 255.0f);
+    fAlpha[1] = ((float) e1) * (1.0f / 255.0f);
+
+    if ( e0 > e1 )
+    {
+        for( size_t i = 1; i < 7; ++i )
+            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
+    }
+    else
+    {
+        for( size_t i = 1; i < 5; ++i )
+            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
+
+        fAlpha[6] = 0.0f;
+        fAlpha[7] = 1.0f;
+    }
+
+    const PackedVector::XMUBYTEN4 lo = _QuantizeUNorm8( XMLoadFloat4( &f[0] ) );
+    const PackedVector::XMUBYTEN4 hi = _QuantizeUNorm8( XMLoadFloat4( &f[1] ) );
+    pal[0] = lo.x; pal[1] = lo.y; pal[2] = lo.z; pal[3] = lo.w;
+    pal[4] = hi.x; pal[5] = hi.y; pal[6] = hi.z; pal[7] = hi.w;
+}
+
+// BC4 / BC5 channel values, as BC4_UNORM / BC4_SNORM::DecodeFromIndex compute them
+template<bool SNORM> static void _DecodeRedPalette( _In_reads_(2) const uint8_t *pBlock, _Out_writes_(8) float fRed[8] )
+{
+    float fred_0, fred_1;
+    bool sixValues;
+    if ( SNORM )
+    {
+        const int8_t red_0 = static_cast<int8_t>( pBlock[0] );
+        const int8_t red_1 = static_cast<int8_t>( pBlock[1] );
+        const int8_t sred_0 = ( red_0 == -128 ) ? -127 : red_0;
+        const int8_t sred_1 = ( red_1 == -128 ) ? -127 : red_1;
+        fred_0 = sred_0 / 127.0f;
+        fred_1 = sred_1 / 127.0f;
+        sixValues = ( red_0 > red_1 );
+    }
+    else
+    {
+        fred_0 = pBlock[0] / 255.0f;
+        fred_1 = pBlock[1] / 255.0f;
+        sixValues = ( pBlock[0] > pBlock[1] );
+    }
+
+    fRed[0] = fred_0;
+    fRed[1] = fred_1;
+    if ( sixValues )
+    {
+        for( size_t uIndex = 1; uIndex < 7; ++uIndex )
+            fRed[uIndex + 1] = (fred_0 * (7-uIndex) + fred_1 * uIndex) / 7.0f;
+    }
+    else
+    {
+        for( size_t uIndex = 1; uIndex < 5; ++uIndex )
+            fRed[uIndex + 1] = (fred_0 * (5-uIndex) + fred_1 * uIndex) / 5.0f;
+        fRed[6] = SNORM ? -1.0f : 0.0f;
+        fRed[7] = 1.0f;
+    }
+}
+
+// BC4 / BC5 palette stored as _StoreScanline stores the destination: R8_UNORM and
+// R8_SNORM truncate, R8G8_UNORM (XMStoreUByteN2) and R8G8_SNORM (XMStoreByteN2) round
+template<bool SNORM, size_t CHANNELS> static void _BuildRedPalette( _In_reads_(2) const uint8_t *pBlock, _Out_writes_(8) uint8_t pal[8] )
+{
+    float fRed[8];
+    _DecodeRedPalette<SNORM>( pBlock, fRed );
+
+    if ( CHANNELS == 1 )
+    {
+        for( size_t i = 0; i < 8; ++i )
+        {
+            float v = fRed[i];
+            if ( SNORM )
+            {
+                v = std::max<float>( std::min<float>( v, 1.f ), -1.f );
+                pal[i] = static_cast<uint8_t>( static_cast<int8_t>( v * 127.f ) );
+            }
+            else
+            {
+                v = std::max<float>( std::min<float>( v, 1.f ), 0.f );
+                pal[i] = static_cast<uint8_t>( v * 255.f );
+            }
+        }
+    }
+    else
+    {
+        for( size_t i = 0; i < 8; i += 2 )
+        {
+            const XMVECTOR v = XMVectorSet( fRed[i], fRed[i + 1], 0.f, 0.f );
+            if ( SNORM )
+            {
+                PackedVector::XMBYTEN2 q;
+                PackedVector::XMStoreByteN2( &q, v );
+                pal[i] = static_cast<uint8_t>( q.x );
+                pal[i + 1] = static_cast<uint8_t>( q.y );
+            }
+            else
+            {
+                PackedVector::XMUBYTEN2 q;
+                PackedVector::XMStoreUByteN2( &q, v );
+                pal[i] = q.x;
+                pal[i + 1] = q.y;
+            }
+        }
+    }
+}
+
+// 16 3-bit indices of a BC3 alpha / BC4 block
+inline static uint64_t _Indices48( _In_reads_(6) const uint8_t *p )
+{
+    return uint64_t(p[0]) | ( uint64_t(p[1]) << 8 ) | ( uint64_t(p[2]) << 16 )
+         | ( uint64_t(p[3]) << 24 ) | ( uint64_t(p[4]) << 32 ) | ( uint64_t(p[5]) << 40 );
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC1 - BC3 to RGBA8 / BGRA8
+//-------------------------------------------------------------------------------------
+
+// BC is 1, 2 or 3
+template<int BC> inline static const D3DX_BC1* _ColorBlock( _In_ const uint8_t *pBlock )
+{
+    return reinterpret_cast<const D3DX_BC1*>( ( BC == 1 ) ? pBlock : pBlock + 8 );
+}
+
+template<int BC> inline static size_t _BlockSize()
+{
+    return ( BC == 1 ) ? 8 : 16;
+}
+
+// Alpha byte of each texel, already in bits 24..31 (BC2 / BC3 only)
+template<int BC> static void _DecodeAlpha( _In_ const uint8_t *pBlock, _Out_writes_(NUM_PIXELS_PER_BLOCK) uint32_t alpha[NUM_PIXELS_PER_BLOCK] )
+{
+    if ( BC == 2 )
+    {
+        auto pBC2 = reinterpret_cast<const D3DX_BC2*>( pBlock );
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+        {
+            uint32_t a4 = ( pBC2->bitmap[i >> 3] >> ( 4 * ( i & 7 ) ) ) & 0xF;
+            alpha[i] = uint32_t( s_colorTables.expand4[a4] ) << 24;
+        }
+    }
+    else
+    {
+        auto pBC3 = reinterpret_cast<const D3DX_BC3*>( pBlock );
+        uint8_t pal[8];
+        _BuildAlphaPalette( pBC3->alpha[0], pBC3->alpha[1], pal );
+
+        uint64_t bits = _Indices48( pBC3->bitmap );
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, bits >>= 3 )
+            alpha[i] = uint32_t( pal[bits & 7] ) << 24;
+    }
+}
+
+// All 16 texels of one block; used for the scalar path and partial edge blocks
+template<int BC, bool BGRA> static void _DecodeColorBlock( _In_ const uint8_t *pBlock, _Out_writes_(NUM_PIXELS_PER_BLOCK) uint32_t texels[NUM_PIXELS_PER_BLOCK] )
+{
+    const D3DX_BC1 *pBC1 = _ColorBlock<BC>( pBlock );
+
+    uint32_t pal[4];
+    _BuildColorPalette( pBC1, BC == 1, BGRA, pal );
+
+    uint32_t bits = pBC1->bitmap;
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, bits >>= 2 )
+        texels[i] = pal[bits & 3];
+
+    if ( BC != 1 )
+    {
+        uint32_t alpha[NUM_PIXELS_PER_BLOCK];
+        _DecodeAlpha<BC>( pBlock, alpha );
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+            texels[i] = ( texels[i] & 0x00FFFFFF ) | alpha[i];
+    }
+}
+
+template<int BC, bool BGRA> static void _StoreColorBlock( _In_ const uint8_t *pBlock, _Out_ uint8_t *pDest, _In_ size_t rowPitch, _In_ size_t pw, _In_ size_t ph )
+{
+    uint32_t texels[NUM_PIXELS_PER_BLOCK];
+    _DecodeColorBlock<BC, BGRA>( pBlock, texels );
+
+    for( size_t y = 0; y < ph; ++y )
+        memcpy( pDest + y * rowPitch, &texels[y * 4], pw * sizeof(uint32_t) );
+}
+
+template<int BC, bool BGRA> static void _DecodeColorRow( uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height )
+{
+    for( size_t x = 0; x < width; x += 4, pBC += _BlockSize<BC>() )
+    {
+        _StoreColorBlock<BC, BGRA>( pBC, pDest + x * 4, rowPitch, std::min<size_t>( 4, width - x ), height );
+    }
+}
+
+#if BC_INTEGER_X86
+
+// One full-width block: index expansion with compare / select on four texels at a time
+template<int BC, bool BGRA> static void _DecodeColorBlock_SSE2( _In_ const uint8_t *pBlock, _Out_ uint8_t *pDest, _In_ size_t rowPitch, _In_ size_t height )
+{
+    const D3DX_BC1 *pBC1 = _ColorBlock<BC>( pBlock );
+
+    uint32_t pal[4];
+    _BuildColorPalette( pBC1, BC == 1, BGRA, pal );
+
+    const __m128i palette = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pal ) );
+    const __m128i p0 = _mm_shuffle_epi32( palette, 0x00 );
+    const __m128i p1 = _mm_shuffle_epi32( palette, 0x55 );
+    const __m128i p2 = _mm_shuffle_epi32( palette, 0xAA );
+    const __m128i p3 = _mm_shuffle_epi32( palette, 0xFF );
+
+    // Texel i of a row holds its index in bits 2i..2i+1
+    const __m128i index3 = _mm_setr_epi32( 3, 3 << 2, 3 << 4, 3 << 6 );
+    const __m128i index2 = _mm_setr_epi32( 2, 2 << 2, 2 << 4, 2 << 6 );
+    const __m128i index1 = _mm_setr_epi32( 1, 1 << 2, 1 << 4, 1 << 6 );
+    const __m128i zero   = _mm_setzero_si128();
+
+    uint32_t alpha[NUM_PIXELS_PER_BLOCK];
+    if ( BC != 1 )
+        _DecodeAlpha<BC>( pBlock, alpha );
+    const __m128i rgbMask = _mm_set1_epi32( 0x00FFFFFF );
+
+    uint32_t bits = pBC1->bitmap;
+    for( size_t y = 0; y < height; ++y, bits >>= 8 )
+    {
+        const __m128i idx = _mm_and_si128( _mm_set1_epi32( static_cast<int>( bits ) ), index3 );
+
+        __m128i c = _mm_or_si128(
+            _mm_or_si128( _mm_and_si128( _mm_cmpeq_epi32( idx, zero ),   p0 ), _mm_and_si128( _mm_cmpeq_epi32( idx, index1 ), p1 ) ),
+            _mm_or_si128( _mm_and_si128( _mm_cmpeq_epi32( idx, index2 ), p2 ), _mm_and_si128( _mm_cmpeq_epi32( idx, index3 ), p3 ) ) );
+
+        if ( BC != 1 )
+            c = _mm_or_si128( _mm_and_si128( c, rgbMask ), _mm_loadu_si128( reinterpret_cast<const __m128i*>( &alpha[y * 4] ) ) );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + y * rowPitch ), c );
+    }
+}
+
+template<int BC, bool BGRA> static void _DecodeColorRow_SSE2( uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height )
+{
+    size_t x = 0;
+    for( ; x + 4 <= width; x += 4, pBC += _BlockSize<BC>() )
+        _DecodeColorBlock_SSE2<BC, BGRA>( pBC, pDest + x * 4, rowPitch, height );
+
+    if ( x < width )
+        _StoreColorBlock<BC, BGRA>( pBC, pDest + x * 4, rowPitch, width - x, height );
+}
+
+// Two adjacent blocks per iteration: each 128-bit lane holds one block's palette
+// and PSHUFB looks the texels up, so a destination row gets 32 bytes per store
+template<int BC, bool BGRA> BC_TARGET_AVX2 static void _DecodeColorRow_AVX2( uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height )
+{
+    const __m256i shifts    = _mm256_setr_epi32( 0, 2, 4, 6, 0, 2, 4, 6 );
+    const __m256i three     = _mm256_set1_epi32( 3 );
+    const __m256i broadcast = _mm256_setr_epi8( 0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+                                                0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12 );
+    const __m256i bytes     = _mm256_set1_epi32( 0x03020100 );
+    const __m256i rgbMask   = _mm256_set1_epi32( 0x00FFFFFF );
+
+    size_t x = 0;
+    for( ; x + 8 <= width; x += 8, pBC += 2 * _BlockSize<BC>() )
+    {
+        const uint8_t *pBlockA = pBC;
+        const uint8_t *pBlockB = pBC + _BlockSize<BC>();
+
+        uint32_t palA[4], palB[4];
+        _BuildColorPalette( _ColorBlock<BC>( pBlockA ), BC == 1, BGRA, palA );
+        _BuildColorPalette( _ColorBlock<BC>( pBlockB ), BC == 1, BGRA, palB );
+        const __m256i palette = _mm256_inserti128_si256(
+            _mm256_castsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( palA ) ) ),
+            _mm_loadu_si128( reinterpret_cast<const __m128i*>( palB ) ), 1 );
+
+        uint32_t alphaA[NUM_PIXELS_PER_BLOCK], alphaB[NUM_PIXELS_PER_BLOCK];
+        if ( BC != 1 )
+        {
+            _DecodeAlpha<BC>( pBlockA, alphaA );
+            _DecodeAlpha<BC>( pBlockB, alphaB );
+        }
+
+        uint32_t bitsA = _ColorBlock<BC>( pBlockA )->bitmap;
+        uint32_t bitsB = _ColorBlock<BC>( pBlockB )->bitmap;
+        for( size_t y = 0; y < height; ++y, bitsA >>= 8, bitsB >>= 8 )
+        {
+            __m256i idx = _mm256_inserti128_si256(
+                _mm256_castsi128_si256( _mm_set1_epi32( static_cast<int>( bitsA ) ) ),
+                _mm_set1_epi32( static_cast<int>( bitsB ) ), 1 );
+            idx = _mm256_and_si256( _mm256_srlv_epi32( idx, shifts ), three );
+
+            // Byte offsets of palette entry idx: 4*idx + { 0, 1, 2, 3 }
+            const __m256i control = _mm256_add_epi8( _mm256_shuffle_epi8( _mm256_slli_epi32( idx, 2 ), broadcast ), bytes );
+            __m256i c = _mm256_shuffle_epi8( palette, control );
+
+            if ( BC != 1 )
+            {
+                const __m256i alpha = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &alphaA[y * 4] ) ) ),
+                    _mm_loadu_si128( reinterpret_cast<const __m128i*>( &alphaB[y * 4] ) ), 1 );
+                c = _mm256_or_si256( _mm256_and_si256( c, rgbMask ), alpha );
+            }
+
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + y * rowPitch + x * 4 ), c );
+        }
+    }
+
+    _DecodeColorRow_SSE2<BC, BGRA>( pDest + x * 4, rowPitch, pBC, width - x, height );
+}
+
+#endif // BC_INTEGER_X86
+
+
+//-------------------------------------------------------------------------------------
+// BC4 / BC5 to R8 / R8G8 (UNORM or SNORM)
+//-------------------------------------------------------------------------------------
+template<bool SNORM, size_t CHANNELS> static void _DecodeRedRow( uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height )
+{
+    for( size_t x = 0; x < width; x += 4, pBC += 8 * CHANNELS )
+    {
+        const size_t pw = std::min<size_t>( 4, width - x );
+
+        for( size_t c = 0; c < CHANNELS; ++c )
+        {
+            const uint8_t *pBlock = pBC + 8 * c;
+
+            uint8_t pal[8];
+            _BuildRedPalette<SNORM, CHANNELS>( pBlock, pal );
+
+            const uint64_t bits = _Indices48( pBlock + 2 );
+            for( size_t y = 0; y < height; ++y )
+            {
+                uint8_t *pRow = pDest + y * rowPitch + x * CHANNELS + c;
+                for( size_t i = 0; i < pw; ++i )
+                    pRow[i * CHANNELS] = pal[( bits >> ( 3 * ( y * 4 + i ) ) ) & 7];
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC7 to RGBA8 / BGRA8
+//-------------------------------------------------------------------------------------
+template<bool BGRA> static void _DecodeBC7Row( uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height )
+{
+    for( size_t x = 0; x < width; x += 4, pBC += 16 )
+    {
+        LDRColorA texels[NUM_PIXELS_PER_BLOCK];
+        D3DXDecodeBC7LDR( texels, pBC );
+
+        if ( BGRA )
+        {
+            for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+                std::swap( texels[i].r, texels[i].b );
+        }
+
+        const size_t pw = std::min<size_t>( 4, width - x );
+        for( size_t y = 0; y < height; ++y )
+            memcpy( pDest + y * rowPitch + x * 4, &texels[y * 4], pw * sizeof(LDRColorA) );
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC6H to R16G16B16A16_FLOAT
+//-------------------------------------------------------------------------------------
+template<bool SIGNED> static void _DecodeBC6HRow( uint8_t *pDest, size_t rowPitch, const uint8_t *pBC, size_t width, size_t height )
+{
+    for( size_t x = 0; x < width; x += 4, pBC += 16 )
+    {
+        PackedVector::XMHALF4 texels[NUM_PIXELS_PER_BLOCK];
+        if ( SIGNED )
+            D3DXDecodeBC6HSHalf( texels, pBC );
+        else
+            D3DXDecodeBC6HUHalf( texels, pBC );
+
+        const size_t pw = std::min<size_t>( 4, width - x );
+        for( size_t y = 0; y < height; ++y )
+            memcpy( pDest + y * rowPitch + x * 8, &texels[y * 4], pw * sizeof(PackedVector::XMHALF4) );
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+BC_DECODE_ROW D3DXGetDecodeRow( DXGI_FORMAT bcFormat, DXGI_FORMAT destFormat )
+{
+    // sRGB-ness must match: the texels are copied, not converted
+    switch( bcFormat )
+    {
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+        return ( destFormat == DXGI_FORMAT_R8_UNORM ) ? _DecodeRedRow<false, 1> : nullptr;
+
+    case DXGI_FORMAT_BC4_SNORM:
+        return ( destFormat == DXGI_FORMAT_R8_SNORM ) ? _DecodeRedRow<true, 1> : nullptr;
+
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+        return ( destFormat == DXGI_FORMAT_R8G8_UNORM ) ? _DecodeRedRow<false, 2> : nullptr;
+
+    case DXGI_FORMAT_BC5_SNORM:
+        return ( destFormat == DXGI_FORMAT_R8G8_SNORM ) ? _DecodeRedRow<true, 2> : nullptr;
+
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+        return ( destFormat == DXGI_FORMAT_R16G16B16A16_FLOAT ) ? _DecodeBC6HRow<false> : nullptr;
+
+    case DXGI_FORMAT_BC6H_SF16:
+        return ( destFormat == DXGI_FORMAT_R16G16B16A16_FLOAT ) ? _DecodeBC6HRow<true> : nullptr;
+
+    default:
+        break;
+    }
+
+    int bc;
+    bool srgb = false;
+    switch( bcFormat )
+    {
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:         bc = 7; break;
+    case DXGI_FORMAT_BC7_UNORM_SRGB:    bc = 7; srgb = true; break;
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:         bc = 1; break;
+    case DXGI_FORMAT_BC1_UNORM_SRGB:    bc = 1; srgb = true; break;
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:         bc = 2; break;
+    case DXGI_FORMAT_BC2_UNORM_SRGB:    bc = 2; srgb = true; break;
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:         bc = 3; break;
+    case DXGI_FORMAT_BC3_UNORM_SRGB:    bc = 3; srgb = true; break;
+    default:
+        return nullptr;
+    }
+
+    bool bgra;
+    switch( destFormat )
+    {
+    case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+    case DXGI_FORMAT_R8G8B8A8_UNORM:        if ( srgb ) return nullptr; bgra = false; break;
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:   if ( !srgb ) return nullptr; bgra = false; break;
+    case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8A8_UNORM:        if ( srgb ) return nullptr; bgra = true; break;
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:   if ( !srgb ) return nullptr; bgra = true; break;
+    default:
+        return nullptr;
+    }
+
+    if ( bc == 7 )
+        return bgra ? _DecodeBC7Row<true> : _DecodeBC7Row<false>;
+
+    static const BC_DECODE_ROW s_scalar[3][2] =
+    {
+        { _DecodeColorRow<1, false>, _DecodeColorRow<1, true> },
+        { _DecodeColorRow<2, false>, _DecodeColorRow<2, true> },
+        { _DecodeColorRow<3, false>, _DecodeColorRow<3, true> },
+    };
+#if BC_INTEGER_X86
+    static const BC_DECODE_ROW s_sse2[3][2] =
+    {
+        { _DecodeColorRow_SSE2<1, false>, _DecodeColorRow_SSE2<1, true> },
+        { _DecodeColorRow_SSE2<2, false>, _DecodeColorRow_SSE2<2, true> },
+        { _DecodeColorRow_SSE2<3, false>, _DecodeColorRow_SSE2<3, true> },
+    };
+    static const BC_DECODE_ROW s_avx2[3][2] =
+    {
+        { _DecodeColorRow_AVX2<1, false>, _DecodeColorRow_AVX2<1, true> },
+        { _DecodeColorRow_AVX2<2, false>, _DecodeColorRow_AVX2<2, true> },
+        { _DecodeColorRow_AVX2<3, false>, _DecodeColorRow_AVX2<3, true> },
+    };
+
+    const DWORD cpu = _GetCPUFeatures();
+    if ( cpu & CPU_FEATURE_AVX2 )
+        return s_avx2[bc - 1][bgra];
+    if ( cpu & CPU_FEATURE_SSE2 )
+        return s_sse2[bc - 1][bgra];
+#endif
+    return s_scalar[bc - 1][bgra];
+}
+
+}; // namespace
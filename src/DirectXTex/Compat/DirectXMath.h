@@ -0,0 +1,553 @@
+//-------------------------------------------------------------------------------------
+// DirectXMath.h
+//
+// DirectX Texture Library - DirectXMath subset for non-Windows builds
+//
+// Only the functions the library uses, written with SSE2 intrinsics the way the SSE
+// code paths of DirectXMath are, so conversions round the same way as on Windows.
+// XMVECTOR is __m128; GCC and Clang supply its arithmetic operators.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#if !defined(__i386__) && !defined(__x86_64__)
+#error The DirectXMath subset requires SSE2 (x86 or x64)
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+#define DIRECTX_MATH_VERSION 306
+
+#define XM_CALLCONV
+#define XMGLOBALCONST extern const __attribute__((weak))
+
+#define XM_PERMUTE_PS( v, c ) _mm_shuffle_ps( v, v, c )
+
+namespace DirectX
+{
+
+const uint32_t XM_SELECT_0 = 0x00000000;
+const uint32_t XM_SELECT_1 = 0xFFFFFFFF;
+
+typedef __m128 XMVECTOR;
+typedef const XMVECTOR FXMVECTOR;
+typedef const XMVECTOR GXMVECTOR;
+typedef const XMVECTOR HXMVECTOR;
+typedef const XMVECTOR& CXMVECTOR;
+
+//---------------------------------------------------------------------------------
+// Constant vectors
+struct __attribute__((aligned(16))) XMVECTORF32
+{
+    union
+    {
+        float f[4];
+        XMVECTOR v;
+    };
+
+    inline operator XMVECTOR() const { return v; }
+    inline operator const float*() const { return f; }
+};
+
+struct __attribute__((aligned(16))) XMVECTORI32
+{
+    union
+    {
+        int32_t i[4];
+        XMVECTOR v;
+    };
+
+    inline operator XMVECTOR() const { return v; }
+};
+
+struct __attribute__((aligned(16))) XMVECTORU32
+{
+    union
+    {
+        uint32_t u[4];
+        XMVECTOR v;
+    };
+
+    inline operator XMVECTOR() const { return v; }
+};
+
+XMGLOBALCONST XMVECTORF32 g_XMIdentityR3     = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMOne            = { { { 1.0f, 1.0f, 1.0f, 1.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMZero           = { { { 0.0f, 0.0f, 0.0f, 0.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMNegativeOne    = { { { -1.0f, -1.0f, -1.0f, -1.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMOneHalf        = { { { 0.5f, 0.5f, 0.5f, 0.5f } } };
+XMGLOBALCONST XMVECTORU32 g_XMSelect1000     = { { { XM_SELECT_1, XM_SELECT_0, XM_SELECT_0, XM_SELECT_0 } } };
+XMGLOBALCONST XMVECTORU32 g_XMSelect1100     = { { { XM_SELECT_1, XM_SELECT_1, XM_SELECT_0, XM_SELECT_0 } } };
+XMGLOBALCONST XMVECTORU32 g_XMSelect1110     = { { { XM_SELECT_1, XM_SELECT_1, XM_SELECT_1, XM_SELECT_0 } } };
+XMGLOBALCONST XMVECTORU32 g_XMNegativeZero   = { { { 0x80000000, 0x80000000, 0x80000000, 0x80000000 } } };
+XMGLOBALCONST XMVECTORU32 g_XMAbsMask        = { { { 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF } } };
+XMGLOBALCONST XMVECTORF32 g_XMNoFraction     = { { { 8388608.0f, 8388608.0f, 8388608.0f, 8388608.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMMaxInt         = { { { 65536.0f*32768.0f-128.0f, 65536.0f*32768.0f-128.0f, 65536.0f*32768.0f-128.0f, 65536.0f*32768.0f-128.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMMaxUInt        = { { { 65536.0f*65536.0f-256.0f, 65536.0f*65536.0f-256.0f, 65536.0f*65536.0f-256.0f, 65536.0f*65536.0f-256.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMUnsignedFix    = { { { 32768.0f*65536.0f, 32768.0f*65536.0f, 32768.0f*65536.0f, 32768.0f*65536.0f } } };
+XMGLOBALCONST XMVECTORF32 g_XMFixUnsigned    = { { { 32768.0f*65536.0f, 32768.0f*65536.0f, 32768.0f*65536.0f, 32768.0f*65536.0f } } };
+
+// The vector extensions only apply the built-in operators to XMVECTOR itself, so the
+// constant wrappers get the overloads DirectXMath declares for its operator support
+inline XMVECTOR operator- ( const XMVECTORF32& V ) { return _mm_sub_ps( _mm_setzero_ps(), V.v ); }
+inline XMVECTOR operator+ ( FXMVECTOR V1, const XMVECTORF32& V2 ) { return _mm_add_ps( V1, V2.v ); }
+inline XMVECTOR operator+ ( const XMVECTORF32& V1, FXMVECTOR V2 ) { return _mm_add_ps( V1.v, V2 ); }
+inline XMVECTOR operator+ ( const XMVECTORF32& V1, const XMVECTORF32& V2 ) { return _mm_add_ps( V1.v, V2.v ); }
+inline XMVECTOR operator- ( FXMVECTOR V1, const XMVECTORF32& V2 ) { return _mm_sub_ps( V1, V2.v ); }
+inline XMVECTOR operator- ( const XMVECTORF32& V1, FXMVECTOR V2 ) { return _mm_sub_ps( V1.v, V2 ); }
+inline XMVECTOR operator- ( const XMVECTORF32& V1, const XMVECTORF32& V2 ) { return _mm_sub_ps( V1.v, V2.v ); }
+inline XMVECTOR operator* ( FXMVECTOR V1, const XMVECTORF32& V2 ) { return _mm_mul_ps( V1, V2.v ); }
+inline XMVECTOR operator* ( const XMVECTORF32& V1, FXMVECTOR V2 ) { return _mm_mul_ps( V1.v, V2 ); }
+inline XMVECTOR operator* ( const XMVECTORF32& V1, const XMVECTORF32& V2 ) { return _mm_mul_ps( V1.v, V2.v ); }
+inline XMVECTOR operator/ ( FXMVECTOR V1, const XMVECTORF32& V2 ) { return _mm_div_ps( V1, V2.v ); }
+inline XMVECTOR operator/ ( const XMVECTORF32& V1, FXMVECTOR V2 ) { return _mm_div_ps( V1.v, V2 ); }
+
+//---------------------------------------------------------------------------------
+// Storage types
+struct XMFLOAT2
+{
+    float x;
+    float y;
+
+    XMFLOAT2() {}
+    XMFLOAT2( float _x, float _y ) : x(_x), y(_y) {}
+};
+
+struct XMFLOAT3
+{
+    float x;
+    float y;
+    float z;
+
+    XMFLOAT3() {}
+    XMFLOAT3( float _x, float _y, float _z ) : x(_x), y(_y), z(_z) {}
+};
+
+struct XMFLOAT4
+{
+    float x;
+    float y;
+    float z;
+    float w;
+
+    XMFLOAT4() {}
+    XMFLOAT4( float _x, float _y, float _z, float _w ) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct __attribute__((aligned(16))) XMFLOAT4A : public XMFLOAT4
+{
+    XMFLOAT4A() : XMFLOAT4() {}
+    XMFLOAT4A( float _x, float _y, float _z, float _w ) : XMFLOAT4(_x, _y, _z, _w) {}
+};
+
+struct XMINT2 { int32_t x; int32_t y; };
+struct XMINT3 { int32_t x; int32_t y; int32_t z; };
+struct XMINT4 { int32_t x; int32_t y; int32_t z; int32_t w; };
+
+struct XMUINT2 { uint32_t x; uint32_t y; };
+struct XMUINT3 { uint32_t x; uint32_t y; uint32_t z; };
+struct XMUINT4 { uint32_t x; uint32_t y; uint32_t z; uint32_t w; };
+
+//---------------------------------------------------------------------------------
+// Initialization and element access
+inline XMVECTOR XM_CALLCONV XMVectorZero()
+{
+    return _mm_setzero_ps();
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSet( float x, float y, float z, float w )
+{
+    return _mm_set_ps( w, z, y, x );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorReplicate( float value )
+{
+    return _mm_set_ps1( value );
+}
+
+inline float XM_CALLCONV XMVectorGetX( FXMVECTOR V )
+{
+    return _mm_cvtss_f32( V );
+}
+
+inline float XM_CALLCONV XMVectorGetW( FXMVECTOR V )
+{
+    return _mm_cvtss_f32( XM_PERMUTE_PS( V, _MM_SHUFFLE(3,3,3,3) ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSetW( FXMVECTOR V, float w )
+{
+    // Swap w and x, set x, swap back
+    XMVECTOR vResult = XM_PERMUTE_PS( V, _MM_SHUFFLE(0,2,1,3) );
+    vResult = _mm_move_ss( vResult, _mm_set_ss( w ) );
+    return XM_PERMUTE_PS( vResult, _MM_SHUFFLE(0,2,1,3) );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatX( FXMVECTOR V ) { return XM_PERMUTE_PS( V, _MM_SHUFFLE(0,0,0,0) ); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatY( FXMVECTOR V ) { return XM_PERMUTE_PS( V, _MM_SHUFFLE(1,1,1,1) ); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatZ( FXMVECTOR V ) { return XM_PERMUTE_PS( V, _MM_SHUFFLE(2,2,2,2) ); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatW( FXMVECTOR V ) { return XM_PERMUTE_PS( V, _MM_SHUFFLE(3,3,3,3) ); }
+
+template<uint32_t SwizzleX, uint32_t SwizzleY, uint32_t SwizzleZ, uint32_t SwizzleW>
+inline XMVECTOR XM_CALLCONV XMVectorSwizzle( FXMVECTOR V )
+{
+    static_assert( SwizzleX <= 3 && SwizzleY <= 3 && SwizzleZ <= 3 && SwizzleW <= 3, "Swizzle template parameter out of range" );
+    return XM_PERMUTE_PS( V, _MM_SHUFFLE( SwizzleW, SwizzleZ, SwizzleY, SwizzleX ) );
+}
+
+template<uint32_t PermuteX, uint32_t PermuteY, uint32_t PermuteZ, uint32_t PermuteW>
+inline XMVECTOR XM_CALLCONV XMVectorPermute( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    static_assert( PermuteX <= 7 && PermuteY <= 7 && PermuteZ <= 7 && PermuteW <= 7, "Permute template parameter out of range" );
+
+    __attribute__((aligned(16))) float a[8];
+    _mm_store_ps( a, V1 );
+    _mm_store_ps( a + 4, V2 );
+    return _mm_set_ps( a[ PermuteW ], a[ PermuteZ ], a[ PermuteY ], a[ PermuteX ] );
+}
+
+//---------------------------------------------------------------------------------
+// Comparison and selection
+inline XMVECTOR XM_CALLCONV XMVectorSelect( FXMVECTOR V1, FXMVECTOR V2, FXMVECTOR Control )
+{
+    XMVECTOR vTemp1 = _mm_andnot_ps( Control, V1 );
+    XMVECTOR vTemp2 = _mm_and_ps( V2, Control );
+    return _mm_or_ps( vTemp1, vTemp2 );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorGreater( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    return _mm_cmpgt_ps( V1, V2 );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorLess( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    return _mm_cmplt_ps( V1, V2 );
+}
+
+inline bool XM_CALLCONV XMVector4Less( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    return _mm_movemask_ps( _mm_cmplt_ps( V1, V2 ) ) == 0x0f;
+}
+
+//---------------------------------------------------------------------------------
+// Arithmetic
+inline XMVECTOR XM_CALLCONV XMVectorAdd( FXMVECTOR V1, FXMVECTOR V2 )      { return _mm_add_ps( V1, V2 ); }
+inline XMVECTOR XM_CALLCONV XMVectorSubtract( FXMVECTOR V1, FXMVECTOR V2 ) { return _mm_sub_ps( V1, V2 ); }
+inline XMVECTOR XM_CALLCONV XMVectorMultiply( FXMVECTOR V1, FXMVECTOR V2 ) { return _mm_mul_ps( V1, V2 ); }
+inline XMVECTOR XM_CALLCONV XMVectorDivide( FXMVECTOR V1, FXMVECTOR V2 )   { return _mm_div_ps( V1, V2 ); }
+inline XMVECTOR XM_CALLCONV XMVectorMin( FXMVECTOR V1, FXMVECTOR V2 )      { return _mm_min_ps( V1, V2 ); }
+inline XMVECTOR XM_CALLCONV XMVectorMax( FXMVECTOR V1, FXMVECTOR V2 )      { return _mm_max_ps( V1, V2 ); }
+
+inline XMVECTOR XM_CALLCONV XMVectorMultiplyAdd( FXMVECTOR V1, FXMVECTOR V2, FXMVECTOR V3 )
+{
+    return _mm_add_ps( _mm_mul_ps( V1, V2 ), V3 );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorScale( FXMVECTOR V, float ScaleFactor )
+{
+    return _mm_mul_ps( V, _mm_set_ps1( ScaleFactor ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorLerp( FXMVECTOR V0, FXMVECTOR V1, float t )
+{
+    XMVECTOR L = _mm_sub_ps( V1, V0 );
+    XMVECTOR S = _mm_set_ps1( t );
+    return _mm_add_ps( _mm_mul_ps( L, S ), V0 );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorClamp( FXMVECTOR V, FXMVECTOR Min, FXMVECTOR Max )
+{
+    XMVECTOR vResult = _mm_max_ps( Min, V );
+    return _mm_min_ps( Max, vResult );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSaturate( FXMVECTOR V )
+{
+    // NaN becomes 0
+    XMVECTOR vResult = _mm_max_ps( V, g_XMZero );
+    return _mm_min_ps( vResult, g_XMOne );
+}
+
+// Round to nearest, ties to even
+inline XMVECTOR XM_CALLCONV XMVectorRound( FXMVECTOR V )
+{
+    __m128 sign = _mm_and_ps( V, g_XMNegativeZero );
+    __m128 sMagic = _mm_or_ps( g_XMNoFraction, sign );
+    __m128 R1 = _mm_add_ps( V, sMagic );
+    R1 = _mm_sub_ps( R1, sMagic );
+    __m128 R2 = _mm_and_ps( V, g_XMAbsMask );
+    __m128 mask = _mm_cmple_ps( R2, g_XMNoFraction );
+    R2 = _mm_andnot_ps( mask, V );
+    R1 = _mm_and_ps( R1, mask );
+    return _mm_xor_ps( R1, R2 );
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorPow( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    __attribute__((aligned(16))) float a[4];
+    __attribute__((aligned(16))) float b[4];
+    _mm_store_ps( a, V1 );
+    _mm_store_ps( b, V2 );
+    return _mm_set_ps( powf( a[3], b[3] ), powf( a[2], b[2] ), powf( a[1], b[1] ), powf( a[0], b[0] ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Dot( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    XMVECTOR vDot = _mm_mul_ps( V1, V2 );
+    XMVECTOR vTemp = XM_PERMUTE_PS( vDot, _MM_SHUFFLE(2,1,2,1) );
+    vDot = _mm_add_ss( vDot, vTemp );
+    vTemp = XM_PERMUTE_PS( vTemp, _MM_SHUFFLE(1,1,1,1) );
+    vDot = _mm_add_ss( vDot, vTemp );
+    return XM_PERMUTE_PS( vDot, _MM_SHUFFLE(0,0,0,0) );
+}
+
+inline XMVECTOR XM_CALLCONV XMVector4Dot( FXMVECTOR V1, FXMVECTOR V2 )
+{
+    XMVECTOR vTemp2 = V2;
+    XMVECTOR vTemp = _mm_mul_ps( V1, vTemp2 );
+    vTemp2 = _mm_shuffle_ps( vTemp2, vTemp, _MM_SHUFFLE(1,0,0,0) );
+    vTemp2 = _mm_add_ps( vTemp2, vTemp );
+    vTemp = _mm_shuffle_ps( vTemp, vTemp2, _MM_SHUFFLE(0,3,0,0) );
+    vTemp = _mm_add_ps( vTemp, vTemp2 );
+    return XM_PERMUTE_PS( vTemp, _MM_SHUFFLE(2,2,2,2) );
+}
+
+//---------------------------------------------------------------------------------
+// Integer <-> float
+inline XMVECTOR XM_CALLCONV XMConvertVectorIntToFloat( FXMVECTOR VInt, uint32_t DivExponent )
+{
+    XMVECTOR vResult = _mm_cvtepi32_ps( _mm_castps_si128( VInt ) );
+    uint32_t uScale = 0x3F800000U - ( DivExponent << 23 );
+    __m128i vScale = _mm_set1_epi32( static_cast<int>( uScale ) );
+    return _mm_mul_ps( vResult, _mm_castsi128_ps( vScale ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMConvertVectorFloatToInt( FXMVECTOR VFloat, uint32_t MulExponent )
+{
+    XMVECTOR vResult = _mm_set_ps1( static_cast<float>( 1U << MulExponent ) );
+    vResult = _mm_mul_ps( vResult, VFloat );
+    // Positive overflow saturates to 0x7FFFFFFF
+    XMVECTOR vOverflow = _mm_cmpgt_ps( vResult, g_XMMaxInt );
+    __m128i vResulti = _mm_cvttps_epi32( vResult );
+    vResult = _mm_and_ps( vOverflow, g_XMAbsMask );
+    vOverflow = _mm_andnot_ps( vOverflow, _mm_castsi128_ps( vResulti ) );
+    return _mm_or_ps( vOverflow, vResult );
+}
+
+inline XMVECTOR XM_CALLCONV XMConvertVectorUIntToFloat( FXMVECTOR VUInt, uint32_t DivExponent )
+{
+    // Values above 0x7FFFFFFF are converted without their top bit and fixed up after
+    XMVECTOR vMask = _mm_and_ps( VUInt, g_XMNegativeZero );
+    XMVECTOR vResult = _mm_xor_ps( VUInt, vMask );
+    vResult = _mm_cvtepi32_ps( _mm_castps_si128( vResult ) );
+    __m128i iMask = _mm_srai_epi32( _mm_castps_si128( vMask ), 31 );
+    vMask = _mm_and_ps( _mm_castsi128_ps( iMask ), g_XMFixUnsigned );
+    vResult = _mm_add_ps( vResult, vMask );
+    uint32_t uScale = 0x3F800000U - ( DivExponent << 23 );
+    iMask = _mm_set1_epi32( static_cast<int>( uScale ) );
+    return _mm_mul_ps( vResult, _mm_castsi128_ps( iMask ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMConvertVectorFloatToUInt( FXMVECTOR VFloat, uint32_t MulExponent )
+{
+    XMVECTOR vResult = _mm_set_ps1( static_cast<float>( 1U << MulExponent ) );
+    vResult = _mm_mul_ps( vResult, VFloat );
+    vResult = _mm_max_ps( vResult, g_XMZero );
+    // Too large saturates to 0xFFFFFFFF
+    XMVECTOR vOverflow = _mm_cmpgt_ps( vResult, g_XMMaxUInt );
+    XMVECTOR vValue = g_XMUnsignedFix;
+    XMVECTOR vMask = _mm_cmpge_ps( vResult, vValue );
+    vValue = _mm_and_ps( vValue, vMask );
+    vResult = _mm_sub_ps( vResult, vValue );
+    __m128i vResulti = _mm_cvttps_epi32( vResult );
+    vMask = _mm_and_ps( vMask, g_XMNegativeZero );
+    vResult = _mm_xor_ps( _mm_castsi128_ps( vResulti ), vMask );
+    return _mm_or_ps( vResult, vOverflow );
+}
+
+//---------------------------------------------------------------------------------
+// Load operations
+inline XMVECTOR XM_CALLCONV XMLoadInt( const uint32_t* pSource )
+{
+    return _mm_load_ss( reinterpret_cast<const float*>( pSource ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat( const float* pSource )
+{
+    return _mm_load_ss( pSource );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat2( const XMFLOAT2* pSource )
+{
+    return _mm_set_ps( 0.f, 0.f, pSource->y, pSource->x );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat3( const XMFLOAT3* pSource )
+{
+    return _mm_set_ps( 0.f, pSource->z, pSource->y, pSource->x );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat4( const XMFLOAT4* pSource )
+{
+    return _mm_loadu_ps( &pSource->x );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat4A( const XMFLOAT4A* pSource )
+{
+    return _mm_load_ps( &pSource->x );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadSInt2( const XMINT2* pSource )
+{
+    return _mm_cvtepi32_ps( _mm_set_epi32( 0, 0, pSource->y, pSource->x ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadSInt3( const XMINT3* pSource )
+{
+    return _mm_cvtepi32_ps( _mm_set_epi32( 0, pSource->z, pSource->y, pSource->x ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadSInt4( const XMINT4* pSource )
+{
+    return _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource ) ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUInt2( const XMUINT2* pSource )
+{
+    __m128i v = _mm_set_epi32( 0, 0, static_cast<int>( pSource->y ), static_cast<int>( pSource->x ) );
+    return XMConvertVectorUIntToFloat( _mm_castsi128_ps( v ), 0 );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUInt3( const XMUINT3* pSource )
+{
+    __m128i v = _mm_set_epi32( 0, static_cast<int>( pSource->z ), static_cast<int>( pSource->y ), static_cast<int>( pSource->x ) );
+    return XMConvertVectorUIntToFloat( _mm_castsi128_ps( v ), 0 );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUInt4( const XMUINT4* pSource )
+{
+    __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource ) );
+    return XMConvertVectorUIntToFloat( _mm_castsi128_ps( v ), 0 );
+}
+
+//---------------------------------------------------------------------------------
+// Store operations
+inline void XM_CALLCONV XMStoreInt( uint32_t* pDestination, FXMVECTOR V )
+{
+    _mm_store_ss( reinterpret_cast<float*>( pDestination ), V );
+}
+
+inline void XM_CALLCONV XMStoreFloat( float* pDestination, FXMVECTOR V )
+{
+    _mm_store_ss( pDestination, V );
+}
+
+inline void XM_CALLCONV XMStoreFloat2( XMFLOAT2* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) float a[4];
+    _mm_store_ps( a, V );
+    pDestination->x = a[0];
+    pDestination->y = a[1];
+}
+
+inline void XM_CALLCONV XMStoreFloat3( XMFLOAT3* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) float a[4];
+    _mm_store_ps( a, V );
+    pDestination->x = a[0];
+    pDestination->y = a[1];
+    pDestination->z = a[2];
+}
+
+inline void XM_CALLCONV XMStoreFloat4( XMFLOAT4* pDestination, FXMVECTOR V )
+{
+    _mm_storeu_ps( &pDestination->x, V );
+}
+
+inline void XM_CALLCONV XMStoreFloat4A( XMFLOAT4A* pDestination, FXMVECTOR V )
+{
+    _mm_store_ps( &pDestination->x, V );
+}
+
+inline void XM_CALLCONV XMStoreSInt2( XMINT2* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) int32_t a[4];
+    _mm_store_ps( reinterpret_cast<float*>( a ), XMConvertVectorFloatToInt( V, 0 ) );
+    pDestination->x = a[0];
+    pDestination->y = a[1];
+}
+
+inline void XM_CALLCONV XMStoreSInt3( XMINT3* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) int32_t a[4];
+    _mm_store_ps( reinterpret_cast<float*>( a ), XMConvertVectorFloatToInt( V, 0 ) );
+    pDestination->x = a[0];
+    pDestination->y = a[1];
+    pDestination->z = a[2];
+}
+
+inline void XM_CALLCONV XMStoreSInt4( XMINT4* pDestination, FXMVECTOR V )
+{
+    _mm_storeu_ps( reinterpret_cast<float*>( pDestination ), XMConvertVectorFloatToInt( V, 0 ) );
+}
+
+inline void XM_CALLCONV XMStoreUInt2( XMUINT2* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) uint32_t a[4];
+    _mm_store_ps( reinterpret_cast<float*>( a ), XMConvertVectorFloatToUInt( V, 0 ) );
+    pDestination->x = a[0];
+    pDestination->y = a[1];
+}
+
+inline void XM_CALLCONV XMStoreUInt3( XMUINT3* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) uint32_t a[4];
+    _mm_store_ps( reinterpret_cast<float*>( a ), XMConvertVectorFloatToUInt( V, 0 ) );
+    pDestination->x = a[0];
+    pDestination->y = a[1];
+    pDestination->z = a[2];
+}
+
+inline void XM_CALLCONV XMStoreUInt4( XMUINT4* pDestination, FXMVECTOR V )
+{
+    _mm_storeu_ps( reinterpret_cast<float*>( pDestination ), XMConvertVectorFloatToUInt( V, 0 ) );
+}
+
+//---------------------------------------------------------------------------------
+// Color space
+inline XMVECTOR XM_CALLCONV XMColorRGBToSRGB( FXMVECTOR rgb )
+{
+    static const XMVECTORF32 Cutoff = { { { 0.0031308f, 0.0031308f, 0.0031308f, 1.f } } };
+    static const XMVECTORF32 Linear = { { { 12.92f, 12.92f, 12.92f, 1.f } } };
+    static const XMVECTORF32 Scale = { { { 1.055f, 1.055f, 1.055f, 1.f } } };
+    static const XMVECTORF32 Bias = { { { 0.055f, 0.055f, 0.055f, 0.f } } };
+    static const XMVECTORF32 InvGamma = { { { 1.0f/2.4f, 1.0f/2.4f, 1.0f/2.4f, 1.f } } };
+
+    XMVECTOR V = XMVectorSaturate( rgb );
+    XMVECTOR V0 = XMVectorMultiply( V, Linear );
+    XMVECTOR V1 = XMVectorSubtract( XMVectorMultiply( Scale, XMVectorPow( V, InvGamma ) ), Bias );
+    XMVECTOR select = XMVectorLess( V, Cutoff );
+    V = XMVectorSelect( V1, V0, select );
+    return XMVectorSelect( rgb, V, g_XMSelect1110 );
+}
+
+inline XMVECTOR XM_CALLCONV XMColorSRGBToRGB( FXMVECTOR srgb )
+{
+    static const XMVECTORF32 Cutoff = { { { 0.04045f, 0.04045f, 0.04045f, 1.f } } };
+    static const XMVECTORF32 ILinear = { { { 1.f/12.92f, 1.f/12.92f, 1.f/12.92f, 1.f } } };
+    static const XMVECTORF32 Scale = { { { 1.f/1.055f, 1.f/1.055f, 1.f/1.055f, 1.f } } };
+    static const XMVECTORF32 Bias = { { { 0.055f, 0.055f, 0.055f, 0.f } } };
+    static const XMVECTORF32 Gamma = { { { 2.4f, 2.4f, 2.4f, 1.f } } };
+
+    XMVECTOR V = XMVectorSaturate( srgb );
+    XMVECTOR V0 = XMVectorMultiply( V, ILinear );
+    XMVECTOR V1 = XMVectorPow( XMVectorMultiply( XMVectorAdd( V, Bias ), Scale ), Gamma );
+    XMVECTOR select = XMVectorGreater( V, Cutoff );
+    V = XMVectorSelect( V0, V1, select );
+    return XMVectorSelect( srgb, V, g_XMSelect1110 );
+}
+
+} // namespace DirectX
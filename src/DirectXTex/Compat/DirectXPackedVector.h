@@ -0,0 +1,931 @@
+//-------------------------------------------------------------------------------------
+// DirectXPackedVector.h
+//
+// DirectX Texture Library - DirectXMath packed vector subset for non-Windows builds
+//
+// Normalized stores saturate, scale and round to nearest even like the SSE code paths
+// of DirectXMath; loads scale by the reciprocal of the channel maximum.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <string.h>
+
+#include "DirectXMath.h"
+
+namespace DirectX
+{
+
+namespace PackedVector
+{
+
+typedef uint16_t HALF;
+
+//---------------------------------------------------------------------------------
+// Packed types
+struct XMHALF2
+{
+    union
+    {
+        struct { HALF x; HALF y; };
+        uint32_t v;
+    };
+
+    XMHALF2() {}
+    XMHALF2( HALF _x, HALF _y ) : x(_x), y(_y) {}
+};
+
+struct XMHALF4
+{
+    union
+    {
+        struct { HALF x; HALF y; HALF z; HALF w; };
+        uint64_t v;
+    };
+
+    XMHALF4() {}
+    XMHALF4( HALF _x, HALF _y, HALF _z, HALF _w ) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+#define XM_PACKED_PAIR( name, type, packed ) \
+    struct name \
+    { \
+        union \
+        { \
+            struct { type x; type y; }; \
+            packed v; \
+        }; \
+        name() {} \
+        name( type _x, type _y ) : x(_x), y(_y) {} \
+    };
+
+#define XM_PACKED_QUAD( name, type, packed ) \
+    struct name \
+    { \
+        union \
+        { \
+            struct { type x; type y; type z; type w; }; \
+            packed v; \
+        }; \
+        name() {} \
+        name( type _x, type _y, type _z, type _w ) : x(_x), y(_y), z(_z), w(_w) {} \
+    };
+
+XM_PACKED_PAIR( XMSHORTN2, int16_t, uint32_t )
+XM_PACKED_PAIR( XMSHORT2, int16_t, uint32_t )
+XM_PACKED_PAIR( XMUSHORTN2, uint16_t, uint32_t )
+XM_PACKED_PAIR( XMUSHORT2, uint16_t, uint32_t )
+XM_PACKED_PAIR( XMBYTEN2, int8_t, uint16_t )
+XM_PACKED_PAIR( XMBYTE2, int8_t, uint16_t )
+XM_PACKED_PAIR( XMUBYTEN2, uint8_t, uint16_t )
+XM_PACKED_PAIR( XMUBYTE2, uint8_t, uint16_t )
+
+XM_PACKED_QUAD( XMSHORTN4, int16_t, uint64_t )
+XM_PACKED_QUAD( XMSHORT4, int16_t, uint64_t )
+XM_PACKED_QUAD( XMUSHORTN4, uint16_t, uint64_t )
+XM_PACKED_QUAD( XMUSHORT4, uint16_t, uint64_t )
+XM_PACKED_QUAD( XMBYTEN4, int8_t, uint32_t )
+XM_PACKED_QUAD( XMBYTE4, int8_t, uint32_t )
+XM_PACKED_QUAD( XMUBYTEN4, uint8_t, uint32_t )
+XM_PACKED_QUAD( XMUBYTE4, uint8_t, uint32_t )
+
+#undef XM_PACKED_PAIR
+#undef XM_PACKED_QUAD
+
+// 10:10:10:2
+struct XMUDECN4
+{
+    union
+    {
+        struct { uint32_t x : 10; uint32_t y : 10; uint32_t z : 10; uint32_t w : 2; };
+        uint32_t v;
+    };
+
+    XMUDECN4() {}
+    explicit XMUDECN4( uint32_t Packed ) : v(Packed) {}
+};
+
+struct XMUDEC4
+{
+    union
+    {
+        struct { uint32_t x : 10; uint32_t y : 10; uint32_t z : 10; uint32_t w : 2; };
+        uint32_t v;
+    };
+
+    XMUDEC4() {}
+    explicit XMUDEC4( uint32_t Packed ) : v(Packed) {}
+};
+
+// 11:11:10 float
+struct XMFLOAT3PK
+{
+    union
+    {
+        struct
+        {
+            uint32_t xm : 6;
+            uint32_t xe : 5;
+            uint32_t ym : 6;
+            uint32_t ye : 5;
+            uint32_t zm : 5;
+            uint32_t ze : 5;
+        };
+        uint32_t v;
+    };
+
+    XMFLOAT3PK() {}
+    explicit XMFLOAT3PK( uint32_t Packed ) : v(Packed) {}
+};
+
+// 9:9:9 with a shared 5-bit exponent
+struct XMFLOAT3SE
+{
+    union
+    {
+        struct
+        {
+            uint32_t xm : 9;
+            uint32_t ym : 9;
+            uint32_t zm : 9;
+            uint32_t e  : 5;
+        };
+        uint32_t v;
+    };
+
+    XMFLOAT3SE() {}
+    explicit XMFLOAT3SE( uint32_t Packed ) : v(Packed) {}
+};
+
+// 5:6:5
+struct XMU565
+{
+    union
+    {
+        struct { uint16_t x : 5; uint16_t y : 6; uint16_t z : 5; };
+        uint16_t v;
+    };
+
+    XMU565() {}
+    explicit XMU565( uint16_t Packed ) : v(Packed) {}
+};
+
+// 5:5:5:1
+struct XMU555
+{
+    union
+    {
+        struct { uint16_t x : 5; uint16_t y : 5; uint16_t z : 5; uint16_t w : 1; };
+        uint16_t v;
+    };
+
+    XMU555() {}
+    explicit XMU555( uint16_t Packed ) : v(Packed) {}
+};
+
+// 4:4:4:4
+struct XMUNIBBLE4
+{
+    union
+    {
+        struct { uint16_t x : 4; uint16_t y : 4; uint16_t z : 4; uint16_t w : 4; };
+        uint16_t v;
+    };
+
+    XMUNIBBLE4() {}
+    explicit XMUNIBBLE4( uint16_t Packed ) : v(Packed) {}
+};
+
+//---------------------------------------------------------------------------------
+// Internal helpers
+namespace Internal
+{
+    // Saturates V to [Min, Max] and rounds to nearest even; returns the integer lanes
+    inline void XMClampRoundStore( FXMVECTOR V, FXMVECTOR Min, FXMVECTOR Max, int32_t* pResult )
+    {
+        XMVECTOR N = XMVectorClamp( V, Min, Max );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pResult ), _mm_cvtps_epi32( N ) );
+    }
+
+    // Scales V by Scale after saturating to [Min, 1] and rounds to nearest even
+    inline void XMNormStore( FXMVECTOR V, FXMVECTOR Min, FXMVECTOR Scale, int32_t* pResult )
+    {
+        XMVECTOR N = XMVectorClamp( V, Min, g_XMOne );
+        N = _mm_mul_ps( N, Scale );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pResult ), _mm_cvtps_epi32( N ) );
+    }
+
+    inline float round_to_nearest( float x )
+    {
+        float i = floorf( x );
+        x -= i;
+        if ( x < 0.5f )
+            return i;
+        if ( x > 0.5f )
+            return i + 1.f;
+
+        float int_part;
+        modff( i / 2.f, &int_part );
+        if ( ( 2.f * int_part ) == i )
+            return i;
+
+        return i + 1.f;
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Half precision
+inline float XMConvertHalfToFloat( HALF Value )
+{
+    uint32_t Mantissa = static_cast<uint32_t>( Value & 0x03FF );
+
+    uint32_t Exponent = ( Value & 0x7C00 );
+    if ( Exponent == 0x7C00 ) // INF/NAN
+    {
+        Exponent = 0x8f;
+    }
+    else if ( Exponent != 0 ) // The value is normalized
+    {
+        Exponent = static_cast<uint32_t>( ( Value >> 10 ) & 0x1F );
+    }
+    else if ( Mantissa != 0 ) // The value is denormalized
+    {
+        // Normalize the value in the resulting float
+        Exponent = 1;
+        do
+        {
+            Exponent--;
+            Mantissa <<= 1;
+        } while ( ( Mantissa & 0x0400 ) == 0 );
+
+        Mantissa &= 0x03FF;
+    }
+    else // The value is zero
+    {
+        Exponent = static_cast<uint32_t>( -112 );
+    }
+
+    uint32_t Result = ( ( Value & 0x8000 ) << 16 )  // Sign
+                    | ( ( Exponent + 112 ) << 23 )   // Exponent
+                    | ( Mantissa << 13 );            // Mantissa
+
+    float f;
+    memcpy( &f, &Result, sizeof(f) );
+    return f;
+}
+
+inline HALF XMConvertFloatToHalf( float Value )
+{
+    uint32_t Result;
+
+    uint32_t IValue;
+    memcpy( &IValue, &Value, sizeof(IValue) );
+    uint32_t Sign = ( IValue & 0x80000000U ) >> 16U;
+    IValue = IValue & 0x7FFFFFFFU; // Hack off the sign
+
+    if ( IValue > 0x477FE000U )
+    {
+        // The number is too large to be represented as a half. Saturate to infinity.
+        if ( ( ( IValue & 0x7F800000 ) == 0x7F800000 ) && ( ( IValue & 0x7FFFFF ) != 0 ) )
+            Result = 0x7FFF; // NAN
+        else
+            Result = 0x7C00U; // INF
+    }
+    else
+    {
+        if ( IValue < 0x38800000U )
+        {
+            // The number is too small to be represented as a normalized half.
+            // Convert it to a denormalized value.
+            uint32_t Shift = 113U - ( IValue >> 23U );
+            IValue = ( 0x800000U | ( IValue & 0x7FFFFFU ) ) >> Shift;
+        }
+        else
+        {
+            // Rebias the exponent to represent the value as a normalized half.
+            IValue += 0xC8000000U;
+        }
+
+        Result = ( ( IValue + 0x0FFFU + ( ( IValue >> 13U ) & 1U ) ) >> 13U ) & 0x7FFFU;
+    }
+    return static_cast<HALF>( Result | Sign );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadHalf2( const XMHALF2* pSource )
+{
+    return XMVectorSet( XMConvertHalfToFloat( pSource->x ), XMConvertHalfToFloat( pSource->y ), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadHalf4( const XMHALF4* pSource )
+{
+    return XMVectorSet( XMConvertHalfToFloat( pSource->x ), XMConvertHalfToFloat( pSource->y ),
+                        XMConvertHalfToFloat( pSource->z ), XMConvertHalfToFloat( pSource->w ) );
+}
+
+inline void XM_CALLCONV XMStoreHalf2( XMHALF2* pDestination, FXMVECTOR V )
+{
+    XMFLOAT4A t;
+    XMStoreFloat4A( &t, V );
+    pDestination->x = XMConvertFloatToHalf( t.x );
+    pDestination->y = XMConvertFloatToHalf( t.y );
+}
+
+inline void XM_CALLCONV XMStoreHalf4( XMHALF4* pDestination, FXMVECTOR V )
+{
+    XMFLOAT4A t;
+    XMStoreFloat4A( &t, V );
+    pDestination->x = XMConvertFloatToHalf( t.x );
+    pDestination->y = XMConvertFloatToHalf( t.y );
+    pDestination->z = XMConvertFloatToHalf( t.z );
+    pDestination->w = XMConvertFloatToHalf( t.w );
+}
+
+//---------------------------------------------------------------------------------
+// 8 and 16 bit integer types
+inline XMVECTOR XM_CALLCONV XMLoadUByteN2( const XMUBYTEN2* pSource )
+{
+    return XMVectorSet( float(pSource->x) * (1.0f/255.0f), float(pSource->y) * (1.0f/255.0f), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUByteN4( const XMUBYTEN4* pSource )
+{
+    __m128i v = _mm_cvtsi32_si128( static_cast<int>( pSource->v ) );
+    v = _mm_unpacklo_epi8( v, _mm_setzero_si128() );
+    v = _mm_unpacklo_epi16( v, _mm_setzero_si128() );
+    return _mm_mul_ps( _mm_cvtepi32_ps( v ), _mm_set_ps1( 1.0f/255.0f ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUByte2( const XMUBYTE2* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUByte4( const XMUBYTE4* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadByteN2( const XMBYTEN2* pSource )
+{
+    XMVECTOR V = XMVectorSet( float(pSource->x) * (1.0f/127.0f), float(pSource->y) * (1.0f/127.0f), 0.0f, 0.0f );
+    return _mm_max_ps( V, g_XMNegativeOne );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadByteN4( const XMBYTEN4* pSource )
+{
+    XMVECTOR V = XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+    return _mm_max_ps( _mm_mul_ps( V, _mm_set_ps1( 1.0f/127.0f ) ), g_XMNegativeOne );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadByte2( const XMBYTE2* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadByte4( const XMBYTE4* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUShortN2( const XMUSHORTN2* pSource )
+{
+    return XMVectorSet( float(pSource->x) * (1.0f/65535.0f), float(pSource->y) * (1.0f/65535.0f), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUShortN4( const XMUSHORTN4* pSource )
+{
+    XMVECTOR V = XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+    return _mm_mul_ps( V, _mm_set_ps1( 1.0f/65535.0f ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUShort2( const XMUSHORT2* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUShort4( const XMUSHORT4* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadShortN2( const XMSHORTN2* pSource )
+{
+    XMVECTOR V = XMVectorSet( float(pSource->x) * (1.0f/32767.0f), float(pSource->y) * (1.0f/32767.0f), 0.0f, 0.0f );
+    return _mm_max_ps( V, g_XMNegativeOne );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadShortN4( const XMSHORTN4* pSource )
+{
+    XMVECTOR V = XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+    return _mm_max_ps( _mm_mul_ps( V, _mm_set_ps1( 1.0f/32767.0f ) ), g_XMNegativeOne );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadShort2( const XMSHORT2* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), 0.0f, 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadShort4( const XMSHORT4* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline void XM_CALLCONV XMStoreUByteN2( XMUBYTEN2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMZero, _mm_set_ps1( 255.0f ), i );
+    pDestination->x = static_cast<uint8_t>( i[0] );
+    pDestination->y = static_cast<uint8_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreUByteN4( XMUBYTEN4* pDestination, FXMVECTOR V )
+{
+    XMVECTOR N = XMVectorSaturate( V );
+    N = _mm_mul_ps( N, _mm_set_ps1( 255.0f ) );
+    __m128i vInt = _mm_cvtps_epi32( N );
+    vInt = _mm_packs_epi32( vInt, vInt );
+    vInt = _mm_packus_epi16( vInt, vInt );
+    pDestination->v = static_cast<uint32_t>( _mm_cvtsi128_si32( vInt ) );
+}
+
+inline void XM_CALLCONV XMStoreUByte2( XMUBYTE2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps1( 255.0f ), i );
+    pDestination->x = static_cast<uint8_t>( i[0] );
+    pDestination->y = static_cast<uint8_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreUByte4( XMUBYTE4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps1( 255.0f ), i );
+    pDestination->x = static_cast<uint8_t>( i[0] );
+    pDestination->y = static_cast<uint8_t>( i[1] );
+    pDestination->z = static_cast<uint8_t>( i[2] );
+    pDestination->w = static_cast<uint8_t>( i[3] );
+}
+
+inline void XM_CALLCONV XMStoreByteN2( XMBYTEN2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMNegativeOne, _mm_set_ps1( 127.0f ), i );
+    pDestination->x = static_cast<int8_t>( i[0] );
+    pDestination->y = static_cast<int8_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreByteN4( XMBYTEN4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMNegativeOne, _mm_set_ps1( 127.0f ), i );
+    pDestination->x = static_cast<int8_t>( i[0] );
+    pDestination->y = static_cast<int8_t>( i[1] );
+    pDestination->z = static_cast<int8_t>( i[2] );
+    pDestination->w = static_cast<int8_t>( i[3] );
+}
+
+inline void XM_CALLCONV XMStoreByte2( XMBYTE2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, _mm_set_ps1( -127.0f ), _mm_set_ps1( 127.0f ), i );
+    pDestination->x = static_cast<int8_t>( i[0] );
+    pDestination->y = static_cast<int8_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreByte4( XMBYTE4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, _mm_set_ps1( -127.0f ), _mm_set_ps1( 127.0f ), i );
+    pDestination->x = static_cast<int8_t>( i[0] );
+    pDestination->y = static_cast<int8_t>( i[1] );
+    pDestination->z = static_cast<int8_t>( i[2] );
+    pDestination->w = static_cast<int8_t>( i[3] );
+}
+
+inline void XM_CALLCONV XMStoreUShortN2( XMUSHORTN2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMZero, _mm_set_ps1( 65535.0f ), i );
+    pDestination->x = static_cast<uint16_t>( i[0] );
+    pDestination->y = static_cast<uint16_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreUShortN4( XMUSHORTN4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMZero, _mm_set_ps1( 65535.0f ), i );
+    pDestination->x = static_cast<uint16_t>( i[0] );
+    pDestination->y = static_cast<uint16_t>( i[1] );
+    pDestination->z = static_cast<uint16_t>( i[2] );
+    pDestination->w = static_cast<uint16_t>( i[3] );
+}
+
+inline void XM_CALLCONV XMStoreUShort2( XMUSHORT2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps1( 65535.0f ), i );
+    pDestination->x = static_cast<uint16_t>( i[0] );
+    pDestination->y = static_cast<uint16_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreUShort4( XMUSHORT4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps1( 65535.0f ), i );
+    pDestination->x = static_cast<uint16_t>( i[0] );
+    pDestination->y = static_cast<uint16_t>( i[1] );
+    pDestination->z = static_cast<uint16_t>( i[2] );
+    pDestination->w = static_cast<uint16_t>( i[3] );
+}
+
+inline void XM_CALLCONV XMStoreShortN2( XMSHORTN2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMNegativeOne, _mm_set_ps1( 32767.0f ), i );
+    pDestination->x = static_cast<int16_t>( i[0] );
+    pDestination->y = static_cast<int16_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreShortN4( XMSHORTN4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMNegativeOne, _mm_set_ps1( 32767.0f ), i );
+    pDestination->x = static_cast<int16_t>( i[0] );
+    pDestination->y = static_cast<int16_t>( i[1] );
+    pDestination->z = static_cast<int16_t>( i[2] );
+    pDestination->w = static_cast<int16_t>( i[3] );
+}
+
+inline void XM_CALLCONV XMStoreShort2( XMSHORT2* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, _mm_set_ps1( -32767.0f ), _mm_set_ps1( 32767.0f ), i );
+    pDestination->x = static_cast<int16_t>( i[0] );
+    pDestination->y = static_cast<int16_t>( i[1] );
+}
+
+inline void XM_CALLCONV XMStoreShort4( XMSHORT4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, _mm_set_ps1( -32767.0f ), _mm_set_ps1( 32767.0f ), i );
+    pDestination->x = static_cast<int16_t>( i[0] );
+    pDestination->y = static_cast<int16_t>( i[1] );
+    pDestination->z = static_cast<int16_t>( i[2] );
+    pDestination->w = static_cast<int16_t>( i[3] );
+}
+
+//---------------------------------------------------------------------------------
+// 10:10:10:2
+inline XMVECTOR XM_CALLCONV XMLoadUDecN4( const XMUDECN4* pSource )
+{
+    XMVECTOR V = XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+    return _mm_mul_ps( V, _mm_set_ps( 1.0f/3.0f, 1.0f/1023.0f, 1.0f/1023.0f, 1.0f/1023.0f ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUDecN4_XR( const XMUDECN4* pSource )
+{
+    XMVECTOR V = XMVectorSet( float( int32_t(pSource->x) - 0x180 ), float( int32_t(pSource->y) - 0x180 ),
+                              float( int32_t(pSource->z) - 0x180 ), float(pSource->w) );
+    return _mm_mul_ps( V, _mm_set_ps( 1.0f/3.0f, 1.0f/510.0f, 1.0f/510.0f, 1.0f/510.0f ) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUDec4( const XMUDEC4* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline void XM_CALLCONV XMStoreUDecN4( XMUDECN4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMNormStore( V, g_XMZero, _mm_set_ps( 3.0f, 1023.0f, 1023.0f, 1023.0f ), i );
+    pDestination->v = ( uint32_t(i[3]) << 30 ) | ( ( uint32_t(i[2]) & 0x3FF ) << 20 )
+                    | ( ( uint32_t(i[1]) & 0x3FF ) << 10 ) | ( uint32_t(i[0]) & 0x3FF );
+}
+
+inline void XM_CALLCONV XMStoreUDecN4_XR( XMUDECN4* pDestination, FXMVECTOR V )
+{
+    static const XMVECTORF32 Scale = { { { 510.0f, 510.0f, 510.0f, 3.0f } } };
+    static const XMVECTORF32 Bias = { { { 384.0f, 384.0f, 384.0f, 0.0f } } };
+    static const XMVECTORF32 C = { { { 1023.f, 1023.f, 1023.f, 3.f } } };
+
+    XMVECTOR N = XMVectorMultiplyAdd( V, Scale, Bias );
+    N = XMVectorClamp( N, g_XMZero, C );
+
+    XMFLOAT4A tmp;
+    XMStoreFloat4A( &tmp, N );
+    pDestination->v = ( uint32_t(tmp.w) << 30 ) | ( ( uint32_t(tmp.z) & 0x3FF ) << 20 )
+                    | ( ( uint32_t(tmp.y) & 0x3FF ) << 10 ) | ( uint32_t(tmp.x) & 0x3FF );
+}
+
+inline void XM_CALLCONV XMStoreUDec4( XMUDEC4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps( 3.0f, 1023.0f, 1023.0f, 1023.0f ), i );
+    pDestination->v = ( uint32_t(i[3]) << 30 ) | ( ( uint32_t(i[2]) & 0x3FF ) << 20 )
+                    | ( ( uint32_t(i[1]) & 0x3FF ) << 10 ) | ( uint32_t(i[0]) & 0x3FF );
+}
+
+//---------------------------------------------------------------------------------
+// 16 bit packed (unnormalized channel values; callers scale)
+inline XMVECTOR XM_CALLCONV XMLoadU565( const XMU565* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), 0.0f );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadU555( const XMU555* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadUNibble4( const XMUNIBBLE4* pSource )
+{
+    return XMVectorSet( float(pSource->x), float(pSource->y), float(pSource->z), float(pSource->w) );
+}
+
+inline void XM_CALLCONV XMStoreU565( XMU565* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps( 0.0f, 31.0f, 63.0f, 31.0f ), i );
+    pDestination->v = static_cast<uint16_t>( ( ( i[2] & 0x1F ) << 11 ) | ( ( i[1] & 0x3F ) << 5 ) | ( i[0] & 0x1F ) );
+}
+
+inline void XM_CALLCONV XMStoreU555( XMU555* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps( 1.0f, 31.0f, 31.0f, 31.0f ), i );
+    pDestination->v = static_cast<uint16_t>( ( ( i[3] != 0 ) ? 0x8000 : 0 ) | ( ( i[2] & 0x1F ) << 10 )
+                                           | ( ( i[1] & 0x1F ) << 5 ) | ( i[0] & 0x1F ) );
+}
+
+inline void XM_CALLCONV XMStoreUNibble4( XMUNIBBLE4* pDestination, FXMVECTOR V )
+{
+    int32_t i[4];
+    Internal::XMClampRoundStore( V, g_XMZero, _mm_set_ps1( 15.0f ), i );
+    pDestination->v = static_cast<uint16_t>( ( ( i[3] & 0xF ) << 12 ) | ( ( i[2] & 0xF ) << 8 )
+                                           | ( ( i[1] & 0xF ) << 4 ) | ( i[0] & 0xF ) );
+}
+
+//---------------------------------------------------------------------------------
+// Small floats
+inline XMVECTOR XM_CALLCONV XMLoadFloat3PK( const XMFLOAT3PK* pSource )
+{
+    __attribute__((aligned(16))) uint32_t Result[4];
+    uint32_t Mantissa;
+    uint32_t Exponent;
+
+    // X Channel (6-bit mantissa)
+    Mantissa = pSource->xm;
+
+    if ( pSource->xe == 0x1f ) // INF or NAN
+    {
+        Result[0] = 0x7f800000 | ( static_cast<uint32_t>( pSource->xm ) << 17 );
+    }
+    else
+    {
+        if ( pSource->xe != 0 ) // The value is normalized
+        {
+            Exponent = pSource->xe;
+        }
+        else if ( Mantissa != 0 ) // The value is denormalized
+        {
+            // Normalize the value in the resulting float
+            Exponent = 1;
+
+            do
+            {
+                Exponent--;
+                Mantissa <<= 1;
+            } while ( ( Mantissa & 0x40 ) == 0 );
+
+            Mantissa &= 0x3F;
+        }
+        else // The value is zero
+        {
+            Exponent = static_cast<uint32_t>( -112 );
+        }
+
+        Result[0] = ( ( Exponent + 112 ) << 23 ) | ( Mantissa << 17 );
+    }
+
+    // Y Channel (6-bit mantissa)
+    Mantissa = pSource->ym;
+
+    if ( pSource->ye == 0x1f ) // INF or NAN
+    {
+        Result[1] = 0x7f800000 | ( static_cast<uint32_t>( pSource->ym ) << 17 );
+    }
+    else
+    {
+        if ( pSource->ye != 0 ) // The value is normalized
+        {
+            Exponent = pSource->ye;
+        }
+        else if ( Mantissa != 0 ) // The value is denormalized
+        {
+            // Normalize the value in the resulting float
+            Exponent = 1;
+
+            do
+            {
+                Exponent--;
+                Mantissa <<= 1;
+            } while ( ( Mantissa & 0x40 ) == 0 );
+
+            Mantissa &= 0x3F;
+        }
+        else // The value is zero
+        {
+            Exponent = static_cast<uint32_t>( -112 );
+        }
+
+        Result[1] = ( ( Exponent + 112 ) << 23 ) | ( Mantissa << 17 );
+    }
+
+    // Z Channel (5-bit mantissa)
+    Mantissa = pSource->zm;
+
+    if ( pSource->ze == 0x1f ) // INF or NAN
+    {
+        Result[2] = 0x7f800000 | ( static_cast<uint32_t>( pSource->zm ) << 17 );
+    }
+    else
+    {
+        if ( pSource->ze != 0 ) // The value is normalized
+        {
+            Exponent = pSource->ze;
+        }
+        else if ( Mantissa != 0 ) // The value is denormalized
+        {
+            // Normalize the value in the resulting float
+            Exponent = 1;
+
+            do
+            {
+                Exponent--;
+                Mantissa <<= 1;
+            } while ( ( Mantissa & 0x20 ) == 0 );
+
+            Mantissa &= 0x1F;
+        }
+        else // The value is zero
+        {
+            Exponent = static_cast<uint32_t>( -112 );
+        }
+
+        Result[2] = ( ( Exponent + 112 ) << 23 ) | ( Mantissa << 18 );
+    }
+
+    Result[3] = 0x3F800000; // 1.0f
+    return _mm_load_ps( reinterpret_cast<const float*>( Result ) );
+}
+
+inline void XM_CALLCONV XMStoreFloat3PK( XMFLOAT3PK* pDestination, FXMVECTOR V )
+{
+    __attribute__((aligned(16))) uint32_t IValue[4];
+    _mm_store_ps( reinterpret_cast<float*>( IValue ), V );
+
+    uint32_t Result[3];
+
+    // X & Y Channels (5-bit exponent, 6-bit mantissa)
+    for ( uint32_t j = 0; j < 2; ++j )
+    {
+        uint32_t Sign = IValue[j] & 0x80000000;
+        uint32_t I = IValue[j] & 0x7FFFFFFF;
+
+        if ( ( I & 0x7F800000 ) == 0x7F800000 )
+        {
+            // INF or NAN
+            Result[j] = 0x7c0;
+            if ( ( I & 0x7FFFFF ) != 0 )
+            {
+                Result[j] = 0x7c0 | ( ( ( I >> 17 ) | ( I >> 11 ) | ( I >> 6 ) | ( I ) ) & 0x3f );
+            }
+            else if ( Sign )
+            {
+                // -INF is clamped to 0 since 3PK is positive only
+                Result[j] = 0;
+            }
+        }
+        else if ( Sign )
+        {
+            // 3PK is positive only, so clamp to zero
+            Result[j] = 0;
+        }
+        else if ( I > 0x477E0000U )
+        {
+            // The number is too large to be represented as a float11, set to max
+            Result[j] = 0x7BF;
+        }
+        else
+        {
+            if ( I < 0x38800000U )
+            {
+                // The number is too small to be represented as a normalized float11
+                // Convert it to a denormalized value.
+                uint32_t Shift = 113U - ( I >> 23U );
+                I = ( 0x800000U | ( I & 0x7FFFFFU ) ) >> Shift;
+            }
+            else
+            {
+                // Rebias the exponent to represent the value as a normalized float11
+                I += 0xC8000000U;
+            }
+
+            Result[j] = ( ( I + 0xFFFFU + ( ( I >> 17U ) & 1U ) ) >> 17U ) & 0x7ffU;
+        }
+    }
+
+    // Z Channel (5-bit exponent, 5-bit mantissa)
+    uint32_t Sign = IValue[2] & 0x80000000;
+    uint32_t I = IValue[2] & 0x7FFFFFFF;
+
+    if ( ( I & 0x7F800000 ) == 0x7F800000 )
+    {
+        // INF or NAN
+        Result[2] = 0x3e0;
+        if ( I & 0x7FFFFF )
+        {
+            Result[2] = 0x3e0 | ( ( ( I >> 18 ) | ( I >> 13 ) | ( I >> 3 ) | ( I ) ) & 0x1f );
+        }
+        else if ( Sign )
+        {
+            // -INF is clamped to 0 since 3PK is positive only
+            Result[2] = 0;
+        }
+    }
+    else if ( Sign )
+    {
+        // 3PK is positive only, so clamp to zero
+        Result[2] = 0;
+    }
+    else if ( I > 0x477C0000U )
+    {
+        // The number is too large to be represented as a float10, set to max
+        Result[2] = 0x3df;
+    }
+    else
+    {
+        if ( I < 0x38800000U )
+        {
+            // The number is too small to be represented as a normalized float10
+            // Convert it to a denormalized value.
+            uint32_t Shift = 113U - ( I >> 23U );
+            I = ( 0x800000U | ( I & 0x7FFFFFU ) ) >> Shift;
+        }
+        else
+        {
+            // Rebias the exponent to represent the value as a normalized float10
+            I += 0xC8000000U;
+        }
+
+        Result[2] = ( ( I + 0x1FFFFU + ( ( I >> 18U ) & 1U ) ) >> 18U ) & 0x3ffU;
+    }
+
+    // Pack Result into memory
+    pDestination->v = ( Result[0] & 0x7ff ) | ( ( Result[1] & 0x7ff ) << 11 ) | ( ( Result[2] & 0x3ff ) << 22 );
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat3SE( const XMFLOAT3SE* pSource )
+{
+    union { float f; int32_t i; } fi;
+    fi.i = 0x33800000 + ( static_cast<int32_t>( pSource->e ) << 23 );
+    float Scale = fi.f;
+
+    return XMVectorSet( Scale * float( pSource->xm ), Scale * float( pSource->ym ), Scale * float( pSource->zm ), 1.0f );
+}
+
+inline void XM_CALLCONV XMStoreFloat3SE( XMFLOAT3SE* pDestination, FXMVECTOR V )
+{
+    XMFLOAT4A tmp;
+    XMStoreFloat4A( &tmp, V );
+
+    static const float maxf9 = float( 0x1FF << 7 );
+    static const float minf9 = float( 1.f / ( 1 << 16 ) );
+
+    float x = ( tmp.x >= 0.f ) ? ( ( tmp.x > maxf9 ) ? maxf9 : tmp.x ) : 0.f;
+    float y = ( tmp.y >= 0.f ) ? ( ( tmp.y > maxf9 ) ? maxf9 : tmp.y ) : 0.f;
+    float z = ( tmp.z >= 0.f ) ? ( ( tmp.z > maxf9 ) ? maxf9 : tmp.z ) : 0.f;
+
+    const float max_xy = ( x > y ) ? x : y;
+    const float max_xyz = ( max_xy > z ) ? max_xy : z;
+
+    const float maxColor = ( max_xyz > minf9 ) ? max_xyz : minf9;
+
+    union { float f; int32_t i; } fi;
+    fi.f = maxColor;
+    fi.i += 0x00004000; // round up leaving 9 bits in fraction (including assumed 1)
+
+    uint32_t exp = static_cast<uint32_t>( fi.i ) >> 23;
+    pDestination->e = exp - 0x6f;
+
+    fi.i = static_cast<int32_t>( 0x83000000 - ( exp << 23 ) );
+    float ScaleR = fi.f;
+
+    pDestination->xm = static_cast<uint32_t>( Internal::round_to_nearest( x * ScaleR ) );
+    pDestination->ym = static_cast<uint32_t>( Internal::round_to_nearest( y * ScaleR ) );
+    pDestination->zm = static_cast<uint32_t>( Internal::round_to_nearest( z * ScaleR ) );
+}
+
+} // namespace PackedVector
+
+} // namespace DirectX
@@ -0,0 +1,222 @@
+//-------------------------------------------------------------------------------------
+// winadapter.h
+//
+// DirectX Texture Library - Windows types and helpers for non-Windows builds
+//
+// Supplies the subset of the Windows SDK that the DDS, block compression, conversion
+// and resize code uses (basic types, HRESULT codes, SAL annotations, SRW locks, fiber
+// local storage and the CRT's secure/aligned helpers) on top of POSIX. WIC, D3D11 and
+// the Win32 file APIs are not provided; those parts of the library are Windows only.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#if defined(_WIN32)
+#error winadapter.h is only for non-Windows builds
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+
+//---------------------------------------------------------------------------------
+// Basic types
+typedef int32_t         HRESULT;
+typedef uint32_t        DWORD;
+typedef uint32_t        UINT;
+typedef int32_t         LONG;
+typedef uint32_t        ULONG;
+typedef int             BOOL;
+typedef uint8_t         BYTE;
+typedef size_t          SIZE_T;
+typedef uintptr_t       ULONG_PTR;
+typedef void            VOID;
+typedef void*           PVOID;
+typedef void*           LPVOID;
+typedef const void*     LPCVOID;
+typedef wchar_t         WCHAR;
+typedef const wchar_t*  LPCWSTR;
+typedef wchar_t*        LPWSTR;
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+#define WINAPI
+#define __cdecl
+
+//---------------------------------------------------------------------------------
+// HRESULT
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+#define S_OK                    ((HRESULT)0L)
+#define S_FALSE                 ((HRESULT)1L)
+#define E_NOTIMPL               ((HRESULT)0x80004001L)
+#define E_NOINTERFACE           ((HRESULT)0x80004002L)
+#define E_POINTER               ((HRESULT)0x80004003L)
+#define E_ABORT                 ((HRESULT)0x80004004L)
+#define E_FAIL                  ((HRESULT)0x80004005L)
+#define E_PENDING               ((HRESULT)0x8000000AL)
+#define E_UNEXPECTED            ((HRESULT)0x8000FFFFL)
+#define E_OUTOFMEMORY           ((HRESULT)0x8007000EL)
+#define E_INVALIDARG            ((HRESULT)0x80070057L)
+
+#define ERROR_FILE_NOT_FOUND        2L
+#define ERROR_ACCESS_DENIED         5L
+#define ERROR_INVALID_DATA          13L
+#define ERROR_HANDLE_EOF            38L
+#define ERROR_NOT_SUPPORTED         50L
+#define ERROR_INSUFFICIENT_BUFFER   122L
+#define ERROR_ARITHMETIC_OVERFLOW   534L
+#define ERROR_FILE_TOO_LARGE        223L
+
+#define FACILITY_WIN32  7
+#define HRESULT_FROM_WIN32(x) \
+    ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((uint32_t)(x) & 0x0000FFFF) | (FACILITY_WIN32 << 16) | 0x80000000)))
+
+#define E_NOT_SUFFICIENT_BUFFER HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)
+
+//---------------------------------------------------------------------------------
+// Misc macros
+#ifndef MAKEFOURCC
+#define MAKEFOURCC(ch0, ch1, ch2, ch3) \
+    ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) | \
+    ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+
+template <typename T, size_t N> char (&_countof_helper( T (&)[N] ))[N];
+#define _countof(a) (sizeof(_countof_helper(a)))
+#define ARRAYSIZE(a) _countof(a)
+
+#define _isnan(x) isnan(x)
+
+// __declspec(selectany), __declspec(align(n)) and __declspec(thread)
+#define __declspec(x) __declspec_##x
+#define __declspec_selectany __attribute__((weak))
+#define __declspec_align(n) __attribute__((aligned(n)))
+#define __declspec_thread __thread
+
+#define __forceinline inline __attribute__((always_inline))
+
+//---------------------------------------------------------------------------------
+// SAL annotations (no-ops)
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _In_count_(x)
+#define _In_range_(lo, hi)
+#define _In_reads_(x)
+#define _In_reads_opt_(x)
+#define _In_reads_bytes_(x)
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_all_(x)
+#define _Inout_updates_all_opt_(x)
+#define _Inout_updates_bytes_(x)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(x)
+#define _Out_writes_opt_(x)
+#define _Out_writes_bytes_(x)
+#define _Out_writes_bytes_to_(x, y)
+#define _Out_writes_bytes_to_opt_(x, y)
+#define _Outptr_
+#define _Deref_out_
+#define _Ret_maybenull_
+#define _Success_(x)
+#define _When_(x, y)
+#define _Use_decl_annotations_
+#define _Analysis_assume_(x)
+
+//---------------------------------------------------------------------------------
+// CRT helpers
+inline void* _aligned_malloc( size_t size, size_t alignment )
+{
+    void* p = nullptr;
+    return ( posix_memalign( &p, ( alignment < sizeof(void*) ) ? sizeof(void*) : alignment, size ) == 0 ) ? p : nullptr;
+}
+
+inline void _aligned_free( void* p )
+{
+    free( p );
+}
+
+inline int memcpy_s( void* dest, size_t destSize, const void* src, size_t count )
+{
+    if ( !count )
+        return 0;
+    if ( !dest || !src )
+        return EINVAL;
+    if ( destSize < count )
+    {
+        memset( dest, 0, destSize );
+        return ERANGE;
+    }
+    memcpy( dest, src, count );
+    return 0;
+}
+
+inline void* bsearch_s( const void* key, const void* base, size_t num, size_t width,
+                        int (*compare)( void*, const void*, const void* ), void* context )
+{
+    const uint8_t* first = reinterpret_cast<const uint8_t*>( base );
+    while ( num > 0 )
+    {
+        const uint8_t* mid = first + ( num / 2 ) * width;
+        int r = compare( context, key, mid );
+        if ( r == 0 )
+            return const_cast<uint8_t*>( mid );
+        if ( r > 0 )
+        {
+            first = mid + width;
+            num -= num / 2 + 1;
+        }
+        else
+        {
+            num /= 2;
+        }
+    }
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------
+// Slim reader/writer locks
+typedef pthread_rwlock_t SRWLOCK;
+#define SRWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+
+inline void InitializeSRWLock( SRWLOCK* lock )        { pthread_rwlock_init( lock, nullptr ); }
+inline void AcquireSRWLockExclusive( SRWLOCK* lock )  { pthread_rwlock_wrlock( lock ); }
+inline void ReleaseSRWLockExclusive( SRWLOCK* lock )  { pthread_rwlock_unlock( lock ); }
+inline void AcquireSRWLockShared( SRWLOCK* lock )     { pthread_rwlock_rdlock( lock ); }
+inline void ReleaseSRWLockShared( SRWLOCK* lock )     { pthread_rwlock_unlock( lock ); }
+
+//---------------------------------------------------------------------------------
+// Fiber local storage, mapped onto pthread keys: the callback runs when a thread that
+// stored a value exits. Unlike FlsFree, pthread_key_delete does not run the callbacks
+#define FLS_OUT_OF_INDEXES ((DWORD)0xFFFFFFFF)
+
+typedef void (*PFLS_CALLBACK_FUNCTION)( PVOID );
+
+inline DWORD FlsAlloc( PFLS_CALLBACK_FUNCTION callback )
+{
+    pthread_key_t key;
+    if ( pthread_key_create( &key, callback ) != 0 )
+        return FLS_OUT_OF_INDEXES;
+    static_assert( sizeof(pthread_key_t) <= sizeof(DWORD), "pthread_key_t does not fit a DWORD" );
+    return static_cast<DWORD>( key );
+}
+
+inline BOOL FlsFree( DWORD index )                  { return pthread_key_delete( static_cast<pthread_key_t>( index ) ) == 0; }
+inline PVOID FlsGetValue( DWORD index )             { return pthread_getspecific( static_cast<pthread_key_t>( index ) ); }
+inline BOOL FlsSetValue( DWORD index, PVOID value ) { return pthread_setspecific( static_cast<pthread_key_t>( index ), value ) == 0; }
@@ -18,14 +18,15 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //--------------------------------------------------------------------------------------
 
-#if defined(_MSC_VER) && (_MSC_VER > 1000)
 #pragma once
-#endif
 
 #if defined(_XBOX_ONE) && defined(_TITLE) && MONOLITHIC
 #include <d3d11_x.h>
-#else
+#elif defined(_WIN32)
 #include <dxgiformat.h>
+#else
+#include "Compat/winadapter.h"
+#include "Compat/dxgiformat.h"
 #endif
 
 // VS 2010's stdint.h conflicts with intsafe.h
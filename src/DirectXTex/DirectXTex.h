@@ -13,9 +13,7 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#if defined(_MSC_VER) && (_MSC_VER > 1000)
 #pragma once
-#endif
 
 #if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP) && (_WIN32_WINNT <= _WIN32_WINNT_WIN8)
 #error WIC is not supported on Windows Phone 8.0
@@ -33,11 +31,16 @@
 #if defined(_XBOX_ONE) && defined(_TITLE) && MONOLITHIC
 #include <d3d11_x.h>
 #define DCOMMON_H_INCLUDED
-#else
+#elif defined(_WIN32)
 #include <d3d11_1.h>
+#else
+#include "Compat/winadapter.h"
+#include "Compat/dxgiformat.h"
 #endif
 
+#if defined(_WIN32)
 #include <ocidl.h>
+#endif
 
 #define DIRECTX_TEX_VERSION 130
 
@@ -161,6 +164,10 @@ namespace DirectX
         DDS_FLAGS_EXPAND_LUMINANCE      = 0x20,
             // When loading legacy luminance formats expand replicating the color channels rather than leaving them packed (L8, L16, A8L8)
 
+        DDS_FLAGS_MEMORY_MAPPED         = 0x40,
+            // LoadFromDDSFile maps the file and loads from the mapping instead of reading through a temporary buffer; LoadFromDDSMemory treats
+            // the source as a file mapping. Either way only the requested subresources are prefetched (PrefetchVirtualMemory, or madvise on POSIX)
+
         DDS_FLAGS_FORCE_DX10_EXT        = 0x10000,
             // Always use the 'DX10' header extension for DDS writer (i.e. don't try to write DX9 compatible DDS files)
 
@@ -203,10 +210,26 @@ namespace DirectX
             // Filtering mode to use for any required image resizing (only needed when loading arrays of differently sized images; defaults to Fant)
     };
 
+    //---------------------------------------------------------------------------------
+    // Random-access byte source for streaming DDS loads
+    class DDSReadStream
+    {
+    public:
+        virtual ~DDSReadStream() {}
+
+        virtual HRESULT Read( _Out_writes_bytes_to_(size, bytesRead) void* pDestination, _In_ size_t size, _Out_ size_t& bytesRead ) = 0;
+            // Reads up to size bytes at the current position; returning 0 bytes indicates end of stream
+        virtual HRESULT Seek( _In_ uint64_t position ) = 0;
+            // Sets the read position relative to the start of the stream
+        virtual HRESULT GetSize( _Out_ uint64_t& size ) = 0;
+    };
+
     HRESULT GetMetadataFromDDSMemory( _In_reads_bytes_(size) LPCVOID pSource, _In_ size_t size, _In_ DWORD flags,
                                       _Out_ TexMetadata& metadata );
     HRESULT GetMetadataFromDDSFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags,
                                     _Out_ TexMetadata& metadata );
+    HRESULT GetMetadataFromDDSStream( _Inout_ DDSReadStream& stream, _In_ DWORD flags,
+                                      _Out_ TexMetadata& metadata );
 
     HRESULT GetMetadataFromTGAMemory( _In_reads_bytes_(size) LPCVOID pSource, _In_ size_t size,
                                       _Out_ TexMetadata& metadata );
@@ -218,6 +241,90 @@ namespace DirectX
     HRESULT GetMetadataFromWICFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags,
                                     _Out_ TexMetadata& metadata );
 
+    //---------------------------------------------------------------------------------
+    // Pixel memory allocators for ScratchImage and Blob
+    class IImageAllocator
+    {
+    public:
+        // Returns at least size bytes, 16-byte aligned, or nullptr; Free gets the same size back
+        virtual void* Allocate( _In_ size_t size ) = 0;
+        virtual void Free( _In_ void* pMemory, _In_ size_t size ) = 0;
+
+    protected:
+        ~IImageAllocator() {}
+    };
+
+    // ScratchImage and Blob objects constructed without an explicit allocator take the calling
+    // thread's allocator (nullptr = _aligned_malloc) and keep it for their lifetime
+    void SetThreadImageAllocator( _In_opt_ IImageAllocator* allocator );
+    IImageAllocator* GetThreadImageAllocator();
+
+    struct ImagePoolStats
+    {
+        uint64_t allocations;       // Allocate calls
+        uint64_t hits;              // ... served from a cached buffer
+        uint64_t frees;
+        uint64_t discards;          // Freed buffers not kept because the cache was full
+        size_t   outstandingBytes;  // Handed out and not yet freed
+        size_t   retainedBytes;     // Cached for reuse
+        size_t   peakRetainedBytes;
+    };
+
+    // Size-class pool: freed buffers are cached by rounded size (4 classes per power of two,
+    // 4 KB to 256 MB) and handed out again, up to maxRetainedBytes. Safe to free from any
+    // thread; the pool must outlive every buffer it hands out
+    class ImagePool : public IImageAllocator
+    {
+    public:
+        explicit ImagePool( _In_ size_t maxRetainedBytes = 32 * 1024 * 1024 );
+        virtual ~ImagePool();
+
+        virtual void* Allocate( _In_ size_t size ) override;
+        virtual void Free( _In_ void* pMemory, _In_ size_t size ) override;
+
+        // Releases every cached buffer
+        void Trim();
+
+        ImagePoolStats GetStats() const;
+
+    private:
+        static const size_t c_sizeClasses = 65;
+        static const size_t c_classDepth = 8;
+
+        mutable SRWLOCK _lock;
+        size_t          _maxRetainedBytes;
+        ImagePoolStats  _stats;
+        size_t          _outstandingBuffers;
+        bool            _retired;
+        size_t          _cachedCount[ c_sizeClasses ];
+        void*           _cached[ c_sizeClasses ][ c_classDepth ];
+
+        static size_t _GetSizeClass( _In_ size_t size, _Out_ size_t& classSize );
+        void _FreeCached();
+        void _Retire();
+
+        friend class ThreadImagePools;
+
+        ImagePool( const ImagePool& );
+        ImagePool& operator=( const ImagePool& );
+    };
+
+    // The calling thread's pool, created on first use (nullptr if out of memory). It is retired
+    // when the thread exits
+    ImagePool* GetThreadImagePool();
+
+    // Empties the calling thread's pool and retires it now; buffers still out are freed as they
+    // come back. Call when the thread is done with image work, e.g. from a worker's exit hook
+    void ReleaseThreadImagePool();
+
+    // Empties and retires the pools of every thread. Only for shutdown (e.g. DLL unload),
+    // when no thread will touch its pool again
+    void ReleaseImagePools();
+
+    // Frees the scanline buffers and filter tables that Convert, Resize, GenerateMipMaps and the
+    // BC decoders keep between calls on the calling thread (they also go when the thread exits)
+    void ReleaseScratchWorkspace();
+
     //---------------------------------------------------------------------------------
     // Bitmap image container
     struct Image
@@ -234,9 +341,11 @@ namespace DirectX
     {
     public:
         ScratchImage()
-            : _nimages(0), _size(0), _image(nullptr), _memory(nullptr) {}
+            : _nimages(0), _size(0), _image(nullptr), _memory(nullptr), _allocator(GetThreadImageAllocator()) {}
+        explicit ScratchImage(_In_opt_ IImageAllocator* allocator)
+            : _nimages(0), _size(0), _image(nullptr), _memory(nullptr), _allocator(allocator) {}
         ScratchImage(ScratchImage&& moveFrom)
-            : _nimages(0), _size(0), _image(nullptr), _memory(nullptr) { *this = std::move(moveFrom); }
+            : _nimages(0), _size(0), _image(nullptr), _memory(nullptr), _allocator(nullptr) { *this = std::move(moveFrom); }
         ~ScratchImage() { Release(); }
 
         ScratchImage& operator= (ScratchImage&& moveFrom);
@@ -274,19 +383,56 @@ namespace DirectX
         TexMetadata _metadata;
         Image*      _image;
         uint8_t*    _memory;
+        IImageAllocator* _allocator;
 
         // Hide copy constructor and assignment operator
         ScratchImage( const ScratchImage& );
         ScratchImage& operator=( const ScratchImage& );
     };
 
+    //---------------------------------------------------------------------------------
+    // Non-owning image container: the images point into caller-owned pixel memory laid out
+    // as in a ScratchImage / DDS file, which must outlive the view
+    class ImageSetView
+    {
+    public:
+        ImageSetView()
+            : _nimages(0), _metadata(), _image(nullptr) {}
+        ImageSetView(ImageSetView&& moveFrom)
+            : _nimages(0), _metadata(), _image(nullptr) { *this = std::move(moveFrom); }
+        ~ImageSetView() { Release(); }
+
+        ImageSetView& operator= (ImageSetView&& moveFrom);
+
+        HRESULT Initialize( _In_ const TexMetadata& mdata, _In_reads_bytes_(size) const uint8_t* pPixels, _In_ size_t size,
+                            _In_ DWORD flags = CP_FLAGS_NONE );
+
+        void Release();
+
+        const TexMetadata& GetMetadata() const { return _metadata; }
+        const Image* GetImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice) const;
+
+        const Image* GetImages() const { return _image; }
+        size_t GetImageCount() const { return _nimages; }
+
+    private:
+        size_t      _nimages;
+        TexMetadata _metadata;
+        Image*      _image;
+
+        // Hide copy constructor and assignment operator
+        ImageSetView( const ImageSetView& );
+        ImageSetView& operator=( const ImageSetView& );
+    };
+
     //---------------------------------------------------------------------------------
     // Memory blob (allocated buffer pointer is always 16-byte aligned)
     class Blob
     {
     public:
-        Blob() : _buffer(nullptr), _size(0) {}
-        Blob(Blob&& moveFrom) : _buffer(nullptr), _size(0) { *this = std::move(moveFrom); }
+        Blob() : _buffer(nullptr), _size(0), _allocator(GetThreadImageAllocator()) {}
+        explicit Blob(_In_opt_ IImageAllocator* allocator) : _buffer(nullptr), _size(0), _allocator(allocator) {}
+        Blob(Blob&& moveFrom) : _buffer(nullptr), _size(0), _allocator(nullptr) { *this = std::move(moveFrom); }
         ~Blob() { Release(); }
 
         Blob& operator= (Blob&& moveFrom);
@@ -301,6 +447,7 @@ namespace DirectX
     private:
         void*   _buffer;
         size_t  _size;
+        IImageAllocator* _allocator;
 
         // Hide copy constructor and assignment operator
         Blob( const Blob& );
@@ -316,6 +463,26 @@ namespace DirectX
     HRESULT LoadFromDDSFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags,
                              _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
 
+    HRESULT LoadFromDDSMemory( _In_reads_bytes_(size) LPCVOID pSource, _In_ size_t size, _In_ DWORD flags,
+                               _In_ size_t mipBase, _In_ size_t mipLevels, _In_ size_t itemBase, _In_ size_t arraySize,
+                               _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
+    HRESULT LoadFromDDSFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags,
+                             _In_ size_t mipBase, _In_ size_t mipLevels, _In_ size_t itemBase, _In_ size_t arraySize,
+                             _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
+        // Loads only the given mip range of the given array items; a count of 0 means "through the last one"
+        // For volume textures itemBase must be 0 and all slices of each loaded level are returned
+        // The returned metadata describes the loaded subset (a partial cubemap is returned as a 2D texture array)
+
+    HRESULT LoadFromDDSMemory( _In_reads_bytes_(size) LPCVOID pSource, _In_ size_t size, _In_ DWORD flags,
+                               _Out_opt_ TexMetadata* metadata, _Out_ ImageSetView& view );
+        // Zero-copy load: the view's images point into pSource, which must outlive the view
+        // Returns HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED ) for legacy formats that need expansion, swizzling or an alpha fill
+
+    HRESULT LoadFromDDSStream( _Inout_ DDSReadStream& stream, _In_ DWORD flags,
+                               _In_ size_t mipBase, _In_ size_t mipLevels, _In_ size_t itemBase, _In_ size_t arraySize,
+                               _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
+        // Same as the ranged LoadFromDDSFile, but only the header and the requested subresources are read from the stream
+
     HRESULT SaveToDDSMemory( _In_ const Image& image, _In_ DWORD flags,
                              _Out_ Blob& blob );
     HRESULT SaveToDDSMemory( _In_reads_(nimages) const Image* images, _In_ size_t nimages, _In_ const TexMetadata& metadata, _In_ DWORD flags,
@@ -339,6 +506,7 @@ namespace DirectX
     HRESULT LoadFromWICFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags,
                              _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
 
+#if defined(_WIN32)
     HRESULT SaveToWICMemory( _In_ const Image& image, _In_ DWORD flags, _In_ REFGUID guidContainerFormat,
                              _Out_ Blob& blob, _In_opt_ const GUID* targetFormat = nullptr, _In_opt_ std::function<void(IPropertyBag2*)> setCustomProps = nullptr );
     HRESULT SaveToWICMemory( _In_count_(nimages) const Image* images, _In_ size_t nimages, _In_ DWORD flags, _In_ REFGUID guidContainerFormat,
@@ -361,6 +529,7 @@ namespace DirectX
     };
 
     REFGUID GetWICCodec( _In_ WICCodecs codec );
+#endif
 
     //---------------------------------------------------------------------------------
     // Texture conversion, resizing, mipmap generation, and block compression
@@ -512,16 +681,40 @@ namespace DirectX
                       _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef, _Out_ ScratchImage& cImages );
         // Note that alphaRef is only used by BC1. 0.5f is a typical value to use
 
+#if defined(_WIN32)
     HRESULT Compress( _In_ ID3D11Device* pDevice, _In_ const Image& srcImage, _In_ DXGI_FORMAT format, _In_ DWORD compress,
                       _In_ float alphaWeight, _Out_ ScratchImage& image );
     HRESULT Compress( _In_ ID3D11Device* pDevice, _In_ const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
                       _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaWeight, _Out_ ScratchImage& cImages );
         // DirectCompute-based compression (alphaWeight is only used by BC7. 1.0 is the typical value to use)
+#endif
 
     HRESULT Decompress( _In_ const Image& cImage, _In_ DXGI_FORMAT format, _Out_ ScratchImage& image );
     HRESULT Decompress( _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
                         _In_ DXGI_FORMAT format, _Out_ ScratchImage& images );
 
+    HRESULT Decompress( _In_ const Image& cImage, _In_ DXGI_FORMAT format, _In_ size_t maxThreads, _Out_ ScratchImage& image );
+    HRESULT Decompress( _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+                        _In_ DXGI_FORMAT format, _In_ size_t maxThreads, _Out_ ScratchImage& images );
+        // Multithreaded across block rows and subresources on at most maxThreads threads (0 uses the OpenMP default);
+        // returns E_NOTIMPL if the library was built without OpenMP
+
+    HRESULT DecompressAndResize( _In_ const Image& cImage, _In_ size_t width, _In_ size_t height, _In_ DXGI_FORMAT format,
+                                 _In_ DWORD filter, _Out_ ScratchImage& image );
+        // Decodes and area filters to width x height in one pass without a full size intermediate (box filtering only)
+
+    HRESULT DecompressAndResize( _In_ const Image& cImage, _In_ DWORD filter, _In_ const Image& destImage );
+        // As above, but writes into caller-owned storage (e.g. a DIB section); size and format come from destImage
+
+    HRESULT DecompressBlocks( _In_ DXGI_FORMAT bcFormat, _In_ const uint8_t* pBlocks,
+                              _In_ size_t width, _In_ size_t height, _In_ DXGI_FORMAT format,
+                              _Out_writes_bytes_(rowPitch * height) uint8_t* pDest, _In_ size_t rowPitch );
+        // Decodes one row of consecutive blocks covering width x height texels (height <= 4) into caller-owned storage;
+        // the format dispatch happens once per call, not once per block
+
+    HRESULT DecompressBlockAverage( _In_ const Image& cImage, _In_ DXGI_FORMAT format, _Out_ ScratchImage& image );
+        // Emits one texel per 4x4 block (quarter resolution), averaged from block endpoints where the format allows
+
     //---------------------------------------------------------------------------------
     // Normal map operations
 
@@ -591,6 +784,7 @@ namespace DirectX
 
     HRESULT ComputeMSE( _In_ const Image& image1, _In_ const Image& image2, _Out_ float& mse, _Out_writes_opt_(4) float* mseV, _In_ DWORD flags = 0 );
 
+#if defined(_WIN32)
     //---------------------------------------------------------------------------------
     // Direct3D 11 functions
     bool IsSupportedTexture( _In_ ID3D11Device* pDevice, _In_ const TexMetadata& metadata );
@@ -610,6 +804,7 @@ namespace DirectX
                                         _Outptr_ ID3D11ShaderResourceView** ppSRV );
 
     HRESULT CaptureTexture( _In_ ID3D11Device* pDevice, _In_ ID3D11DeviceContext* pContext, _In_ ID3D11Resource* pSource, _Out_ ScratchImage& result );
+#endif
 
 #include "DirectXTex.inl"
 
@@ -13,14 +13,14 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
 #ifdef _OPENMP
 #include <omp.h>
 #pragma warning(disable : 4616 6993)
 #endif
 
-#include "bc.h"
+#include "BC.h"
 
 
 namespace DirectX
@@ -354,7 +354,86 @@ static DXGI_FORMAT _DefaultDecompress( _In_ DXGI_FORMAT format )
 
 
 //-------------------------------------------------------------------------------------
-static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result )
+inline static bool _DetermineDecoderSettings( _In_ DXGI_FORMAT format, _Out_ DXGI_FORMAT& cformat, _Out_ BC_DECODE& pfDecode, _Out_ size_t& sbpp )
+{
+    // Promote "typeless" BC formats
+    switch( format )
+    {
+    case DXGI_FORMAT_BC1_TYPELESS:  cformat = DXGI_FORMAT_BC1_UNORM; break;
+    case DXGI_FORMAT_BC2_TYPELESS:  cformat = DXGI_FORMAT_BC2_UNORM; break;
+    case DXGI_FORMAT_BC3_TYPELESS:  cformat = DXGI_FORMAT_BC3_UNORM; break;
+    case DXGI_FORMAT_BC4_TYPELESS:  cformat = DXGI_FORMAT_BC4_UNORM; break;
+    case DXGI_FORMAT_BC5_TYPELESS:  cformat = DXGI_FORMAT_BC5_UNORM; break;
+    case DXGI_FORMAT_BC6H_TYPELESS: cformat = DXGI_FORMAT_BC6H_UF16; break;
+    case DXGI_FORMAT_BC7_TYPELESS:  cformat = DXGI_FORMAT_BC7_UNORM; break;
+    default:                        cformat = format;                break;
+    }
+
+    switch( cformat )
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   sbpp = 8;   break;
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   sbpp = 16;  break;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   sbpp = 16;  break;
+    case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  sbpp = 8;   break;
+    case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  sbpp = 8;   break;
+    case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  sbpp = 16;  break;
+    case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  sbpp = 16;  break;
+    case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; sbpp = 16;  break;
+    case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; sbpp = 16;  break;
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   sbpp = 16;  break;
+    default:
+        pfDecode = nullptr;
+        sbpp = 0;
+        return false;
+    }
+
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Decodes one row of blocks (width x height texels, height <= 4) into XMVECTOR scanlines
+// of the given stride, then converts and stores each scanline with a single call
+//-------------------------------------------------------------------------------------
+static bool _DecodeBlockRow( _In_ BC_DECODE pfDecode, _In_ size_t sbpp, _In_ DXGI_FORMAT cformat,
+                             _In_reads_bytes_(((width + 3) / 4) * sbpp) const uint8_t *pBC, _In_ size_t width, _In_ size_t height,
+                             _In_ DXGI_FORMAT format, _Out_writes_bytes_(rowPitch*height) uint8_t *pDest, _In_ size_t rowPitch,
+                             _Out_writes_(stride*4) XMVECTOR *scanlines, _In_ size_t stride )
+{
+    assert( pfDecode && pBC && pDest && scanlines );
+    assert( height > 0 && height <= 4 && stride >= width );
+
+    XMVECTOR temp[16];
+    for( size_t x = 0; x < width; x += 4, pBC += sbpp )
+    {
+        pfDecode( temp, pBC );
+
+        const size_t pw = std::min<size_t>( 4, width - x );
+        for( size_t y = 0; y < height; ++y )
+            memcpy( &scanlines[ y * stride + x ], &temp[ y * 4 ], pw * sizeof(XMVECTOR) );
+    }
+
+    for( size_t y = 0; y < height; ++y )
+    {
+        XMVECTOR *scanline = &scanlines[ y * stride ];
+        _ConvertScanline( scanline, width, format, cformat, 0 );
+
+        if ( !_StoreScanline( pDest + y * rowPitch, rowPitch, format, scanline, width ) )
+            return false;
+    }
+
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Decodes block rows [ blockRow, blockRow + blockRows ) of cImage
+//-------------------------------------------------------------------------------------
+static HRESULT _DecompressBCRows( _In_ const Image& cImage, _In_ const Image& result, _In_ size_t blockRow, _In_ size_t blockRows )
 {
     if ( !cImage.pixels || !result.pixels )
         return E_POINTER;
@@ -376,91 +455,444 @@ static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result
     // Round to bytes
     dbpp = ( dbpp + 7 ) / 8;
 
-    uint8_t *pDest = result.pixels;
+    assert( blockRow * 4 < cImage.height && blockRows > 0 );
+    const size_t hEnd = std::min<size_t>( cImage.height, ( blockRow + blockRows ) * 4 );
+
+    uint8_t *pDest = result.pixels + blockRow * 4 * result.rowPitch;
     if ( !pDest )
         return E_POINTER;
 
-    // Promote "typeless" BC formats
+    // 8-bit (and BC6H to half) destinations skip the XMVECTOR decode / convert / store round trip
+    BC_DECODE_ROW pfDecodeRow = D3DXGetDecodeRow( cImage.format, format );
+    if ( pfDecodeRow )
+    {
+        const uint8_t *pSrc = cImage.pixels + blockRow * cImage.rowPitch;
+        for( size_t h=blockRow * 4; h < hEnd; h += 4 )
+        {
+            pfDecodeRow( pDest, result.rowPitch, pSrc, cImage.width, std::min<size_t>( 4, cImage.height - h ) );
+
+            pSrc += cImage.rowPitch;
+            pDest += result.rowPitch*4;
+        }
+
+        return S_OK;
+    }
+
+    // Determine BC format decoder
     DXGI_FORMAT cformat;
-    switch( cImage.format )
+    BC_DECODE pfDecode;
+    size_t sbpp;
+    if ( !_DetermineDecoderSettings( cImage.format, cformat, pfDecode, sbpp ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    // Four scanlines for a whole row of blocks, so conversion and store are dispatched once per scanline
+    const size_t stride = ( cImage.width + 3 ) & ~size_t(3);
+    ScopedScratchArray<XMVECTOR> scanlines( stride * 4 );
+    if ( !scanlines )
+        return E_OUTOFMEMORY;
+
+    const uint8_t *pSrc = cImage.pixels + blockRow * cImage.rowPitch;
+    for( size_t h=blockRow * 4; h < hEnd; h += 4 )
     {
-    case DXGI_FORMAT_BC1_TYPELESS:  cformat = DXGI_FORMAT_BC1_UNORM; break;
-    case DXGI_FORMAT_BC2_TYPELESS:  cformat = DXGI_FORMAT_BC2_UNORM; break;
-    case DXGI_FORMAT_BC3_TYPELESS:  cformat = DXGI_FORMAT_BC3_UNORM; break;
-    case DXGI_FORMAT_BC4_TYPELESS:  cformat = DXGI_FORMAT_BC4_UNORM; break;
-    case DXGI_FORMAT_BC5_TYPELESS:  cformat = DXGI_FORMAT_BC5_UNORM; break;
-    case DXGI_FORMAT_BC6H_TYPELESS: cformat = DXGI_FORMAT_BC6H_UF16; break;
-    case DXGI_FORMAT_BC7_TYPELESS:  cformat = DXGI_FORMAT_BC7_UNORM; break;
-    default:                        cformat = cImage.format;         break;
+        if ( !_DecodeBlockRow( pfDecode, sbpp, cformat, pSrc, cImage.width, std::min<size_t>( 4, cImage.height - h ),
+                               format, pDest, result.rowPitch, scanlines.get(), stride ) )
+            return E_FAIL;
+
+        pSrc += cImage.rowPitch;
+        pDest += result.rowPitch*4;
+    }
+
+    return S_OK;
+}
+
+static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result )
+{
+    return _DecompressBCRows( cImage, result, 0, ( cImage.height + 3 ) / 4 );
+}
+
+
+//-------------------------------------------------------------------------------------
+#ifdef _OPENMP
+struct DecompressBand
+{
+    size_t image;
+    size_t blockRow;
+    size_t blockRows;
+};
+
+// Splits every image into bands of block rows and decodes the bands of all images on up to
+// maxThreads OpenMP threads, so both one huge image and a long array of small slices scale
+static HRESULT _DecompressBC_Parallel( _In_reads_(nimages) const Image* cImages, _In_reads_(nimages) const Image* results,
+                                       _In_ size_t nimages, _In_ size_t maxThreads )
+{
+    // Roughly this many destination bytes per band: small slices stay whole, large images are
+    // cut into enough bands to balance
+    static const size_t BAND_BYTES = 256 * 1024;
+
+    std::unique_ptr<DecompressBand[]> bands;
+    size_t nBands = 0;
+    for( size_t pass = 0; pass < 2; ++pass )
+    {
+        if ( pass == 1 )
+        {
+            bands.reset( new (std::nothrow) DecompressBand[ nBands ] );
+            if ( !bands )
+                return E_OUTOFMEMORY;
+            nBands = 0;
+        }
+
+        for( size_t index=0; index < nimages; ++index )
+        {
+            const size_t nbHeight = ( cImages[ index ].height + 3 ) / 4;
+            const size_t bandRows = std::max<size_t>( 1, BAND_BYTES / std::max<size_t>( 1, results[ index ].rowPitch * 4 ) );
+
+            for( size_t row = 0; row < nbHeight; row += bandRows, ++nBands )
+            {
+                if ( pass == 1 )
+                {
+                    bands[ nBands ].image = index;
+                    bands[ nBands ].blockRow = row;
+                    bands[ nBands ].blockRows = std::min<size_t>( bandRows, nbHeight - row );
+                }
+            }
+        }
+    }
+
+    if ( nBands > INT32_MAX )
+        return E_FAIL;
+
+    int threads = omp_get_max_threads();
+    if ( maxThreads > 0 && maxThreads < static_cast<size_t>( threads ) )
+        threads = static_cast<int>( maxThreads );
+    threads = std::max<int>( 1, std::min<int>( threads, static_cast<int>( nBands ) ) );
+
+    HRESULT hr = S_OK;
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for( int nb=0; nb < static_cast<int>( nBands ); ++nb )
+    {
+        const DecompressBand& band = bands[ nb ];
+
+        HRESULT hrBand = _DecompressBCRows( cImages[ band.image ], results[ band.image ], band.blockRow, band.blockRows );
+        if ( FAILED(hrBand) )
+        {
+#pragma omp critical
+            hr = hrBand;
+        }
+    }
+
+    return hr;
+}
+#endif // _OPENMP
+
+
+//-------------------------------------------------------------------------------------
+// Area filter footprint of one destination texel along an axis
+//-------------------------------------------------------------------------------------
+struct AreaSpan
+{
+    size_t start;       // First source texel covered
+    size_t count;       // Number of source texels covered
+    size_t weight;      // Index of the first weight for this span
+};
+
+static bool _CreateAreaSpans( _In_ size_t srcSize, _In_ size_t destSize,
+                              _Out_ std::unique_ptr<AreaSpan[]>& spans, _Out_ std::unique_ptr<float[]>& weights )
+{
+    assert( srcSize > 0 && destSize > 0 );
+
+    const double scale = double(srcSize) / double(destSize);
+
+    // Each destination texel covers 'scale' source texels, which straddle at most ceil(scale) + 1 of them
+    const size_t maxTaps = static_cast<size_t>( scale ) + 2;
+
+    spans.reset( new (std::nothrow) AreaSpan[ destSize ] );
+    weights.reset( new (std::nothrow) float[ destSize * maxTaps ] );
+    if ( !spans || !weights )
+        return false;
+
+    size_t index = 0;
+    for( size_t x = 0; x < destSize; ++x )
+    {
+        double x0 = double(x) * scale;
+        double x1 = ( x + 1 < destSize ) ? double(x + 1) * scale : double(srcSize);
+
+        size_t i0 = std::min<size_t>( static_cast<size_t>( x0 ), srcSize - 1 );
+        size_t i1 = static_cast<size_t>( x1 );
+        if ( double(i1) < x1 )
+            ++i1;
+        i1 = std::min<size_t>( i1, srcSize );
+        if ( i1 <= i0 )
+            i1 = i0 + 1;
+
+        assert( ( i1 - i0 ) <= maxTaps );
+
+        spans[ x ].start = i0;
+        spans[ x ].count = i1 - i0;
+        spans[ x ].weight = index;
+
+        const double norm = 1.0 / ( x1 - x0 );
+        for( size_t i = i0; i < i1; ++i )
+        {
+            double overlap = std::min<double>( double(i + 1), x1 ) - std::max<double>( double(i), x0 );
+            weights[ index++ ] = static_cast<float>( std::max<double>( overlap, 0.0 ) * norm );
+        }
+    }
+
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Decodes one 4-row block row at a time into a small ring and accumulates it straight into
+// the area filtered destination, so the full resolution image is never materialized
+//-------------------------------------------------------------------------------------
+static HRESULT _DecompressAndResizeBC( _In_ const Image& cImage, _In_ DWORD filter, _In_ const Image& result )
+{
+    if ( !cImage.pixels || !result.pixels )
+        return E_POINTER;
+
+    if ( !cImage.width || !cImage.height || !result.width || !result.height )
+        return E_INVALIDARG;
+
+    const DXGI_FORMAT format = result.format;
+    size_t dbpp = BitsPerPixel( format );
+    if ( !dbpp )
+        return E_FAIL;
+
+    if ( dbpp < 8 )
+    {
+        // We don't support decompressing to monochrome (DXGI_FORMAT_R1_UNORM)
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
     // Determine BC format decoder
+    DXGI_FORMAT cformat;
     BC_DECODE pfDecode;
     size_t sbpp;
-    switch(cformat)
+    if ( !_DetermineDecoderSettings( cImage.format, cformat, pfDecode, sbpp ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    const size_t nblocks = ( cImage.width + 3 ) / 4;
+    if ( cImage.rowPitch < nblocks * sbpp )
+        return E_FAIL;
+
+    // sRGB sources are filtered in linear space and re-encoded on store
+    bool srgbIn = false;
+    switch( cformat )
     {
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        filter |= TEX_FILTER_SRGB;
+        srgbIn = true;
+        break;
+
     case DXGI_FORMAT_BC1_UNORM:
-    case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   sbpp = 8;   break;
     case DXGI_FORMAT_BC2_UNORM:
-    case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   sbpp = 16;  break;
     case DXGI_FORMAT_BC3_UNORM:
-    case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   sbpp = 16;  break;
-    case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  sbpp = 8;   break;
-    case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  sbpp = 8;   break;
-    case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  sbpp = 16;  break;
-    case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  sbpp = 16;  break;
-    case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; sbpp = 16;  break;
-    case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; sbpp = 16;  break;
     case DXGI_FORMAT_BC7_UNORM:
-    case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   sbpp = 16;  break;
+        srgbIn = ( filter & TEX_FILTER_SRGB_IN ) != 0;
+        break;
+
     default:
-        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+        filter &= ~TEX_FILTER_SRGB_IN;
+        break;
     }
 
+    std::unique_ptr<AreaSpan[]> colSpans;
+    std::unique_ptr<float[]> colWeights;
+    std::unique_ptr<AreaSpan[]> rowSpans;
+    std::unique_ptr<float[]> rowWeights;
+    if ( !_CreateAreaSpans( cImage.width, result.width, colSpans, colWeights )
+         || !_CreateAreaSpans( cImage.height, result.height, rowSpans, rowWeights ) )
+        return E_OUTOFMEMORY;
+
+    // Allocate temporary space (4 source scanlines + 1 accumulation scanline)
+    ScopedScratchArray<XMVECTOR> scanline( cImage.width*4 + result.width );
+    if ( !scanline )
+        return E_OUTOFMEMORY;
+
+    XMVECTOR* ring = scanline.get();
+    XMVECTOR* accum = ring + cImage.width*4;
+    memset( accum, 0, sizeof(XMVECTOR) * result.width );
+
     XMVECTOR temp[16];
     const uint8_t *pSrc = cImage.pixels;
-    const size_t rowPitch = result.rowPitch;
-    for( size_t h=0; h < cImage.height; h += 4 )
+    uint8_t *pDest = result.pixels;
+    size_t dy = 0;
+
+    for( size_t h = 0; h < cImage.height; h += 4 )
     {
+        const size_t ph = std::min<size_t>( 4, cImage.height - h );
+
+        // Decode the block row
         const uint8_t *sptr = pSrc;
-        uint8_t* dptr = pDest;
-        size_t ph = std::min<size_t>( 4, cImage.height - h );
-        size_t w = 0;
-        for( size_t count = 0; count < cImage.rowPitch; count += sbpp, w += 4 )
+        for( size_t w = 0; w < cImage.width; w += 4 )
         {
             pfDecode( temp, sptr );
             _ConvertScanline( temp, 16, format, cformat, 0 );
 
+            if ( srgbIn )
+                _LinearizeScanline( temp, 16 );
+
             size_t pw = std::min<size_t>( 4, cImage.width - w );
-            assert( pw > 0 && ph > 0 );
+            for( size_t r = 0; r < ph; ++r )
+            {
+                XMVECTOR* dptr = ring + r*cImage.width + w;
+                for( size_t i = 0; i < pw; ++i )
+                    dptr[ i ] = temp[ r*4 + i ];
+            }
 
-            if ( !_StoreScanline( dptr, rowPitch, format, &temp[0], pw ) )
-                return E_FAIL;
+            sptr += sbpp;
+        }
 
-            if ( ph > 1 )
+        // Filter each decoded scanline into the destination rows it covers
+        for( size_t r = 0; r < ph; ++r )
+        {
+            const size_t y = h + r;
+            const XMVECTOR* urow = ring + r*cImage.width;
+
+            while( dy < result.height )
             {
-                if ( !_StoreScanline( dptr + rowPitch, rowPitch, format, &temp[4], pw ) )
-                    return E_FAIL;
+                const AreaSpan& vspan = rowSpans[ dy ];
+                if ( y < vspan.start )
+                    break;
 
-                if ( ph > 2 )
+                const float vweight = rowWeights[ vspan.weight + ( y - vspan.start ) ];
+                if ( vweight > 0.f )
                 {
-                    if ( !_StoreScanline( dptr + rowPitch*2, rowPitch, format, &temp[8], pw ) )
-                        return E_FAIL;
-
-                    if ( ph > 3 )
+                    for( size_t x = 0; x < result.width; ++x )
                     {
-                        if ( !_StoreScanline( dptr + rowPitch*3, rowPitch, format, &temp[12], pw ) )
-                            return E_FAIL;
+                        const AreaSpan& hspan = colSpans[ x ];
+                        const float* hweights = &colWeights[ hspan.weight ];
+                        const XMVECTOR* uptr = urow + hspan.start;
+
+                        XMVECTOR v = XMVectorZero();
+                        for( size_t i = 0; i < hspan.count; ++i )
+                            v = XMVectorMultiplyAdd( uptr[ i ], XMVectorReplicate( hweights[ i ] ), v );
+
+                        accum[ x ] = XMVectorMultiplyAdd( v, XMVectorReplicate( vweight ), accum[ x ] );
                     }
                 }
+
+                if ( y + 1 < vspan.start + vspan.count )
+                    break;
+
+                // Destination row complete
+                if ( !_StoreScanlineLinear( pDest, result.rowPitch, format, accum, result.width, filter ) )
+                    return E_FAIL;
+
+                memset( accum, 0, sizeof(XMVECTOR) * result.width );
+                pDest += result.rowPitch;
+                ++dy;
+            }
+        }
+
+        pSrc += cImage.rowPitch;
+    }
+
+    return ( dy == result.height ) ? S_OK : E_FAIL;
+}
+
+
+//-------------------------------------------------------------------------------------
+// One texel per 4x4 block; BC1-BC5 average from endpoints + index histograms, while
+// BC6H/BC7 and partial edge blocks fall back to decoding the block
+//-------------------------------------------------------------------------------------
+static HRESULT _DecompressBlockAverageBC( _In_ const Image& cImage, _In_ const Image& result )
+{
+    if ( !cImage.pixels || !result.pixels )
+        return E_POINTER;
+
+    assert( result.width == ( cImage.width + 3 ) / 4 );
+    assert( result.height == ( cImage.height + 3 ) / 4 );
+
+    const DXGI_FORMAT format = result.format;
+    size_t dbpp = BitsPerPixel( format );
+    if ( !dbpp )
+        return E_FAIL;
+
+    if ( dbpp < 8 )
+    {
+        // We don't support decompressing to monochrome (DXGI_FORMAT_R1_UNORM)
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    // Determine BC format decoder
+    DXGI_FORMAT cformat;
+    BC_DECODE pfDecode;
+    size_t sbpp;
+    if ( !_DetermineDecoderSettings( cImage.format, cformat, pfDecode, sbpp ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    if ( cImage.rowPitch < result.width * sbpp )
+        return E_FAIL;
+
+    BC_AVERAGE pfAverage;
+    switch( cformat )
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:    pfAverage = D3DXAverageBC1;     break;
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:    pfAverage = D3DXAverageBC2;     break;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:    pfAverage = D3DXAverageBC3;     break;
+    case DXGI_FORMAT_BC4_UNORM:         pfAverage = D3DXAverageBC4U;    break;
+    case DXGI_FORMAT_BC4_SNORM:         pfAverage = D3DXAverageBC4S;    break;
+    case DXGI_FORMAT_BC5_UNORM:         pfAverage = D3DXAverageBC5U;    break;
+    case DXGI_FORMAT_BC5_SNORM:         pfAverage = D3DXAverageBC5S;    break;
+    default:                            pfAverage = nullptr;            break;
+    }
+
+    ScopedScratchArray<XMVECTOR> scanline( result.width );
+    if ( !scanline )
+        return E_OUTOFMEMORY;
+
+    XMVECTOR* row = scanline.get();
+
+    XMVECTOR temp[16];
+    const uint8_t *pSrc = cImage.pixels;
+    uint8_t *pDest = result.pixels;
+    for( size_t y = 0; y < result.height; ++y )
+    {
+        const size_t ph = std::min<size_t>( 4, cImage.height - y*4 );
+
+        const uint8_t *sptr = pSrc;
+        for( size_t x = 0; x < result.width; ++x )
+        {
+            const size_t pw = std::min<size_t>( 4, cImage.width - x*4 );
+
+            if ( pfAverage && pw == 4 && ph == 4 )
+            {
+                pfAverage( &row[ x ], sptr );
+            }
+            else
+            {
+                // Only the texels inside the image contribute
+                pfDecode( temp, sptr );
+
+                XMVECTOR sum = XMVectorZero();
+                for( size_t r = 0; r < ph; ++r )
+                {
+                    for( size_t i = 0; i < pw; ++i )
+                        sum = XMVectorAdd( sum, temp[ r*4 + i ] );
+                }
+
+                row[ x ] = XMVectorScale( sum, 1.f / float( pw * ph ) );
             }
 
             sptr += sbpp;
-            dptr += dbpp*4;
         }
 
+        _ConvertScanline( row, result.width, format, cformat, 0 );
+
+        if ( !_StoreScanline( pDest, result.rowPitch, format, row, result.width ) )
+            return E_FAIL;
+
         pSrc += cImage.rowPitch;
-        pDest += rowPitch*4;
+        pDest += result.rowPitch;
     }
 
     return S_OK;
@@ -680,11 +1112,30 @@ HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& met
 }
 
 
+//-------------------------------------------------------------------------------------
+// Filters supported by _DecompressAndResizeBC
+//-------------------------------------------------------------------------------------
+static bool _IsDecompressAndResizeFilter( _In_ DWORD filter )
+{
+    static_assert( TEX_FILTER_BOX == 0x400000, "TEX_FILTER_ flag values don't match TEX_FILTER_MASK" );
+
+    switch( filter & TEX_FILTER_MASK )
+    {
+    case TEX_FILTER_DEFAULT:
+    case TEX_FILTER_BOX:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
 //-------------------------------------------------------------------------------------
 // Decompression
 //-------------------------------------------------------------------------------------
-_Use_decl_annotations_
-HRESULT Decompress( const Image& cImage, DXGI_FORMAT format, ScratchImage& image )
+static HRESULT _Decompress( _In_ const Image& cImage, _In_ DXGI_FORMAT format, _In_ bool parallel, _In_ size_t maxThreads,
+                            _Out_ ScratchImage& image )
 {
     if ( !IsCompressed(cImage.format) || IsCompressed(format) )
         return E_INVALIDARG;
@@ -721,7 +1172,15 @@ HRESULT Decompress( const Image& cImage, DXGI_FORMAT format, ScratchImage& image
     }
 
     // Decompress single image
-    hr = _DecompressBC( cImage, *img );
+#ifdef _OPENMP
+    if ( parallel )
+        hr = _DecompressBC_Parallel( &cImage, img, 1, maxThreads );
+    else
+#else
+    UNREFERENCED_PARAMETER( parallel );
+    UNREFERENCED_PARAMETER( maxThreads );
+#endif
+        hr = _DecompressBC( cImage, *img );
     if ( FAILED(hr) )
         image.Release();
 
@@ -729,8 +1188,205 @@ HRESULT Decompress( const Image& cImage, DXGI_FORMAT format, ScratchImage& image
 }
 
 _Use_decl_annotations_
-HRESULT Decompress( const Image* cImages, size_t nimages, const TexMetadata& metadata,
-                    DXGI_FORMAT format, ScratchImage& images )
+HRESULT Decompress( const Image& cImage, DXGI_FORMAT format, ScratchImage& image )
+{
+    return _Decompress( cImage, format, false, 0, image );
+}
+
+_Use_decl_annotations_
+HRESULT Decompress( const Image& cImage, DXGI_FORMAT format, size_t maxThreads, ScratchImage& image )
+{
+#ifndef _OPENMP
+    UNREFERENCED_PARAMETER( cImage );
+    UNREFERENCED_PARAMETER( format );
+    UNREFERENCED_PARAMETER( maxThreads );
+    UNREFERENCED_PARAMETER( image );
+    return E_NOTIMPL;
+#else
+    return _Decompress( cImage, format, true, maxThreads, image );
+#endif // _OPENMP
+}
+
+_Use_decl_annotations_
+HRESULT DecompressAndResize( const Image& cImage, size_t width, size_t height, DXGI_FORMAT format, DWORD filter, ScratchImage& image )
+{
+    if ( !IsCompressed(cImage.format) || IsCompressed(format) )
+        return E_INVALIDARG;
+
+    if ( !width || !height )
+        return E_INVALIDARG;
+
+    if ( !_IsDecompressAndResizeFilter( filter ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    if ( format == DXGI_FORMAT_UNKNOWN )
+    {
+        // Pick a default decompressed format based on BC input format
+        format = _DefaultDecompress( cImage.format );
+        if ( format == DXGI_FORMAT_UNKNOWN )
+        {
+            // Input is not a compressed format
+            return E_INVALIDARG;
+        }
+    }
+    else
+    {
+        if ( !IsValid(format) )
+            return E_INVALIDARG;
+
+        if ( IsTypeless(format) || IsPlanar(format) || IsPalettized(format) )
+            return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    // Create resized image
+    HRESULT hr = image.Initialize2D( format, width, height, 1, 1 );
+    if ( FAILED(hr) )
+        return hr;
+
+    const Image *img = image.GetImage( 0, 0, 0 );
+    if ( !img )
+    {
+        image.Release();
+        return E_POINTER;
+    }
+
+    hr = _DecompressAndResizeBC( cImage, filter, *img );
+    if ( FAILED(hr) )
+        image.Release();
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DecompressAndResize( const Image& cImage, DWORD filter, const Image& destImage )
+{
+    if ( !IsCompressed(cImage.format) )
+        return E_INVALIDARG;
+
+    if ( !destImage.pixels )
+        return E_POINTER;
+
+    if ( !destImage.width || !destImage.height || !IsValid(destImage.format) || IsCompressed(destImage.format) )
+        return E_INVALIDARG;
+
+    if ( IsTypeless(destImage.format) || IsPlanar(destImage.format) || IsPalettized(destImage.format) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    if ( !_IsDecompressAndResizeFilter( filter ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    size_t rowPitch, slicePitch;
+    ComputePitch( destImage.format, destImage.width, destImage.height, rowPitch, slicePitch, CP_FLAGS_NONE );
+    if ( destImage.rowPitch < rowPitch )
+        return E_INVALIDARG;
+
+    return _DecompressAndResizeBC( cImage, filter, destImage );
+}
+
+_Use_decl_annotations_
+HRESULT DecompressBlocks( DXGI_FORMAT bcFormat, const uint8_t* pBlocks, size_t width, size_t height,
+                          DXGI_FORMAT format, uint8_t* pDest, size_t rowPitch )
+{
+    if ( !pBlocks || !pDest )
+        return E_POINTER;
+
+    if ( !IsCompressed(bcFormat) || IsCompressed(format) || !width || !height || height > 4 )
+        return E_INVALIDARG;
+
+    if ( format == DXGI_FORMAT_UNKNOWN )
+    {
+        // Pick a default decompressed format based on BC input format
+        format = _DefaultDecompress( bcFormat );
+        if ( format == DXGI_FORMAT_UNKNOWN )
+            return E_INVALIDARG;
+    }
+    else
+    {
+        if ( !IsValid(format) )
+            return E_INVALIDARG;
+
+        if ( IsTypeless(format) || IsPlanar(format) || IsPalettized(format) )
+            return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    const size_t dbpp = BitsPerPixel( format );
+    if ( dbpp < 8 )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    if ( rowPitch < ( ( width * dbpp ) + 7 ) / 8 )
+        return E_INVALIDARG;
+
+    // Everything format-dependent is resolved here, once for the whole row of blocks
+    BC_DECODE_ROW pfDecodeRow = D3DXGetDecodeRow( bcFormat, format );
+    if ( pfDecodeRow )
+    {
+        pfDecodeRow( pDest, rowPitch, pBlocks, width, height );
+        return S_OK;
+    }
+
+    DXGI_FORMAT cformat;
+    BC_DECODE pfDecode;
+    size_t sbpp;
+    if ( !_DetermineDecoderSettings( bcFormat, cformat, pfDecode, sbpp ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    const size_t stride = ( width + 3 ) & ~size_t(3);
+    ScopedScratchArray<XMVECTOR> scanlines( stride * 4 );
+    if ( !scanlines )
+        return E_OUTOFMEMORY;
+
+    if ( !_DecodeBlockRow( pfDecode, sbpp, cformat, pBlocks, width, height, format, pDest, rowPitch, scanlines.get(), stride ) )
+        return E_FAIL;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DecompressBlockAverage( const Image& cImage, DXGI_FORMAT format, ScratchImage& image )
+{
+    if ( !IsCompressed(cImage.format) || IsCompressed(format) )
+        return E_INVALIDARG;
+
+    if ( format == DXGI_FORMAT_UNKNOWN )
+    {
+        // Pick a default decompressed format based on BC input format
+        format = _DefaultDecompress( cImage.format );
+        if ( format == DXGI_FORMAT_UNKNOWN )
+        {
+            // Input is not a compressed format
+            return E_INVALIDARG;
+        }
+    }
+    else
+    {
+        if ( !IsValid(format) )
+            return E_INVALIDARG;
+
+        if ( IsTypeless(format) || IsPlanar(format) || IsPalettized(format) )
+            return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    // Create block resolution image
+    HRESULT hr = image.Initialize2D( format, ( cImage.width + 3 ) / 4, ( cImage.height + 3 ) / 4, 1, 1 );
+    if ( FAILED(hr) )
+        return hr;
+
+    const Image *img = image.GetImage( 0, 0, 0 );
+    if ( !img )
+    {
+        image.Release();
+        return E_POINTER;
+    }
+
+    hr = _DecompressBlockAverageBC( cImage, *img );
+    if ( FAILED(hr) )
+        image.Release();
+
+    return hr;
+}
+
+static HRESULT _Decompress( _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+                            _In_ DXGI_FORMAT format, _In_ bool parallel, _In_ size_t maxThreads, _Out_ ScratchImage& images )
 {
     if ( !cImages || !nimages )
         return E_INVALIDARG;
@@ -795,6 +1451,9 @@ HRESULT Decompress( const Image* cImages, size_t nimages, const TexMetadata& met
             return E_FAIL;
         }
 
+        if ( parallel )
+            continue;
+
         hr = _DecompressBC( src, dest[ index ] );
         if ( FAILED(hr) )
         {
@@ -803,7 +1462,46 @@ HRESULT Decompress( const Image* cImages, size_t nimages, const TexMetadata& met
         }
     }
 
+#ifdef _OPENMP
+    if ( parallel )
+    {
+        // Every subresource has been validated above
+        hr = _DecompressBC_Parallel( cImages, dest, nimages, maxThreads );
+        if ( FAILED(hr) )
+        {
+            images.Release();
+            return hr;
+        }
+    }
+#else
+    UNREFERENCED_PARAMETER( maxThreads );
+#endif
+
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT Decompress( const Image* cImages, size_t nimages, const TexMetadata& metadata,
+                    DXGI_FORMAT format, ScratchImage& images )
+{
+    return _Decompress( cImages, nimages, metadata, format, false, 0, images );
+}
+
+_Use_decl_annotations_
+HRESULT Decompress( const Image* cImages, size_t nimages, const TexMetadata& metadata,
+                    DXGI_FORMAT format, size_t maxThreads, ScratchImage& images )
+{
+#ifndef _OPENMP
+    UNREFERENCED_PARAMETER( cImages );
+    UNREFERENCED_PARAMETER( nimages );
+    UNREFERENCED_PARAMETER( metadata );
+    UNREFERENCED_PARAMETER( format );
+    UNREFERENCED_PARAMETER( maxThreads );
+    UNREFERENCED_PARAMETER( images );
+    return E_NOTIMPL;
+#else
+    return _Decompress( cImages, nimages, metadata, format, true, maxThreads, images );
+#endif // _OPENMP
+}
+
 }; // namespace
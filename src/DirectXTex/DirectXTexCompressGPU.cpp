@@ -13,9 +13,9 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
-#include "bcdirectcompute.h"
+#include "BCDirectCompute.h"
 
 namespace DirectX
 {
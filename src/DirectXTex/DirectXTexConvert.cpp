@@ -13,10 +13,12 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
 using namespace DirectX::PackedVector;
+#if defined(_WIN32)
 using Microsoft::WRL::ComPtr;
+#endif
 
 namespace
 {
@@ -596,84 +598,26 @@ bool _ExpandScanline( LPVOID pDestination, size_t outSize, DXGI_FORMAT outFormat
     assert( IsValid(outFormat) && !IsPlanar(outFormat) && !IsPalettized(outFormat) );
     assert( IsValid(inFormat) && !IsPlanar(inFormat) && !IsPalettized(inFormat) );
 
+    if ( outFormat != DXGI_FORMAT_R8G8B8A8_UNORM )
+        return false;
+
+    LEGACY_EXPAND conversion;
     switch( inFormat )
     {
-    case DXGI_FORMAT_B5G6R5_UNORM:
-        if ( outFormat != DXGI_FORMAT_R8G8B8A8_UNORM )
-            return false;
-
-        // DXGI_FORMAT_B5G6R5_UNORM -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t * __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
-
-                uint32_t t1 = ((t & 0xf800) >> 8) | ((t & 0xe000) >> 13);
-                uint32_t t2 = ((t & 0x07e0) << 5) | ((t & 0x0600) >> 5);
-                uint32_t t3 = ((t & 0x001f) << 19) | ((t & 0x001c) << 14);
-
-                *(dPtr++) = t1 | t2 | t3 | 0xff000000;
-            }
-            return true;
-        }
+    case DXGI_FORMAT_B5G6R5_UNORM:      conversion = LEGACY_EXPAND_565; break;
+    case DXGI_FORMAT_B5G5R5A1_UNORM:    conversion = LEGACY_EXPAND_5551; break;
+    case DXGI_FORMAT_B4G4R4A4_UNORM:    conversion = LEGACY_EXPAND_4444; break;
+    default:
         return false;
-        
-    case DXGI_FORMAT_B5G5R5A1_UNORM:
-        if ( outFormat != DXGI_FORMAT_R8G8B8A8_UNORM )
-            return false;
-
-        // DXGI_FORMAT_B5G5R5A1_UNORM -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t * __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
-
-                uint32_t t1 = ((t & 0x7c00) >> 7) | ((t & 0x7000) >> 12);
-                uint32_t t2 = ((t & 0x03e0) << 6) | ((t & 0x0380) << 1);
-                uint32_t t3 = ((t & 0x001f) << 19) | ((t & 0x001c) << 14);
-                uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : ((t & 0x8000) ? 0xff000000 : 0);
+    }
 
-                *(dPtr++) = t1 | t2 | t3 | ta;
-            }
-            return true;
-        }
+    if ( inSize < 2 || outSize < 4 )
         return false;
 
-    case DXGI_FORMAT_B4G4R4A4_UNORM:
-        if ( outFormat != DXGI_FORMAT_R8G8B8A8_UNORM )
-            return false;
-
-        // DXGI_FORMAT_B4G4R4A4_UNORM -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t * __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
-
-                uint32_t t1 = ((t & 0x0f00) >> 4) | ((t & 0x0f00) >> 8);
-                uint32_t t2 = ((t & 0x00f0) << 8) | ((t & 0x00f0) << 4);
-                uint32_t t3 = ((t & 0x000f) << 20) | ((t & 0x000f) << 16);
-                uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : (((t & 0xf000) << 16) | ((t & 0xf000) << 12));
-
-                *(dPtr++) = t1 | t2 | t3 | ta;
-            }
-            return true;
-        }
-        return false;
-    }
-
-    return false;
+    // -> DXGI_FORMAT_R8G8B8A8_UNORM, see DirectXTexLegacy.cpp
+    _LegacyExpandRow( conversion, pDestination, pSource, std::min<size_t>( inSize / 2, outSize / 4 ),
+                      nullptr, ( flags & TEXP_SCANLINE_SETALPHA ) != 0 );
+    return true;
 }
 
 
@@ -2729,6 +2673,18 @@ static inline XMVECTOR XMColorSRGBToRGB( FXMVECTOR srgb )
 }
 #endif
 
+_Use_decl_annotations_
+void _LinearizeScanline( XMVECTOR* pBuffer, size_t count )
+{
+    assert( pBuffer && count > 0 );
+
+    XMVECTOR* ptr = pBuffer;
+    for( size_t i=0; i < count; ++i, ++ptr )
+    {
+        *ptr = XMColorSRGBToRGB( *ptr );
+    }
+}
+
 _Use_decl_annotations_
 bool _LoadScanlineLinear( XMVECTOR* pDestination, size_t count,
                           LPCVOID pSource, size_t size, DXGI_FORMAT format, DWORD flags )
@@ -2781,11 +2737,7 @@ bool _LoadScanlineLinear( XMVECTOR* pDestination, size_t count,
         // sRGB input processing (sRGB -> Linear RGB)
         if ( flags & TEX_FILTER_SRGB_IN )
         {
-            XMVECTOR* ptr = pDestination;
-            for( size_t i=0; i < count; ++i, ++ptr )
-            {
-                *ptr = XMColorSRGBToRGB( *ptr );
-            }
+            _LinearizeScanline( pDestination, count );
         }
 
         return true;
@@ -3800,6 +3752,7 @@ bool _StoreScanlineDither( LPVOID pDestination, size_t size, DXGI_FORMAT format,
 #undef STORE_SCANLINE1
 
 
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // Selection logic for using WIC vs. our own routines
 //-------------------------------------------------------------------------------------
@@ -3815,6 +3768,12 @@ static inline bool _UseWICConversion( _In_ DWORD filter, _In_ DXGI_FORMAT sforma
         return false;
     }
 
+    if ( !(filter & TEX_FILTER_FORCE_WIC) && _GetDirectConverter( sformat, tformat, filter ) )
+    {
+        // Direct integer conversion is exact and cheaper than a WIC format converter
+        return false;
+    }
+
     if ( !_DXGIToWIC( sformat, pfGUID ) || !_DXGIToWIC( tformat, targetGUID ) )
     {
         // Source or target format are not WIC supported native pixel formats
@@ -3949,6 +3908,24 @@ static HRESULT _ConvertUsingWIC( _In_ const Image& srcImage, _In_ const WICPixel
 }
 
 
+#else
+//-------------------------------------------------------------------------------------
+// WIC is Windows only; other builds always use our own routines
+//-------------------------------------------------------------------------------------
+static inline bool _UseWICConversion( _In_ DWORD, _In_ DXGI_FORMAT, _In_ DXGI_FORMAT,
+                                      _Out_ WICPixelFormatGUID&, _Out_ WICPixelFormatGUID& )
+{
+    return false;
+}
+
+static HRESULT _ConvertUsingWIC( _In_ const Image&, _In_ const WICPixelFormatGUID&, _In_ const WICPixelFormatGUID&,
+                                 _In_ DWORD, _In_ float, _In_ const Image& )
+{
+    return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+}
+#endif
+
+
 //-------------------------------------------------------------------------------------
 // Convert the source image (not using WIC)
 //-------------------------------------------------------------------------------------
@@ -3964,10 +3941,24 @@ static HRESULT _Convert( _In_ const Image& srcImage, _In_ DWORD filter, _In_ con
 
     size_t width = srcImage.width;
 
+    DIRECT_CONVERT_ROW pfnDirect = _GetDirectConverter( srcImage.format, destImage.format, filter );
+    if ( pfnDirect )
+    {
+        // Integer path for the pair, same result as the float pipeline below
+        for( size_t h = 0; h < srcImage.height; ++h )
+        {
+            pfnDirect( pDest, pSrc, width );
+
+            pSrc += srcImage.rowPitch;
+            pDest += destImage.rowPitch;
+        }
+        return S_OK;
+    }
+
     if ( filter & TEX_FILTER_DITHER_DIFFUSION )
     {
         // Error diffusion dithering (aka Floyd-Steinberg dithering)
-        ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*(width*2 + 2)), 16 ) ) );
+        ScopedScratchArray<XMVECTOR> scanline( width*2 + 2 );
         if ( !scanline )
             return E_OUTOFMEMORY;
 
@@ -3990,7 +3981,7 @@ static HRESULT _Convert( _In_ const Image& srcImage, _In_ DWORD filter, _In_ con
     }
     else
     {
-        ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width), 16 ) ) );
+        ScopedScratchArray<XMVECTOR> scanline( width );
         if ( !scanline )
             return E_OUTOFMEMORY;
 
@@ -13,9 +13,14 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
-#include "dds.h"
+#include "DDS.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace DirectX
 {
@@ -731,75 +736,35 @@ static bool _LegacyExpandScanline( _Out_writes_bytes_(outSize) LPVOID pDestinati
     assert( pSource && inSize > 0 );
     assert( IsValid(outFormat) && !IsPlanar(outFormat) && !IsPalettized(outFormat) );
 
+    // Pick the expansion for this source/target pair; the kernels live in DirectXTexLegacy.cpp
+    LEGACY_EXPAND conversion;
+    size_t inBytes = 1;
+    size_t outBytes = 4;
+
     switch( inFormat )
     {
     case TEXP_LEGACY_R8G8B8:
         if ( outFormat != DXGI_FORMAT_R8G8B8A8_UNORM )
             return false;
 
-        // D3DFMT_R8G8B8 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 3 && outSize >= 4 )
-        {
-            const uint8_t * __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 2 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 3, ocount += 4 )
-            {
-                // 24bpp Direct3D 9 files are actually BGR, so need to swizzle as well
-                uint32_t t1 = ( *(sPtr) << 16 );
-                uint32_t t2 = ( *(sPtr+1) << 8 ); 
-                uint32_t t3 = *(sPtr+2);
-
-                *(dPtr++) = t1 | t2 | t3 | 0xff000000;
-                sPtr += 3;
-            }
-            return true;
-        }
-        return false;
+        // 24bpp Direct3D 9 files are actually BGR, so need to swizzle as well
+        conversion = LEGACY_EXPAND_R8G8B8;
+        inBytes = 3;
+        break;
 
     case TEXP_LEGACY_R3G3B2:
         switch( outFormat )
         {
         case DXGI_FORMAT_R8G8B8A8_UNORM:
-            // D3DFMT_R3G3B2 -> DXGI_FORMAT_R8G8B8A8_UNORM
-            if ( inSize >= 1 && outSize >= 4 )
-            {
-                const uint8_t* __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-                uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-                for( size_t ocount = 0, icount = 0; ( ( icount < inSize ) && ( ocount < ( outSize - 3 ) ) ); ++icount, ocount += 4 )
-                {
-                    uint8_t t = *(sPtr++);
-
-                    uint32_t t1 = (t & 0xe0) | ((t & 0xe0) >> 3) | ((t & 0xc0) >> 6);
-                    uint32_t t2 = ((t & 0x1c) << 11) | ((t & 0x1c) << 8) | ((t & 0x18) << 5);
-                    uint32_t t3 = ((t & 0x03) << 22) | ((t & 0x03) << 20) | ((t & 0x03) << 18) | ((t & 0x03) << 16);
-
-                    *(dPtr++) = t1 | t2 | t3 | 0xff000000;
-                }
-                return true;
-            }
-            return false;
+            conversion = LEGACY_EXPAND_R3G3B2;
+            break;
 
         case DXGI_FORMAT_B5G6R5_UNORM:
-            // D3DFMT_R3G3B2 -> DXGI_FORMAT_B5G6R5_UNORM
-            if ( inSize >= 1 && outSize >= 2 )
-            {
-                const uint8_t* __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-                uint16_t * __restrict dPtr = reinterpret_cast<uint16_t*>(pDestination);
-
-                for( size_t ocount = 0, icount = 0; ( ( icount < inSize ) && ( ocount < ( outSize - 1 ) ) ); ++icount, ocount += 2 )
-                {
-                    uint8_t t = *(sPtr++);
-
-                    uint16_t t1 = ((t & 0xe0) << 8) | ((t & 0xc0) << 5);
-                    uint16_t t2 = ((t & 0x1c) << 6) | ((t & 0x1c) << 3);
-                    uint16_t t3 = ((t & 0x03) << 3) | ((t & 0x03) << 1) | ((t & 0x02) >> 1);
+            conversion = LEGACY_EXPAND_R3G3B2_TO_565;
+            outBytes = 2;
+            break;
 
-                    *(dPtr++) = t1 | t2 | t3;
-                }
-                return true;
-            }
+        default:
             return false;
         }
         break;
@@ -808,111 +773,38 @@ static bool _LegacyExpandScanline( _Out_writes_bytes_(outSize) LPVOID pDestinati
         if ( outFormat != DXGI_FORMAT_R8G8B8A8_UNORM )
             return false;
 
-        // D3DFMT_A8R3G3B2 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t* __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
-
-                uint32_t t1 = (t & 0x00e0) | ((t & 0x00e0) >> 3) | ((t & 0x00c0) >> 6);
-                uint32_t t2 = ((t & 0x001c) << 11) | ((t & 0x001c) << 8) | ((t & 0x0018) << 5);
-                uint32_t t3 = ((t & 0x0003) << 22) | ((t & 0x0003) << 20) | ((t & 0x0003) << 18) | ((t & 0x0003) << 16);
-                uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : ((t & 0xff00) << 16);
-
-                *(dPtr++) = t1 | t2 | t3 | ta;
-            }
-            return true;
-        }
-        return false;
+        conversion = LEGACY_EXPAND_A8R3G3B2;
+        inBytes = 2;
+        break;
 
     case TEXP_LEGACY_P8:
         if ( (outFormat != DXGI_FORMAT_R8G8B8A8_UNORM) || !pal8 )
             return false;
 
-        // D3DFMT_P8 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 1 && outSize >= 4 )
-        {
-            const uint8_t* __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < inSize ) && ( ocount < ( outSize - 3 ) ) ); ++icount, ocount += 4 )
-            {
-                uint8_t t = *(sPtr++);
-
-                *(dPtr++) = pal8[ t ];
-            }
-            return true;
-        }
-        return false;
+        conversion = LEGACY_EXPAND_P8;
+        break;
 
     case TEXP_LEGACY_A8P8:
         if ( (outFormat != DXGI_FORMAT_R8G8B8A8_UNORM) || !pal8 )
             return false;
 
-        // D3DFMT_A8P8 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t* __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
-
-                uint32_t t1 = pal8[ t & 0xff ];
-                uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : ((t & 0xff00) << 16);
-
-                *(dPtr++) = t1 | ta;
-            }
-            return true;
-        }
-        return false;
+        conversion = LEGACY_EXPAND_A8P8;
+        inBytes = 2;
+        break;
 
     case TEXP_LEGACY_A4L4:
         switch( outFormat )
         {
-        case DXGI_FORMAT_B4G4R4A4_UNORM :
-            // D3DFMT_A4L4 -> DXGI_FORMAT_B4G4R4A4_UNORM 
-            if ( inSize >= 1 && outSize >= 2 )
-            {
-                const uint8_t * __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-                uint16_t * __restrict dPtr = reinterpret_cast<uint16_t*>(pDestination);
-
-                for( size_t ocount = 0, icount = 0; ( ( icount < inSize ) && ( ocount < ( outSize - 1 ) ) ); ++icount, ocount += 2 )
-                {
-                    uint8_t t = *(sPtr++);
-
-                    uint16_t t1 = (t & 0x0f);
-                    uint16_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xf000 : ((t & 0xf0) << 8);
-
-                    *(dPtr++) = t1 | (t1 << 4) | (t1 << 8) | ta;
-                }
-                return true;
-            }
-            return false;
+        case DXGI_FORMAT_B4G4R4A4_UNORM:
+            conversion = LEGACY_EXPAND_A4L4_TO_4444;
+            outBytes = 2;
+            break;
 
         case DXGI_FORMAT_R8G8B8A8_UNORM:
-            // D3DFMT_A4L4 -> DXGI_FORMAT_R8G8B8A8_UNORM
-            if ( inSize >= 1 && outSize >= 4 )
-            {
-                const uint8_t * __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-                uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
-
-                for( size_t ocount = 0, icount = 0; ( ( icount < inSize ) && ( ocount < ( outSize - 3 ) ) ); ++icount, ocount += 4 )
-                {
-                    uint8_t t = *(sPtr++);
-
-                    uint32_t t1 = ((t & 0x0f) << 4) | (t & 0x0f);
-                    uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : (((t & 0xf0) << 24) | ((t & 0xf0) << 20));
+            conversion = LEGACY_EXPAND_A4L4;
+            break;
 
-                    *(dPtr++) = t1 | (t1 << 8) | (t1 << 16) | ta;
-                }
-                return true;
-            }
+        default:
             return false;
         }
         break;
@@ -921,100 +813,154 @@ static bool _LegacyExpandScanline( _Out_writes_bytes_(outSize) LPVOID pDestinati
         if (outFormat != DXGI_FORMAT_R8G8B8A8_UNORM)
             return false;
 
-        // D3DFMT_A4R4G4B4 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t * __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
+        // D3DFMT_A4R4G4B4
+        conversion = LEGACY_EXPAND_4444;
+        inBytes = 2;
+        break;
 
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
+    case TEXP_LEGACY_L8:
+        if (outFormat != DXGI_FORMAT_R8G8B8A8_UNORM)
+            return false;
 
-                uint32_t t1 = ((t & 0x0f00) >> 4) | ((t & 0x0f00) >> 8);
-                uint32_t t2 = ((t & 0x00f0) << 8) | ((t & 0x00f0) << 4);
-                uint32_t t3 = ((t & 0x000f) << 20) | ((t & 0x000f) << 16);
-                uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : (((t & 0xf000) << 16) | ((t & 0xf000) << 12));
+        conversion = LEGACY_EXPAND_L8;
+        break;
 
-                *(dPtr++) = t1 | t2 | t3 | ta;
-            }
-            return true;
-        }
-        return false;
+    case TEXP_LEGACY_L16:
+        if (outFormat != DXGI_FORMAT_R16G16B16A16_UNORM)
+            return false;
 
-    case TEXP_LEGACY_L8:
+        conversion = LEGACY_EXPAND_L16;
+        inBytes = 2;
+        outBytes = 8;
+        break;
+
+    case TEXP_LEGACY_A8L8:
         if (outFormat != DXGI_FORMAT_R8G8B8A8_UNORM)
             return false;
 
-        // D3DFMT_L8 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 1 && outSize >= 4 )
-        {
-            const uint8_t * __restrict sPtr = reinterpret_cast<const uint8_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
+        conversion = LEGACY_EXPAND_A8L8;
+        inBytes = 2;
+        break;
 
-            for( size_t ocount = 0, icount = 0; ( ( icount < inSize ) && ( ocount < ( outSize - 3 ) ) ); ++icount, ocount += 4 )
-            {
-                uint32_t t1 = *(sPtr++);
-                uint32_t t2 = (t1 << 8);
-                uint32_t t3 = (t1 << 16);
+    default:
+        return false;
+    }
 
-                *(dPtr++) = t1 | t2 | t3 | 0xff000000;
-            }
-            return true;
-        }
+    if ( inSize < inBytes || outSize < outBytes )
         return false;
 
-    case TEXP_LEGACY_L16:
-        if (outFormat != DXGI_FORMAT_R16G16B16A16_UNORM)
-            return false;
+    _LegacyExpandRow( conversion, pDestination, pSource, std::min<size_t>( inSize / inBytes, outSize / outBytes ),
+                      pal8, ( flags & TEXP_SCANLINE_SETALPHA ) != 0 );
+    return true;
+}
 
-        // D3DFMT_L16 -> DXGI_FORMAT_R16G16B16A16_UNORM
-        if ( inSize >= 2 && outSize >= 8 )
-        {
-            const uint16_t* __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint64_t * __restrict dPtr = reinterpret_cast<uint64_t*>(pDestination);
 
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 7 ) ) ); icount += 2, ocount += 8 )
-            {
-                uint16_t t = *(sPtr++);
+//-------------------------------------------------------------------------------------
+// Adjusts the pitch flags for legacy formats that are expanded on load
+//-------------------------------------------------------------------------------------
+inline static DWORD _GetSourcePitchFlags( _In_ DWORD cpFlags, _In_ DWORD convFlags )
+{
+    if ( convFlags & CONV_FLAGS_EXPAND )
+    {
+        if ( convFlags & CONV_FLAGS_888 )
+            cpFlags |= CP_FLAGS_24BPP;
+        else if ( convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8) )
+            cpFlags |= CP_FLAGS_16BPP;
+        else if ( convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8) )
+            cpFlags |= CP_FLAGS_8BPP;
+    }
 
-                uint64_t t1 = t;
-                uint64_t t2 = (t1 << 16);
-                uint64_t t3 = (t1 << 32);
+    return cpFlags;
+}
 
-                *(dPtr++) = t1 | t2 | t3 | 0xffff000000000000;
-            }
-            return true;
-        }
-        return false;
 
-    case TEXP_LEGACY_A8L8:
-        if (outFormat != DXGI_FORMAT_R8G8B8A8_UNORM)
-            return false;
+//-------------------------------------------------------------------------------------
+// Converts or copies a single subresource from DDS pixel data into scratch image data
+//-------------------------------------------------------------------------------------
+static HRESULT _CopySubresource( _In_ const Image& srcImage, _In_ const Image& destImage, _In_ const TexMetadata& metadata,
+                                 _In_ DWORD convFlags, _In_reads_opt_(256) const uint32_t *pal8 )
+{
+    if ( destImage.height != srcImage.height )
+        return E_FAIL;
 
-        // D3DFMT_A8L8 -> DXGI_FORMAT_R8G8B8A8_UNORM
-        if ( inSize >= 2 && outSize >= 4 )
-        {
-            const uint16_t* __restrict sPtr = reinterpret_cast<const uint16_t*>(pSource);
-            uint32_t * __restrict dPtr = reinterpret_cast<uint32_t*>(pDestination);
+    size_t dpitch = destImage.rowPitch;
+    size_t spitch = srcImage.rowPitch;
 
-            for( size_t ocount = 0, icount = 0; ( ( icount < ( inSize - 1 ) ) && ( ocount < ( outSize - 3 ) ) ); icount += 2, ocount += 4 )
-            {
-                uint16_t t = *(sPtr++);
+    const uint8_t *pSrc = const_cast<const uint8_t*>( srcImage.pixels );
+    if ( !pSrc )
+        return E_POINTER;
 
-                uint32_t t1 = (t & 0xff);
-                uint32_t t2 = (t1 << 8);
-                uint32_t t3 = (t1 << 16);
-                uint32_t ta = ( flags & TEXP_SCANLINE_SETALPHA ) ? 0xff000000 : ((t & 0xff00) << 16);
+    uint8_t *pDest = destImage.pixels;
+    if ( !pDest )
+        return E_POINTER;
 
-                *(dPtr++) = t1 | t2 | t3 | ta;
+    DWORD tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0;
+    if ( convFlags & CONV_FLAGS_SWIZZLE )
+        tflags |= TEXP_SCANLINE_LEGACY;
+
+    if ( IsCompressed( metadata.format ) )
+    {
+        size_t csize = std::min<size_t>( destImage.slicePitch, srcImage.slicePitch );
+        memcpy_s( pDest, destImage.slicePitch, pSrc, csize );
+    }
+    else if ( IsPlanar( metadata.format ) )
+    {
+        // Direct3D does not support any planar formats for Texture3D
+        if ( metadata.dimension == TEX_DIMENSION_TEXTURE3D )
+            return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+        size_t count = ComputeScanlines( metadata.format, destImage.height );
+        if ( !count )
+            return E_UNEXPECTED;
+
+        size_t csize = std::min<size_t>( dpitch, spitch );
+        for( size_t h = 0; h < count; ++h )
+        {
+            memcpy_s( pDest, dpitch, pSrc, csize );
+            pSrc += spitch;
+            pDest += dpitch;
+        }
+    }
+    else
+    {
+        for( size_t h = 0; h < destImage.height; ++h )
+        {
+            if ( convFlags & CONV_FLAGS_EXPAND )
+            {
+                if ( convFlags & (CONV_FLAGS_565|CONV_FLAGS_5551|CONV_FLAGS_4444) )
+                {
+                    if ( !_ExpandScanline( pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
+                                           pSrc, spitch,
+                                           (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
+                                           tflags ) )
+                        return E_FAIL;
+                }
+                else
+                {
+                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat( convFlags );
+                    if ( !_LegacyExpandScanline( pDest, dpitch, metadata.format,
+                                                 pSrc, spitch, lformat, pal8,
+                                                 tflags ) )
+                        return E_FAIL;
+                }
             }
-            return true;
+            else if ( convFlags & CONV_FLAGS_SWIZZLE )
+            {
+                _SwizzleScanline( pDest, dpitch, pSrc, spitch,
+                                  metadata.format, tflags );
+            }
+            else
+            {
+                _CopyScanline( pDest, dpitch, pSrc, spitch,
+                               metadata.format, tflags );
+            }
+
+            pSrc += spitch;
+            pDest += dpitch;
         }
-        return false;
     }
 
-    return false;
+    return S_OK;
 }
 
 
@@ -1029,16 +975,8 @@ static HRESULT _CopyImage( _In_reads_bytes_(size) const void* pPixels, _In_ size
 
     if ( !size )
         return E_FAIL;
-     
-    if ( convFlags & CONV_FLAGS_EXPAND )
-    {
-        if ( convFlags & CONV_FLAGS_888 )
-            cpFlags |= CP_FLAGS_24BPP;
-        else if ( convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8) )
-            cpFlags |= CP_FLAGS_16BPP;
-        else if ( convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8) )
-            cpFlags |= CP_FLAGS_8BPP;
-    }
+
+    cpFlags = _GetSourcePitchFlags( cpFlags, convFlags );
 
     size_t pixelSize, nimages;
     _DetermineImageArray( metadata, cpFlags, nimages, pixelSize );
@@ -1071,186 +1009,371 @@ static HRESULT _CopyImage( _In_reads_bytes_(size) const void* pPixels, _In_ size
         return E_FAIL;
     }
 
-    DWORD tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0;
-    if ( convFlags & CONV_FLAGS_SWIZZLE )
-        tflags |= TEXP_SCANLINE_LEGACY;
+    // The DDS pixel data stores subresources in the same order as the scratch image
+    for( size_t index = 0; index < nimages; ++index )
+    {
+        HRESULT hr = _CopySubresource( timages[ index ], images[ index ], metadata, convFlags, pal8 );
+        if ( FAILED(hr) )
+            return hr;
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Validates a subresource range and computes the metadata of the loaded subset
+//-------------------------------------------------------------------------------------
+static HRESULT _GetDDSSubsetMetadata( _In_ const TexMetadata& metadata, _In_ size_t mipBase, _In_ size_t mipLevels,
+                                      _In_ size_t itemBase, _In_ size_t arraySize, _Out_ TexMetadata& subset )
+{
+    memcpy( &subset, &metadata, sizeof(TexMetadata) );
+
+    if ( mipBase >= metadata.mipLevels )
+        return E_INVALIDARG;
 
-    switch (metadata.dimension)
+    if ( !mipLevels )
+        mipLevels = metadata.mipLevels - mipBase;
+
+    if ( mipLevels > ( metadata.mipLevels - mipBase ) )
+        return E_INVALIDARG;
+
+    if ( metadata.dimension == TEX_DIMENSION_TEXTURE3D )
     {
-    case TEX_DIMENSION_TEXTURE1D:
-    case TEX_DIMENSION_TEXTURE2D:
-        {
-            size_t index = 0;
-            for( size_t item = 0; item < metadata.arraySize; ++item )
-            {
-                for( size_t level = 0; level < metadata.mipLevels; ++level, ++index )
-                {
-                    if ( index >= nimages )
-                        return E_FAIL;
+        // Volume textures have no array items; all slices of each level are loaded
+        if ( itemBase > 0 || arraySize > 1 )
+            return E_INVALIDARG;
 
-                    if ( images[ index ].height != timages[ index ].height )
-                        return E_FAIL;
+        arraySize = 1;
+    }
+    else
+    {
+        if ( itemBase >= metadata.arraySize )
+            return E_INVALIDARG;
 
-                    size_t dpitch = images[ index ].rowPitch;
-                    size_t spitch = timages[ index ].rowPitch;
+        if ( !arraySize )
+            arraySize = metadata.arraySize - itemBase;
 
-                    const uint8_t *pSrc = const_cast<const uint8_t*>( timages[ index ].pixels );
-                    if ( !pSrc )
-                        return E_POINTER;
+        if ( arraySize > ( metadata.arraySize - itemBase ) )
+            return E_INVALIDARG;
+    }
 
-                    uint8_t *pDest = images[ index ].pixels;
-                    if ( !pDest )
-                        return E_POINTER;
+    subset.width = std::max<size_t>( 1, metadata.width >> mipBase );
+    subset.height = std::max<size_t>( 1, metadata.height >> mipBase );
+    subset.depth = std::max<size_t>( 1, metadata.depth >> mipBase );
+    subset.mipLevels = mipLevels;
+    subset.arraySize = arraySize;
 
-                    if ( IsCompressed( metadata.format ) )
-                    {
-                        size_t csize = std::min<size_t>( images[ index ].slicePitch, timages[ index ].slicePitch );
-                        memcpy_s( pDest, images[ index ].slicePitch, pSrc, csize );
-                    }
-                    else if ( IsPlanar( metadata.format ) )
-                    {
-                        size_t count = ComputeScanlines( metadata.format, images[ index ].height );
-                        if ( !count )
-                            return E_UNEXPECTED;
+    if ( metadata.IsCubemap() && ( ( itemBase % 6 ) != 0 || ( arraySize % 6 ) != 0 ) )
+    {
+        // A partial cube is returned as a plain 2D texture array
+        subset.miscFlags &= ~TEX_MISC_TEXTURECUBE;
+    }
 
-                        size_t csize = std::min<size_t>( dpitch, spitch );
-                        for( size_t h = 0; h < count; ++h )
-                        {
-                            memcpy_s( pDest, dpitch, pSrc, csize );
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
-                    }
-                    else
-                    {
-                        for( size_t h = 0; h < images[ index ].height; ++h )
-                        {
-                            if ( convFlags & CONV_FLAGS_EXPAND )
-                            {
-                                if ( convFlags & (CONV_FLAGS_565|CONV_FLAGS_5551|CONV_FLAGS_4444) )
-                                {
-                                    if ( !_ExpandScanline( pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                                           pSrc, spitch,
-                                                           (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                                           tflags ) )
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat( convFlags );
-                                    if ( !_LegacyExpandScanline( pDest, dpitch, metadata.format,
-                                                                 pSrc, spitch, lformat, pal8,
-                                                                 tflags ) )
-                                        return E_FAIL;
-                                }
-                            }
-                            else if ( convFlags & CONV_FLAGS_SWIZZLE )
-                            {
-                                _SwizzleScanline( pDest, dpitch, pSrc, spitch,
-                                                  metadata.format, tflags );
-                            }
-                            else
-                            {
-                                _CopyScanline( pDest, dpitch, pSrc, spitch,
-                                               metadata.format, tflags );
-                            }
+    return S_OK;
+}
 
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
-                    }
-                }
-            }
-        }
-        break;
 
-    case TEX_DIMENSION_TEXTURE3D:
-        {
-            size_t index = 0;
-            size_t d = metadata.depth;
+//-------------------------------------------------------------------------------------
+// Computes the layout and byte offset of a single subresource within the DDS pixel
+// data (relative to the first byte following the header and optional palette)
+//-------------------------------------------------------------------------------------
+static void _LocateDDSSubresource( _In_ const TexMetadata& metadata, _In_ DWORD cpFlags,
+                                   _In_ size_t mip, _In_ size_t item, _In_ size_t slice,
+                                   _Out_ Image& srcImage, _Out_ size_t& offset )
+{
+    assert( mip < metadata.mipLevels );
 
-            for( size_t level = 0; level < metadata.mipLevels; ++level )
-            {
-                for( size_t slice = 0; slice < d; ++slice, ++index )
-                {
-                    if ( index >= nimages )
-                        return E_FAIL;
+    size_t _offset = 0;
+    size_t w = metadata.width;
+    size_t h = metadata.height;
+    size_t d = metadata.depth;
+    size_t rowPitch = 0, slicePitch = 0;
 
-                    if ( images[ index ].height != timages[ index ].height )
-                        return E_FAIL;
+    if ( metadata.dimension == TEX_DIMENSION_TEXTURE3D )
+    {
+        // All slices of a given miplevel are contiguous
+        for( size_t level = 0; level < mip; ++level )
+        {
+            ComputePitch( metadata.format, w, h, rowPitch, slicePitch, cpFlags );
+            _offset += slicePitch * d;
 
-                    size_t dpitch = images[ index ].rowPitch;
-                    size_t spitch = timages[ index ].rowPitch;
+            if ( h > 1 )
+                h >>= 1;
 
-                    const uint8_t *pSrc = const_cast<const uint8_t*>( timages[ index ].pixels );
-                    if ( !pSrc )
-                        return E_POINTER;
+            if ( w > 1 )
+                w >>= 1;
 
-                    uint8_t *pDest = images[ index ].pixels;
-                    if ( !pDest )
-                        return E_POINTER;
+            if ( d > 1 )
+                d >>= 1;
+        }
 
-                    if ( IsCompressed( metadata.format ) )
-                    {
-                        size_t csize = std::min<size_t>( images[ index ].slicePitch, timages[ index ].slicePitch );
-                        memcpy_s( pDest, images[ index ].slicePitch, pSrc, csize );
-                    }
-                    else if ( IsPlanar( metadata.format ) )
-                    {
-                        // Direct3D does not support any planar formats for Texture3D
-                        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
-                    }
-                    else
-                    {
-                        for( size_t h = 0; h < images[ index ].height; ++h )
-                        {
-                            if ( convFlags & CONV_FLAGS_EXPAND )
-                            {
-                                if ( convFlags & (CONV_FLAGS_565|CONV_FLAGS_5551|CONV_FLAGS_4444) )
-                                {
-                                    if ( !_ExpandScanline( pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                                           pSrc, spitch,
-                                                           (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                                           tflags ) )
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat( convFlags );
-                                    if ( !_LegacyExpandScanline( pDest, dpitch, metadata.format,
-                                                                 pSrc, spitch, lformat, pal8,
-                                                                 tflags ) )
-                                        return E_FAIL;
-                                }
-                            }
-                            else if ( convFlags & CONV_FLAGS_SWIZZLE )
-                            {
-                                _SwizzleScanline( pDest, dpitch, pSrc, spitch, metadata.format, tflags );
-                            }
-                            else
-                            {
-                                _CopyScanline( pDest, dpitch, pSrc, spitch, metadata.format, tflags );
-                            }
+        ComputePitch( metadata.format, w, h, rowPitch, slicePitch, cpFlags );
+        _offset += slicePitch * slice;
+    }
+    else
+    {
+        // Each array item stores its complete mip chain before the next item
+        size_t itemSize = 0;
+        for( size_t level = 0; level < metadata.mipLevels; ++level )
+        {
+            size_t lw = std::max<size_t>( 1, metadata.width >> level );
+            size_t lh = std::max<size_t>( 1, metadata.height >> level );
+            ComputePitch( metadata.format, lw, lh, rowPitch, slicePitch, cpFlags );
 
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
-                    }
-                }
+            if ( level < mip )
+                _offset += slicePitch;
+            itemSize += slicePitch;
+        }
 
-                if ( d > 1 )
-                    d >>= 1;
+        _offset += itemSize * item;
+
+        w = std::max<size_t>( 1, metadata.width >> mip );
+        h = std::max<size_t>( 1, metadata.height >> mip );
+        ComputePitch( metadata.format, w, h, rowPitch, slicePitch, cpFlags );
+    }
+
+    srcImage.width = w;
+    srcImage.height = h;
+    srcImage.format = metadata.format;
+    srcImage.rowPitch = rowPitch;
+    srcImage.slicePitch = slicePitch;
+    srcImage.pixels = nullptr;
+
+    offset = _offset;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Loads a range of subresources; the fetch callback receives each subresource's offset
+// within the DDS pixel data and is responsible for converting it into the destination
+//-------------------------------------------------------------------------------------
+typedef std::function<HRESULT(size_t offset, Image& srcImage, const Image& destImage)> DDSFetchSubresource;
+
+static HRESULT _LoadDDSSubresources( _In_ const TexMetadata& metadata, _In_ DWORD cpFlags, _In_ DWORD convFlags,
+                                     _In_ size_t dataSize, _In_ size_t mipBase, _In_ size_t itemBase,
+                                     _In_ const ScratchImage& image, _In_ DDSFetchSubresource fetch )
+{
+    const TexMetadata& subset = image.GetMetadata();
+
+    cpFlags = _GetSourcePitchFlags( cpFlags, convFlags );
+
+    size_t depth = subset.depth;
+
+    for( size_t level = 0; level < subset.mipLevels; ++level )
+    {
+        size_t nitems = ( subset.dimension == TEX_DIMENSION_TEXTURE3D ) ? depth : subset.arraySize;
+
+        for( size_t index = 0; index < nitems; ++index )
+        {
+            const Image* dest = nullptr;
+            Image src;
+            size_t offset;
+
+            if ( subset.dimension == TEX_DIMENSION_TEXTURE3D )
+            {
+                dest = image.GetImage( level, 0, index );
+                _LocateDDSSubresource( metadata, cpFlags, mipBase + level, 0, index, src, offset );
             }
+            else
+            {
+                dest = image.GetImage( level, index, 0 );
+                _LocateDDSSubresource( metadata, cpFlags, mipBase + level, itemBase + index, 0, src, offset );
+            }
+
+            if ( !dest )
+                return E_POINTER;
+
+            if ( offset > dataSize || src.slicePitch > ( dataSize - offset ) )
+                return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+
+            HRESULT hr = fetch( offset, src, *dest );
+            if ( FAILED(hr) )
+                return hr;
         }
-        break;
 
-    default:
-        return E_FAIL;
+        if ( depth > 1 )
+            depth >>= 1;
+    }
+
+    return S_OK;
+}
+
+
+
+//-------------------------------------------------------------------------------------
+// Streaming helpers
+//-------------------------------------------------------------------------------------
+static HRESULT _ReadDDSStream( _In_ DDSReadStream& stream, _Out_writes_bytes_(size) void* pDestination, _In_ size_t size )
+{
+    auto ptr = reinterpret_cast<uint8_t*>( pDestination );
+
+    while( size > 0 )
+    {
+        size_t bytesRead = 0;
+        HRESULT hr = stream.Read( ptr, size, bytesRead );
+        if ( FAILED(hr) )
+            return hr;
+
+        if ( !bytesRead || bytesRead > size )
+            return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+
+        ptr += bytesRead;
+        size -= bytesRead;
     }
 
     return S_OK;
 }
 
+static HRESULT _ReadDDSStreamHeader( _In_ DDSReadStream& stream, _In_ DWORD flags,
+                                     _Out_ TexMetadata& metadata, _Out_ DWORD& convFlags, _Out_ uint64_t& streamSize )
+{
+    HRESULT hr = stream.GetSize( streamSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Subresource offsets are computed in size_t, so the whole stream must be addressable
+    if ( streamSize > SIZE_MAX )
+        return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+    // Need at least enough data to fill the standard header and magic number to be a valid DDS
+    if ( streamSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+        return E_FAIL;
+
+    hr = stream.Seek( 0 );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Read the header in (including extended header if present)
+    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+    uint8_t header[MAX_HEADER_SIZE];
+
+    size_t headerSize = ( streamSize < MAX_HEADER_SIZE ) ? static_cast<size_t>( streamSize ) : MAX_HEADER_SIZE;
+    hr = _ReadDDSStream( stream, header, headerSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    return _DecodeDDSHeader( header, headerSize, flags, metadata, convFlags );
+}
+
+#if defined(_WIN32)
+namespace
+{
+    // DDSReadStream over a Win32 file handle
+    class _HandleReadStream : public DDSReadStream
+    {
+    public:
+        explicit _HandleReadStream( HANDLE hFile ) : m_hFile( hFile ) {}
+
+        virtual HRESULT Read( void* pDestination, size_t size, size_t& bytesRead ) override
+        {
+            bytesRead = 0;
+
+            DWORD bytes = ( size > UINT32_MAX ) ? UINT32_MAX : static_cast<DWORD>( size );
+            DWORD chunkRead = 0;
+            if ( !ReadFile( m_hFile, pDestination, bytes, &chunkRead, 0 ) )
+                return HRESULT_FROM_WIN32( GetLastError() );
+
+            bytesRead = chunkRead;
+            return S_OK;
+        }
+
+        virtual HRESULT Seek( uint64_t position ) override
+        {
+            LARGE_INTEGER filePos;
+            filePos.QuadPart = static_cast<LONGLONG>( position );
+            if ( !SetFilePointerEx( m_hFile, filePos, 0, FILE_BEGIN ) )
+                return HRESULT_FROM_WIN32( GetLastError() );
+
+            return S_OK;
+        }
+
+        virtual HRESULT GetSize( uint64_t& size ) override
+        {
+            size = 0;
+
+            LARGE_INTEGER fileSize = {0};
+#if (_WIN32_WINNT >= _WIN32_WINNT_VISTA)
+            FILE_STANDARD_INFO fileInfo;
+            if ( !GetFileInformationByHandleEx( m_hFile, FileStandardInfo, &fileInfo, sizeof(fileInfo) ) )
+                return HRESULT_FROM_WIN32( GetLastError() );
+            fileSize = fileInfo.EndOfFile;
+#else
+            if ( !GetFileSizeEx( m_hFile, &fileSize ) )
+                return HRESULT_FROM_WIN32( GetLastError() );
+#endif
+            size = static_cast<uint64_t>( fileSize.QuadPart );
+            return S_OK;
+        }
+
+    private:
+        HANDLE m_hFile;
+    };
+
+    // Read-only view of a whole file (DDS_FLAGS_MEMORY_MAPPED)
+    class _MappedFile
+    {
+    public:
+        _MappedFile() : m_pView( nullptr ), m_size( 0 ) {}
+        ~_MappedFile() { if ( m_pView ) UnmapViewOfFile( m_pView ); }
+
+        HRESULT Map( HANDLE hFile )
+        {
+            _HandleReadStream stream( hFile );
+            uint64_t fileSize = 0;
+            HRESULT hr = stream.GetSize( fileSize );
+            if ( FAILED(hr) )
+                return hr;
+
+            // Same limit as the buffered path (and no 4 GB views for 32-bit processes)
+            if ( fileSize > UINT32_MAX )
+                return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+            if ( fileSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+                return E_FAIL;
+
+            // The view keeps the section alive once mapped
+            ScopedHandle hMapping( CreateFileMappingW( hFile, 0, PAGE_READONLY, 0, 0, 0 ) );
+            if ( !hMapping )
+                return HRESULT_FROM_WIN32( GetLastError() );
+
+            m_pView = reinterpret_cast<const uint8_t*>( MapViewOfFile( hMapping.get(), FILE_MAP_READ, 0, 0, 0 ) );
+            if ( !m_pView )
+                return HRESULT_FROM_WIN32( GetLastError() );
+
+            m_size = static_cast<size_t>( fileSize );
+            return S_OK;
+        }
+
+        const uint8_t* GetData() const { return m_pView; }
+        size_t GetSize() const { return m_size; }
+
+    private:
+        const uint8_t*  m_pView;
+        size_t          m_size;
+
+        _MappedFile( const _MappedFile& );
+        _MappedFile& operator=( const _MappedFile& );
+    };
+
+    // PrefetchVirtualMemory is Windows 8+; the library targets Vista, so it is looked up at load time
+    struct _MemoryRangeEntry
+    {
+        PVOID   VirtualAddress;
+        SIZE_T  NumberOfBytes;
+    };
+
+    typedef BOOL (WINAPI *PFN_PREFETCH_VIRTUAL_MEMORY)( HANDLE, ULONG_PTR, _MemoryRangeEntry*, ULONG );
+
+    PFN_PREFETCH_VIRTUAL_MEMORY _GetPrefetchVirtualMemory()
+    {
+        HMODULE hKernel = GetModuleHandleW( L"kernel32.dll" );
+        return hKernel ? reinterpret_cast<PFN_PREFETCH_VIRTUAL_MEMORY>( GetProcAddress( hKernel, "PrefetchVirtualMemory" ) ) : nullptr;
+    }
+
+    const PFN_PREFETCH_VIRTUAL_MEMORY s_pfPrefetchVirtualMemory = _GetPrefetchVirtualMemory();
+}
+
 static HRESULT _CopyImageInPlace( DWORD convFlags, _In_ const ScratchImage& image )
 {
     if ( !image.GetPixels() )
@@ -1295,6 +1418,96 @@ static HRESULT _CopyImageInPlace( DWORD convFlags, _In_ const ScratchImage& imag
 
     return S_OK;
 }
+#endif
+
+#if !defined(_WIN32)
+//-------------------------------------------------------------------------------------
+// madvise() wants page-aligned addresses; the range is widened to whole pages
+//-------------------------------------------------------------------------------------
+static void _AdviseSequentialRead( _In_reads_bytes_(bytes) const uint8_t* pStart, _In_ size_t bytes )
+{
+    static const uintptr_t s_pageSize = static_cast<uintptr_t>( sysconf( _SC_PAGESIZE ) );
+
+    const uintptr_t first = reinterpret_cast<uintptr_t>( pStart ) & ~( s_pageSize - 1 );
+    const uintptr_t last = reinterpret_cast<uintptr_t>( pStart ) + bytes;
+
+    madvise( reinterpret_cast<void*>( first ), last - first, MADV_SEQUENTIAL );
+    madvise( reinterpret_cast<void*>( first ), last - first, MADV_WILLNEED );
+}
+#endif
+
+//-------------------------------------------------------------------------------------
+// Asks the memory manager to read ahead the pages of the subresources about to be loaded
+// from a mapped DDS file (DDS_FLAGS_MEMORY_MAPPED): one range per array item (or one for
+// a volume), since the requested mip levels of an item are contiguous. Uses
+// PrefetchVirtualMemory on Windows and madvise elsewhere. A hint only; failures are ignored
+//-------------------------------------------------------------------------------------
+static void _PrefetchDDSSubresources( _In_reads_bytes_(size) const uint8_t* pData, _In_ size_t size, _In_ DWORD flags,
+                                      _In_ size_t mipBase, _In_ size_t mipLevels, _In_ size_t itemBase, _In_ size_t arraySize )
+{
+#if defined(_WIN32)
+    if ( !s_pfPrefetchVirtualMemory )
+        return;
+#endif
+
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    if ( FAILED( _DecodeDDSHeader( pData, size, flags, mdata, convFlags ) ) )
+        return;
+
+    TexMetadata subset;
+    if ( FAILED( _GetDDSSubsetMetadata( mdata, mipBase, mipLevels, itemBase, arraySize, subset ) ) )
+        return;
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if ( convFlags & CONV_FLAGS_DX10 )
+        offset += sizeof(DDS_HEADER_DXT10);
+    if ( convFlags & CONV_FLAGS_PAL8 )
+        offset += ( 256 * sizeof(uint32_t) );
+
+    if ( offset >= size )
+        return;
+
+    DWORD cpFlags = _GetSourcePitchFlags( (flags & DDS_FLAGS_LEGACY_DWORD) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE, convFlags );
+    const size_t dataSize = size - offset;
+    const size_t lastMip = mipBase + subset.mipLevels - 1;
+    const size_t nitems = ( mdata.dimension == TEX_DIMENSION_TEXTURE3D ) ? 1 : subset.arraySize;
+
+#if defined(_WIN32)
+    std::unique_ptr<_MemoryRangeEntry[]> ranges( new (std::nothrow) _MemoryRangeEntry[ nitems ] );
+    if ( !ranges )
+        return;
+
+    ULONG count = 0;
+#endif
+    for( size_t index = 0; index < nitems; ++index )
+    {
+        const size_t item = ( mdata.dimension == TEX_DIMENSION_TEXTURE3D ) ? 0 : itemBase + index;
+        const size_t lastSlice = ( mdata.dimension == TEX_DIMENSION_TEXTURE3D ) ? std::max<size_t>( 1, mdata.depth >> lastMip ) - 1 : 0;
+
+        Image first, last;
+        size_t start, end;
+        _LocateDDSSubresource( mdata, cpFlags, mipBase, item, 0, first, start );
+        _LocateDDSSubresource( mdata, cpFlags, lastMip, item, lastSlice, last, end );
+        end += last.slicePitch;
+
+        if ( start >= dataSize )
+            continue;
+
+#if defined(_WIN32)
+        ranges[ count ].VirtualAddress = const_cast<uint8_t*>( pData + offset + start );
+        ranges[ count ].NumberOfBytes = std::min<size_t>( end, dataSize ) - start;
+        ++count;
+#else
+        _AdviseSequentialRead( pData + offset + start, std::min<size_t>( end, dataSize ) - start );
+#endif
+    }
+
+#if defined(_WIN32)
+    if ( count > 0 )
+        s_pfPrefetchVirtualMemory( GetCurrentProcess(), count, ranges.get(), 0 );
+#endif
+}
 
 
 //=====================================================================================
@@ -1315,6 +1528,7 @@ HRESULT GetMetadataFromDDSMemory( LPCVOID pSource, size_t size, DWORD flags, Tex
     return _DecodeDDSHeader( pSource, size, flags, metadata, convFlags );
 }
 
+#if defined(_WIN32)
 _Use_decl_annotations_
 HRESULT GetMetadataFromDDSFile( LPCWSTR szFile, DWORD flags, TexMetadata& metadata )
 {
@@ -1374,6 +1588,19 @@ HRESULT GetMetadataFromDDSFile( LPCWSTR szFile, DWORD flags, TexMetadata& metada
     DWORD convFlags = 0;
     return _DecodeDDSHeader( header, bytesRead, flags, metadata, convFlags );
 }
+#endif
+
+
+//-------------------------------------------------------------------------------------
+// Obtain metadata from a DDS stream
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT GetMetadataFromDDSStream( DDSReadStream& stream, DWORD flags, TexMetadata& metadata )
+{
+    DWORD convFlags = 0;
+    uint64_t streamSize = 0;
+    return _ReadDDSStreamHeader( stream, flags, metadata, convFlags, streamSize );
+}
 
 
 //-------------------------------------------------------------------------------------
@@ -1393,6 +1620,9 @@ HRESULT LoadFromDDSMemory( LPCVOID pSource, size_t size, DWORD flags, TexMetadat
     if ( FAILED(hr) )
         return hr;
 
+    if ( flags & DDS_FLAGS_MEMORY_MAPPED )
+        _PrefetchDDSSubresources( reinterpret_cast<const uint8_t*>(pSource), size, flags, 0, 0, 0, 0 );
+
     size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
     if ( convFlags & CONV_FLAGS_DX10 )
         offset += sizeof(DDS_HEADER_DXT10);
@@ -1429,6 +1659,117 @@ HRESULT LoadFromDDSMemory( LPCVOID pSource, size_t size, DWORD flags, TexMetadat
 }
 
 
+//-------------------------------------------------------------------------------------
+// Describe a DDS file in memory without copying its pixels
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT LoadFromDDSMemory( LPCVOID pSource, size_t size, DWORD flags, TexMetadata* metadata, ImageSetView& view )
+{
+    if ( !pSource || size == 0 )
+        return E_INVALIDARG;
+
+    view.Release();
+
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    HRESULT hr = _DecodeDDSHeader( pSource, size, flags, mdata, convFlags );  
+    if ( FAILED(hr) )
+        return hr;
+
+    // Anything _CopySubresource would rewrite can't be handed out in place
+    if ( convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA | CONV_FLAGS_PAL8) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    if ( flags & DDS_FLAGS_MEMORY_MAPPED )
+        _PrefetchDDSSubresources( reinterpret_cast<const uint8_t*>(pSource), size, flags, 0, 0, 0, 0 );
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if ( convFlags & CONV_FLAGS_DX10 )
+        offset += sizeof(DDS_HEADER_DXT10);
+
+    assert( offset <= size );
+
+    DWORD cpFlags = _GetSourcePitchFlags( (flags & DDS_FLAGS_LEGACY_DWORD) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE, convFlags );
+
+    hr = view.Initialize( mdata, reinterpret_cast<const uint8_t*>(pSource) + offset, size - offset, cpFlags );
+    if ( FAILED(hr) )
+        return hr;
+
+    if ( metadata )
+        memcpy( metadata, &mdata, sizeof(TexMetadata) );
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Load a range of subresources from a DDS file in memory
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT LoadFromDDSMemory( LPCVOID pSource, size_t size, DWORD flags,
+                           size_t mipBase, size_t mipLevels, size_t itemBase, size_t arraySize,
+                           TexMetadata* metadata, ScratchImage& image )
+{
+    if ( !pSource || size == 0 )
+        return E_INVALIDARG;
+
+    image.Release();
+
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    HRESULT hr = _DecodeDDSHeader( pSource, size, flags, mdata, convFlags );  
+    if ( FAILED(hr) )
+        return hr;
+
+    if ( flags & DDS_FLAGS_MEMORY_MAPPED )
+        _PrefetchDDSSubresources( reinterpret_cast<const uint8_t*>(pSource), size, flags, mipBase, mipLevels, itemBase, arraySize );
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if ( convFlags & CONV_FLAGS_DX10 )
+        offset += sizeof(DDS_HEADER_DXT10);
+
+    assert( offset <= size );
+
+    const uint32_t *pal8 = nullptr;
+    if ( convFlags & CONV_FLAGS_PAL8 )
+    {
+        pal8 = reinterpret_cast<const uint32_t*>( reinterpret_cast<const uint8_t*>(pSource) + offset );
+        assert( pal8 );
+        offset += ( 256 * sizeof(uint32_t) );
+        if ( size < offset )
+            return E_FAIL;
+    }
+
+    TexMetadata subset;
+    hr = _GetDDSSubsetMetadata( mdata, mipBase, mipLevels, itemBase, arraySize, subset );
+    if ( FAILED(hr) )
+        return hr;
+
+    hr = image.Initialize( subset );
+    if ( FAILED(hr) )
+        return hr;
+
+    auto pPixels = reinterpret_cast<const uint8_t*>(pSource) + offset;
+    hr = _LoadDDSSubresources( mdata, (flags & DDS_FLAGS_LEGACY_DWORD) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE, convFlags,
+                               size - offset, mipBase, itemBase, image,
+                               [&]( size_t srcOffset, Image& srcImage, const Image& destImage ) -> HRESULT
+                               {
+                                   srcImage.pixels = const_cast<uint8_t*>( pPixels + srcOffset );
+                                   return _CopySubresource( srcImage, destImage, mdata, convFlags, pal8 );
+                               } );
+    if ( FAILED(hr) )
+    {
+        image.Release();
+        return hr;
+    }
+    if ( metadata )
+        memcpy( metadata, &image.GetMetadata(), sizeof(TexMetadata) );
+
+    return S_OK;
+}
+
+
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // Load a DDS file from disk
 //-------------------------------------------------------------------------------------
@@ -1452,6 +1793,16 @@ HRESULT LoadFromDDSFile( LPCWSTR szFile, DWORD flags, TexMetadata* metadata, Scr
         return HRESULT_FROM_WIN32( GetLastError() );
     }
 
+    if ( flags & DDS_FLAGS_MEMORY_MAPPED )
+    {
+        _MappedFile file;
+        HRESULT hr = file.Map( hFile.get() );
+        if ( FAILED(hr) )
+            return hr;
+
+        return LoadFromDDSMemory( file.GetData(), file.GetSize(), flags, metadata, image );
+    }
+
     // Get the file size
     LARGE_INTEGER fileSize = {0};
 
@@ -1602,6 +1953,156 @@ HRESULT LoadFromDDSFile( LPCWSTR szFile, DWORD flags, TexMetadata* metadata, Scr
 
     return S_OK;
 }
+#endif
+
+
+//-------------------------------------------------------------------------------------
+// Load a range of subresources from a DDS stream
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT LoadFromDDSStream( DDSReadStream& stream, DWORD flags,
+                           size_t mipBase, size_t mipLevels, size_t itemBase, size_t arraySize,
+                           TexMetadata* metadata, ScratchImage& image )
+{
+    image.Release();
+
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    uint64_t streamSize = 0;
+    HRESULT hr = _ReadDDSStreamHeader( stream, flags, mdata, convFlags, streamSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if ( convFlags & CONV_FLAGS_DX10 )
+        offset += sizeof(DDS_HEADER_DXT10);
+
+    std::unique_ptr<uint32_t[]> pal8;
+    if ( convFlags & CONV_FLAGS_PAL8 )
+    {
+        pal8.reset( new (std::nothrow) uint32_t[256] );
+        if ( !pal8 )
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        hr = stream.Seek( offset );
+        if ( FAILED(hr) )
+            return hr;
+
+        hr = _ReadDDSStream( stream, pal8.get(), 256 * sizeof(uint32_t) );
+        if ( FAILED(hr) )
+            return E_FAIL;
+
+        offset += ( 256 * sizeof(uint32_t) );
+    }
+
+    if ( streamSize <= offset )
+        return E_FAIL;
+
+    size_t remaining = static_cast<size_t>( streamSize - offset );
+
+    TexMetadata subset;
+    hr = _GetDDSSubsetMetadata( mdata, mipBase, mipLevels, itemBase, arraySize, subset );
+    if ( FAILED(hr) )
+        return hr;
+
+    hr = image.Initialize( subset );
+    if ( FAILED(hr) )
+        return hr;
+
+    std::unique_ptr<uint8_t[]> temp;
+    size_t tempSize = 0;
+
+    hr = _LoadDDSSubresources( mdata, (flags & DDS_FLAGS_LEGACY_DWORD) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE, convFlags,
+                               remaining, mipBase, itemBase, image,
+                               [&]( size_t srcOffset, Image& srcImage, const Image& destImage ) -> HRESULT
+                               {
+                                   HRESULT hrRead = stream.Seek( static_cast<uint64_t>( offset ) + srcOffset );
+                                   if ( FAILED(hrRead) )
+                                       return hrRead;
+
+                                   bool direct = !( convFlags & (CONV_FLAGS_EXPAND|CONV_FLAGS_SWIZZLE|CONV_FLAGS_NOALPHA) )
+                                                 && ( srcImage.rowPitch == destImage.rowPitch )
+                                                 && ( srcImage.slicePitch == destImage.slicePitch );
+
+                                   // Read straight into the scratch image when no conversion is required
+                                   uint8_t* pDest = destImage.pixels;
+                                   if ( !direct )
+                                   {
+                                       if ( tempSize < srcImage.slicePitch )
+                                       {
+                                           temp.reset( new (std::nothrow) uint8_t[ srcImage.slicePitch ] );
+                                           if ( !temp )
+                                               return E_OUTOFMEMORY;
+                                           tempSize = srcImage.slicePitch;
+                                       }
+                                       pDest = temp.get();
+                                   }
+
+                                   hrRead = _ReadDDSStream( stream, pDest, srcImage.slicePitch );
+                                   if ( FAILED(hrRead) )
+                                       return hrRead;
+
+                                   if ( direct )
+                                       return S_OK;
+
+                                   srcImage.pixels = temp.get();
+                                   return _CopySubresource( srcImage, destImage, mdata, convFlags, pal8.get() );
+                               } );
+    if ( FAILED(hr) )
+    {
+        image.Release();
+        return hr;
+    }
+
+    if ( metadata )
+        memcpy( metadata, &image.GetMetadata(), sizeof(TexMetadata) );
+
+    return S_OK;
+}
+
+
+#if defined(_WIN32)
+//-------------------------------------------------------------------------------------
+// Load a range of subresources from a DDS file on disk
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT LoadFromDDSFile( LPCWSTR szFile, DWORD flags,
+                         size_t mipBase, size_t mipLevels, size_t itemBase, size_t arraySize,
+                         TexMetadata* metadata, ScratchImage& image )
+{
+    if ( !szFile )
+        return E_INVALIDARG;
+
+    image.Release();
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile( safe_handle ( CreateFile2( szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, 0 ) ) );
+#else
+    ScopedHandle hFile( safe_handle ( CreateFileW( szFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                                   FILE_ATTRIBUTE_NORMAL, 0 ) ) );
+#endif
+
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    if ( flags & DDS_FLAGS_MEMORY_MAPPED )
+    {
+        _MappedFile file;
+        HRESULT hr = file.Map( hFile.get() );
+        if ( FAILED(hr) )
+            return hr;
+
+        return LoadFromDDSMemory( file.GetData(), file.GetSize(), flags, mipBase, mipLevels, itemBase, arraySize, metadata, image );
+    }
+
+    _HandleReadStream stream( hFile.get() );
+    return LoadFromDDSStream( stream, flags, mipBase, mipLevels, itemBase, arraySize, metadata, image );
+}
+#endif
 
 
 //-------------------------------------------------------------------------------------
@@ -1815,6 +2316,7 @@ HRESULT SaveToDDSMemory( const Image* images, size_t nimages, const TexMetadata&
 }
 
 
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // Save a DDS file to disk
 //-------------------------------------------------------------------------------------
@@ -1998,5 +2500,6 @@ HRESULT SaveToDDSFile( const Image* images, size_t nimages, const TexMetadata& m
 
     return S_OK;
 }
+#endif
 
 }; // namespace
@@ -0,0 +1,433 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexDirect.cpp
+//
+// DirectX Texture Library - Direct format-to-format row converters
+//
+// Byte permutations and 8 <-> 16 bit UNORM width changes done in integer registers,
+// skipping the XMVECTOR load/convert/store of _Convert. Every entry gives the same
+// bytes as the float pipeline: permutations are lossless, widening is x * 257 and
+// narrowing rounds (XMStore*N) or truncates (R8_UNORM) exactly as the store would
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define DIRECT_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#else
+#define DIRECT_X86 0
+#endif
+
+#if defined(_MSC_VER) || !DIRECT_X86
+#define DIRECT_TARGET_AVX2
+#else
+#define DIRECT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace DirectX
+{
+
+enum DIRECT_ISA
+{
+    DIRECT_ISA_SCALAR = 0,
+    DIRECT_ISA_SSE2,
+    DIRECT_ISA_AVX2,
+    DIRECT_ISA_COUNT
+};
+
+//-------------------------------------------------------------------------------------
+// Permutations on 32-bit texels (8:8:8:8). Also applied to packed 8-bit results of a
+// narrowing, and to 8-bit sources ahead of a widening
+//-------------------------------------------------------------------------------------
+struct _Keep8888
+{
+    static uint32_t Apply( _In_ uint32_t t ) { return t; }
+#if DIRECT_X86
+    static __m128i Apply( _In_ __m128i t ) { return t; }
+    DIRECT_TARGET_AVX2 static __m256i Apply( _In_ __m256i t ) { return t; }
+#endif
+};
+
+// R <-> B swap and/or opaque alpha (B8G8R8X8 reads and writes alpha as 1.0)
+template<bool SWAP_RB, bool SET_ALPHA>
+struct _Swizzle8888
+{
+    static uint32_t Apply( _In_ uint32_t t )
+    {
+        if ( SWAP_RB )
+            t = ( t & 0xff00ff00 ) | ( ( t >> 16 ) & 0xff ) | ( ( t & 0xff ) << 16 );
+        return SET_ALPHA ? ( t | 0xff000000 ) : t;
+    }
+
+#if DIRECT_X86
+    static __m128i Apply( _In_ __m128i t )
+    {
+        if ( SWAP_RB )
+        {
+            const __m128i mask = _mm_set1_epi32( 0xff );
+            t = _mm_or_si128( _mm_and_si128( t, _mm_set1_epi32( static_cast<int>( 0xff00ff00 ) ) ),
+                              _mm_or_si128( _mm_and_si128( _mm_srli_epi32( t, 16 ), mask ),
+                                            _mm_slli_epi32( _mm_and_si128( t, mask ), 16 ) ) );
+        }
+        return SET_ALPHA ? _mm_or_si128( t, _mm_set1_epi32( static_cast<int>( 0xff000000 ) ) ) : t;
+    }
+
+    DIRECT_TARGET_AVX2 static __m256i Apply( _In_ __m256i t )
+    {
+        if ( SWAP_RB )
+        {
+            const __m256i shuffle = _mm256_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                                      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+            t = _mm256_shuffle_epi8( t, shuffle );
+        }
+        return SET_ALPHA ? _mm256_or_si256( t, _mm256_set1_epi32( static_cast<int>( 0xff000000 ) ) ) : t;
+    }
+#endif
+};
+
+
+//-------------------------------------------------------------------------------------
+// 16-bit UNORM -> 8-bit UNORM on 16-bit lanes. x * 255 / 65535 is x / 257, and
+// floor( x * 0xff01 / 2^24 ) == floor( x / 257 ) for every 16-bit x. x / 257 is never
+// a half, so round-half-up and round-to-nearest-even agree
+//-------------------------------------------------------------------------------------
+
+// static_cast<uint8_t>( v * 255.f ) (_StoreScanline for R8_UNORM)
+struct _Truncate16To8
+{
+    static uint32_t Apply( _In_ uint32_t x ) { return x / 257; }
+#if DIRECT_X86
+    static __m128i Apply( _In_ __m128i x )
+    {
+        return _mm_srli_epi16( _mm_mulhi_epu16( x, _mm_set1_epi16( static_cast<short>( 0xff01 ) ) ), 8 );
+    }
+
+    DIRECT_TARGET_AVX2 static __m256i Apply( _In_ __m256i x )
+    {
+        return _mm256_srli_epi16( _mm256_mulhi_epu16( x, _mm256_set1_epi16( static_cast<short>( 0xff01 ) ) ), 8 );
+    }
+#endif
+};
+
+// XMStoreUByteN4 / XMStoreUByteN2
+struct _Round16To8
+{
+    static uint32_t Apply( _In_ uint32_t x ) { return ( x + 128 ) / 257; }
+#if DIRECT_X86
+    static __m128i Apply( _In_ __m128i x )
+    {
+        // q + ( x - q * 257 > 128 ); the compare yields -1 for true
+        __m128i q = _Truncate16To8::Apply( x );
+        __m128i r = _mm_sub_epi16( x, _mm_mullo_epi16( q, _mm_set1_epi16( 257 ) ) );
+        return _mm_sub_epi16( q, _mm_cmpgt_epi16( r, _mm_set1_epi16( 128 ) ) );
+    }
+
+    DIRECT_TARGET_AVX2 static __m256i Apply( _In_ __m256i x )
+    {
+        __m256i q = _Truncate16To8::Apply( x );
+        __m256i r = _mm256_sub_epi16( x, _mm256_mullo_epi16( q, _mm256_set1_epi16( 257 ) ) );
+        return _mm256_sub_epi16( q, _mm256_cmpgt_epi16( r, _mm256_set1_epi16( 128 ) ) );
+    }
+#endif
+};
+
+
+//-------------------------------------------------------------------------------------
+// Row drivers. count is in texels; P permutes 32-bit texels and must be _Keep8888
+// unless the 8-bit side has four channels
+//-------------------------------------------------------------------------------------
+template<class P> static void _Permute32_Scalar( _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint32_t* pSource, _In_ size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+        pDest[i] = P::Apply( pSource[i] );
+}
+
+template<class N, class P, size_t CH> static void _Narrow16_Scalar( _Out_writes_(count * CH) uint8_t* pDest, _In_reads_(count * CH) const uint16_t* pSource, _In_ size_t count )
+{
+    for( size_t i = 0; i < count; ++i, pDest += CH, pSource += CH )
+    {
+        if ( CH == 4 )
+        {
+            uint32_t t = N::Apply( pSource[0] ) | ( N::Apply( pSource[1] ) << 8 )
+                         | ( N::Apply( pSource[2] ) << 16 ) | ( N::Apply( pSource[3] ) << 24 );
+            *reinterpret_cast<uint32_t*>( pDest ) = P::Apply( t );
+        }
+        else
+        {
+            for( size_t c = 0; c < CH; ++c )
+                pDest[c] = static_cast<uint8_t>( N::Apply( pSource[c] ) );
+        }
+    }
+}
+
+template<class P, size_t CH> static void _Widen8_Scalar( _Out_writes_(count * CH) uint16_t* pDest, _In_reads_(count * CH) const uint8_t* pSource, _In_ size_t count )
+{
+    for( size_t i = 0; i < count; ++i, pDest += CH, pSource += CH )
+    {
+        if ( CH == 4 )
+        {
+            uint32_t t = P::Apply( *reinterpret_cast<const uint32_t*>( pSource ) );
+            for( size_t c = 0; c < 4; ++c, t >>= 8 )
+                pDest[c] = static_cast<uint16_t>( ( t & 0xff ) * 257 );
+        }
+        else
+        {
+            for( size_t c = 0; c < CH; ++c )
+                pDest[c] = static_cast<uint16_t>( pSource[c] * 257 );
+        }
+    }
+}
+
+#if DIRECT_X86
+template<class P> static void _Permute32_SSE2( uint32_t* pDest, const uint32_t* pSource, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ), P::Apply( v ) );
+    }
+    _Permute32_Scalar<P>( pDest + i, pSource + i, count - i );
+}
+
+template<class N, class P, size_t CH> static void _Narrow16_SSE2( uint8_t* pDest, const uint16_t* pSource, size_t count )
+{
+    // 16 channels per step
+    const size_t step = 16 / CH;
+    size_t i = 0;
+    for( ; i + step <= count; i += step )
+    {
+        __m128i lo = N::Apply( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i * CH ) ) );
+        __m128i hi = N::Apply( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i * CH + 8 ) ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i * CH ), P::Apply( _mm_packus_epi16( lo, hi ) ) );
+    }
+    _Narrow16_Scalar<N, P, CH>( pDest + i * CH, pSource + i * CH, count - i );
+}
+
+template<class P, size_t CH> static void _Widen8_SSE2( uint16_t* pDest, const uint8_t* pSource, size_t count )
+{
+    // x * 257 == ( x << 8 ) | x, which is what interleaving a byte with itself gives
+    const size_t step = 16 / CH;
+    size_t i = 0;
+    for( ; i + step <= count; i += step )
+    {
+        __m128i v = P::Apply( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i * CH ) ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i * CH ),     _mm_unpacklo_epi8( v, v ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i * CH + 8 ), _mm_unpackhi_epi8( v, v ) );
+    }
+    _Widen8_Scalar<P, CH>( pDest + i * CH, pSource + i * CH, count - i );
+}
+
+template<class P> DIRECT_TARGET_AVX2 static void _Permute32_AVX2( uint32_t* pDest, const uint32_t* pSource, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pSource + i ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i ), P::Apply( v ) );
+    }
+    _Permute32_Scalar<P>( pDest + i, pSource + i, count - i );
+}
+
+template<class N, class P, size_t CH> DIRECT_TARGET_AVX2 static void _Narrow16_AVX2( uint8_t* pDest, const uint16_t* pSource, size_t count )
+{
+    // 32 channels per step; the pack works per 128-bit lane, so put the quadwords back in order
+    const size_t step = 32 / CH;
+    size_t i = 0;
+    for( ; i + step <= count; i += step )
+    {
+        __m256i lo = N::Apply( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pSource + i * CH ) ) );
+        __m256i hi = N::Apply( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pSource + i * CH + 16 ) ) );
+        __m256i v = _mm256_permute4x64_epi64( _mm256_packus_epi16( lo, hi ), 0xD8 );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i * CH ), P::Apply( v ) );
+    }
+    _Narrow16_Scalar<N, P, CH>( pDest + i * CH, pSource + i * CH, count - i );
+}
+
+template<class P, size_t CH> DIRECT_TARGET_AVX2 static void _Widen8_AVX2( uint16_t* pDest, const uint8_t* pSource, size_t count )
+{
+    // Quadwords 0 2 1 3 so the per-lane unpacks produce channels 0-15 then 16-31
+    const size_t step = 32 / CH;
+    size_t i = 0;
+    for( ; i + step <= count; i += step )
+    {
+        __m256i v = P::Apply( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pSource + i * CH ) ) );
+        v = _mm256_permute4x64_epi64( v, 0xD8 );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i * CH ),      _mm256_unpacklo_epi8( v, v ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i * CH + 16 ), _mm256_unpackhi_epi8( v, v ) );
+    }
+    _Widen8_Scalar<P, CH>( pDest + i * CH, pSource + i * CH, count - i );
+}
+#endif // DIRECT_X86
+
+
+//-------------------------------------------------------------------------------------
+// Type-erased entry points, one per driver and ISA
+//-------------------------------------------------------------------------------------
+template<class P> static void _Permute32Row_Scalar( void* pDest, const void* pSource, size_t count )
+{
+    _Permute32_Scalar<P>( reinterpret_cast<uint32_t*>( pDest ), reinterpret_cast<const uint32_t*>( pSource ), count );
+}
+
+template<class N, class P, size_t CH> static void _Narrow16Row_Scalar( void* pDest, const void* pSource, size_t count )
+{
+    _Narrow16_Scalar<N, P, CH>( reinterpret_cast<uint8_t*>( pDest ), reinterpret_cast<const uint16_t*>( pSource ), count );
+}
+
+template<class P, size_t CH> static void _Widen8Row_Scalar( void* pDest, const void* pSource, size_t count )
+{
+    _Widen8_Scalar<P, CH>( reinterpret_cast<uint16_t*>( pDest ), reinterpret_cast<const uint8_t*>( pSource ), count );
+}
+
+#if DIRECT_X86
+template<class P> static void _Permute32Row_SSE2( void* pDest, const void* pSource, size_t count )
+{
+    _Permute32_SSE2<P>( reinterpret_cast<uint32_t*>( pDest ), reinterpret_cast<const uint32_t*>( pSource ), count );
+}
+
+template<class N, class P, size_t CH> static void _Narrow16Row_SSE2( void* pDest, const void* pSource, size_t count )
+{
+    _Narrow16_SSE2<N, P, CH>( reinterpret_cast<uint8_t*>( pDest ), reinterpret_cast<const uint16_t*>( pSource ), count );
+}
+
+template<class P, size_t CH> static void _Widen8Row_SSE2( void* pDest, const void* pSource, size_t count )
+{
+    _Widen8_SSE2<P, CH>( reinterpret_cast<uint16_t*>( pDest ), reinterpret_cast<const uint8_t*>( pSource ), count );
+}
+
+template<class P> static void _Permute32Row_AVX2( void* pDest, const void* pSource, size_t count )
+{
+    _Permute32_AVX2<P>( reinterpret_cast<uint32_t*>( pDest ), reinterpret_cast<const uint32_t*>( pSource ), count );
+}
+
+template<class N, class P, size_t CH> static void _Narrow16Row_AVX2( void* pDest, const void* pSource, size_t count )
+{
+    _Narrow16_AVX2<N, P, CH>( reinterpret_cast<uint8_t*>( pDest ), reinterpret_cast<const uint16_t*>( pSource ), count );
+}
+
+template<class P, size_t CH> static void _Widen8Row_AVX2( void* pDest, const void* pSource, size_t count )
+{
+    _Widen8_AVX2<P, CH>( reinterpret_cast<uint16_t*>( pDest ), reinterpret_cast<const uint8_t*>( pSource ), count );
+}
+
+#define DIRECT_ROWS( driver, ... ) { &driver##Row_Scalar<__VA_ARGS__>, &driver##Row_SSE2<__VA_ARGS__>, &driver##Row_AVX2<__VA_ARGS__> }
+#else
+#define DIRECT_ROWS( driver, ... ) { &driver##Row_Scalar<__VA_ARGS__>, &driver##Row_Scalar<__VA_ARGS__>, &driver##Row_Scalar<__VA_ARGS__> }
+#endif // DIRECT_X86
+
+#define DIRECT_PERMUTE( in, out, P )        { in, out, DIRECT_ROWS( _Permute32, P ) }
+#define DIRECT_NARROW( in, out, N, P, CH )  { in, out, DIRECT_ROWS( _Narrow16, N, P, CH ) }
+#define DIRECT_WIDEN( in, out, P, CH )      { in, out, DIRECT_ROWS( _Widen8, P, CH ) }
+
+
+//-------------------------------------------------------------------------------------
+// Registry. sRGB pairs are listed only where both sides share the colour space, since
+// _ConvertScanline then cancels SRGB_IN against SRGB_OUT
+//-------------------------------------------------------------------------------------
+struct DirectConvert
+{
+    DXGI_FORMAT         inFormat;
+    DXGI_FORMAT         outFormat;
+    DIRECT_CONVERT_ROW  rows[ DIRECT_ISA_COUNT ];
+};
+
+typedef _Swizzle8888<true, false>  _SwapRB;
+typedef _Swizzle8888<true, true>   _SwapRBSetAlpha;
+typedef _Swizzle8888<false, true>  _SetAlpha;
+
+static const DirectConvert g_DirectConvertTable[] =
+{
+    DIRECT_PERMUTE( DXGI_FORMAT_R8G8B8A8_UNORM,         DXGI_FORMAT_B8G8R8A8_UNORM,         _SwapRB ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8A8_UNORM,         DXGI_FORMAT_R8G8B8A8_UNORM,         _SwapRB ),
+    DIRECT_PERMUTE( DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    _SwapRB ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    _SwapRB ),
+    DIRECT_PERMUTE( DXGI_FORMAT_R8G8B8A8_UNORM,         DXGI_FORMAT_B8G8R8X8_UNORM,         _SwapRBSetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8X8_UNORM,         DXGI_FORMAT_R8G8B8A8_UNORM,         _SwapRBSetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    _SwapRBSetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    _SwapRBSetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8A8_UNORM,         DXGI_FORMAT_B8G8R8X8_UNORM,         _SetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8X8_UNORM,         DXGI_FORMAT_B8G8R8A8_UNORM,         _SetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    _SetAlpha ),
+    DIRECT_PERMUTE( DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    _SetAlpha ),
+
+    DIRECT_NARROW( DXGI_FORMAT_R16G16B16A16_UNORM,      DXGI_FORMAT_R8G8B8A8_UNORM,         _Round16To8, _Keep8888, 4 ),
+    DIRECT_NARROW( DXGI_FORMAT_R16G16B16A16_UNORM,      DXGI_FORMAT_B8G8R8A8_UNORM,         _Round16To8, _SwapRB, 4 ),
+    DIRECT_NARROW( DXGI_FORMAT_R16G16_UNORM,            DXGI_FORMAT_R8G8_UNORM,             _Round16To8, _Keep8888, 2 ),
+    DIRECT_NARROW( DXGI_FORMAT_R16_UNORM,               DXGI_FORMAT_R8_UNORM,               _Truncate16To8, _Keep8888, 1 ),
+
+    DIRECT_WIDEN( DXGI_FORMAT_R8G8B8A8_UNORM,           DXGI_FORMAT_R16G16B16A16_UNORM,     _Keep8888, 4 ),
+    DIRECT_WIDEN( DXGI_FORMAT_B8G8R8A8_UNORM,           DXGI_FORMAT_R16G16B16A16_UNORM,     _SwapRB, 4 ),
+    DIRECT_WIDEN( DXGI_FORMAT_R8G8_UNORM,               DXGI_FORMAT_R16G16_UNORM,           _Keep8888, 2 ),
+    DIRECT_WIDEN( DXGI_FORMAT_R8_UNORM,                 DXGI_FORMAT_R16_UNORM,              _Keep8888, 1 ),
+};
+
+#undef DIRECT_PERMUTE
+#undef DIRECT_NARROW
+#undef DIRECT_WIDEN
+#undef DIRECT_ROWS
+
+
+//-------------------------------------------------------------------------------------
+// Lookup
+//-------------------------------------------------------------------------------------
+static DIRECT_ISA _GetDirectISA( _In_ DWORD cpu )
+{
+#if DIRECT_X86
+    if ( cpu & CPU_FEATURE_AVX2 )
+        return DIRECT_ISA_AVX2;
+    if ( cpu & CPU_FEATURE_SSE2 )
+        return DIRECT_ISA_SSE2;
+#else
+    UNREFERENCED_PARAMETER( cpu );
+#endif
+    return DIRECT_ISA_SCALAR;
+}
+
+_Use_decl_annotations_
+DIRECT_CONVERT_ROW _GetDirectConverter( DXGI_FORMAT inFormat, DXGI_FORMAT outFormat, DWORD filter )
+{
+    return _GetDirectConverter( inFormat, outFormat, filter, _GetCPUFeatures() );
+}
+
+_Use_decl_annotations_
+DIRECT_CONVERT_ROW _GetDirectConverter( DXGI_FORMAT inFormat, DXGI_FORMAT outFormat, DWORD filter, DWORD cpuFeatures )
+{
+    if ( filter & (TEX_FILTER_DITHER | TEX_FILTER_DITHER_DIFFUSION) )
+        return nullptr;
+
+    // Explicit sRGB flags only cancel out when both formats are sRGB
+    if ( (filter & TEX_FILTER_SRGB) && !( IsSRGB( inFormat ) && IsSRGB( outFormat ) ) )
+        return nullptr;
+
+    for( size_t index = 0; index < _countof(g_DirectConvertTable); ++index )
+    {
+        const DirectConvert& entry = g_DirectConvertTable[ index ];
+        if ( entry.inFormat == inFormat && entry.outFormat == outFormat )
+            return entry.rows[ _GetDirectISA( cpuFeatures ) ];
+    }
+
+    return nullptr;
+}
+
+_Use_decl_annotations_
+bool _GetDirectConverterPair( size_t index, DXGI_FORMAT& inFormat, DXGI_FORMAT& outFormat )
+{
+    if ( index >= _countof(g_DirectConvertTable) )
+        return false;
+
+    inFormat = g_DirectConvertTable[ index ].inFormat;
+    outFormat = g_DirectConvertTable[ index ].outFormat;
+    return true;
+}
+
+}; // namespace
@@ -13,7 +13,7 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
 namespace DirectX
 {
@@ -225,6 +225,61 @@ bool _SetupImageArray( uint8_t *pMemory, size_t pixelSize,
 }
 
 
+//-------------------------------------------------------------------------------------
+// Index of a subresource in an image array laid out by _SetupImageArray
+//-------------------------------------------------------------------------------------
+static bool _GetImageIndex( _In_ const TexMetadata& metadata, _In_ size_t mip, _In_ size_t item, _In_ size_t slice, _Out_ size_t& index )
+{
+    if ( mip >= metadata.mipLevels )
+        return false;
+
+    index = 0;
+
+    switch( metadata.dimension )
+    {
+    case TEX_DIMENSION_TEXTURE1D:
+    case TEX_DIMENSION_TEXTURE2D:
+        if ( slice > 0 )
+            return false;
+
+        if ( item >= metadata.arraySize )
+            return false;
+
+        index = item*( metadata.mipLevels ) + mip;
+        break;
+
+    case TEX_DIMENSION_TEXTURE3D:
+        if ( item > 0 )
+        {
+            // No support for arrays of volumes
+            return false;
+        }
+        else
+        {
+            size_t d = metadata.depth;
+
+            for( size_t level = 0; level < mip; ++level )
+            {
+                index += d;
+                if ( d > 1 )
+                    d >>= 1;
+            }
+
+            if ( slice >= d )
+                return false;
+
+            index += slice;
+        }
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+
 //=====================================================================================
 // ScratchImage - Bitmap image container
 //=====================================================================================
@@ -240,6 +295,7 @@ ScratchImage& ScratchImage::operator= (ScratchImage&& moveFrom)
         _metadata = moveFrom._metadata;
         _image = moveFrom._image;
         _memory = moveFrom._memory;
+        _allocator = moveFrom._allocator;
 
         moveFrom._nimages = 0;
         moveFrom._size = 0;
@@ -331,7 +387,7 @@ HRESULT ScratchImage::Initialize( const TexMetadata& mdata, DWORD flags )
     _nimages = nimages;
     memset( _image, 0, sizeof(Image) * nimages );
 
-    _memory = reinterpret_cast<uint8_t*>( _aligned_malloc( pixelSize, 16 ) );
+    _memory = reinterpret_cast<uint8_t*>( _AllocateImageMemory( _allocator, pixelSize ) );
     if ( !_memory )
     {
         Release();
@@ -400,7 +456,7 @@ HRESULT ScratchImage::Initialize2D( DXGI_FORMAT fmt, size_t width, size_t height
     _nimages = nimages;
     memset( _image, 0, sizeof(Image) * nimages );
 
-    _memory = reinterpret_cast<uint8_t*>( _aligned_malloc( pixelSize, 16 ) );
+    _memory = reinterpret_cast<uint8_t*>( _AllocateImageMemory( _allocator, pixelSize ) );
     if ( !_memory )
     {
         Release();
@@ -452,7 +508,7 @@ HRESULT ScratchImage::Initialize3D( DXGI_FORMAT fmt, size_t width, size_t height
     _nimages = nimages;
     memset( _image, 0, sizeof(Image) * nimages );
 
-    _memory = reinterpret_cast<uint8_t*>( _aligned_malloc( pixelSize, 16 ) );
+    _memory = reinterpret_cast<uint8_t*>( _AllocateImageMemory( _allocator, pixelSize ) );
     if ( !_memory )
     {
         Release();
@@ -667,7 +723,6 @@ HRESULT ScratchImage::Initialize3DFromImages( const Image* images, size_t depth,
 void ScratchImage::Release()
 {
     _nimages = 0;
-    _size = 0;
 
     if ( _image )
     {
@@ -677,9 +732,11 @@ void ScratchImage::Release()
 
     if ( _memory )
     {
-        _aligned_free( _memory );
+        _FreeImageMemory( _allocator, _memory, _size );
         _memory = 0;
     }
+
+    _size = 0;
     
     memset(&_metadata, 0, sizeof(_metadata));
 }
@@ -715,52 +772,10 @@ bool ScratchImage::OverrideFormat( DXGI_FORMAT f )
 _Use_decl_annotations_
 const Image* ScratchImage::GetImage(size_t mip, size_t item, size_t slice) const
 {
-    if ( mip >= _metadata.mipLevels )
+    size_t index;
+    if ( !_GetImageIndex( _metadata, mip, item, slice, index ) )
         return nullptr;
 
-    size_t index = 0;
-
-    switch( _metadata.dimension )
-    {
-    case TEX_DIMENSION_TEXTURE1D:
-    case TEX_DIMENSION_TEXTURE2D:
-        if ( slice > 0 )
-            return nullptr;
-
-        if ( item >= _metadata.arraySize )
-            return nullptr;
-
-        index = item*( _metadata.mipLevels ) + mip;
-        break;
-
-    case TEX_DIMENSION_TEXTURE3D:
-        if ( item > 0 )
-        {
-            // No support for arrays of volumes
-            return nullptr;
-        }
-        else
-        {
-            size_t d = _metadata.depth;
-
-            for( size_t level = 0; level < mip; ++level )
-            {
-                index += d;
-                if ( d > 1 )
-                    d >>= 1;
-            }
-
-            if ( slice >= d )
-                return nullptr;
-
-            index += slice;
-        }
-        break;
-
-    default:
-        return nullptr;
-    }
- 
     return &_image[index];
 }
 
@@ -818,4 +833,437 @@ bool ScratchImage::IsAlphaAllOpaque() const
     return true;
 }
 
+
+//=====================================================================================
+// ImageSetView - Non-owning image container
+//=====================================================================================
+
+ImageSetView& ImageSetView::operator= (ImageSetView&& moveFrom)
+{
+    if ( this != &moveFrom )
+    {
+        Release();
+
+        _nimages = moveFrom._nimages;
+        _metadata = moveFrom._metadata;
+        _image = moveFrom._image;
+
+        moveFrom._nimages = 0;
+        moveFrom._image = nullptr;
+    }
+    return *this;
+}
+
+_Use_decl_annotations_
+HRESULT ImageSetView::Initialize( const TexMetadata& mdata, const uint8_t* pPixels, size_t size, DWORD flags )
+{
+    if ( !pPixels || !size )
+        return E_INVALIDARG;
+
+    if ( !IsValid(mdata.format) || !mdata.width || !mdata.height || !mdata.depth || !mdata.arraySize || !mdata.mipLevels )
+        return E_INVALIDARG;
+
+    if ( IsPalettized(mdata.format) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    switch( mdata.dimension )
+    {
+    case TEX_DIMENSION_TEXTURE1D:
+    case TEX_DIMENSION_TEXTURE2D:
+        if ( mdata.depth != 1 )
+            return E_INVALIDARG;
+        break;
+
+    case TEX_DIMENSION_TEXTURE3D:
+        if ( mdata.arraySize != 1 )
+            return E_INVALIDARG;
+        break;
+
+    default:
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    Release();
+
+    size_t pixelSize, nimages;
+    _DetermineImageArray( mdata, flags, nimages, pixelSize );
+    if ( pixelSize > size )
+        return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+
+    _image = new (std::nothrow) Image[ nimages ];
+    if ( !_image )
+        return E_OUTOFMEMORY;
+
+    // The descriptors only ever hand the pixels out; nothing here writes through them
+    if ( !_SetupImageArray( const_cast<uint8_t*>( pPixels ), pixelSize, mdata, flags, _image, nimages ) )
+    {
+        Release();
+        return E_FAIL;
+    }
+
+    _nimages = nimages;
+    _metadata = mdata;
+
+    return S_OK;
+}
+
+void ImageSetView::Release()
+{
+    _nimages = 0;
+
+    if ( _image )
+    {
+        delete [] _image;
+        _image = 0;
+    }
+
+    memset(&_metadata, 0, sizeof(_metadata));
+}
+
+_Use_decl_annotations_
+const Image* ImageSetView::GetImage(size_t mip, size_t item, size_t slice) const
+{
+    size_t index;
+    if ( !_GetImageIndex( _metadata, mip, item, slice, index ) )
+        return nullptr;
+
+    return &_image[index];
+}
+
+
+//=====================================================================================
+// ImagePool - Size-class pool for pixel memory
+//=====================================================================================
+
+// VS 2013 has no thread_local
+#if defined(_MSC_VER)
+#define IMAGE_THREAD_LOCAL __declspec(thread)
+#else
+#define IMAGE_THREAD_LOCAL __thread
+#endif
+
+static IMAGE_THREAD_LOCAL IImageAllocator* t_imageAllocator = nullptr;
+
+_Use_decl_annotations_
+ImagePool::ImagePool( size_t maxRetainedBytes )
+    : _maxRetainedBytes( maxRetainedBytes ),
+      _outstandingBuffers( 0 ),
+      _retired( false )
+{
+    InitializeSRWLock( &_lock );
+    memset( &_stats, 0, sizeof(_stats) );
+    memset( _cachedCount, 0, sizeof(_cachedCount) );
+}
+
+ImagePool::~ImagePool()
+{
+    assert( !_outstandingBuffers );
+    _FreeCached();
+}
+
+//-------------------------------------------------------------------------------------
+// Rounds size up to its class: one class up to 4 KB, then 4 per power of two up to
+// 256 MB (at most 25% slack). Larger sizes return c_sizeClasses and are not pooled
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+size_t ImagePool::_GetSizeClass( size_t size, size_t& classSize )
+{
+    if ( size <= 4096 )
+    {
+        classSize = 4096;
+        return 0;
+    }
+
+    size_t e = 12;
+    while ( e < 28 && ( ( size - 1 ) >> ( e + 1 ) ) )
+        ++e;
+
+    if ( e >= 28 )
+    {
+        classSize = size;
+        return c_sizeClasses;
+    }
+
+    size_t step = size_t(1) << ( e - 2 );
+    size_t q = ( size - 1 ) / step + 1;
+    classSize = q * step;
+    return 1 + ( e - 12 ) * 4 + ( q - 5 );
+}
+
+_Use_decl_annotations_
+void* ImagePool::Allocate( size_t size )
+{
+    size_t classSize;
+    size_t index = _GetSizeClass( size, classSize );
+
+    void* pMemory = nullptr;
+
+    AcquireSRWLockExclusive( &_lock );
+    ++_stats.allocations;
+    if ( index < c_sizeClasses && _cachedCount[ index ] > 0 )
+    {
+        pMemory = _cached[ index ][ --_cachedCount[ index ] ];
+        _stats.retainedBytes -= classSize;
+        ++_stats.hits;
+    }
+    else
+    {
+        ReleaseSRWLockExclusive( &_lock );
+
+        pMemory = _aligned_malloc( classSize, 16 );
+        if ( !pMemory )
+            return nullptr;
+
+        AcquireSRWLockExclusive( &_lock );
+    }
+    _stats.outstandingBytes += classSize;
+    ++_outstandingBuffers;
+    ReleaseSRWLockExclusive( &_lock );
+
+    return pMemory;
+}
+
+_Use_decl_annotations_
+void ImagePool::Free( void* pMemory, size_t size )
+{
+    if ( !pMemory )
+        return;
+
+    size_t classSize;
+    size_t index = _GetSizeClass( size, classSize );
+
+    bool cached = false;
+    bool release;
+
+    AcquireSRWLockExclusive( &_lock );
+    assert( _outstandingBuffers > 0 );
+    ++_stats.frees;
+    _stats.outstandingBytes -= classSize;
+    --_outstandingBuffers;
+
+    if ( !_retired && index < c_sizeClasses && _cachedCount[ index ] < c_classDepth
+         && _stats.retainedBytes + classSize <= _maxRetainedBytes )
+    {
+        _cached[ index ][ _cachedCount[ index ]++ ] = pMemory;
+        _stats.retainedBytes += classSize;
+        _stats.peakRetainedBytes = std::max( _stats.peakRetainedBytes, _stats.retainedBytes );
+        cached = true;
+    }
+    else
+    {
+        ++_stats.discards;
+    }
+
+    release = _retired && !_outstandingBuffers;
+    ReleaseSRWLockExclusive( &_lock );
+
+    if ( !cached )
+        _aligned_free( pMemory );
+
+    if ( release )
+        delete this;
+}
+
+void ImagePool::Trim()
+{
+    AcquireSRWLockExclusive( &_lock );
+    _FreeCached();
+    ReleaseSRWLockExclusive( &_lock );
+}
+
+ImagePoolStats ImagePool::GetStats() const
+{
+    AcquireSRWLockShared( &_lock );
+    ImagePoolStats stats = _stats;
+    ReleaseSRWLockShared( &_lock );
+    return stats;
+}
+
+void ImagePool::_FreeCached()
+{
+    for( size_t index = 0; index < c_sizeClasses; ++index )
+    {
+        for( size_t j = 0; j < _cachedCount[ index ]; ++j )
+        {
+            _aligned_free( _cached[ index ][ j ] );
+        }
+        _cachedCount[ index ] = 0;
+    }
+    _stats.retainedBytes = 0;
+}
+
+//-------------------------------------------------------------------------------------
+// Empties a heap-allocated pool and deletes it now, or with the last outstanding buffer
+//-------------------------------------------------------------------------------------
+void ImagePool::_Retire()
+{
+    AcquireSRWLockExclusive( &_lock );
+    _FreeCached();
+    _retired = true;
+    bool release = !_outstandingBuffers;
+    ReleaseSRWLockExclusive( &_lock );
+
+    if ( release )
+        delete this;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Per-thread allocator and pool
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void SetThreadImageAllocator( IImageAllocator* allocator )
+{
+    t_imageAllocator = allocator;
+}
+
+IImageAllocator* GetThreadImageAllocator()
+{
+    return t_imageAllocator;
+}
+
+//-------------------------------------------------------------------------------------
+// Each thread's pool sits in a fiber-local slot whose callback retires it at thread exit,
+// which DllMain cannot do once DisableThreadLibraryCalls is in effect, and for every
+// thread at FlsFree on unload. Slots holding a pool are listed for ReleaseImagePools
+//-------------------------------------------------------------------------------------
+struct ThreadPoolSlot
+{
+    ImagePool*      pool;       // nullptr until first use, and once retired
+    ThreadPoolSlot* next;
+};
+
+static SRWLOCK s_threadPoolsLock = SRWLOCK_INIT;
+static ThreadPoolSlot* s_threadPools = nullptr;
+
+class ThreadImagePools
+{
+public:
+    // Takes the slot's pool off the list and retires it
+    static void Retire( _In_ ThreadPoolSlot* slot )
+    {
+        AcquireSRWLockExclusive( &s_threadPoolsLock );
+        ImagePool* pool = slot->pool;
+        if ( pool )
+        {
+            for( ThreadPoolSlot** link = &s_threadPools; *link; link = &(*link)->next )
+            {
+                if ( *link == slot )
+                {
+                    *link = slot->next;
+                    break;
+                }
+            }
+            slot->pool = nullptr;
+            slot->next = nullptr;
+        }
+        ReleaseSRWLockExclusive( &s_threadPoolsLock );
+
+        if ( pool )
+            pool->_Retire();
+    }
+
+    static void RetireAll()
+    {
+        AcquireSRWLockExclusive( &s_threadPoolsLock );
+        ThreadPoolSlot* slot = s_threadPools;
+        s_threadPools = nullptr;
+        while ( slot )
+        {
+            ThreadPoolSlot* next = slot->next;
+            slot->pool->_Retire();
+            slot->pool = nullptr;
+            slot->next = nullptr;
+            slot = next;
+        }
+        ReleaseSRWLockExclusive( &s_threadPoolsLock );
+    }
+};
+
+static void WINAPI _FreeThreadPoolSlot( PVOID pData )
+{
+    auto slot = reinterpret_cast<ThreadPoolSlot*>( pData );
+    if ( !slot )
+        return;
+
+    ThreadImagePools::Retire( slot );
+    delete slot;
+}
+
+class ThreadPoolIndex
+{
+public:
+    ThreadPoolIndex() : index( FlsAlloc( _FreeThreadPoolSlot ) ) {}
+    ~ThreadPoolIndex() { if ( index != FLS_OUT_OF_INDEXES ) FlsFree( index ); }
+
+    DWORD index;
+};
+
+static ThreadPoolIndex g_threadPoolIndex;
+
+static ThreadPoolSlot* _GetThreadPoolSlot()
+{
+    if ( g_threadPoolIndex.index == FLS_OUT_OF_INDEXES )
+        return nullptr;
+
+    return reinterpret_cast<ThreadPoolSlot*>( FlsGetValue( g_threadPoolIndex.index ) );
+}
+
+ImagePool* GetThreadImagePool()
+{
+    if ( g_threadPoolIndex.index == FLS_OUT_OF_INDEXES )
+        return nullptr;
+
+    ThreadPoolSlot* slot = _GetThreadPoolSlot();
+    if ( !slot )
+    {
+        slot = new (std::nothrow) ThreadPoolSlot;
+        if ( !slot )
+            return nullptr;
+
+        slot->pool = nullptr;
+        slot->next = nullptr;
+        if ( !FlsSetValue( g_threadPoolIndex.index, slot ) )
+        {
+            delete slot;
+            return nullptr;
+        }
+    }
+
+    if ( !slot->pool )
+    {
+        ImagePool* pool = new (std::nothrow) ImagePool;
+        if ( !pool )
+            return nullptr;
+
+        AcquireSRWLockExclusive( &s_threadPoolsLock );
+        slot->pool = pool;
+        slot->next = s_threadPools;
+        s_threadPools = slot;
+        ReleaseSRWLockExclusive( &s_threadPoolsLock );
+    }
+    return slot->pool;
+}
+
+void ReleaseThreadImagePool()
+{
+    ThreadPoolSlot* slot = _GetThreadPoolSlot();
+    if ( !slot || !slot->pool )
+        return;
+
+    if ( t_imageAllocator == slot->pool )
+        t_imageAllocator = nullptr;
+
+    ThreadImagePools::Retire( slot );
+}
+
+void ReleaseImagePools()
+{
+    ThreadPoolSlot* slot = _GetThreadPoolSlot();
+    if ( slot && slot->pool && t_imageAllocator == slot->pool )
+        t_imageAllocator = nullptr;
+
+    ThreadImagePools::RetireAll();
+}
+
 }; // namespace
@@ -0,0 +1,519 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexLegacy.cpp
+//
+// DirectX Texture Library - Legacy (Direct3D 9) format expansion kernels
+//
+// Each arithmetic conversion is written once as a formula over 32-bit lanes and
+// instantiated for scalar, SSE2 and AVX2 code; 8-bit indexed sources go through 256
+// entry tables (AVX2 gathers). Results are identical whichever path the CPU selects
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define LEGACY_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#else
+#define LEGACY_X86 0
+#endif
+
+#if defined(_MSC_VER) || !LEGACY_X86
+#define LEGACY_TARGET_SSSE3
+#define LEGACY_TARGET_AVX2
+#else
+#define LEGACY_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define LEGACY_TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+namespace DirectX
+{
+
+enum LEGACY_ISA
+{
+    LEGACY_ISA_SCALAR = 0,
+    LEGACY_ISA_SSE2,
+    LEGACY_ISA_AVX2,
+};
+
+//-------------------------------------------------------------------------------------
+// Lane operations: the same formula compiles for uint32_t, __m128i and __m256i
+//-------------------------------------------------------------------------------------
+inline static uint32_t _VAnd( _In_ uint32_t v, _In_ uint32_t m ) { return v & m; }
+inline static uint32_t _VOrC( _In_ uint32_t v, _In_ uint32_t c ) { return v | c; }
+inline static uint32_t _VOr( _In_ uint32_t a, _In_ uint32_t b ) { return a | b; }
+template<int N> inline static uint32_t _VShl( _In_ uint32_t v ) { return v << N; }
+template<int N> inline static uint32_t _VShr( _In_ uint32_t v ) { return v >> N; }
+template<int N> inline static uint32_t _VSar( _In_ uint32_t v ) { return static_cast<uint32_t>( static_cast<int32_t>( v ) >> N ); }
+
+#if LEGACY_X86
+inline static __m128i _VAnd( _In_ __m128i v, _In_ uint32_t m ) { return _mm_and_si128( v, _mm_set1_epi32( static_cast<int>( m ) ) ); }
+inline static __m128i _VOrC( _In_ __m128i v, _In_ uint32_t c ) { return _mm_or_si128( v, _mm_set1_epi32( static_cast<int>( c ) ) ); }
+inline static __m128i _VOr( _In_ __m128i a, _In_ __m128i b ) { return _mm_or_si128( a, b ); }
+template<int N> inline static __m128i _VShl( _In_ __m128i v ) { return _mm_slli_epi32( v, N ); }
+template<int N> inline static __m128i _VShr( _In_ __m128i v ) { return _mm_srli_epi32( v, N ); }
+template<int N> inline static __m128i _VSar( _In_ __m128i v ) { return _mm_srai_epi32( v, N ); }
+
+LEGACY_TARGET_AVX2 inline static __m256i _VAnd( _In_ __m256i v, _In_ uint32_t m ) { return _mm256_and_si256( v, _mm256_set1_epi32( static_cast<int>( m ) ) ); }
+LEGACY_TARGET_AVX2 inline static __m256i _VOrC( _In_ __m256i v, _In_ uint32_t c ) { return _mm256_or_si256( v, _mm256_set1_epi32( static_cast<int>( c ) ) ); }
+LEGACY_TARGET_AVX2 inline static __m256i _VOr( _In_ __m256i a, _In_ __m256i b ) { return _mm256_or_si256( a, b ); }
+template<int N> LEGACY_TARGET_AVX2 inline static __m256i _VShl( _In_ __m256i v ) { return _mm256_slli_epi32( v, N ); }
+template<int N> LEGACY_TARGET_AVX2 inline static __m256i _VShr( _In_ __m256i v ) { return _mm256_srli_epi32( v, N ); }
+template<int N> LEGACY_TARGET_AVX2 inline static __m256i _VSar( _In_ __m256i v ) { return _mm256_srai_epi32( v, N ); }
+#endif
+
+
+//-------------------------------------------------------------------------------------
+// Per-pixel formulas on the zero-extended source texel. The caller forces alpha by
+// OR-ing 0xff000000, so every alpha term must live in the top byte only
+//-------------------------------------------------------------------------------------
+
+// DXGI_FORMAT_B5G6R5_UNORM -> DXGI_FORMAT_R8G8B8A8_UNORM
+struct _Expand565
+{
+    template<class V> static V Apply( V t )
+    {
+        V t1 = _VOr( _VShr<8>( _VAnd( t, 0xf800 ) ), _VShr<13>( _VAnd( t, 0xe000 ) ) );
+        V t2 = _VOr( _VShl<5>( _VAnd( t, 0x07e0 ) ), _VShr<5>( _VAnd( t, 0x0600 ) ) );
+        V t3 = _VOr( _VShl<19>( _VAnd( t, 0x001f ) ), _VShl<14>( _VAnd( t, 0x001c ) ) );
+        return _VOrC( _VOr( _VOr( t1, t2 ), t3 ), 0xff000000 );
+    }
+};
+
+// DXGI_FORMAT_B5G5R5A1_UNORM -> DXGI_FORMAT_R8G8B8A8_UNORM
+struct _Expand5551
+{
+    template<class V> static V Apply( V t )
+    {
+        V t1 = _VOr( _VShr<7>( _VAnd( t, 0x7c00 ) ), _VShr<12>( _VAnd( t, 0x7000 ) ) );
+        V t2 = _VOr( _VShl<6>( _VAnd( t, 0x03e0 ) ), _VShl<1>( _VAnd( t, 0x0380 ) ) );
+        V t3 = _VOr( _VShl<19>( _VAnd( t, 0x001f ) ), _VShl<14>( _VAnd( t, 0x001c ) ) );
+        V ta = _VAnd( _VSar<7>( _VShl<16>( t ) ), 0xff000000 );
+        return _VOr( _VOr( t1, t2 ), _VOr( t3, ta ) );
+    }
+};
+
+// DXGI_FORMAT_B4G4R4A4_UNORM (D3DFMT_A4R4G4B4) -> DXGI_FORMAT_R8G8B8A8_UNORM
+struct _Expand4444
+{
+    template<class V> static V Apply( V t )
+    {
+        V t1 = _VOr( _VShr<4>( _VAnd( t, 0x0f00 ) ), _VShr<8>( _VAnd( t, 0x0f00 ) ) );
+        V t2 = _VOr( _VShl<8>( _VAnd( t, 0x00f0 ) ), _VShl<4>( _VAnd( t, 0x00f0 ) ) );
+        V t3 = _VOr( _VShl<20>( _VAnd( t, 0x000f ) ), _VShl<16>( _VAnd( t, 0x000f ) ) );
+        V ta = _VOr( _VShl<16>( _VAnd( t, 0xf000 ) ), _VShl<12>( _VAnd( t, 0xf000 ) ) );
+        return _VOr( _VOr( t1, t2 ), _VOr( t3, ta ) );
+    }
+};
+
+// D3DFMT_L8 -> DXGI_FORMAT_R8G8B8A8_UNORM
+struct _ExpandL8
+{
+    template<class V> static V Apply( V t )
+    {
+        return _VOrC( _VOr( _VOr( t, _VShl<8>( t ) ), _VShl<16>( t ) ), 0xff000000 );
+    }
+};
+
+// D3DFMT_A8L8 -> DXGI_FORMAT_R8G8B8A8_UNORM
+struct _ExpandA8L8
+{
+    template<class V> static V Apply( V t )
+    {
+        V t1 = _VAnd( t, 0xff );
+        return _VOr( _VOr( t1, _VShl<8>( t1 ) ), _VOr( _VShl<16>( t1 ), _VShl<16>( _VAnd( t, 0xff00 ) ) ) );
+    }
+};
+
+
+//-------------------------------------------------------------------------------------
+// Tables for 8-bit sources
+//-------------------------------------------------------------------------------------
+struct LegacyTables
+{
+    uint32_t r3g3b2[256];       // D3DFMT_R3G3B2 -> RGBA8 color (alpha 0); also the low byte of D3DFMT_A8R3G3B2
+    uint32_t r3g3b2to565[256];  // D3DFMT_R3G3B2 -> B5G6R5
+    uint32_t a4l4[256];         // D3DFMT_A4L4 -> RGBA8
+    uint32_t a4l4to4444[256];   // D3DFMT_A4L4 -> B4G4R4A4
+
+    LegacyTables()
+    {
+        for( uint32_t t = 0; t < 256; ++t )
+        {
+            r3g3b2[t] = ( (t & 0xe0) | ((t & 0xe0) >> 3) | ((t & 0xc0) >> 6) )
+                      | ( ((t & 0x1c) << 11) | ((t & 0x1c) << 8) | ((t & 0x18) << 5) )
+                      | ( ((t & 0x03) << 22) | ((t & 0x03) << 20) | ((t & 0x03) << 18) | ((t & 0x03) << 16) );
+
+            r3g3b2to565[t] = ( ((t & 0xe0) << 8) | ((t & 0xc0) << 5) )
+                           | ( ((t & 0x1c) << 6) | ((t & 0x1c) << 3) )
+                           | ( ((t & 0x03) << 3) | ((t & 0x03) << 1) | ((t & 0x02) >> 1) );
+
+            uint32_t l8 = ((t & 0x0f) << 4) | (t & 0x0f);
+            a4l4[t] = l8 | (l8 << 8) | (l8 << 16) | ((t & 0xf0) << 24) | ((t & 0xf0) << 20);
+
+            uint32_t l4 = (t & 0x0f);
+            a4l4to4444[t] = l4 | (l4 << 4) | (l4 << 8) | ((t & 0xf0) << 8);
+        }
+    }
+};
+
+static const LegacyTables s_legacyTables;
+
+
+//-------------------------------------------------------------------------------------
+// Row drivers: 16-bit and 8-bit sources through a formula
+//-------------------------------------------------------------------------------------
+template<class F> static void _ExpandRow16_Scalar( _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint16_t* pSource, _In_ size_t count, _In_ uint32_t alpha )
+{
+    for( size_t i = 0; i < count; ++i )
+        pDest[i] = F::Apply( static_cast<uint32_t>( pSource[i] ) ) | alpha;
+}
+
+template<class F> static void _ExpandRow8_Scalar( _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint8_t* pSource, _In_ size_t count, _In_ uint32_t alpha )
+{
+    for( size_t i = 0; i < count; ++i )
+        pDest[i] = F::Apply( static_cast<uint32_t>( pSource[i] ) ) | alpha;
+}
+
+#if LEGACY_X86
+template<class F> static void _ExpandRow16_SSE2( uint32_t* pDest, const uint16_t* pSource, size_t count, uint32_t alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ),     _VOrC( F::Apply( _mm_unpacklo_epi16( v, zero ) ), alpha ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i + 4 ), _VOrC( F::Apply( _mm_unpackhi_epi16( v, zero ) ), alpha ) );
+    }
+    _ExpandRow16_Scalar<F>( pDest + i, pSource + i, count - i, alpha );
+}
+
+template<class F> static void _ExpandRow8_SSE2( uint32_t* pDest, const uint8_t* pSource, size_t count, uint32_t alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for( ; i + 16 <= count; i += 16 )
+    {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) );
+        __m128i lo = _mm_unpacklo_epi8( v, zero );
+        __m128i hi = _mm_unpackhi_epi8( v, zero );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ),      _VOrC( F::Apply( _mm_unpacklo_epi16( lo, zero ) ), alpha ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i + 4 ),  _VOrC( F::Apply( _mm_unpackhi_epi16( lo, zero ) ), alpha ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i + 8 ),  _VOrC( F::Apply( _mm_unpacklo_epi16( hi, zero ) ), alpha ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i + 12 ), _VOrC( F::Apply( _mm_unpackhi_epi16( hi, zero ) ), alpha ) );
+    }
+    _ExpandRow8_Scalar<F>( pDest + i, pSource + i, count - i, alpha );
+}
+
+template<class F> LEGACY_TARGET_AVX2 static void _ExpandRow16_AVX2( uint32_t* pDest, const uint16_t* pSource, size_t count, uint32_t alpha )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256i v = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i ), _VOrC( F::Apply( v ), alpha ) );
+    }
+    _ExpandRow16_Scalar<F>( pDest + i, pSource + i, count - i, alpha );
+}
+
+template<class F> LEGACY_TARGET_AVX2 static void _ExpandRow8_AVX2( uint32_t* pDest, const uint8_t* pSource, size_t count, uint32_t alpha )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256i v = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSource + i ) ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i ), _VOrC( F::Apply( v ), alpha ) );
+    }
+    _ExpandRow8_Scalar<F>( pDest + i, pSource + i, count - i, alpha );
+}
+#endif // LEGACY_X86
+
+template<class F> static void _ExpandRow16( _In_ LEGACY_ISA isa, _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint16_t* pSource, _In_ size_t count, _In_ uint32_t alpha )
+{
+#if LEGACY_X86
+    if ( isa == LEGACY_ISA_AVX2 )
+        return _ExpandRow16_AVX2<F>( pDest, pSource, count, alpha );
+    if ( isa == LEGACY_ISA_SSE2 )
+        return _ExpandRow16_SSE2<F>( pDest, pSource, count, alpha );
+#else
+    UNREFERENCED_PARAMETER( isa );
+#endif
+    _ExpandRow16_Scalar<F>( pDest, pSource, count, alpha );
+}
+
+template<class F> static void _ExpandRow8( _In_ LEGACY_ISA isa, _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint8_t* pSource, _In_ size_t count, _In_ uint32_t alpha )
+{
+#if LEGACY_X86
+    if ( isa == LEGACY_ISA_AVX2 )
+        return _ExpandRow8_AVX2<F>( pDest, pSource, count, alpha );
+    if ( isa == LEGACY_ISA_SSE2 )
+        return _ExpandRow8_SSE2<F>( pDest, pSource, count, alpha );
+#else
+    UNREFERENCED_PARAMETER( isa );
+#endif
+    _ExpandRow8_Scalar<F>( pDest, pSource, count, alpha );
+}
+
+
+//-------------------------------------------------------------------------------------
+// Table lookups: index8 -> table (P8, R3G3B2, A4L4), alpha8:index8 -> table | alpha
+// (A8P8, A8R3G3B2) and index8 -> 16-bit table (R3G3B2 -> 565, A4L4 -> 4444).
+// SSE2 has no gather, so it uses the scalar loop
+//-------------------------------------------------------------------------------------
+static void _ExpandIndex8_Scalar( _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint8_t* pSource, _In_ size_t count,
+                                  _In_reads_(256) const uint32_t* pTable, _In_ uint32_t alpha )
+{
+    for( size_t i = 0; i < count; ++i )
+        pDest[i] = pTable[ pSource[i] ] | alpha;
+}
+
+static void _ExpandAlphaIndex8_Scalar( _Out_writes_(count) uint32_t* pDest, _In_reads_(count) const uint16_t* pSource, _In_ size_t count,
+                                       _In_reads_(256) const uint32_t* pTable, _In_ uint32_t alpha )
+{
+    for( size_t i = 0; i < count; ++i )
+    {
+        uint32_t t = pSource[i];
+        pDest[i] = pTable[ t & 0xff ] | ( (t & 0xff00) << 16 ) | alpha;
+    }
+}
+
+static void _ExpandIndex8To16_Scalar( _Out_writes_(count) uint16_t* pDest, _In_reads_(count) const uint8_t* pSource, _In_ size_t count,
+                                      _In_reads_(256) const uint32_t* pTable, _In_ uint32_t alpha )
+{
+    for( size_t i = 0; i < count; ++i )
+        pDest[i] = static_cast<uint16_t>( pTable[ pSource[i] ] | alpha );
+}
+
+#if LEGACY_X86
+LEGACY_TARGET_AVX2 static void _ExpandIndex8_AVX2( uint32_t* pDest, const uint8_t* pSource, size_t count, const uint32_t* pTable, uint32_t alpha )
+{
+    const int* table = reinterpret_cast<const int*>( pTable );
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256i index = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSource + i ) ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i ), _VOrC( _mm256_i32gather_epi32( table, index, 4 ), alpha ) );
+    }
+    _ExpandIndex8_Scalar( pDest + i, pSource + i, count - i, pTable, alpha );
+}
+
+LEGACY_TARGET_AVX2 static void _ExpandAlphaIndex8_AVX2( uint32_t* pDest, const uint16_t* pSource, size_t count, const uint32_t* pTable, uint32_t alpha )
+{
+    const int* table = reinterpret_cast<const int*>( pTable );
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256i t = _mm256_cvtepu16_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) ) );
+        __m256i color = _mm256_i32gather_epi32( table, _VAnd( t, 0xff ), 4 );
+        __m256i ta = _VShl<16>( _VAnd( t, 0xff00 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i ), _VOrC( _VOr( color, ta ), alpha ) );
+    }
+    _ExpandAlphaIndex8_Scalar( pDest + i, pSource + i, count - i, pTable, alpha );
+}
+
+LEGACY_TARGET_AVX2 static void _ExpandIndex8To16_AVX2( uint16_t* pDest, const uint8_t* pSource, size_t count, const uint32_t* pTable, uint32_t alpha )
+{
+    const int* table = reinterpret_cast<const int*>( pTable );
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256i index = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSource + i ) ) );
+        __m256i v = _VOrC( _mm256_i32gather_epi32( table, index, 4 ), alpha );
+
+        // Entries are <= 0xffff, so the saturating pack is exact; the permute undoes the per-lane pack order
+        v = _mm256_permute4x64_epi64( _mm256_packus_epi32( v, v ), 0x08 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ), _mm256_castsi256_si128( v ) );
+    }
+    _ExpandIndex8To16_Scalar( pDest + i, pSource + i, count - i, pTable, alpha );
+}
+#endif // LEGACY_X86
+
+
+//-------------------------------------------------------------------------------------
+// D3DFMT_R8G8B8 (stored BGR) -> DXGI_FORMAT_R8G8B8A8_UNORM
+//-------------------------------------------------------------------------------------
+static void _ExpandB8G8R8_Scalar( _Out_writes_(count) uint32_t* pDest, _In_reads_(count * 3) const uint8_t* pSource, _In_ size_t count )
+{
+    for( size_t i = 0; i < count; ++i, pSource += 3 )
+        pDest[i] = ( uint32_t( pSource[0] ) << 16 ) | ( uint32_t( pSource[1] ) << 8 ) | pSource[2] | 0xff000000;
+}
+
+#if LEGACY_X86
+LEGACY_TARGET_SSSE3 static void _ExpandB8G8R8_SSSE3( uint32_t* pDest, const uint8_t* pSource, size_t count )
+{
+    const __m128i shuffle = _mm_setr_epi8( 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 );
+    const __m128i alpha = _mm_set1_epi32( static_cast<int>( 0xff000000 ) );
+
+    // Each 16-byte load covers 4 texels (12 bytes); stop while a full load stays in bounds
+    size_t i = 0;
+    for( ; i + 6 <= count; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i * 3 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ), _mm_or_si128( _mm_shuffle_epi8( v, shuffle ), alpha ) );
+    }
+    _ExpandB8G8R8_Scalar( pDest + i, pSource + i * 3, count - i );
+}
+
+LEGACY_TARGET_AVX2 static void _ExpandB8G8R8_AVX2( uint32_t* pDest, const uint8_t* pSource, size_t count )
+{
+    const __m256i shuffle = _mm256_setr_epi8( 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                                              2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 );
+
+    // Two 16-byte loads, 12 bytes apart, feed the two 128-bit lanes
+    size_t i = 0;
+    for( ; i + 10 <= count; i += 8 )
+    {
+        const uint8_t* sPtr = pSource + i * 3;
+        __m256i v = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( sPtr ) ) ),
+                                             _mm_loadu_si128( reinterpret_cast<const __m128i*>( sPtr + 12 ) ), 1 );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + i ), _VOrC( _mm256_shuffle_epi8( v, shuffle ), 0xff000000 ) );
+    }
+    _ExpandB8G8R8_Scalar( pDest + i, pSource + i * 3, count - i );
+}
+#endif // LEGACY_X86
+
+
+//-------------------------------------------------------------------------------------
+// D3DFMT_L16 -> DXGI_FORMAT_R16G16B16A16_UNORM
+//-------------------------------------------------------------------------------------
+static void _ExpandL16_Scalar( _Out_writes_(count) uint64_t* pDest, _In_reads_(count) const uint16_t* pSource, _In_ size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+    {
+        uint64_t t = pSource[i];
+        pDest[i] = t | (t << 16) | (t << 32) | 0xffff000000000000;
+    }
+}
+
+#if LEGACY_X86
+static void _ExpandL16_SSE2( uint64_t* pDest, const uint16_t* pSource, size_t count )
+{
+    const __m128i ones = _mm_set1_epi16( -1 );
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128i v = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSource + i ) );
+        __m128i ll = _mm_unpacklo_epi16( v, v );        // L L per texel
+        __m128i la = _mm_unpacklo_epi16( v, ones );     // L 0xffff per texel
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ),     _mm_unpacklo_epi32( ll, la ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i + 2 ), _mm_unpackhi_epi32( ll, la ) );
+    }
+    _ExpandL16_Scalar( pDest + i, pSource + i, count - i );
+}
+#endif // LEGACY_X86
+
+
+//-------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------
+static LEGACY_ISA _GetLegacyISA( _In_ DWORD cpu )
+{
+#if LEGACY_X86
+    if ( cpu & CPU_FEATURE_AVX2 )
+        return LEGACY_ISA_AVX2;
+    if ( cpu & CPU_FEATURE_SSE2 )
+        return LEGACY_ISA_SSE2;
+#else
+    UNREFERENCED_PARAMETER( cpu );
+#endif
+    return LEGACY_ISA_SCALAR;
+}
+
+_Use_decl_annotations_
+void _LegacyExpandRow( LEGACY_EXPAND conversion, void* pDestination, const void* pSource, size_t count,
+                       const uint32_t* pal8, bool setAlpha )
+{
+    _LegacyExpandRow( conversion, pDestination, pSource, count, pal8, setAlpha, _GetCPUFeatures() );
+}
+
+_Use_decl_annotations_
+void _LegacyExpandRow( LEGACY_EXPAND conversion, void* pDestination, const void* pSource, size_t count,
+                       const uint32_t* pal8, bool setAlpha, DWORD cpuFeatures )
+{
+    assert( pDestination && pSource );
+
+    const LEGACY_ISA isa = _GetLegacyISA( cpuFeatures );
+    const uint32_t alpha = setAlpha ? 0xff000000 : 0;
+
+    auto d32 = reinterpret_cast<uint32_t*>( pDestination );
+    auto s8 = reinterpret_cast<const uint8_t*>( pSource );
+    auto s16 = reinterpret_cast<const uint16_t*>( pSource );
+
+    const uint32_t* table = nullptr;
+    uint32_t tableAlpha = 0;
+
+    switch( conversion )
+    {
+    case LEGACY_EXPAND_565:     _ExpandRow16<_Expand565>( isa, d32, s16, count, 0 ); return;
+    case LEGACY_EXPAND_5551:    _ExpandRow16<_Expand5551>( isa, d32, s16, count, alpha ); return;
+    case LEGACY_EXPAND_4444:    _ExpandRow16<_Expand4444>( isa, d32, s16, count, alpha ); return;
+    case LEGACY_EXPAND_L8:      _ExpandRow8<_ExpandL8>( isa, d32, s8, count, 0 ); return;
+    case LEGACY_EXPAND_A8L8:    _ExpandRow16<_ExpandA8L8>( isa, d32, s16, count, alpha ); return;
+
+    case LEGACY_EXPAND_L16:
+#if LEGACY_X86
+        if ( isa != LEGACY_ISA_SCALAR )
+            return _ExpandL16_SSE2( reinterpret_cast<uint64_t*>( pDestination ), s16, count );
+#endif
+        return _ExpandL16_Scalar( reinterpret_cast<uint64_t*>( pDestination ), s16, count );
+
+    case LEGACY_EXPAND_R8G8B8:
+#if LEGACY_X86
+        if ( isa == LEGACY_ISA_AVX2 )
+            return _ExpandB8G8R8_AVX2( d32, s8, count );
+        if ( cpuFeatures & CPU_FEATURE_SSSE3 )
+            return _ExpandB8G8R8_SSSE3( d32, s8, count );
+#endif
+        return _ExpandB8G8R8_Scalar( d32, s8, count );
+
+    case LEGACY_EXPAND_R3G3B2_TO_565:
+    case LEGACY_EXPAND_A4L4_TO_4444:
+        {
+            auto d16 = reinterpret_cast<uint16_t*>( pDestination );
+            table = ( conversion == LEGACY_EXPAND_A4L4_TO_4444 ) ? s_legacyTables.a4l4to4444 : s_legacyTables.r3g3b2to565;
+            tableAlpha = ( conversion == LEGACY_EXPAND_A4L4_TO_4444 && setAlpha ) ? 0xf000 : 0;
+#if LEGACY_X86
+            if ( isa == LEGACY_ISA_AVX2 )
+                return _ExpandIndex8To16_AVX2( d16, s8, count, table, tableAlpha );
+#endif
+            return _ExpandIndex8To16_Scalar( d16, s8, count, table, tableAlpha );
+        }
+
+    case LEGACY_EXPAND_P8:      table = pal8; break;
+    case LEGACY_EXPAND_R3G3B2:  table = s_legacyTables.r3g3b2; tableAlpha = 0xff000000; break;
+    case LEGACY_EXPAND_A4L4:    table = s_legacyTables.a4l4; tableAlpha = alpha; break;
+
+    case LEGACY_EXPAND_A8P8:
+    case LEGACY_EXPAND_A8R3G3B2:
+        table = ( conversion == LEGACY_EXPAND_A8P8 ) ? pal8 : s_legacyTables.r3g3b2;
+        assert( table );
+#if LEGACY_X86
+        if ( isa == LEGACY_ISA_AVX2 )
+            return _ExpandAlphaIndex8_AVX2( d32, s16, count, table, alpha );
+#endif
+        return _ExpandAlphaIndex8_Scalar( d32, s16, count, table, alpha );
+
+    default:
+        assert( false );
+        return;
+    }
+
+    assert( table );
+#if LEGACY_X86
+    if ( isa == LEGACY_ISA_AVX2 )
+        return _ExpandIndex8_AVX2( d32, s8, count, table, tableAlpha );
+#endif
+    _ExpandIndex8_Scalar( d32, s8, count, table, tableAlpha );
+}
+
+}; // namespace
@@ -13,11 +13,13 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
-#include "filters.h"
+#include "Filters.h"
 
+#if defined(_WIN32)
 using Microsoft::WRL::ComPtr;
+#endif
 
 namespace DirectX
 {
@@ -112,6 +114,7 @@ bool _CalculateMipLevels3D( _In_ size_t width, _In_ size_t height, _In_ size_t d
 }
 
 
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // WIC related helper functions
 //-------------------------------------------------------------------------------------
@@ -543,6 +546,21 @@ static HRESULT _GenerateMipMapsUsingWIC( _In_ const Image& baseImage, _In_ DWORD
 
     return S_OK;
 }
+#else
+//-------------------------------------------------------------------------------------
+// WIC is Windows only; other builds always use the custom filters
+//-------------------------------------------------------------------------------------
+static bool _UseWICFiltering( _In_ DXGI_FORMAT, _In_ DWORD )
+{
+    return false;
+}
+
+static HRESULT _GenerateMipMapsUsingWIC( _In_ const Image&, _In_ DWORD, _In_ size_t,
+                                         _In_ const WICPixelFormatGUID&, _In_ const ScratchImage&, _In_ size_t )
+{
+    return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+}
+#endif
 
 
 //-------------------------------------------------------------------------------------
@@ -614,7 +632,7 @@ static HRESULT _Generate2DMipsPointFilter( _In_ size_t levels, _In_ const Scratc
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate temporary space (2 scanlines)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*2), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*2 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -701,7 +719,7 @@ static HRESULT _Generate2DMipsBoxFilter( _In_ size_t levels, _In_ DWORD filter,
         return E_FAIL;
 
     // Allocate temporary space (3 scanlines)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*3), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*3 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -792,11 +810,11 @@ static HRESULT _Generate2DMipsLinearFilter( _In_ size_t levels, _In_ DWORD filte
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate temporary space (3 scanlines, plus X and Y filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*3), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*3 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
-    std::unique_ptr<LinearFilter[]> lf( new (std::nothrow) LinearFilter[ width+height ] );
+    ScopedScratchArray<LinearFilter> lf( width+height );
     if ( !lf )
         return E_OUTOFMEMORY;
 
@@ -904,11 +922,11 @@ static HRESULT _Generate2DMipsCubicFilter( _In_ size_t levels, _In_ DWORD filter
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate temporary space (5 scanlines, plus X and Y filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*5), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*5 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
-    std::unique_ptr<CubicFilter[]> cf( new (std::nothrow) CubicFilter[ width+height ] );
+    ScopedScratchArray<CubicFilter> cf( width+height );
     if ( !cf )
         return E_OUTOFMEMORY;
 
@@ -1092,7 +1110,7 @@ static HRESULT _Generate2DMipsTriangleFilter( _In_ size_t levels, _In_ DWORD fil
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate initial temporary space (1 scanline, accumulation rows, plus X and Y filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( sizeof(XMVECTOR) * width, 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -1354,7 +1372,7 @@ static HRESULT _Generate3DMipsPointFilter( _In_ size_t depth, _In_ size_t levels
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate temporary space (2 scanlines)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*2), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*2 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -1503,7 +1521,7 @@ static HRESULT _Generate3DMipsBoxFilter( _In_ size_t depth, _In_ size_t levels,
         return E_FAIL;
 
     // Allocate temporary space (5 scanlines)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*5), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*5 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -1672,11 +1690,11 @@ static HRESULT _Generate3DMipsLinearFilter( _In_ size_t depth, _In_ size_t level
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate temporary space (5 scanlines, plus X/Y/Z filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*5), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*5 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
-    std::unique_ptr<LinearFilter[]> lf( new (std::nothrow) LinearFilter[ width+height+depth ] );
+    ScopedScratchArray<LinearFilter> lf( width+height+depth );
     if ( !lf )
         return E_OUTOFMEMORY;
 
@@ -1865,11 +1883,11 @@ static HRESULT _Generate3DMipsCubicFilter( _In_ size_t depth, _In_ size_t levels
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate temporary space (17 scanlines, plus X/Y/Z filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*17), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width*17 );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
-    std::unique_ptr<CubicFilter[]> cf( new (std::nothrow) CubicFilter[ width+height+depth ] );
+    ScopedScratchArray<CubicFilter> cf( width+height+depth );
     if ( !cf )
         return E_OUTOFMEMORY;
 
@@ -2246,7 +2264,7 @@ static HRESULT _Generate3DMipsTriangleFilter( _In_ size_t depth, _In_ size_t lev
     size_t height = mipChain.GetMetadata().height;
 
     // Allocate initial temporary space (1 scanline, accumulation rows, plus X/Y/Z filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( sizeof(XMVECTOR) * width, 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -2651,7 +2669,7 @@ HRESULT GenerateMipMaps( const Image* srcImages, size_t nimages, const TexMetada
     if ( !_CalculateMipLevels(metadata.width, metadata.height, levels) )
         return E_INVALIDARG;
 
-    std::vector<const Image> baseImages;
+    std::vector<Image> baseImages;
     baseImages.reserve( metadata.arraySize );
     for( size_t item=0; item < metadata.arraySize; ++item )
     {
@@ -2957,7 +2975,7 @@ HRESULT GenerateMipMaps3D( const Image* srcImages, size_t nimages, const TexMeta
     if ( !_CalculateMipLevels3D(metadata.width, metadata.height, metadata.depth, levels) )
         return E_INVALIDARG;
 
-    std::vector<const Image> baseImages;
+    std::vector<Image> baseImages;
     baseImages.reserve( metadata.depth );
     for( size_t slice=0; slice < metadata.depth; ++slice )
     {
@@ -13,43 +13,56 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#if defined(_MSC_VER) && (_MSC_VER > 1000)
 #pragma once
-#endif
 
+#if defined(_WIN32)
 #define NOMINMAX
 #include <windows.h>
 #include <directxmath.h>
 #include <directxpackedvector.h>
+#else
+#include "Compat/winadapter.h"
+#include "Compat/DirectXMath.h"
+#include "Compat/DirectXPackedVector.h"
+#endif
 #include <assert.h>
 
+#if defined(_WIN32)
 #include <malloc.h>
+#endif
 #include <memory>
 
 #include <vector>
 
 #include <stdlib.h>
+#if defined(_WIN32)
 #include <search.h>
 
 #include <ole2.h>
+#endif
 
-#include "directxtex.h"
+#include "DirectXTex.h"
 
+#if defined(_WIN32)
 // VS 2010's stdint.h conflicts with intsafe.h
 #pragma warning(push)
 #pragma warning(disable : 4005)
 #include <wincodec.h>
 #include <wrl.h>
 #pragma warning(pop)
+#endif
 
 #include "scoped.h"
 
+#if defined(_WIN32)
 struct IWICImagingFactory;
+#endif
 
 #define TEX_FILTER_MASK 0xF00000
 
 namespace DirectX
 {
+#if defined(_WIN32)
     //---------------------------------------------------------------------------------
     // WIC helper functions
     DXGI_FORMAT _WICToDXGI( _In_ const GUID& guid );
@@ -60,7 +73,20 @@ namespace DirectX
     IWICImagingFactory* _GetWIC();
 
     bool _IsWIC2();
+#endif
+
+    //---------------------------------------------------------------------------------
+    // CPU feature detection (resolved once while the module loads)
+    enum CPU_FEATURE_FLAGS
+    {
+        CPU_FEATURE_SSE2    = 0x1,
+        CPU_FEATURE_SSSE3   = 0x2,
+        CPU_FEATURE_AVX2    = 0x4,   // Includes OS support for the YMM state
+    };
 
+    DWORD _GetCPUFeatures();
+
+#if defined(_WIN32)
     inline WICBitmapDitherType _GetWICDither( _In_ DWORD flags )
     {
         static_assert( TEX_FILTER_DITHER == 0x10000, "TEX_FILTER_DITHER* flag values don't match mask" );
@@ -106,9 +132,36 @@ namespace DirectX
             return WICBitmapInterpolationModeFant;
         }
     }
+#else
+    //---------------------------------------------------------------------------------
+    // WIC is Windows only; the pixel format stand-in keeps the WIC/non-WIC selection
+    // code shared, and no DXGI format maps to it so the non-WIC paths are always taken
+    struct WICPixelFormatGUID { uint32_t Data1; };
+
+    const WICPixelFormatGUID GUID_WICPixelFormat128bppRGBAFloat = { 0 };
+
+    inline bool _DXGIToWIC( _In_ DXGI_FORMAT, _Out_ WICPixelFormatGUID& guid, _In_ bool = false )
+    {
+        guid.Data1 = 0;
+        return false;
+    }
+#endif
 
     //---------------------------------------------------------------------------------
     // Image helper functions
+    inline void* _AllocateImageMemory( _In_opt_ IImageAllocator* allocator, _In_ size_t size )
+    {
+        return ( allocator ) ? allocator->Allocate( size ) : _aligned_malloc( size, 16 );
+    }
+
+    inline void _FreeImageMemory( _In_opt_ IImageAllocator* allocator, _In_ void* pMemory, _In_ size_t size )
+    {
+        if ( allocator )
+            allocator->Free( pMemory, size );
+        else
+            _aligned_free( pMemory );
+    }
+
     void _DetermineImageArray( _In_ const TexMetadata& metadata, _In_ DWORD cpFlags,
                                _Out_ size_t& nImages, _Out_ size_t& pixelSize );
 
@@ -117,6 +170,34 @@ namespace DirectX
                            _In_ const TexMetadata& metadata, _In_ DWORD cpFlags,
                            _Out_writes_(nImages) Image* images, _In_ size_t nImages );
 
+    //---------------------------------------------------------------------------------
+    // Per-thread scratch memory for scanline buffers and filter tables. Each thread has a
+    // few slots that only grow, so repeated calls stop allocating; nested users take other
+    // slots, and requests beyond the free slots (or too large to keep) go to the heap
+    _Ret_maybenull_ void* _AcquireScratch( _In_ size_t size, _Out_ size_t& slot );
+    void _ReleaseScratch( _In_ void* pMemory, _In_ size_t slot );
+
+    template<class T>
+    class ScopedScratchArray
+    {
+    public:
+        explicit ScopedScratchArray( _In_ size_t count ) : _slot(0)
+        {
+            _ptr = reinterpret_cast<T*>( _AcquireScratch( sizeof(T) * count, _slot ) );
+        }
+        ~ScopedScratchArray() { if ( _ptr ) _ReleaseScratch( _ptr, _slot ); }
+
+        T* get() const { return _ptr; }
+        explicit operator bool() const { return _ptr != nullptr; }
+
+    private:
+        T*      _ptr;
+        size_t  _slot;
+
+        ScopedScratchArray( const ScopedScratchArray& );
+        ScopedScratchArray& operator=( const ScopedScratchArray& );
+    };
+
     //---------------------------------------------------------------------------------
     // Conversion helper functions
 
@@ -170,10 +251,57 @@ namespace DirectX
                           _In_reads_bytes_(inSize) LPCVOID pSource, _In_ size_t inSize,
                           _In_ DXGI_FORMAT inFormat, _In_ DWORD flags );
 
+    // Legacy expansions done by _LegacyExpandRow (DirectXTexLegacy.cpp); all produce
+    // DXGI_FORMAT_R8G8B8A8_UNORM unless noted
+    enum LEGACY_EXPAND
+    {
+        LEGACY_EXPAND_R8G8B8 = 0,       // D3DFMT_R8G8B8
+        LEGACY_EXPAND_R3G3B2,           // D3DFMT_R3G3B2
+        LEGACY_EXPAND_R3G3B2_TO_565,    // D3DFMT_R3G3B2 -> DXGI_FORMAT_B5G6R5_UNORM
+        LEGACY_EXPAND_A8R3G3B2,         // D3DFMT_A8R3G3B2
+        LEGACY_EXPAND_P8,               // D3DFMT_P8
+        LEGACY_EXPAND_A8P8,             // D3DFMT_A8P8
+        LEGACY_EXPAND_A4L4,             // D3DFMT_A4L4
+        LEGACY_EXPAND_A4L4_TO_4444,     // D3DFMT_A4L4 -> DXGI_FORMAT_B4G4R4A4_UNORM
+        LEGACY_EXPAND_L8,               // D3DFMT_L8
+        LEGACY_EXPAND_L16,              // D3DFMT_L16 -> DXGI_FORMAT_R16G16B16A16_UNORM
+        LEGACY_EXPAND_A8L8,             // D3DFMT_A8L8
+        LEGACY_EXPAND_565,              // DXGI_FORMAT_B5G6R5_UNORM
+        LEGACY_EXPAND_5551,             // DXGI_FORMAT_B5G5R5A1_UNORM
+        LEGACY_EXPAND_4444,             // DXGI_FORMAT_B4G4R4A4_UNORM (D3DFMT_A4R4G4B4)
+    };
+
+    // Expands count texels; pal8 is required for P8 and A8P8. setAlpha forces opaque alpha
+    // where the source has an alpha channel. Picks SSE2/SSSE3/AVX2 code from _GetCPUFeatures
+    void _LegacyExpandRow( _In_ LEGACY_EXPAND conversion, _Out_ void* pDestination, _In_ const void* pSource, _In_ size_t count,
+                           _In_reads_opt_(256) const uint32_t* pal8, _In_ bool setAlpha );
+
+    // The same with the code for a given set of CPU_FEATURE_FLAGS (0 = scalar), for
+    // dds_thumbnail_cli's self-checks
+    void _LegacyExpandRow( _In_ LEGACY_EXPAND conversion, _Out_ void* pDestination, _In_ const void* pSource, _In_ size_t count,
+                           _In_reads_opt_(256) const uint32_t* pal8, _In_ bool setAlpha, _In_ DWORD cpuFeatures );
+
+    // Integer row converters for format pairs that need no float intermediate
+    // (DirectXTexDirect.cpp), bit-identical to _Convert. Returns nullptr when the pair is
+    // not registered or the filter asks for dithering or a colour-space change
+    typedef void (*DIRECT_CONVERT_ROW)( _Out_ void* pDestination, _In_ const void* pSource, _In_ size_t count );
+
+    DIRECT_CONVERT_ROW _GetDirectConverter( _In_ DXGI_FORMAT inFormat, _In_ DXGI_FORMAT outFormat, _In_ DWORD filter );
+
+    // The same with the code for a given set of CPU_FEATURE_FLAGS (0 = scalar), and the
+    // registered pairs by index; both for dds_thumbnail_cli's self-checks and benchmarks
+    DIRECT_CONVERT_ROW _GetDirectConverter( _In_ DXGI_FORMAT inFormat, _In_ DXGI_FORMAT outFormat, _In_ DWORD filter,
+                                            _In_ DWORD cpuFeatures );
+
+    _Success_(return != false)
+    bool _GetDirectConverterPair( _In_ size_t index, _Out_ DXGI_FORMAT& inFormat, _Out_ DXGI_FORMAT& outFormat );
+
     _Success_(return != false)
     bool _LoadScanline( _Out_writes_(count) XMVECTOR* pDestination, _In_ size_t count,
                         _In_reads_bytes_(size) LPCVOID pSource, _In_ size_t size, _In_ DXGI_FORMAT format );
 
+    void _LinearizeScanline( _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count );
+
     _Success_(return != false)
     bool _LoadScanlineLinear( _Out_writes_(count) XMVECTOR* pDestination, _In_ size_t count,
                              _In_reads_bytes_(size) LPCVOID pSource, _In_ size_t size, _In_ DXGI_FORMAT format, _In_ DWORD flags  );
@@ -13,15 +13,18 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
-#include "filters.h"
+#include "Filters.h"
 
+#if defined(_WIN32)
 using Microsoft::WRL::ComPtr;
+#endif
 
 namespace DirectX
 {
 
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // WIC related helper functions
 //-------------------------------------------------------------------------------------
@@ -218,6 +221,27 @@ static bool _UseWICFiltering( _In_ DXGI_FORMAT format, _In_ DWORD filter )
 }
 
 
+#else
+//-------------------------------------------------------------------------------------
+// WIC is Windows only; other builds always use the custom filters
+//-------------------------------------------------------------------------------------
+static HRESULT _PerformResizeUsingWIC( _In_ const Image&, _In_ DWORD, _In_ const WICPixelFormatGUID&, _In_ const Image& )
+{
+    return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+}
+
+static HRESULT _PerformResizeViaF32( _In_ const Image&, _In_ DWORD, _In_ const Image& )
+{
+    return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+}
+
+static bool _UseWICFiltering( _In_ DXGI_FORMAT, _In_ DWORD )
+{
+    return false;
+}
+#endif
+
+
 //-------------------------------------------------------------------------------------
 // Resize custom filters
 //-------------------------------------------------------------------------------------
@@ -229,8 +253,7 @@ static HRESULT _ResizePointFilter( _In_ const Image& srcImage, _In_ const Image&
     assert( srcImage.format == destImage.format );
 
     // Allocate temporary space (2 scanlines)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc(
-                                         ( sizeof(XMVECTOR) * (srcImage.width + destImage.width ) ), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( srcImage.width + destImage.width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -290,8 +313,7 @@ static HRESULT _ResizeBoxFilter( _In_ const Image& srcImage, _In_ DWORD filter,
         return E_FAIL;
 
     // Allocate temporary space (3 scanlines)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc(
-                                         ( sizeof(XMVECTOR) * ( srcImage.width*2 + destImage.width ) ), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( srcImage.width*2 + destImage.width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -349,12 +371,11 @@ static HRESULT _ResizeLinearFilter( _In_ const Image& srcImage, _In_ DWORD filte
     assert( srcImage.format == destImage.format );
 
     // Allocate temporary space (3 scanlines, plus X and Y filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc(
-                                         ( sizeof(XMVECTOR) * ( srcImage.width*2 + destImage.width ) ), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( srcImage.width*2 + destImage.width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
-    std::unique_ptr<LinearFilter[]> lf( new (std::nothrow) LinearFilter[ destImage.width + destImage.height ] );
+    ScopedScratchArray<LinearFilter> lf( destImage.width + destImage.height );
     if ( !lf )
         return E_OUTOFMEMORY;
 
@@ -435,12 +456,11 @@ static HRESULT _ResizeCubicFilter( _In_ const Image& srcImage, _In_ DWORD filter
     assert( srcImage.format == destImage.format );
 
     // Allocate temporary space (5 scanlines, plus X and Y filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc(
-                                         ( sizeof(XMVECTOR) * ( srcImage.width*4 + destImage.width ) ), 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( srcImage.width*4 + destImage.width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
-    std::unique_ptr<CubicFilter[]> cf( new (std::nothrow) CubicFilter[ destImage.width + destImage.height ] );
+    ScopedScratchArray<CubicFilter> cf( destImage.width + destImage.height );
     if ( !cf )
         return E_OUTOFMEMORY;
 
@@ -597,7 +617,7 @@ static HRESULT _ResizeTriangleFilter( _In_ const Image& srcImage, _In_ DWORD fil
     using namespace TriangleFilter;
 
     // Allocate initial temporary space (1 scanline, accumulation rows, plus X and Y filters)
-    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( sizeof(XMVECTOR) * srcImage.width, 16 ) ) );
+    ScopedScratchArray<XMVECTOR> scanline( srcImage.width );
     if ( !scanline )
         return E_OUTOFMEMORY;
 
@@ -13,8 +13,15 @@
 // http://go.microsoft.com/fwlink/?LinkId=248926
 //-------------------------------------------------------------------------------------
 
-#include "directxtexp.h"
+#include "DirectXTexP.h"
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // WIC Pixel Format Translation Data
 //-------------------------------------------------------------------------------------
@@ -53,10 +60,12 @@ static WICTranslate g_WICFormats[] =
 };
 
 static bool g_WIC2 = false;
+#endif
 
 namespace DirectX
 {
 
+#if defined(_WIN32)
 //=====================================================================================
 // WIC Utilities
 //=====================================================================================
@@ -229,8 +238,218 @@ IWICImagingFactory* _GetWIC()
 
     return s_Factory;
 }
+#endif
+
+
+//=====================================================================================
+// CPU features
+//=====================================================================================
+
+static DWORD _DetectCPUFeatures()
+{
+    DWORD features = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    int info[4];
+    __cpuid( info, 0 );
+    const int maxLeaf = info[0];
+
+    __cpuid( info, 1 );
+    if ( info[3] & (1 << 26) )
+        features |= CPU_FEATURE_SSE2;
+    if ( info[2] & (1 << 9) )
+        features |= CPU_FEATURE_SSSE3;
+
+    // AVX2 also needs OSXSAVE, AVX and the OS saving the XMM/YMM state
+    if ( maxLeaf >= 7 && ( info[2] & (1 << 27) ) && ( info[2] & (1 << 28) ) && ( _xgetbv( 0 ) & 6 ) == 6 )
+    {
+        __cpuidex( info, 7, 0 );
+        if ( info[1] & (1 << 5) )
+            features |= CPU_FEATURE_AVX2;
+    }
+#elif defined(__i386__) || defined(__x86_64__)
+    unsigned int info[4] = { 0, 0, 0, 0 };
+    const unsigned int maxLeaf = __get_cpuid_max( 0, nullptr );
+
+    __get_cpuid( 1, &info[0], &info[1], &info[2], &info[3] );
+    if ( info[3] & (1u << 26) )
+        features |= CPU_FEATURE_SSE2;
+    if ( info[2] & (1u << 9) )
+        features |= CPU_FEATURE_SSSE3;
+
+    if ( maxLeaf >= 7 && ( info[2] & (1u << 27) ) && ( info[2] & (1u << 28) ) )
+    {
+        unsigned int xcr0lo = 0, xcr0hi = 0;
+        __asm__ __volatile__( "xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0) );
+        if ( ( xcr0lo & 6 ) == 6 )
+        {
+            __cpuid_count( 7, 0, info[0], info[1], info[2], info[3] );
+            if ( info[1] & (1u << 5) )
+                features |= CPU_FEATURE_AVX2;
+        }
+    }
+#endif
+
+    return features;
+}
+
+static const DWORD g_CPUFeatures = _DetectCPUFeatures();
+
+DWORD _GetCPUFeatures()
+{
+    return g_CPUFeatures;
+}
+
+
+//=====================================================================================
+// Scratch workspace
+//=====================================================================================
 
+static const size_t c_scratchSlots = 4;
+static const size_t c_maxScratchSize = 16 * 1024 * 1024;    // Larger buffers are not kept
 
+struct ScratchWorkspace
+{
+    void*   memory[ c_scratchSlots ];
+    size_t  capacity[ c_scratchSlots ];
+    bool    busy[ c_scratchSlots ];
+};
+
+// Fiber-local storage rather than __declspec(thread) for the callback: the workspace is
+// freed when its thread exits, and FlsFree frees every thread's when the module unloads
+static void WINAPI _FreeScratchWorkspace( PVOID pData )
+{
+    auto workspace = reinterpret_cast<ScratchWorkspace*>( pData );
+    if ( !workspace )
+        return;
+
+    for( size_t j = 0; j < c_scratchSlots; ++j )
+    {
+        assert( !workspace->busy[ j ] );
+        _aligned_free( workspace->memory[ j ] );
+    }
+    delete workspace;
+}
+
+class ScratchIndex
+{
+public:
+    ScratchIndex() : index( FlsAlloc( _FreeScratchWorkspace ) ) {}
+    ~ScratchIndex() { if ( index != FLS_OUT_OF_INDEXES ) FlsFree( index ); }
+
+    DWORD index;
+};
+
+static ScratchIndex g_scratchIndex;
+
+static ScratchWorkspace* _GetScratchWorkspace()
+{
+    if ( g_scratchIndex.index == FLS_OUT_OF_INDEXES )
+        return nullptr;
+
+    auto workspace = reinterpret_cast<ScratchWorkspace*>( FlsGetValue( g_scratchIndex.index ) );
+    if ( !workspace )
+    {
+        workspace = new (std::nothrow) ScratchWorkspace;
+        if ( !workspace )
+            return nullptr;
+
+        memset( workspace, 0, sizeof(ScratchWorkspace) );
+        if ( !FlsSetValue( g_scratchIndex.index, workspace ) )
+        {
+            delete workspace;
+            return nullptr;
+        }
+    }
+    return workspace;
+}
+
+_Use_decl_annotations_
+void* _AcquireScratch( size_t size, size_t& slot )
+{
+    slot = c_scratchSlots;
+
+    ScratchWorkspace* workspace = ( size <= c_maxScratchSize ) ? _GetScratchWorkspace() : nullptr;
+    if ( workspace )
+    {
+        // Smallest free slot that fits, else the largest free one, grown to fit
+        for( size_t j = 0; j < c_scratchSlots; ++j )
+        {
+            if ( workspace->busy[ j ] )
+                continue;
+
+            if ( slot == c_scratchSlots )
+            {
+                slot = j;
+                continue;
+            }
+
+            bool fits = workspace->capacity[ j ] >= size;
+            bool bestFits = workspace->capacity[ slot ] >= size;
+            if ( fits ? ( !bestFits || workspace->capacity[ j ] < workspace->capacity[ slot ] )
+                      : ( !bestFits && workspace->capacity[ j ] > workspace->capacity[ slot ] ) )
+            {
+                slot = j;
+            }
+        }
+    }
+
+    if ( slot == c_scratchSlots )
+        return _aligned_malloc( size, 16 );
+
+    if ( workspace->capacity[ slot ] < size )
+    {
+        _aligned_free( workspace->memory[ slot ] );
+        workspace->capacity[ slot ] = 0;
+
+        workspace->memory[ slot ] = _aligned_malloc( size, 16 );
+        if ( !workspace->memory[ slot ] )
+            return nullptr;
+
+        workspace->capacity[ slot ] = size;
+    }
+
+    workspace->busy[ slot ] = true;
+    return workspace->memory[ slot ];
+}
+
+_Use_decl_annotations_
+void _ReleaseScratch( void* pMemory, size_t slot )
+{
+    if ( slot >= c_scratchSlots )
+    {
+        _aligned_free( pMemory );
+        return;
+    }
+
+    auto workspace = reinterpret_cast<ScratchWorkspace*>( FlsGetValue( g_scratchIndex.index ) );
+    assert( workspace && workspace->busy[ slot ] && workspace->memory[ slot ] == pMemory );
+    workspace->busy[ slot ] = false;
+}
+
+void ReleaseScratchWorkspace()
+{
+    if ( g_scratchIndex.index == FLS_OUT_OF_INDEXES )
+        return;
+
+    auto workspace = reinterpret_cast<ScratchWorkspace*>( FlsGetValue( g_scratchIndex.index ) );
+    if ( !workspace )
+        return;
+
+    // Buffers still in use on this thread keep their slot
+    for( size_t j = 0; j < c_scratchSlots; ++j )
+    {
+        if ( !workspace->busy[ j ] )
+        {
+            _aligned_free( workspace->memory[ j ] );
+            workspace->memory[ j ] = nullptr;
+            workspace->capacity[ j ] = 0;
+        }
+    }
+}
+
+
+#if defined(_WIN32)
 //-------------------------------------------------------------------------------------
 // Public helper function to get common WIC codec GUIDs
 //-------------------------------------------------------------------------------------
@@ -264,6 +483,7 @@ REFGUID GetWICCodec( WICCodecs codec )
         return GUID_NULL;
     }
 }
+#endif
 
 
 //=====================================================================================
@@ -988,6 +1208,7 @@ Blob& Blob::operator= (Blob&& moveFrom)
 
         _buffer = moveFrom._buffer;
         _size = moveFrom._size;
+        _allocator = moveFrom._allocator;
 
         moveFrom._buffer = nullptr;
         moveFrom._size = 0;
@@ -999,7 +1220,7 @@ void Blob::Release()
 {
     if ( _buffer )
     {
-        _aligned_free( _buffer );
+        _FreeImageMemory( _allocator, _buffer, _size );
         _buffer = nullptr;
     }
 
@@ -1014,7 +1235,7 @@ HRESULT Blob::Initialize( size_t size )
 
     Release();
 
-    _buffer = _aligned_malloc( size, 16 );
+    _buffer = _AllocateImageMemory( _allocator, size );
     if ( !_buffer )
     {
         Release();
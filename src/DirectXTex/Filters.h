@@ -11,12 +11,15 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 //-------------------------------------------------------------------------------------
 
-#if defined(_MSC_VER) && (_MSC_VER > 1000)
 #pragma once
-#endif
 
+#if defined(_WIN32)
 #include <directxmath.h>
 #include <directxpackedvector.h>
+#else
+#include "Compat/DirectXMath.h"
+#include "Compat/DirectXPackedVector.h"
+#endif
 
 #include <memory>
 
@@ -11,13 +11,13 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 //-------------------------------------------------------------------------------------
 
-#if defined(_MSC_VER) && (_MSC_VER > 1000)
 #pragma once
-#endif
 
 #include <assert.h>
 #include <memory>
+#if defined(_WIN32)
 #include <malloc.h>
+#endif
 
 //---------------------------------------------------------------------------------
 struct aligned_deleter { void operator()(void* p) { _aligned_free(p); } };
@@ -26,9 +26,11 @@ typedef std::unique_ptr<float, aligned_deleter> ScopedAlignedArrayFloat;
 
 typedef std::unique_ptr<DirectX::XMVECTOR, aligned_deleter> ScopedAlignedArrayXMVECTOR;
 
+#if defined(_WIN32)
 //---------------------------------------------------------------------------------
 struct handle_closer { void operator()(HANDLE h) { assert(h != INVALID_HANDLE_VALUE); if (h) CloseHandle(h); } };
 
 typedef public std::unique_ptr<void, handle_closer> ScopedHandle;
 
 inline HANDLE safe_handle( HANDLE h ) { return (h == INVALID_HANDLE_VALUE) ? 0 : h; }
+#endif
@@ -0,0 +1,469 @@
+// ----------------------------------------------------------------------------
+// dds_read_stream.cpp
+// ----------------------------------------------------------------------------
+#include "dds_read_stream.h"
+#if defined(_WIN32)
+#include <windows.h>
+#include <objidl.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <climits>
+#include <cstring>
+
+#include "./DirectXTex/DirectXTex.h"
+
+namespace
+{
+	int SeekFile(FILE* pFile, int64_t offset, int origin)
+	{
+#if defined(_MSC_VER)
+		return _fseeki64(pFile, offset, origin);
+#else
+		return fseeko(pFile, static_cast<off_t>(offset), origin);
+#endif
+	}
+
+	int64_t TellFile(FILE* pFile)
+	{
+#if defined(_MSC_VER)
+		return _ftelli64(pFile);
+#else
+		return static_cast<int64_t>(ftello(pFile));
+#endif
+	}
+
+} // unnamed namespace
+
+#if defined(_WIN32)
+// ----------------------------------------------------------------------------
+// IStreamReadStream
+// ----------------------------------------------------------------------------
+IStreamReadStream::IStreamReadStream(IStream* pStream)
+	: m_pStream(pStream)
+{
+}
+
+int32_t IStreamReadStream::Read(void* pDestination, size_t size, size_t& bytesRead)
+{
+	bytesRead = 0;
+	if(!m_pStream)
+	{
+		return E_POINTER;
+	}
+
+	// IStream::Read takes a ULONG count; longer requests are returned short.
+	ULONG bytes = (size > ULONG_MAX) ? ULONG_MAX : static_cast<ULONG>(size);
+	ULONG chunkRead = 0;
+	HRESULT hr = m_pStream->Read(pDestination, bytes, &chunkRead);
+	if(FAILED(hr))
+	{
+		return hr;
+	}
+	bytesRead = chunkRead;
+	return S_OK;
+}
+
+int32_t IStreamReadStream::Seek(uint64_t position)
+{
+	if(!m_pStream)
+	{
+		return E_POINTER;
+	}
+
+	LARGE_INTEGER lnPos;
+	lnPos.QuadPart = static_cast<LONGLONG>(position);
+	return m_pStream->Seek(lnPos, STREAM_SEEK_SET, NULL);
+}
+
+int32_t IStreamReadStream::GetSize(uint64_t& size)
+{
+	size = 0;
+	if(!m_pStream)
+	{
+		return E_POINTER;
+	}
+
+	STATSTG statStg;
+	::ZeroMemory(&statStg, sizeof(STATSTG));
+
+	HRESULT hr = m_pStream->Stat(&statStg, STATFLAG_NONAME);
+	if(FAILED(hr))
+	{
+		return hr;
+	}
+	size = statStg.cbSize.QuadPart;
+	return S_OK;
+}
+
+int32_t IStreamReadStream::GetLastWriteTime(uint64_t& time)
+{
+	time = 0;
+	if(!m_pStream)
+	{
+		return E_POINTER;
+	}
+
+	STATSTG statStg;
+	::ZeroMemory(&statStg, sizeof(STATSTG));
+
+	HRESULT hr = m_pStream->Stat(&statStg, STATFLAG_NONAME);
+	if(FAILED(hr))
+	{
+		return hr;
+	}
+	// Streams that are not backed by a file may leave mtime zero.
+	time = (static_cast<uint64_t>(statStg.mtime.dwHighDateTime) << 32) | statStg.mtime.dwLowDateTime;
+	return S_OK;
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// MemoryReadStream
+// ----------------------------------------------------------------------------
+MemoryReadStream::MemoryReadStream(const void* pData, size_t size)
+	: m_pData   (static_cast<const uint8_t*>(pData))
+	, m_size    (size)
+	, m_position(0)
+{
+}
+
+int32_t MemoryReadStream::Read(void* pDestination, size_t size, size_t& bytesRead)
+{
+	bytesRead = 0;
+	if(!m_pData)
+	{
+		return E_POINTER;
+	}
+
+	size_t remaining = (m_position < m_size) ? (m_size - m_position) : 0;
+	bytesRead = (size < remaining) ? size : remaining;
+	memcpy(pDestination, m_pData + m_position, bytesRead);
+	m_position += bytesRead;
+	return S_OK;
+}
+
+int32_t MemoryReadStream::Seek(uint64_t position)
+{
+	if(position > m_size)
+	{
+		return E_INVALIDARG;
+	}
+	m_position = static_cast<size_t>(position);
+	return S_OK;
+}
+
+int32_t MemoryReadStream::GetSize(uint64_t& size)
+{
+	size = m_size;
+	return S_OK;
+}
+
+// ----------------------------------------------------------------------------
+// FileReadStream
+// ----------------------------------------------------------------------------
+FileReadStream::FileReadStream()
+	: m_pFile(NULL)
+{
+}
+
+FileReadStream::~FileReadStream()
+{
+	Close();
+}
+
+bool FileReadStream::Open(const char* szFile)
+{
+	Close();
+#if defined(_MSC_VER)
+	if(fopen_s(&m_pFile, szFile, "rb") != 0)
+	{
+		m_pFile = NULL;
+	}
+#else
+	m_pFile = fopen(szFile, "rb");
+#endif
+	return m_pFile != NULL;
+}
+
+#if defined(_WIN32)
+bool FileReadStream::Open(const wchar_t* szFile)
+{
+	Close();
+	if(_wfopen_s(&m_pFile, szFile, L"rb") != 0)
+	{
+		m_pFile = NULL;
+	}
+	return m_pFile != NULL;
+}
+#endif
+
+void FileReadStream::Close()
+{
+	if(m_pFile)
+	{
+		fclose(m_pFile);
+		m_pFile = NULL;
+	}
+}
+
+int32_t FileReadStream::Read(void* pDestination, size_t size, size_t& bytesRead)
+{
+	bytesRead = 0;
+	if(!m_pFile)
+	{
+		return E_POINTER;
+	}
+
+	bytesRead = fread(pDestination, 1, size, m_pFile);
+	if(bytesRead < size && ferror(m_pFile))
+	{
+		return E_FAIL;
+	}
+	return S_OK;
+}
+
+int32_t FileReadStream::Seek(uint64_t position)
+{
+	if(!m_pFile)
+	{
+		return E_POINTER;
+	}
+	if(position > static_cast<uint64_t>(INT64_MAX))
+	{
+		return E_INVALIDARG;
+	}
+	return (SeekFile(m_pFile, static_cast<int64_t>(position), SEEK_SET) == 0) ? S_OK : E_FAIL;
+}
+
+int32_t FileReadStream::GetSize(uint64_t& size)
+{
+	size = 0;
+	if(!m_pFile)
+	{
+		return E_POINTER;
+	}
+
+	// Measure from the end and restore the current position.
+	int64_t current = TellFile(m_pFile);
+	if(current < 0 || SeekFile(m_pFile, 0, SEEK_END) != 0)
+	{
+		return E_FAIL;
+	}
+	int64_t end = TellFile(m_pFile);
+	if(SeekFile(m_pFile, current, SEEK_SET) != 0 || end < 0)
+	{
+		return E_FAIL;
+	}
+	size = static_cast<uint64_t>(end);
+	return S_OK;
+}
+
+int32_t FileReadStream::GetLastWriteTime(uint64_t& time)
+{
+	time = 0;
+	if(!m_pFile)
+	{
+		return E_POINTER;
+	}
+
+#if defined(_WIN32)
+	FILETIME lastWrite;
+	HANDLE hFile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(m_pFile)));
+	if(hFile == INVALID_HANDLE_VALUE || !GetFileTime(hFile, NULL, NULL, &lastWrite))
+	{
+		return E_FAIL;
+	}
+	time = (static_cast<uint64_t>(lastWrite.dwHighDateTime) << 32) | lastWrite.dwLowDateTime;
+#else
+	struct stat st;
+	if(fstat(fileno(m_pFile), &st) != 0)
+	{
+		return E_FAIL;
+	}
+#if defined(__APPLE__)
+	const long nanoseconds = st.st_mtimespec.tv_nsec;
+#else
+	const long nanoseconds = st.st_mtim.tv_nsec;
+#endif
+	// Seconds from 1601 to the Unix epoch.
+	const uint64_t kEpochOffset = 11644473600ULL;
+	time = (static_cast<uint64_t>(st.st_mtime) + kEpochOffset) * 10000000ULL + static_cast<uint64_t>(nanoseconds) / 100;
+#endif
+	return S_OK;
+}
+
+// ----------------------------------------------------------------------------
+// MappedFileReadStream
+// ----------------------------------------------------------------------------
+MappedFileReadStream::MappedFileReadStream()
+	: m_pView   (NULL)
+	, m_size    (0)
+	, m_position(0)
+#if defined(_WIN32)
+	, m_hMapping(NULL)
+#endif
+{
+}
+
+MappedFileReadStream::~MappedFileReadStream()
+{
+	Close();
+}
+
+bool MappedFileReadStream::Open(const char* szFile)
+{
+	Close();
+	if(!FileReadStream::Open(szFile))
+	{
+		return false;
+	}
+	Map();
+	return true;
+}
+
+#if defined(_WIN32)
+bool MappedFileReadStream::Open(const wchar_t* szFile)
+{
+	Close();
+	if(!FileReadStream::Open(szFile))
+	{
+		return false;
+	}
+	Map();
+	return true;
+}
+#endif
+
+// Leaves the stream unmapped on any failure; reads then go through stdio.
+void MappedFileReadStream::Map()
+{
+	uint64_t size = 0;
+	if(FAILED(FileReadStream::GetSize(size)) || size == 0 || size > SIZE_MAX)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	HANDLE hFile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(GetFile())));
+	if(hFile == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!hMapping)
+	{
+		return;
+	}
+	const void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if(!pView)
+	{
+		CloseHandle(hMapping);
+		return;
+	}
+	m_hMapping = hMapping;
+#else
+	void* pView = mmap(NULL, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fileno(GetFile()), 0);
+	if(pView == MAP_FAILED)
+	{
+		return;
+	}
+#endif
+	m_pView    = static_cast<const uint8_t*>(pView);
+	m_size     = static_cast<size_t>(size);
+	m_position = 0;
+}
+
+void MappedFileReadStream::Close()
+{
+	if(m_pView)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_pView);
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+#else
+		munmap(const_cast<uint8_t*>(m_pView), m_size);
+#endif
+		m_pView    = NULL;
+		m_size     = 0;
+		m_position = 0;
+	}
+	FileReadStream::Close();
+}
+
+int32_t MappedFileReadStream::Read(void* pDestination, size_t size, size_t& bytesRead)
+{
+	if(!m_pView)
+	{
+		return FileReadStream::Read(pDestination, size, bytesRead);
+	}
+
+	size_t remaining = (m_position < m_size) ? (m_size - m_position) : 0;
+	bytesRead = (size < remaining) ? size : remaining;
+	memcpy(pDestination, m_pView + m_position, bytesRead);
+	m_position += bytesRead;
+	return S_OK;
+}
+
+int32_t MappedFileReadStream::Seek(uint64_t position)
+{
+	if(!m_pView)
+	{
+		return FileReadStream::Seek(position);
+	}
+	if(position > m_size)
+	{
+		return E_INVALIDARG;
+	}
+	m_position = static_cast<size_t>(position);
+	return S_OK;
+}
+
+int32_t MappedFileReadStream::GetSize(uint64_t& size)
+{
+	if(!m_pView)
+	{
+		return FileReadStream::GetSize(size);
+	}
+	size = m_size;
+	return S_OK;
+}
+
+// ----------------------------------------------------------------------------
+// CountingReadStream
+// ----------------------------------------------------------------------------
+CountingReadStream::CountingReadStream(ThumbnailReadStream& source)
+	: m_source   (source)
+	, m_bytesRead(0)
+{
+}
+
+int32_t CountingReadStream::Read(void* pDestination, size_t size, size_t& bytesRead)
+{
+	int32_t hr = m_source.Read(pDestination, size, bytesRead);
+	m_bytesRead += bytesRead;
+	return hr;
+}
+
+int32_t CountingReadStream::Seek(uint64_t position)
+{
+	return m_source.Seek(position);
+}
+
+int32_t CountingReadStream::GetSize(uint64_t& size)
+{
+	return m_source.GetSize(size);
+}
+
+int32_t CountingReadStream::GetLastWriteTime(uint64_t& time)
+{
+	return m_source.GetLastWriteTime(time);
+}
+
+const void* CountingReadStream::GetMappedView()
+{
+	return m_source.GetMappedView();
+}
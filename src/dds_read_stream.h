@@ -0,0 +1,161 @@
+// ----------------------------------------------------------------------------
+// dds_read_stream.h
+// ----------------------------------------------------------------------------
+// Description : Byte sources for the thumbnail engine, used by the providers
+//               and the command-line tools. Windows-free; results are HRESULT
+//               values carried in int32_t.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <cstdio>
+
+// Random-access byte source the thumbnail engine reads DDS files from.
+class ThumbnailReadStream
+{
+public:
+	virtual ~ThumbnailReadStream() {}
+
+	// Reads up to size bytes at the current position; 0 bytes means end of stream.
+	virtual int32_t Read(void* pDestination, size_t size, size_t& bytesRead) = 0;
+	// Sets the read position relative to the start of the stream.
+	virtual int32_t Seek(uint64_t position) = 0;
+	virtual int32_t GetSize(uint64_t& size) = 0;
+	// Last modification time in FILETIME units (100 ns since 1601-01-01 UTC);
+	// 0 when the source does not know it.
+	virtual int32_t GetLastWriteTime(uint64_t& time) { time = 0; return 0; }
+	// The whole stream as one read-only view when it is backed by a file
+	// mapping, NULL otherwise; loaders then copy straight out of the pages.
+	virtual const void* GetMappedView() { return NULL; }
+
+}; // class ThumbnailReadStream
+
+#if defined(_WIN32)
+struct IStream;
+
+// Reads from a shell-supplied IStream (not owned).
+class IStreamReadStream : public ThumbnailReadStream
+{
+public:
+	explicit IStreamReadStream(IStream* pStream);
+
+	virtual int32_t Read(void* pDestination, size_t size, size_t& bytesRead) override;
+	virtual int32_t Seek(uint64_t position) override;
+	virtual int32_t GetSize(uint64_t& size) override;
+	virtual int32_t GetLastWriteTime(uint64_t& time) override;
+
+private:
+	IStream* m_pStream;
+
+	IStreamReadStream(const IStreamReadStream&);
+	IStreamReadStream& operator=(const IStreamReadStream&);
+
+}; // class IStreamReadStream
+#endif
+
+// Reads from a caller-owned buffer (e.g. a whole file in memory or a mapping).
+class MemoryReadStream : public ThumbnailReadStream
+{
+public:
+	MemoryReadStream(const void* pData, size_t size);
+
+	virtual int32_t Read(void* pDestination, size_t size, size_t& bytesRead) override;
+	virtual int32_t Seek(uint64_t position) override;
+	virtual int32_t GetSize(uint64_t& size) override;
+
+private:
+	const uint8_t*	m_pData;
+	size_t			m_size;
+	size_t			m_position;
+
+	MemoryReadStream(const MemoryReadStream&);
+	MemoryReadStream& operator=(const MemoryReadStream&);
+
+}; // class MemoryReadStream
+
+// Reads from a stdio FILE; stands in for IStream outside of the shell.
+class FileReadStream : public ThumbnailReadStream
+{
+public:
+	 FileReadStream();
+	~FileReadStream();
+
+	bool Open(const char* szFile);
+#if defined(_WIN32)
+	bool Open(const wchar_t* szFile);
+#endif
+	void Close();
+
+	bool IsOpen() const { return m_pFile != NULL; }
+
+	virtual int32_t Read(void* pDestination, size_t size, size_t& bytesRead) override;
+	virtual int32_t Seek(uint64_t position) override;
+	virtual int32_t GetSize(uint64_t& size) override;
+	virtual int32_t GetLastWriteTime(uint64_t& time) override;
+
+protected:
+	FILE* GetFile() const { return m_pFile; }
+
+private:
+	FILE* m_pFile;
+
+	FileReadStream(const FileReadStream&);
+	FileReadStream& operator=(const FileReadStream&);
+
+}; // class FileReadStream
+
+// Maps the file read-only so DDS loads skip the stdio buffer; files that
+// cannot be mapped (empty, special) are read like FileReadStream.
+class MappedFileReadStream : public FileReadStream
+{
+public:
+	 MappedFileReadStream();
+	~MappedFileReadStream();
+
+	bool Open(const char* szFile);
+#if defined(_WIN32)
+	bool Open(const wchar_t* szFile);
+#endif
+	void Close();
+
+	virtual int32_t Read(void* pDestination, size_t size, size_t& bytesRead) override;
+	virtual int32_t Seek(uint64_t position) override;
+	virtual int32_t GetSize(uint64_t& size) override;
+	virtual const void* GetMappedView() override { return m_pView; }
+
+private:
+	void Map();
+
+	const uint8_t*	m_pView;
+	size_t			m_size;
+	size_t			m_position;
+#if defined(_WIN32)
+	void*			m_hMapping;
+#endif
+
+	MappedFileReadStream(const MappedFileReadStream&);
+	MappedFileReadStream& operator=(const MappedFileReadStream&);
+
+}; // class MappedFileReadStream
+
+// Forwards to another stream and counts the bytes actually read.
+class CountingReadStream : public ThumbnailReadStream
+{
+public:
+	explicit CountingReadStream(ThumbnailReadStream& source);
+
+	uint64_t GetBytesRead() const { return m_bytesRead; }
+
+	virtual int32_t Read(void* pDestination, size_t size, size_t& bytesRead) override;
+	virtual int32_t Seek(uint64_t position) override;
+	virtual int32_t GetSize(uint64_t& size) override;
+	virtual int32_t GetLastWriteTime(uint64_t& time) override;
+	virtual const void* GetMappedView() override;
+
+private:
+	ThumbnailReadStream&	m_source;
+	uint64_t				m_bytesRead;
+
+	CountingReadStream(const CountingReadStream&);
+	CountingReadStream& operator=(const CountingReadStream&);
+
+}; // class CountingReadStream
@@ -0,0 +1,691 @@
+// ----------------------------------------------------------------------------
+// dds_thumbnail_cli.cpp
+// ----------------------------------------------------------------------------
+// Description : Batch front end for thumbnail_engine. Renders thumbnails for
+//               many files without Explorer, to pre-bake the thumbnail pack
+//               or to benchmark the decode path. Directories are walked and
+//               every file is rendered as a task on a work-stealing pool.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <objbase.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "dds_read_stream.h"
+#include "dds_thumbnail_selftest.h"
+#include "thumbnail_cache.h"
+#include "thumbnail_engine.h"
+#include "thumbnail_stats.h"
+#include "work_stealing_pool.h"
+
+namespace
+{
+	const uint64_t kDefaultCacheBudget = 64 * 1024 * 1024;
+
+	// Engine results are HRESULTs; only E_FAIL is produced here.
+	const int32_t kResultOk     = 0;
+	const int32_t kResultFailed = static_cast<int32_t>(0x80004005);
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	enum Mode
+	{
+		kModeRender,
+		kModeVerifyBC,			// Integer BC decoders against the float path
+		kModeVerifyDecompress,	// Parallel Decompress against the serial one
+		kModeVerifyConvert,		// Direct Convert pairs against the float path
+		kModeVerifyLegacy,		// Legacy DDS expansions against the scalar code
+		kModeBenchBC7,			// Per-mode BC7 decode throughput
+		kModeBenchInflate,		// Per-format, per-instruction-set row kernel throughput
+		kModeBenchConvert,		// Direct Convert pairs against the float path
+	};
+
+	struct Options
+	{
+		Mode						mode;
+		std::vector<uint32_t>		sizes;
+		std::string					outputDir;		// Empty: render only
+		std::string					cacheFile;		// Empty: no cache
+		uint64_t					cacheBudget;
+		unsigned					threads;		// 0: one per hardware thread
+		bool						quiet;
+		bool						stats;
+		std::vector<std::string>	inputs;			// Files and directories
+
+		Options() : mode(kModeRender), cacheBudget(kDefaultCacheBudget), threads(0), quiet(false), stats(false) {}
+	};
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"usage: dds_thumbnail_cli [options] <file.dds | dir | @list.txt>...\n"
+			"       dds_thumbnail_cli --verify-bc [-q]\n"
+			"       dds_thumbnail_cli --verify-decompress [-q]\n"
+			"       dds_thumbnail_cli --verify-convert [-q]\n"
+			"       dds_thumbnail_cli --verify-legacy [-q]\n"
+			"       dds_thumbnail_cli --bench-bc7 [-q]\n"
+			"       dds_thumbnail_cli --bench-inflate [-q]\n"
+			"       dds_thumbnail_cli --bench-convert [-q]\n"
+			"  -s <n>[,<n>...]  thumbnail sizes in pixels (default 256)\n"
+			"  -o <dir>         write <dir>/<name>_<n>.bmp, mirroring walked directories\n"
+			"  -c <pack>        read and fill a thumbnail pack\n"
+			"  -b <MB>          thumbnail pack budget (default 64)\n"
+			"  -j <n>           worker threads (default: all cores)\n"
+			"  -q               print the summary only\n"
+			"  -t               per-stage stats: one line per file and a per-format dump\n");
+	}
+
+	bool ParseSizes(const char* text, std::vector<uint32_t>& sizes)
+	{
+		while(*text)
+		{
+			char* end = NULL;
+			unsigned long n = strtoul(text, &end, 10);
+			if(end == text || n == 0 || n > 4096)
+			{
+				return false;
+			}
+			sizes.push_back(static_cast<uint32_t>(n));
+			text = (*end == ',') ? end + 1 : end;
+		}
+		return !sizes.empty();
+	}
+
+	// "@list.txt" names a file with one path per line.
+	bool AddInput(const char* arg, std::vector<std::string>& inputs)
+	{
+		if(arg[0] != '@')
+		{
+			inputs.push_back(arg);
+			return true;
+		}
+
+		std::ifstream list(arg + 1);
+		if(!list)
+		{
+			fprintf(stderr, "cannot open list %s\n", arg + 1);
+			return false;
+		}
+		std::string line;
+		while(std::getline(list, line))
+		{
+			if(!line.empty() && line[line.size() - 1] == '\r')
+			{
+				line.erase(line.size() - 1);
+			}
+			if(!line.empty())
+			{
+				inputs.push_back(line);
+			}
+		}
+		return true;
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			const bool  hasValue = (i + 1 < argc);
+
+			if(strcmp(arg, "-s") == 0 && hasValue)
+			{
+				if(!ParseSizes(argv[++i], options.sizes))
+				{
+					return false;
+				}
+			}
+			else if(strcmp(arg, "-o") == 0 && hasValue)
+			{
+				options.outputDir = argv[++i];
+			}
+			else if(strcmp(arg, "-c") == 0 && hasValue)
+			{
+				options.cacheFile = argv[++i];
+			}
+			else if(strcmp(arg, "-b") == 0 && hasValue)
+			{
+				options.cacheBudget = strtoull(argv[++i], NULL, 10) * 1024 * 1024;
+			}
+			else if(strcmp(arg, "-j") == 0 && hasValue)
+			{
+				options.threads = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+			}
+			else if(strcmp(arg, "-q") == 0)
+			{
+				options.quiet = true;
+			}
+			else if(strcmp(arg, "-t") == 0)
+			{
+				options.stats = true;
+			}
+			else if(strcmp(arg, "--verify-bc") == 0)
+			{
+				options.mode = kModeVerifyBC;
+			}
+			else if(strcmp(arg, "--verify-decompress") == 0)
+			{
+				options.mode = kModeVerifyDecompress;
+			}
+			else if(strcmp(arg, "--verify-convert") == 0)
+			{
+				options.mode = kModeVerifyConvert;
+			}
+			else if(strcmp(arg, "--verify-legacy") == 0)
+			{
+				options.mode = kModeVerifyLegacy;
+			}
+			else if(strcmp(arg, "--bench-bc7") == 0)
+			{
+				options.mode = kModeBenchBC7;
+			}
+			else if(strcmp(arg, "--bench-inflate") == 0)
+			{
+				options.mode = kModeBenchInflate;
+			}
+			else if(strcmp(arg, "--bench-convert") == 0)
+			{
+				options.mode = kModeBenchConvert;
+			}
+			else if(arg[0] == '-')
+			{
+				return false;
+			}
+			else if(!AddInput(arg, options.inputs))
+			{
+				return false;
+			}
+		}
+		if(options.sizes.empty())
+		{
+			options.sizes.push_back(256);
+		}
+		return (options.mode != kModeRender) || !options.inputs.empty();
+	}
+
+	bool IsDirectory(const std::string& path)
+	{
+#if defined(_WIN32)
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct stat st;
+		return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+	}
+
+	bool HasDDSExtension(const char* name)
+	{
+		size_t length = strlen(name);
+		if(length < 4 || name[length - 4] != '.')
+		{
+			return false;
+		}
+		const char* ext = name + length - 3;
+		return (ext[0] | 0x20) == 'd' && (ext[1] | 0x20) == 'd' && (ext[2] | 0x20) == 's';
+	}
+
+	// Lists one directory level: *.dds files and subdirectories (symlinks
+	// and junctions are not followed).
+	void ListDirectory(const std::string& dir, std::vector<std::string>& files, std::vector<std::string>& subdirs)
+	{
+#if defined(_WIN32)
+		WIN32_FIND_DATAA data;
+		HANDLE hFind = FindFirstFileA((dir + "\\*").c_str(), &data);
+		if(hFind == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		do
+		{
+			const char* name = data.cFileName;
+			if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			{
+				continue;
+			}
+			if(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+			{
+				continue;
+			}
+			if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				subdirs.push_back(dir + "\\" + name);
+			}
+			else if(HasDDSExtension(name))
+			{
+				files.push_back(dir + "\\" + name);
+			}
+		}
+		while(FindNextFileA(hFind, &data));
+		FindClose(hFind);
+#else
+		DIR* pDir = opendir(dir.c_str());
+		if(!pDir)
+		{
+			return;
+		}
+		while(struct dirent* pEntry = readdir(pDir))
+		{
+			const char* name = pEntry->d_name;
+			if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			{
+				continue;
+			}
+			std::string path = dir + "/" + name;
+			struct stat st;
+			if(lstat(path.c_str(), &st) != 0)
+			{
+				continue;
+			}
+			if(S_ISDIR(st.st_mode))
+			{
+				subdirs.push_back(path);
+			}
+			else if(S_ISREG(st.st_mode) && HasDDSExtension(name))
+			{
+				files.push_back(path);
+			}
+		}
+		closedir(pDir);
+#endif
+	}
+
+	std::string LeafName(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return (slash == std::string::npos) ? path : path.substr(slash + 1);
+	}
+
+	std::string BaseName(const std::string& path)
+	{
+		std::string name = LeafName(path);
+		size_t dot = name.find_last_of('.');
+		return (dot == std::string::npos) ? name : name.substr(0, dot);
+	}
+
+	// Creates root/subdir one level at a time; existing levels are fine.
+	void MakeDirectories(const std::string& root, const std::string& subdir)
+	{
+		std::string path = root;
+		size_t begin = 0;
+		while(begin < subdir.size())
+		{
+			size_t end = subdir.find('/', begin);
+			if(end == std::string::npos)
+			{
+				end = subdir.size();
+			}
+			path += "/" + subdir.substr(begin, end - begin);
+#if defined(_WIN32)
+			CreateDirectoryA(path.c_str(), NULL);
+#else
+			mkdir(path.c_str(), 0777);
+#endif
+			begin = end + 1;
+		}
+	}
+
+	// Per-file latency, from the start of the task to the last output written.
+	class LatencyStats
+	{
+	public:
+		void Add(uint32_t microseconds)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_samples.push_back(microseconds);
+		}
+
+		// Prints percentiles and a log2 histogram. Call once the pool is idle.
+		void Print()
+		{
+			if(m_samples.empty())
+			{
+				return;
+			}
+			std::sort(m_samples.begin(), m_samples.end());
+			printf("latency (ms): p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+				Percentile(0.5) / 1000.0, Percentile(0.9) / 1000.0, Percentile(0.99) / 1000.0,
+				Percentile(0.999) / 1000.0, m_samples.back() / 1000.0);
+
+			size_t buckets[32] = { 0 };
+			for(size_t i = 0; i < m_samples.size(); ++i)
+			{
+				unsigned bucket = 0;
+				while(bucket < 31 && (1u << bucket) <= m_samples[i])
+				{
+					++bucket;
+				}
+				buckets[bucket]++;
+			}
+			for(unsigned b = 0; b < 32; ++b)
+			{
+				if(buckets[b] == 0)
+				{
+					continue;
+				}
+				const int width = static_cast<int>(buckets[b] * 50 / m_samples.size());
+				printf("  < %10u us %8u %.*s\n", (b < 31) ? (1u << b) : 0xFFFFFFFFu,
+					static_cast<unsigned>(buckets[b]), (width > 0) ? width : 1,
+					"##################################################");
+			}
+		}
+
+	private:
+		std::mutex				m_mutex;
+		std::vector<uint32_t>	m_samples;
+
+		uint32_t Percentile(double p) const
+		{
+			size_t index = static_cast<size_t>(p * (m_samples.size() - 1) + 0.5);
+			return m_samples[index];
+		}
+	};
+
+	void PutLE16(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+	void PutLE32(uint8_t* p, uint32_t v) { PutLE16(p, v); PutLE16(p + 2, v >> 16); }
+
+	// 32bpp top-down BMP, the same layout GetThumbnail hands to the shell.
+	bool WriteBMP(const std::string& path, const ThumbnailImage& thumb)
+	{
+		uint8_t header[54];
+		memset(header, 0, sizeof(header));
+
+		const uint32_t imageSize = static_cast<uint32_t>(thumb.pixels.size());
+		header[0] = 'B';
+		header[1] = 'M';
+		PutLE32(&header[2],  sizeof(header) + imageSize);
+		PutLE32(&header[10], sizeof(header));
+		PutLE32(&header[14], 40);								// biSize
+		PutLE32(&header[18], thumb.cx);							// biWidth
+		PutLE32(&header[22], static_cast<uint32_t>(-static_cast<int32_t>(thumb.cx)));	// biHeight (top-down)
+		PutLE16(&header[26], 1);								// biPlanes
+		PutLE16(&header[28], 32);								// biBitCount
+		PutLE32(&header[34], imageSize);
+
+		FILE* pFile = NULL;
+#if defined(_MSC_VER)
+		if(fopen_s(&pFile, path.c_str(), "wb") != 0)
+		{
+			pFile = NULL;
+		}
+#else
+		pFile = fopen(path.c_str(), "wb");
+#endif
+		if(!pFile)
+		{
+			return false;
+		}
+		bool ok = fwrite(header, sizeof(header), 1, pFile) == 1
+			   && fwrite(thumb.pixels.data(), imageSize, 1, pFile) == 1;
+		ok = (fclose(pFile) == 0) && ok;
+		return ok;
+	}
+
+	struct Batch
+	{
+		const Options*			pOptions;
+		ThumbnailCache*			pCache;
+		WorkStealingPool*		pPool;
+		std::atomic<size_t>		succeeded;
+		std::atomic<size_t>		failed;
+		std::mutex				outputMutex;	// Keeps console lines whole
+		std::mutex				namesMutex;
+		std::set<std::string>	outputNames;	// Output paths claimed so far, relative to -o
+		LatencyStats			latency;
+
+		Batch() : pOptions(NULL), pCache(NULL), pPool(NULL), succeeded(0), failed(0) {}
+	};
+
+	// Output path (without the _<n>.bmp suffix) of one input. subdir is the
+	// file's directory relative to the walked input directory, so the tree
+	// is mirrored; names that still collide (the same name given twice, or
+	// a.dds next to a.DDS) get a hash of the input path appended.
+	std::string OutputBase(Batch& batch, const std::string& path, const std::string& subdir)
+	{
+		std::string relative = subdir.empty() ? BaseName(path) : subdir + "/" + BaseName(path);
+		{
+			std::lock_guard<std::mutex> lock(batch.namesMutex);
+			if(!batch.outputNames.insert(relative).second)
+			{
+				char suffix[24];
+				snprintf(suffix, sizeof(suffix), "_%016llx",
+					static_cast<unsigned long long>(ThumbnailCache::Fingerprint(path.data(), path.size())));
+				relative += suffix;
+				batch.outputNames.insert(relative);
+			}
+		}
+		MakeDirectories(batch.pOptions->outputDir, subdir);
+		return batch.pOptions->outputDir + "/" + relative;
+	}
+
+	// One file: read, parse, decode, resize, inflate and optionally pack and
+	// write. The engine reads only the header and the mip it needs, so the
+	// read stays inside the task; I/O overlaps decode across workers.
+	void ProcessFile(Batch& batch, const std::string& path, const std::string& subdir)
+	{
+		const Options&          options = *batch.pOptions;
+		const Clock::time_point start   = Clock::now();
+
+		ThumbnailCallStats  stats;
+		ThumbnailCallStats* pStats = NULL;
+		if(options.stats)
+		{
+			BeginThumbnailCall(stats, "batch");
+			pStats = &stats;
+		}
+
+		std::vector<ThumbnailImage> thumbnails(options.sizes.size());
+		MappedFileReadStream stream;
+		int32_t hr = stream.Open(path.c_str()) ? kResultOk : kResultFailed;
+		if(hr >= 0)
+		{
+			hr = RenderThumbnails(stream, options.sizes.data(), options.sizes.size(), thumbnails.data(), batch.pCache, pStats);
+		}
+		stream.Close();
+		if(pStats)
+		{
+			EndThumbnailCall(stats, hr);
+		}
+
+		bool written = true;
+		if(hr >= 0 && !options.outputDir.empty())
+		{
+			const std::string base = OutputBase(batch, path, subdir);
+			for(size_t t = 0; t < thumbnails.size(); ++t)
+			{
+				written = WriteBMP(base + "_" + std::to_string(thumbnails[t].cx) + ".bmp", thumbnails[t]) && written;
+			}
+		}
+
+		const uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+		batch.latency.Add(static_cast<uint32_t>(std::min<uint64_t>(microseconds, 0xFFFFFFFFu)));
+
+		if(hr < 0)
+		{
+			batch.failed++;
+			std::lock_guard<std::mutex> lock(batch.outputMutex);
+			fprintf(stderr, "%s: failed (0x%08X)\n", path.c_str(), static_cast<unsigned>(hr));
+			return;
+		}
+		batch.succeeded++;
+		if(!written || !options.quiet)
+		{
+			std::lock_guard<std::mutex> lock(batch.outputMutex);
+			if(!written)
+			{
+				fprintf(stderr, "%s: cannot write thumbnails\n", path.c_str());
+			}
+			if(!options.quiet)
+			{
+				printf("%s\n", path.c_str());
+			}
+		}
+	}
+
+	// One directory level; subdirectories become tasks of their own so a deep
+	// tree is walked by whichever workers are idle. outputDir is dir relative
+	// to the input directory the walk started from.
+	void ProcessDirectory(Batch& batch, const std::string& dir, const std::string& outputDir)
+	{
+		std::vector<std::string> files;
+		std::vector<std::string> subdirs;
+		ListDirectory(dir, files, subdirs);
+
+		for(size_t i = 0; i < subdirs.size(); ++i)
+		{
+			const std::string subdir = subdirs[i];
+			const std::string output = (outputDir.empty() ? "" : outputDir + "/") + LeafName(subdir);
+			batch.pPool->Submit([&batch, subdir, output]() { ProcessDirectory(batch, subdir, output); });
+		}
+		for(size_t i = 0; i < files.size(); ++i)
+		{
+			const std::string file = files[i];
+			batch.pPool->Submit([&batch, file, outputDir]() { ProcessFile(batch, file, outputDir); });
+		}
+	}
+
+	void LogStats(const char* line)
+	{
+		fputs(line, stderr);
+	}
+
+	void InitializeWorker()
+	{
+#if defined(_WIN32)
+		// DirectX::Resize goes through WIC.
+		CoInitializeEx(NULL, COINIT_MULTITHREADED);
+#endif
+#if defined(_OPENMP)
+		// The pool already keeps every core busy; nested OpenMP teams per
+		// worker would only oversubscribe.
+		omp_set_num_threads(1);
+#endif
+	}
+
+	void FinalizeWorker()
+	{
+		// Hands the worker's cached pixel and scratch buffers back to the heap.
+		ReleaseThumbnailThreadResources();
+#if defined(_WIN32)
+		CoUninitialize();
+#endif
+	}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if(!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+	if(options.mode == kModeVerifyBC)
+	{
+		return (VerifyBCDecoders(options.quiet) == 0) ? 0 : 2;
+	}
+	if(options.mode == kModeVerifyDecompress)
+	{
+		return (VerifyParallelDecompress(options.quiet) == 0) ? 0 : 2;
+	}
+	if(options.mode == kModeVerifyConvert)
+	{
+		return (VerifyDirectConverters(options.quiet) == 0) ? 0 : 2;
+	}
+	if(options.mode == kModeVerifyLegacy)
+	{
+		return (VerifyLegacyExpansions(options.quiet) == 0) ? 0 : 2;
+	}
+	if(options.mode == kModeBenchBC7)
+	{
+		return (BenchmarkBC7(options.quiet) == 0) ? 0 : 2;
+	}
+	if(options.mode == kModeBenchInflate)
+	{
+		return (BenchmarkInflateRows(options.quiet) == 0) ? 0 : 2;
+	}
+	if(options.mode == kModeBenchConvert)
+	{
+		return (BenchmarkDirectConverters(options.quiet) == 0) ? 0 : 2;
+	}
+
+	ThumbnailCache  cache;
+	ThumbnailCache* pCache = NULL;
+	if(!options.cacheFile.empty())
+	{
+		if(!cache.Open(options.cacheFile.c_str(), options.cacheBudget))
+		{
+			fprintf(stderr, "cannot open thumbnail pack %s\n", options.cacheFile.c_str());
+			return 1;
+		}
+		pCache = &cache;
+	}
+
+	if(options.stats)
+	{
+		SetThumbnailStatsEnabled(true);
+		if(!options.quiet)
+		{
+			SetThumbnailStatsLog(LogStats);
+		}
+	}
+
+	Batch batch;
+	batch.pOptions = &options;
+	batch.pCache   = pCache;
+
+	const Clock::time_point start = Clock::now();
+	unsigned threads = 0;
+	{
+		WorkStealingPool pool(options.threads, InitializeWorker, FinalizeWorker);
+		batch.pPool = &pool;
+		threads     = pool.GetThreadCount();
+
+		for(size_t i = 0; i < options.inputs.size(); ++i)
+		{
+			const std::string input = options.inputs[i];
+			if(IsDirectory(input))
+			{
+				pool.Submit([&batch, input]() { ProcessDirectory(batch, input, std::string()); });
+			}
+			else
+			{
+				pool.Submit([&batch, input]() { ProcessFile(batch, input, std::string()); });
+			}
+		}
+		pool.Wait();
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	const size_t succeeded = batch.succeeded;
+	const size_t failed    = batch.failed;
+	printf("%u files, %u failed, %u threads, %.3f s, %.1f files/s\n",
+		static_cast<unsigned>(succeeded + failed), static_cast<unsigned>(failed), threads, seconds,
+		(seconds > 0.0) ? (succeeded + failed) / seconds : 0.0);
+	batch.latency.Print();
+	if(options.stats)
+	{
+		fputs(DumpThumbnailStats().c_str(), stdout);
+	}
+
+	cache.Close();
+	return (failed == 0) ? 0 : 2;
+}
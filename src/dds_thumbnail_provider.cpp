@@ -6,10 +6,17 @@
 #include <strsafe.h>
 #include <fstream>
 #include <cassert>
-#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "./DirectXTex/DirectXTex.h"
 #include "./DirectXTex/DDS.h"
+#include "dds_read_stream.h"
+#include "thumbnail_cache.h"
+#include "thumbnail_engine.h"
+#include "thumbnail_stats.h"
 #include "scope_exit.h"
 
 // using namespace Gdiplus;
@@ -22,124 +29,166 @@ extern long      g_cDllRef;
 
 namespace
 {
-	// Is BC format? 
-	bool bcFormat(DXGI_FORMAT fmt)
-	{
-		DXGI_FORMAT bcs[] = 
-		{
-			DXGI_FORMAT_BC1_TYPELESS,
-			DXGI_FORMAT_BC1_UNORM,
-			DXGI_FORMAT_BC1_UNORM_SRGB,
-			DXGI_FORMAT_BC2_TYPELESS,
-			DXGI_FORMAT_BC2_UNORM,
-			DXGI_FORMAT_BC2_UNORM_SRGB,
-			DXGI_FORMAT_BC3_TYPELESS,
-			DXGI_FORMAT_BC3_UNORM,
-			DXGI_FORMAT_BC3_UNORM_SRGB,
-			DXGI_FORMAT_BC4_TYPELESS,
-			DXGI_FORMAT_BC4_UNORM,
-			DXGI_FORMAT_BC4_SNORM,
-			DXGI_FORMAT_BC5_TYPELESS,
-			DXGI_FORMAT_BC5_UNORM,
-			DXGI_FORMAT_BC5_SNORM,
-			DXGI_FORMAT_BC6H_TYPELESS,
-			DXGI_FORMAT_BC6H_UF16,
-			DXGI_FORMAT_BC6H_SF16,
-			DXGI_FORMAT_BC7_TYPELESS,
-			DXGI_FORMAT_BC7_UNORM,
-			DXGI_FORMAT_BC7_UNORM_SRGB,
-		};
+	// Total size of the on-disk thumbnail pack. 
+	const uint64_t kThumbnailCacheBudget = 64 * 1024 * 1024;
+
+	ThumbnailCache g_thumbnailCache;
+	INIT_ONCE      g_thumbnailCacheOnce = INIT_ONCE_STATIC_INIT;
 
-		for(int i=0; i<(sizeof(bcs)/sizeof(DXGI_FORMAT)); ++i)
+	// %LOCALAPPDATA%\dds_thumbnail\thumbnails.pack J. 
+	BOOL CALLBACK OpenThumbnailCache(PINIT_ONCE, PVOID, PVOID*)
+	{
+		wchar_t szPath[MAX_PATH];
+		if(SUCCEEDED(SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, SHGFP_TYPE_CURRENT, szPath))
+			&& SUCCEEDED(StringCchCatW(szPath, ARRAYSIZE(szPath), L"\\dds_thumbnail")))
 		{
-			if(bcs[i] == fmt)
+			CreateDirectoryW(szPath, NULL);
+			if(SUCCEEDED(StringCchCatW(szPath, ARRAYSIZE(szPath), L"\\thumbnails.pack")))
 			{
-				return true;
+				g_thumbnailCache.Open(szPath, kThumbnailCacheBudget);
 			}
 		}
-		return false;
+		return TRUE;
 	}
 
-	inline float UintAsFloat(uint32_t val)
+	// Opened on first use; NULL if the pack is unavailable. 
+	ThumbnailCache* GetThumbnailCache()
 	{
-		union
-		{
-			uint32_t m_uint;
-			float m_flt;
-		} un;
-		un.m_uint = val;
-		return un.m_flt;
+		InitOnceExecuteOnce(&g_thumbnailCacheOnce, OpenThumbnailCache, NULL, NULL);
+		return g_thumbnailCache.IsOpen() ? &g_thumbnailCache : NULL;
 	}
 
-	template <class T> static inline uint32_t CountLeadingZeroBitsSlow(T value)
+	// c[`bvp^f[^̃LbV (pXƍXVL[). 
+	class MetadataCache
 	{
-		uint32_t count = 0U;
-		uint32_t const bitCount = sizeof(T) * 8;
-		T mask = T(1UL) << (bitCount - 1);
-		while (0 == (mask&value) && 0 != mask)
+	public:
+		static const size_t kCapacity = 1024;
+
+		bool Lookup(const std::wstring& path, const WIN32_FILE_ATTRIBUTE_DATA& attributes, DirectX::TexMetadata& metaData)
 		{
-			mask >>= 1;
-			count++;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Map::iterator it = m_map.find(path);
+			if(it == m_map.end())
+			{
+				return false;
+			}
+			const Entry& entry = *it->second;
+			if(CompareFileTime(&entry.lastWrite, &attributes.ftLastWriteTime) != 0
+				|| entry.sizeHigh != attributes.nFileSizeHigh || entry.sizeLow != attributes.nFileSizeLow)
+			{
+				m_entries.erase(it->second);
+				m_map.erase(it);
+				return false;
+			}
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			metaData = entry.metaData;
+			return true;
 		}
-		return count;
-	}
 
-	uint32_t CountLeadingZeroBits(uint32_t value)
-	{
-		return CountLeadingZeroBitsSlow<uint32_t>(value);
-	}
+		void Insert(const std::wstring& path, const WIN32_FILE_ATTRIBUTE_DATA& attributes, const DirectX::TexMetadata& metaData)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Map::iterator it = m_map.find(path);
+			if(it != m_map.end())
+			{
+				m_entries.erase(it->second);
+				m_map.erase(it);
+			}
+			else if(m_map.size() >= kCapacity)
+			{
+				// łÂɎQƂꂽ̂̂Ă. 
+				m_map.erase(m_entries.back().path);
+				m_entries.pop_back();
+			}
 
-	float HalfToFloat(uint16_t value)
-	{
-		int32_t bsgn = (int32_t)(value >> 15) << 31;
-		int32_t rexp = (int32_t)(value >> 10) & 0x1f;
-		int32_t bexp = rexp + (127 - 15);
-		int32_t rmnt = (int32_t)(value & 0x03ff);
+			Entry entry;
+			entry.path      = path;
+			entry.lastWrite = attributes.ftLastWriteTime;
+			entry.sizeHigh  = attributes.nFileSizeHigh;
+			entry.sizeLow   = attributes.nFileSizeLow;
+			entry.metaData  = metaData;
+			m_entries.push_front(entry);
+			m_map[path] = m_entries.begin();
+		}
+
+	private:
+		struct Entry
+		{
+			std::wstring			path;
+			FILETIME				lastWrite;
+			DWORD					sizeHigh;
+			DWORD					sizeLow;
+			DirectX::TexMetadata	metaData;
+		};
+		typedef std::list<Entry>										EntryList;	// 擪ŋߎQƂ
+		typedef std::unordered_map<std::wstring, EntryList::iterator>	Map;
+
+		std::mutex	m_mutex;
+		EntryList	m_entries;
+		Map			m_map;
+	};
 
-		int32_t retval = 0;
+	MetadataCache  g_metadataCache;
 
-		if (rexp == 31)
+	// DDS wb_ǂŃ^f[^𓾂. t@CςĂȂ΃LbVԂ. 
+	HRESULT GetDDSFileMetadata(LPCWSTR szFile, DirectX::TexMetadata& metaData, bool& cacheHit)
+	{
+		cacheHit = false;
+
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if(!GetFileAttributesExW(szFile, GetFileExInfoStandard, &attributes))
 		{
-			if (rmnt == 0)
-			{	// inifinity
-				retval = bsgn | 0x7F800000;
-			}
-			else
-			{	// NaN
-				retval = bsgn | 0x7F800000 | (rmnt << 13U);
-			}
+			return HRESULT_FROM_WIN32(GetLastError());
 		}
-		else if (rexp > 0)
+
+		// pX̑啶͋ʂȂ. 
+		std::wstring path(szFile);
+		CharLowerBuffW(&path[0], static_cast<DWORD>(path.size()));
+
+		if(g_metadataCache.Lookup(path, attributes, metaData))
 		{
-			retval = bsgn | (bexp << 23) | (rmnt << 13U);
+			cacheHit = true;
+			return S_OK;
 		}
-		else
+
+		HRESULT hr = DirectX::GetMetadataFromDDSFile(szFile, DirectX::DDS_FLAGS_NONE, metaData);
+		if(SUCCEEDED(hr))
 		{
-			if (rmnt)
-			{
-				int32_t const expShift = CountLeadingZeroBits(static_cast<uint32_t>(rmnt)) - 22;
-				int32_t const exp = bexp - expShift;
-				int32_t const bmnt = (rmnt << (13 + (expShift + 1))) & 0x7fffff;
-				retval = bsgn | (exp << 23U) | bmnt;
-			}
-			else
-			{
-				retval = bsgn;
-			}
+			g_metadataCache.Insert(path, attributes, metaData);
 		}
-		return UintAsFloat(retval);
+		return hr;
 	}
 
-	DirectX::ScratchImage Resize(int cx, DirectX::ScratchImage& image)
+	INIT_ONCE      g_statsOnce = INIT_ONCE_STATIC_INIT;
+
+	void LogThumbnailStats(const char* line)
 	{
-		HRESULT hr;
-		DirectX::ScratchImage resizedImage;
+		OutputDebugStringA(line);
+	}
 
-		hr = DirectX::Resize(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
-			cx, cx, DirectX::TEX_FILTER_DEFAULT, resizedImage);
-		assert(SUCCEEDED(hr));
+	// ϐ DDS_THUMBNAIL_STATS=1 ŌvLɂ, 1Ăяo1sfobOo͂֏. 
+	BOOL CALLBACK ConfigureThumbnailStats(PINIT_ONCE, PVOID, PVOID*)
+	{
+		wchar_t szValue[8];
+		DWORD   cch = GetEnvironmentVariableW(L"DDS_THUMBNAIL_STATS", szValue, ARRAYSIZE(szValue));
+		if(cch > 0 && cch < ARRAYSIZE(szValue) && szValue[0] != L'0')
+		{
+			SetThumbnailStatsLog(LogThumbnailStats);
+			SetThumbnailStatsEnabled(true);
+		}
+		return TRUE;
+	}
 
-		return resizedImage;
+	// Per-call stats, or NULL while recording is off. 
+	ThumbnailCallStats* BeginCallStats(ThumbnailCallStats& stats, const char* operation)
+	{
+		InitOnceExecuteOnce(&g_statsOnce, ConfigureThumbnailStats, NULL, NULL);
+		if(!IsThumbnailStatsEnabled())
+		{
+			return NULL;
+		}
+		BeginThumbnailCall(stats, operation);
+		return &stats;
 	}
 
 	void InitializeBMI(BITMAPINFO& bmi, BITMAPINFOHEADER& bmiHeader, UINT cx)
@@ -147,12 +196,25 @@ namespace
 		ZeroMemory(&bmiHeader, sizeof(BITMAPINFOHEADER));
 		bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
 		bmiHeader.biWidth = cx;
-		bmiHeader.biHeight = cx;
+		bmiHeader.biHeight = -(LONG)cx;	// top-down: row 0 is the top of the thumbnail
 		bmiHeader.biPlanes = 1;
 		bmiHeader.biBitCount = 32;
 		bmi.bmiHeader = bmiHeader;
 	}
 
+	HBITMAP CreateThumbnailDIB(UINT cx, LPBYTE* ppBits)
+	{
+		LPVOID           lpBits = NULL;
+		BITMAPINFO       bmi;
+		BITMAPINFOHEADER bmiHeader;
+
+		InitializeBMI(bmi, bmiHeader, cx);
+
+		HBITMAP hbmp = CreateDIBSection(NULL, (LPBITMAPINFO)&bmi, DIB_RGB_COLORS, &lpBits, NULL, 0);
+		*ppBits = (LPBYTE)lpBits;
+		return hbmp;
+	}
+
 	const wchar_t* DDSFormatString(DXGI_FORMAT fmt)
 	{
 		static struct DXGI_FORMAT_caption
@@ -292,255 +354,6 @@ namespace
 
 } // unnamed namespace 
 
-typedef std::function<void(UINT, LPBYTE, const DirectX::Image*)> InflateFunction;
-
-// DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB 
-void InflateFunction_FORMAT_R8G8B8A8_UNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[4 * (y    * cx + x)];
-
-			dst[0] = src[2];
-			dst[1] = src[1];
-			dst[2] = src[0];
-			dst[3] = src[3];
-		}
-	}
-}
-
-// DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB 
-void InflateFunction_FORMAT_B8G8R8A8_UNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[4 * (y    * cx + x)];
-
-			dst[0] = src[0];
-			dst[1] = src[1];
-			dst[2] = src[2];
-			dst[3] = src[3];
-		}
-	}
-}
-
-// DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB 
-void InflateFunction_FORMAT_B8G8R8X8_UNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[4 * (y    * cx + x)];
-
-			dst[0] = src[0];
-			dst[1] = src[1];
-			dst[2] = src[2];
-			dst[3] = 255;
-		}
-	}
-}
-
-// DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8_UNORM 
-void InflateFunction_FORMAT_R8_UNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[1 * (y    * cx + x)];
-
-			dst[0] = 0;
-			dst[1] = 0;
-			dst[2] = src[0];
-			dst[3] = 255;
-		}
-	}
-}
-
-// DXGI_FORMAT_R8_SNORM 
-void InflateFunction_FORMAT_R8_SNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	InflateFunction_FORMAT_R8_UNORM(cx, lpb, img);
-}
-
-// DXGI_FORMAT_R8G8_UNORM 
-void InflateFunction_FORMAT_R8G8_UNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[2 * (y    * cx + x)];
-
-			dst[0] = 0;
-			dst[1] = src[1];
-			dst[2] = src[0];
-			dst[3] = 255;
-		}
-	}
-}
-
-// DXGI_FORMAT_R8G8_SNORM 
-void InflateFunction_FORMAT_R8G8_SNORM(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	InflateFunction_FORMAT_R8G8_UNORM(cx, lpb, img);
-}
-
-// DXGI_FORMAT_R32G32B32A32_FLOAT 
-void InflateFunction_FORMAT_R32G32B32A32_FLOAT(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4  * (line * cx + x)];
-			LPBYTE src = &lps[16 * (y    * cx + x)];
-			float* pf = (float*)src;
-
-			float fr = pf[0]; if(fr<0.0f){fr=0.0f;} else if(fr>1.0f){fr=1.0f;};
-			float fg = pf[1]; if(fg<0.0f){fg=0.0f;} else if(fg>1.0f){fg=1.0f;};
-			float fb = pf[2]; if(fb<0.0f){fb=0.0f;} else if(fb>1.0f){fb=1.0f;};
-
-			dst[0] = (BYTE)(fb*255.0f);
-			dst[1] = (BYTE)(fg*255.0f);
-			dst[2] = (BYTE)(fr*255.0f);
-			dst[3] = 255;
-		}
-	}
-}
-
-// DXGI_FORMAT_R32G32_FLOAT 
-void InflateFunction_FORMAT_R32G32_FLOAT(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[8 * (y    * cx + x)];
-			float* pf = (float*)src;
-
-			float fr = pf[0]; if (fr<0.0f){ fr = 0.0f; } else if (fr > 1.0f){ fr = 1.0f; };
-			float fg = pf[1]; if (fg<0.0f){ fg = 0.0f; } else if (fg > 1.0f){ fg = 1.0f; };
-
-			dst[0] = 0;
-			dst[1] = (BYTE)(fg*255.0f);
-			dst[2] = (BYTE)(fr*255.0f);
-			dst[3] = 255;
-		}
-	}
-}
-
-// DXGI_FORMAT_R16G16B16A16_FLOAT 
-void InflateFunction_FORMAT_R16G16B16A16_FLOAT(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[8 * (y    * cx + x)];
-			uint16_t* ph = (uint16_t*)src;
-
-			float fr = HalfToFloat(ph[0]); if (fr<0.0f){ fr = 0.0f; } else if (fr > 1.0f){ fr = 1.0f; };
-			float fg = HalfToFloat(ph[1]); if (fg<0.0f){ fg = 0.0f; } else if (fg > 1.0f){ fg = 1.0f; };
-			float fb = HalfToFloat(ph[2]); if (fb<0.0f){ fb = 0.0f; } else if (fb > 1.0f){ fb = 1.0f; };
-
-			dst[0] = (BYTE)(fb*255.0f);
-			dst[1] = (BYTE)(fg*255.0f);
-			dst[2] = (BYTE)(fr*255.0f);
-			dst[3] = 255;
-		}
-	}
-}
-
-// DXGI_FORMAT_R16G16_FLOAT 
-void InflateFunction_FORMAT_R16G16_FLOAT(UINT cx, LPBYTE lpb, const DirectX::Image* img)
-{
-	LPBYTE lps = (LPBYTE)(img->pixels);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (int y = 0; y < (int)cx; ++y)
-	{
-		int line = (int)cx - y - 1;
-		for (UINT x = 0; x < cx; ++x)
-		{
-			LPBYTE dst = &lpb[4 * (line * cx + x)];
-			LPBYTE src = &lps[4 * (y    * cx + x)];
-			uint16_t* ph = (uint16_t*)src;
-
-			float fr = HalfToFloat(ph[0]); if (fr<0.0f){ fr = 0.0f; } else if (fr > 1.0f){ fr = 1.0f; };
-			float fg = HalfToFloat(ph[1]); if (fg<0.0f){ fg = 0.0f; } else if (fg > 1.0f){ fg = 1.0f; };
-
-			dst[0] = 0;
-			dst[1] = (BYTE)(fg*255.0f);
-			dst[2] = (BYTE)(fr*255.0f);
-			dst[3] = 255;
-		}
-	}
-}
-
-
 DDSThumbnailProvider::DDSThumbnailProvider()
 	: m_cRef   (1)
 	, m_pStream(NULL)
@@ -604,7 +417,7 @@ IFACEMETHODIMP DDSThumbnailProvider::Initialize(IStream *pStream, DWORD grfMode)
 #pragma region IThumbnailProvider
 IFACEMETHODIMP DDSThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
 {
-	HRESULT hr;
+	HRESULT hr = E_NOTIMPL;
 
 	*phbmp    = NULL;
 	*pdwAlpha = WTSAT_UNKNOWN;
@@ -614,176 +427,58 @@ IFACEMETHODIMP DDSThumbnailProvider::GetThumbnail(UINT cx, HBITMAP* phbmp, WTS_A
 		return E_NOTIMPL;
 	}
 
-	ULONG fileSize = (ULONG)(DDSFileSize(m_pStream));
-	if(fileSize==0)
-	{
-		return E_NOTIMPL;
-	}
-
-	// ubN̊m. 
-	uint8_t* ddsBlock = reinterpret_cast<uint8_t*>(malloc(fileSize));
-	SCOPE_EXIT(if(ddsBlock){free(ddsBlock);});
+	ThumbnailCallStats  stats;
+	ThumbnailCallStats* pStats = BeginCallStats(stats, "thumbnail");
+	SCOPE_EXIT(if(pStats) { EndThumbnailCall(*pStats, hr); });
 
-	// DDSC[W̓ǂݍ. 
-	ULONG fileRead;
-	m_pStream->Read(ddsBlock, fileSize, &fileRead);
+	// Xg[KvȔ͈͂ǂݍ. 
+	IStreamReadStream ddsStream(m_pStream);
 
-	DirectX::TexMetadata   metaData;
-	DirectX::ScratchImage  scratchImage;
-	DirectX::ScratchImage  decompressedImage;
-	DirectX::ScratchImage  thumbImage;
-
-	BYTE r=0, g=0, b=0, a=255;
-	bool imageReady = false;
-
-	hr = DirectX::LoadFromDDSMemory(ddsBlock, fileSize, DirectX::DDS_FLAGS_NONE, &metaData, scratchImage);
-	if(SUCCEEDED(hr))
+	uint64_t fileSize = 0;
+	if(FAILED(ddsStream.GetSize(fileSize)) || fileSize==0)
 	{
-		const DirectX::Image*  image = scratchImage.GetImage(0, 0, 0);
-		if(bcFormat(image->format))
-		{
-			hr = DirectX::Decompress(*image, DXGI_FORMAT_UNKNOWN, decompressedImage);
-			if(SUCCEEDED(hr))
-			{
-				thumbImage = Resize(cx, decompressedImage);
-				r = 255;
-				g = 255;
-				b = 128;
-				a = 255;
-				imageReady = true;
-			}
-		}
-		else
-		{
-			thumbImage = Resize(cx, scratchImage);
-			r = 255;
-			g = 120;
-			b = 0;
-			a = 255;
-			imageReady = true;
-		}
-		if(!imageReady)
-		{
-			r = g = b = 0;
-			a = 255;
-		}
+		return E_NOTIMPL;
 	}
 
-	// TlCC[W̍쐬. 
-	bool createHBitmap = false;
-	
-	if(imageReady)
-	{
-		createHBitmap = CreateHBITMAP_Image(cx, phbmp, pdwAlpha, thumbImage);
-	}
-	else
+	LPBYTE lp;
 	{
-		createHBitmap = CreateHBITMAP_Fill (cx, phbmp, pdwAlpha, r, g, b, a);
+		ThumbnailStageTimer timer(pStats, kStageDIB);
+		*phbmp = CreateThumbnailDIB(cx, &lp);
 	}
-
-	return (createHBitmap) ? S_OK : E_NOTIMPL;
-}
-#pragma endregion
-
-bool DDSThumbnailProvider::CreateHBITMAP_Image(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha, DirectX::ScratchImage& image)
-{
-	const DirectX::Image* firstImage = image.GetImage(0, 0, 0);
-	if (!firstImage)
+	if(!*phbmp)
 	{
-		return CreateHBITMAP_Fill(cx, phbmp, pdwAlpha, 0, 0, 0);
+		hr = E_OUTOFMEMORY;
+		return hr;
 	}
 
-	UINT             i;
-	LPBYTE           lp;
-	LPVOID           lpBits;
-	BITMAPINFO       bmi;
-	BITMAPINFOHEADER bmiHeader;
-
-	InitializeBMI(bmi, bmiHeader, cx);
-
-	*phbmp = CreateDIBSection(NULL, (LPBITMAPINFO)&bmi, DIB_RGB_COLORS, &lpBits, NULL, 0);
-
-	lp = (LPBYTE)lpBits;
-
-	DXGI_FORMAT fmt = firstImage->format;
-
-	struct InflatePixelFunctions
-	{
-		DXGI_FORMAT		format;
-		InflateFunction	func;
-	} inflateFunctions[] = 
-	{
-		{ DXGI_FORMAT_R8G8B8A8_UNORM,         InflateFunction_FORMAT_R8G8B8A8_UNORM },
-		{ DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    InflateFunction_FORMAT_R8G8B8A8_UNORM },
-		{ DXGI_FORMAT_R8G8B8A8_UINT,          InflateFunction_FORMAT_R8G8B8A8_UNORM },
-		{ DXGI_FORMAT_R8G8B8A8_SNORM,         InflateFunction_FORMAT_R8G8B8A8_UNORM },
-		{ DXGI_FORMAT_R8G8B8A8_SINT,          InflateFunction_FORMAT_R8G8B8A8_UNORM },
-		{ DXGI_FORMAT_R8G8B8A8_TYPELESS,      InflateFunction_FORMAT_R8G8B8A8_UNORM },
-
-		{ DXGI_FORMAT_B8G8R8A8_TYPELESS,      InflateFunction_FORMAT_B8G8R8A8_UNORM },
-		{ DXGI_FORMAT_B8G8R8A8_UNORM,         InflateFunction_FORMAT_B8G8R8A8_UNORM },
-		{ DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    InflateFunction_FORMAT_B8G8R8A8_UNORM },
-
-		{ DXGI_FORMAT_B8G8R8X8_TYPELESS,      InflateFunction_FORMAT_B8G8R8X8_UNORM },
-		{ DXGI_FORMAT_B8G8R8X8_UNORM,         InflateFunction_FORMAT_B8G8R8X8_UNORM },
-		{ DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    InflateFunction_FORMAT_B8G8R8X8_UNORM },
-
-		{ DXGI_FORMAT_R8_UNORM,               InflateFunction_FORMAT_R8_UNORM       },
-		{ DXGI_FORMAT_R8_SNORM,               InflateFunction_FORMAT_R8_SNORM       },
-
-		{ DXGI_FORMAT_R8G8_TYPELESS,          InflateFunction_FORMAT_R8G8_SNORM     },
-		{ DXGI_FORMAT_R8G8_UNORM,             InflateFunction_FORMAT_R8G8_UNORM     },
-		{ DXGI_FORMAT_R8G8_SNORM,             InflateFunction_FORMAT_R8G8_SNORM     },
-		{ DXGI_FORMAT_R8G8_UINT,              InflateFunction_FORMAT_R8G8_UNORM     },
-		{ DXGI_FORMAT_R8G8_SINT,              InflateFunction_FORMAT_R8G8_SNORM     },
-
-		{ DXGI_FORMAT_R32G32B32A32_FLOAT,     InflateFunction_FORMAT_R32G32B32A32_FLOAT },
-		{ DXGI_FORMAT_R32G32_FLOAT,           InflateFunction_FORMAT_R32G32_FLOAT   },
-
-		{ DXGI_FORMAT_R16G16B16A16_FLOAT,     InflateFunction_FORMAT_R16G16B16A16_FLOAT },
-		{ DXGI_FORMAT_R16G16_FLOAT,           InflateFunction_FORMAT_R16G16_FLOAT   },
-
-	};
-	size_t n = sizeof(inflateFunctions) / sizeof(InflatePixelFunctions);
-
-	for(size_t x=0; x<n; ++x)
+	hr = RenderThumbnail(ddsStream, cx, lp, GetThumbnailCache(), pStats);
+	if(SUCCEEDED(hr))
 	{
-		if(inflateFunctions[x].format == fmt)
-		{
-			(inflateFunctions[x].func)(cx, lp, firstImage);
-			*pdwAlpha = WTSAT_ARGB;
-			return true;
-		}
+		*pdwAlpha = WTSAT_ARGB;
+		return S_OK;
 	}
 
-	for (i = 0; i < cx * cx; i++)
-	{
-		lp[0] = 0;
-		lp[1] = 0;
-		lp[2] = 0;
-		lp[3] = 255;
-		lp += 4;
-	}
+	// TlCC[WȂꍇ͍œhԂ. 
+	ThumbnailStageTimer timer(pStats, kStageDIB);
+	DeleteObject(*phbmp);
+	*phbmp = NULL;
 
-	*pdwAlpha = WTSAT_ARGB;
+	bool createHBitmap = CreateHBITMAP_Fill(cx, phbmp, pdwAlpha, 0, 0, 0, 255);
 
-	return true;
+	return (createHBitmap) ? S_OK : E_NOTIMPL;
 }
-
+#pragma endregion
 
 bool DDSThumbnailProvider::CreateHBITMAP_Fill(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha, BYTE r, BYTE g, BYTE b, BYTE a)
 {
 	UINT             i;
 	LPBYTE           lp;
-	LPVOID           lpBits;
-	BITMAPINFO       bmi;
-	BITMAPINFOHEADER bmiHeader;
-
-	InitializeBMI(bmi, bmiHeader, cx);
 
-	*phbmp  = CreateDIBSection(NULL, (LPBITMAPINFO)&bmi, DIB_RGB_COLORS, &lpBits, NULL, 0);
-
-	lp = (LPBYTE)lpBits;
+	*phbmp = CreateThumbnailDIB(cx, &lp);
+	if (!*phbmp)
+	{
+		return false;
+	}
 
 	for(i = 0; i < cx * cx; i++)
 	{
@@ -799,23 +494,6 @@ bool DDSThumbnailProvider::CreateHBITMAP_Fill(UINT cx, HBITMAP* phbmp, WTS_ALPHA
 	return true;
 }
 
-size_t DDSThumbnailProvider::DDSFileSize(IStream* pStream)
-{
-	// t@CTCY̎擾. 
-	STATSTG statStg;
-	::ZeroMemory(&statStg, sizeof(STATSTG));
-
-	LARGE_INTEGER lnPos;
-	lnPos.QuadPart = 0;
-
-	pStream->Seek(lnPos,    STREAM_SEEK_SET, NULL);
-	pStream->Stat(&statStg, STATFLAG_DEFAULT);
-
-	size_t fileSize = static_cast<size_t>(statStg.cbSize.QuadPart);
-
-	return fileSize;
-}
-
 DDSFileInfoProvider::DDSFileInfoProvider() : m_cRef(1)
 {
 	InterlockedIncrement(&g_cDllRef);
@@ -898,7 +576,12 @@ IFACEMETHODIMP DDSFileInfoProvider::GetCurFile(LPOLESTR *ppszFileName)
 #pragma region IQueryInfo
 IFACEMETHODIMP DDSFileInfoProvider::GetInfoTip(DWORD dwFlags, LPWSTR *ppwszTip)
 {
-	HRESULT hr;
+	HRESULT hr = E_OUTOFMEMORY;
+
+	ThumbnailCallStats  stats;
+	ThumbnailCallStats* pStats = BeginCallStats(stats, "infotip");
+	SCOPE_EXIT(if(pStats) { EndThumbnailCall(*pStats, hr); });
+
 	const int cch = MAX_PATH + 512;
 	*ppwszTip = static_cast<LPWSTR>(CoTaskMemAlloc(cch * sizeof(wchar_t)));
 	if (*ppwszTip == NULL)
@@ -913,9 +596,12 @@ IFACEMETHODIMP DDSFileInfoProvider::GetInfoTip(DWORD dwFlags, LPWSTR *ppwszTip)
 	wchar_t szFormat[50] = L"N/A";
 	{
 		DirectX::TexMetadata info;
-		DirectX::ScratchImage  scratchImage;
+		bool                 cacheHit = false;
 
-		hr = LoadFromDDSFile(m_szSelectedFile, DirectX::DDS_FLAGS_NONE, &info, scratchImage);
+		{
+			ThumbnailStageTimer timer(pStats, kStageOpen);
+			hr = GetDDSFileMetadata(m_szSelectedFile, info, cacheHit);
+		}
 
 		if(SUCCEEDED(hr))
 		{
@@ -923,6 +609,19 @@ IFACEMETHODIMP DDSFileInfoProvider::GetInfoTip(DWORD dwFlags, LPWSTR *ppwszTip)
 			height = info.height;
 			mipLevels = info.mipLevels;
 			StringCchPrintf(szFormat, 50, L"%s", DDSFormatString(info.format));
+
+			if(pStats)
+			{
+				pStats->format    = static_cast<uint32_t>(info.format);
+				pStats->srcWidth  = static_cast<uint32_t>(info.width);
+				pStats->srcHeight = static_cast<uint32_t>(info.height);
+				pStats->cacheHit  = cacheHit;
+				if(!cacheHit)
+				{
+					// }WbN + DDS_HEADER + DDS_HEADER_DXT10 ǂ. 
+					pStats->bytesRead = sizeof(uint32_t) + sizeof(DirectX::DDS_HEADER) + sizeof(DirectX::DDS_HEADER_DXT10);
+				}
+			}
 		}
 	}
 
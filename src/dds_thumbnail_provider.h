@@ -9,11 +9,6 @@
 
 #pragma comment(lib, "windowscodecs.lib")
 
-namespace DirectX
-{
-	class ScratchImage;
-} // namespace DirectX 
-
 class DDSThumbnailProvider
 	: public IInitializeWithStream
 	, public IThumbnailProvider
@@ -46,12 +41,8 @@ private:
 	// The name of the selected file.
 	wchar_t m_szSelectedFile[MAX_PATH];
 
-	bool CreateHBITMAP_Image(UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha, DirectX::ScratchImage& image);
-
 	bool CreateHBITMAP_Fill (UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha, BYTE r, BYTE g, BYTE b, BYTE a = 0xff);
 
-	size_t DDSFileSize(IStream* pStream);
-
 }; // class DDSThumbnailProvider 
 
 class DDSFileInfoProvider : public IPersistFile, public IQueryInfo
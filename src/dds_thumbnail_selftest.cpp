@@ -0,0 +1,1097 @@
+// ----------------------------------------------------------------------------
+// dds_thumbnail_selftest.cpp
+// ----------------------------------------------------------------------------
+#include "dds_thumbnail_selftest.h"
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "./DirectXTex/DirectXTexP.h"
+#include "./DirectXTex/BC.h"
+#include "pixel_inflate.h"
+
+namespace
+{
+	// ---- BC decoders ----
+
+	// Texel i of a 4x4 block uses index i % 4 (BC1) or i % 8 (BC3 alpha, BC4).
+	const uint32_t kColorIndices = 0xE4E4E4E4;
+
+	uint64_t RedIndices()
+	{
+		uint64_t bits = 0;
+		for(unsigned i = 0; i < 16; ++i)
+		{
+			bits |= uint64_t(i & 7) << (3 * i);
+		}
+		return bits;
+	}
+
+	void PutColorBlock(std::vector<uint8_t>& blocks, uint16_t rgb0, uint16_t rgb1)
+	{
+		const uint8_t block[8] =
+		{
+			uint8_t(rgb0), uint8_t(rgb0 >> 8), uint8_t(rgb1), uint8_t(rgb1 >> 8),
+			uint8_t(kColorIndices), uint8_t(kColorIndices >> 8), uint8_t(kColorIndices >> 16), uint8_t(kColorIndices >> 24),
+		};
+		blocks.insert(blocks.end(), block, block + 8);
+	}
+
+	void PutRedBlock(std::vector<uint8_t>& blocks, uint8_t e0, uint8_t e1)
+	{
+		const uint64_t bits = RedIndices();
+		blocks.push_back(e0);
+		blocks.push_back(e1);
+		for(unsigned i = 0; i < 6; ++i)
+		{
+			blocks.push_back(uint8_t(bits >> (8 * i)));
+		}
+	}
+
+	// BC1 colour blocks: every endpoint pair of each channel in turn, once with
+	// the other channels pushing towards rgb0 <= rgb1 (3-colour in BC1) and once
+	// towards rgb0 > rgb1. The decoders treat the channels independently, so
+	// this covers every table entry without enumerating all 2^32 pairs.
+	void MakeColorBlocks(std::vector<uint8_t>& blocks)
+	{
+		static const unsigned kShift[3] = { 11, 5, 0 };
+		static const unsigned kBits[3]  = { 5, 6, 5 };
+
+		for(unsigned c = 0; c < 3; ++c)
+		{
+			const uint32_t maxValue = (1u << kBits[c]) - 1;
+			const uint16_t others   = static_cast<uint16_t>(~(maxValue << kShift[c]));
+			for(uint32_t a = 0; a <= maxValue; ++a)
+			{
+				for(uint32_t b = 0; b <= maxValue; ++b)
+				{
+					const uint16_t ca = static_cast<uint16_t>(a << kShift[c]);
+					const uint16_t cb = static_cast<uint16_t>(b << kShift[c]);
+					PutColorBlock(blocks, ca, cb | others);
+					PutColorBlock(blocks, ca | others, cb);
+				}
+			}
+		}
+	}
+
+	void MakeBlocks(DXGI_FORMAT bcFormat, std::vector<uint8_t>& blocks)
+	{
+		std::vector<uint8_t> colors;
+		MakeColorBlocks(colors);
+		const size_t colorCount = colors.size() / 8;
+
+		switch(bcFormat)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			blocks.swap(colors);
+			break;
+
+		case DXGI_FORMAT_BC2_UNORM:
+			// Texel i has alpha i
+			for(size_t k = 0; k < colorCount; ++k)
+			{
+				for(unsigned i = 0; i < 16; i += 2)
+				{
+					blocks.push_back(uint8_t(i | ((i + 1) << 4)));
+				}
+				blocks.insert(blocks.end(), &colors[k * 8], &colors[k * 8] + 8);
+			}
+			break;
+
+		case DXGI_FORMAT_BC3_UNORM:
+			for(uint32_t e = 0; e < 0x10000; ++e)
+			{
+				PutRedBlock(blocks, uint8_t(e), uint8_t(e >> 8));
+				const size_t k = e % colorCount;
+				blocks.insert(blocks.end(), &colors[k * 8], &colors[k * 8] + 8);
+			}
+			break;
+
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			for(uint32_t e = 0; e < 0x10000; ++e)
+			{
+				PutRedBlock(blocks, uint8_t(e), uint8_t(e >> 8));
+			}
+			break;
+
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+			for(uint32_t e = 0; e < 0x10000; ++e)
+			{
+				PutRedBlock(blocks, uint8_t(e), uint8_t(e >> 8));
+				PutRedBlock(blocks, uint8_t(e >> 8), uint8_t(e));
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	struct DecoderCase
+	{
+		const char*	name;
+		DXGI_FORMAT	bcFormat;
+		DXGI_FORMAT	format;			// Served by the integer row decoder
+		DXGI_FORMAT	floatFormat;	// Same channels, decoded through XMVECTOR
+	};
+
+	const DecoderCase kDecoderCases[] =
+	{
+		{ "BC1 -> R8G8B8A8",	DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ "BC1 -> B8G8R8A8",	DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ "BC2 -> R8G8B8A8",	DXGI_FORMAT_BC2_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ "BC3 -> R8G8B8A8",	DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ "BC3 -> B8G8R8A8",	DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ "BC4U -> R8",			DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_R8_UNORM,       DXGI_FORMAT_R32_FLOAT },
+		{ "BC4S -> R8_SNORM",	DXGI_FORMAT_BC4_SNORM, DXGI_FORMAT_R8_SNORM,       DXGI_FORMAT_R32_FLOAT },
+		{ "BC5U -> R8G8",		DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_R8G8_UNORM,     DXGI_FORMAT_R32G32_FLOAT },
+		{ "BC5S -> R8G8_SNORM",	DXGI_FORMAT_BC5_SNORM, DXGI_FORMAT_R8G8_SNORM,     DXGI_FORMAT_R32G32_FLOAT },
+	};
+
+	// The blocks as one row: DecompressBlocks straight to the 8-bit format,
+	// against DecompressBlocks to float followed by Convert, whose store
+	// (_StoreScanline) is the one the XMVECTOR decode path ends in.
+	size_t VerifyDecoder(const DecoderCase& test, bool quiet)
+	{
+		std::vector<uint8_t> blocks;
+		MakeBlocks(test.bcFormat, blocks);
+
+		const size_t blockSize = DirectX::BitsPerPixel(test.bcFormat) * 2;
+		const size_t width     = blocks.size() / blockSize * 4;
+		const size_t texelSize = DirectX::BitsPerPixel(test.format) / 8;
+		const size_t floatSize = DirectX::BitsPerPixel(test.floatFormat) / 8;
+
+		std::vector<uint8_t> direct(width * 4 * texelSize);
+		std::vector<uint8_t> decoded(width * 4 * floatSize);
+		DirectX::ScratchImage reference;
+
+		HRESULT hr = DirectX::DecompressBlocks(test.bcFormat, blocks.data(), width, 4, test.format, direct.data(), width * texelSize);
+		if(SUCCEEDED(hr))
+		{
+			hr = DirectX::DecompressBlocks(test.bcFormat, blocks.data(), width, 4, test.floatFormat, decoded.data(), width * floatSize);
+		}
+		if(SUCCEEDED(hr))
+		{
+			const DirectX::Image image = { width, 4, test.floatFormat, width * floatSize, width * 4 * floatSize, decoded.data() };
+			hr = DirectX::Convert(image, test.format, DirectX::TEX_FILTER_DEFAULT | DirectX::TEX_FILTER_FORCE_NON_WIC, 0.5f, reference);
+		}
+		if(FAILED(hr))
+		{
+			printf("%-20s failed (0x%08X)\n", test.name, static_cast<unsigned>(hr));
+			return 1;
+		}
+
+		const DirectX::Image* pReference = reference.GetImage(0, 0, 0);
+		size_t mismatches = 0;
+		for(size_t y = 0; y < 4; ++y)
+		{
+			const uint8_t* pDirect = &direct[y * width * texelSize];
+			const uint8_t* pFloat  = pReference->pixels + y * pReference->rowPitch;
+			for(size_t x = 0; x < width; ++x)
+			{
+				if(memcmp(pDirect + x * texelSize, pFloat + x * texelSize, texelSize) == 0)
+				{
+					continue;
+				}
+				if(++mismatches <= 4 && !quiet)
+				{
+					printf("  block %u texel %u: integer", static_cast<unsigned>(x / 4), static_cast<unsigned>(y * 4 + x % 4));
+					for(size_t i = 0; i < texelSize; ++i)
+					{
+						printf(" %02X", pDirect[x * texelSize + i]);
+					}
+					printf(", float");
+					for(size_t i = 0; i < texelSize; ++i)
+					{
+						printf(" %02X", pFloat[x * texelSize + i]);
+					}
+					printf("\n");
+				}
+			}
+		}
+		printf("%-20s %7u blocks, %u mismatched texels\n", test.name,
+			static_cast<unsigned>(width / 4), static_cast<unsigned>(mismatches));
+		return mismatches;
+	}
+
+	// ---- Benchmarks ----
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Fixed-seed generator so every run decodes the same blocks.
+	class XorShift
+	{
+	public:
+		explicit XorShift(uint64_t seed) : m_state(seed) {}
+
+		uint64_t Next()
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 7;
+			m_state ^= m_state << 17;
+			return m_state;
+		}
+
+	private:
+		uint64_t m_state;
+	};
+
+	// Best of five timed passes, each repeating the work until it has run
+	// for at least 50 ms. Returns seconds per call of work.
+	template<typename Work> double TimeBest(Work work)
+	{
+		double best = 0.0;
+		for(int pass = 0; pass < 5; ++pass)
+		{
+			size_t calls = 0;
+			const Clock::time_point start = Clock::now();
+			double seconds;
+			do
+			{
+				work();
+				++calls;
+				seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			}
+			while(seconds < 0.05);
+
+			const double perCall = seconds / calls;
+			best = (pass == 0) ? perCall : std::min(best, perCall);
+		}
+		return best;
+	}
+
+	// ---- BC7 ----
+
+	const size_t kBC7BlocksPerMode = 4096;
+
+	// Random blocks of one mode: the low mode + 1 bits of the first byte are
+	// the mode marker, everything above them is noise.
+	void MakeBC7Blocks(unsigned mode, std::vector<uint8_t>& blocks)
+	{
+		XorShift random(0x9E3779B97F4A7C15ULL + mode);
+		blocks.resize(kBC7BlocksPerMode * 16);
+		for(size_t i = 0; i < blocks.size(); i += 8)
+		{
+			const uint64_t bits = random.Next();
+			memcpy(&blocks[i], &bits, 8);
+		}
+		for(size_t i = 0; i < blocks.size(); i += 16)
+		{
+			blocks[i] = static_cast<uint8_t>((blocks[i] << (mode + 1)) | (1u << mode));
+		}
+	}
+
+	// The XMVECTOR path as Decompress took it before D3DXDecodeBC7LDR: float
+	// texels, then the R8G8B8A8_UNORM store.
+	void DecodeBC7Float(const uint8_t* pBlock, uint32_t texels[NUM_PIXELS_PER_BLOCK])
+	{
+		DirectX::HDRColorA colors[NUM_PIXELS_PER_BLOCK];
+		reinterpret_cast<const DirectX::D3DX_BC7*>(pBlock)->Decode(colors);
+		for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+		{
+			DirectX::PackedVector::XMUBYTEN4 texel;
+			DirectX::PackedVector::XMStoreUByteN4(&texel, DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&colors[i])));
+			texels[i] = texel.v;
+		}
+	}
+
+	void DecodeBC7Integer(const uint8_t* pBlock, uint32_t texels[NUM_PIXELS_PER_BLOCK])
+	{
+		DirectX::D3DXDecodeBC7LDR(reinterpret_cast<DirectX::LDRColorA*>(texels), pBlock);
+	}
+
+	template<void (*Decode)(const uint8_t*, uint32_t*)>
+	void DecodeBC7Blocks(const std::vector<uint8_t>& blocks, std::vector<uint32_t>& texels)
+	{
+		for(size_t b = 0; b < blocks.size() / 16; ++b)
+		{
+			Decode(&blocks[b * 16], &texels[b * NUM_PIXELS_PER_BLOCK]);
+		}
+	}
+
+	// ---- pixel_inflate ----
+
+	// 64 rows of 1024 pixels: at most 1 MB of R32G32B32A32 source, so the
+	// timings are of the kernels rather than of memory.
+	const size_t kInflateWidth  = 1024;
+	const size_t kInflateHeight = 64;
+
+	struct InflateCase
+	{
+		const char*	name;
+		size_t		texelSize;
+		bool		half;		// Source is halves rather than floats
+		bool		floating;	// Source is floats or halves in [-0.25, 1.25]
+		InflateRowFunction InflateRowKernels::* kernel;
+	};
+
+	const InflateCase kInflateCases[] =
+	{
+		{ "R8G8B8A8",			 4, false, false, &InflateRowKernels::rgba8 },
+		{ "B8G8R8A8",			 4, false, false, &InflateRowKernels::bgra8 },
+		{ "B8G8R8X8",			 4, false, false, &InflateRowKernels::bgrx8 },
+		{ "R8",					 1, false, false, &InflateRowKernels::r8 },
+		{ "R8G8",				 2, false, false, &InflateRowKernels::r8g8 },
+		{ "R32G32B32A32_FLOAT",	16, false, true,  &InflateRowKernels::rgba32f },
+		{ "R32G32_FLOAT",		 8, false, true,  &InflateRowKernels::rg32f },
+		{ "R16G16B16A16_FLOAT",	 8, true,  true,  &InflateRowKernels::rgba16f },
+		{ "R16G16_FLOAT",		 4, true,  true,  &InflateRowKernels::rg16f },
+	};
+
+	const char* const kInstructionSetNames[] = { "scalar", "sse2", "ssse3", "avx2+f16c" };
+
+	// Random channels; float formats stay a little outside [0,1] so the clamp
+	// is exercised, and never hold NaN, which the kernels need not agree on.
+	void MakeInflateSource(const InflateCase& test, std::vector<uint8_t>& source)
+	{
+		XorShift random(0x2545F4914F6CDD1DULL + test.texelSize);
+		source.resize(kInflateWidth * kInflateHeight * test.texelSize);
+		if(!test.floating)
+		{
+			for(size_t i = 0; i < source.size(); ++i)
+			{
+				source[i] = static_cast<uint8_t>(random.Next() >> 56);
+			}
+			return;
+		}
+
+		const size_t channelSize = test.half ? 2 : 4;
+		for(size_t i = 0; i < source.size(); i += channelSize)
+		{
+			const float value = static_cast<float>(random.Next() >> 40) / (1 << 24) * 1.5f - 0.25f;
+			if(test.half)
+			{
+				const DirectX::PackedVector::HALF h = DirectX::PackedVector::XMConvertFloatToHalf(value);
+				memcpy(&source[i], &h, 2);
+			}
+			else
+			{
+				memcpy(&source[i], &value, 4);
+			}
+		}
+	}
+
+	void InflateImage(InflateRowFunction kernel, const InflateCase& test, const std::vector<uint8_t>& source, std::vector<uint8_t>& bgra)
+	{
+		for(size_t y = 0; y < kInflateHeight; ++y)
+		{
+			kernel(&bgra[y * kInflateWidth * 4], &source[y * kInflateWidth * test.texelSize], kInflateWidth);
+		}
+	}
+
+	// ---- Parallel Decompress ----
+
+	struct DecompressCase
+	{
+		const char*	name;		// Formats and the decode path the pair takes
+		DXGI_FORMAT	bcFormat;
+		DXGI_FORMAT	format;
+	};
+
+	const DecompressCase kDecompressCases[] =
+	{
+		{ "BC1 -> R8G8B8A8 (integer)",		DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM },
+		{ "BC3 -> B8G8R8A8 (integer)",		DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM },
+		{ "BC4U -> R8 (integer)",			DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_R8_UNORM },
+		{ "BC5S -> R8G8_SNORM (integer)",	DXGI_FORMAT_BC5_SNORM, DXGI_FORMAT_R8G8_SNORM },
+		{ "BC7 -> R8G8B8A8 (integer)",		DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM },
+		{ "BC6HU -> R16G16B16A16F (integer)",	DXGI_FORMAT_BC6H_UF16, DXGI_FORMAT_R16G16B16A16_FLOAT },
+		{ "BC1 -> R32G32B32A32F (XMVECTOR)",	DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ "BC2 -> R10G10B10A2 (XMVECTOR)",	DXGI_FORMAT_BC2_UNORM, DXGI_FORMAT_R10G10B10A2_UNORM },
+		{ "BC5U -> R16G16 (XMVECTOR)",		DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_R16G16_UNORM },
+		{ "BC7 -> R32G32B32A32F (XMVECTOR)",	DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT },
+	};
+
+	struct DecompressShape
+	{
+		size_t	width;
+		size_t	height;
+		size_t	arraySize;
+		size_t	mipLevels;		// 0 = full chain
+	};
+
+	// Odd edges, single texels, arrays of small slices, and one image large
+	// enough to be cut into several bands.
+	const DecompressShape kDecompressShapes[] =
+	{
+		{    1,    1, 1, 1 },
+		{    5,    3, 1, 1 },
+		{   37,   21, 6, 0 },
+		{  130,    7, 1, 0 },
+		{   64,   64, 64, 1 },
+		{ 1027,  517, 1, 1 },
+	};
+
+	const size_t kDecompressThreads[] = { 0, 1, 3 };
+
+	size_t VerifyDecompressCase(const DecompressCase& test, const DecompressShape& shape, bool quiet)
+	{
+		DirectX::TexMetadata metadata;
+		memset(&metadata, 0, sizeof(metadata));
+		metadata.width     = shape.width;
+		metadata.height    = shape.height;
+		metadata.depth     = 1;
+		metadata.arraySize = shape.arraySize;
+		metadata.mipLevels = shape.mipLevels;
+		metadata.format    = test.bcFormat;
+		metadata.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+
+		DirectX::ScratchImage blocks;
+		HRESULT hr = blocks.Initialize(metadata);
+		if(SUCCEEDED(hr))
+		{
+			XorShift random(0xD1B54A32D192ED03ULL + test.bcFormat);
+			uint8_t* pPixels = blocks.GetPixels();
+			for(size_t i = 0; i < blocks.GetPixelsSize(); ++i)
+			{
+				pPixels[i] = static_cast<uint8_t>(random.Next() >> 56);
+			}
+		}
+
+		DirectX::ScratchImage serial;
+		if(SUCCEEDED(hr))
+		{
+			hr = DirectX::Decompress(blocks.GetImages(), blocks.GetImageCount(), blocks.GetMetadata(), test.format, serial);
+		}
+
+		size_t mismatches = 0;
+		for(size_t t = 0; SUCCEEDED(hr) && t < sizeof(kDecompressThreads) / sizeof(kDecompressThreads[0]); ++t)
+		{
+			// The single-image overload on the top level, the array one on all.
+			DirectX::ScratchImage parallel;
+			DirectX::ScratchImage single;
+			hr = DirectX::Decompress(blocks.GetImages(), blocks.GetImageCount(), blocks.GetMetadata(), test.format, kDecompressThreads[t], parallel);
+			if(SUCCEEDED(hr))
+			{
+				hr = DirectX::Decompress(*blocks.GetImage(0, 0, 0), test.format, kDecompressThreads[t], single);
+			}
+			if(FAILED(hr))
+			{
+				break;
+			}
+
+			const DirectX::Image* pSerial = serial.GetImage(0, 0, 0);
+			const DirectX::Image* pSingle = single.GetImage(0, 0, 0);
+			if(parallel.GetPixelsSize() != serial.GetPixelsSize()
+				|| memcmp(parallel.GetPixels(), serial.GetPixels(), serial.GetPixelsSize()) != 0
+				|| pSingle->rowPitch != pSerial->rowPitch
+				|| memcmp(pSingle->pixels, pSerial->pixels, pSerial->slicePitch) != 0)
+			{
+				if(++mismatches <= 1 && !quiet)
+				{
+					printf("  %u threads: output differs from the serial Decompress\n", static_cast<unsigned>(kDecompressThreads[t]));
+				}
+			}
+		}
+
+		char name[64];
+		sprintf(name, "%ux%u[%u]%s", static_cast<unsigned>(shape.width), static_cast<unsigned>(shape.height),
+			static_cast<unsigned>(shape.arraySize), (shape.mipLevels == 0) ? " mips" : "");
+		if(FAILED(hr))
+		{
+			printf("%-34s %-14s failed (0x%08X)\n", test.name, name, static_cast<unsigned>(hr));
+			return 1;
+		}
+		if(!quiet || mismatches != 0)
+		{
+			printf("%-34s %-14s %s\n", test.name, name, (mismatches == 0) ? "identical" : "differs");
+		}
+		return mismatches;
+	}
+
+	// ---- Direct converters ----
+
+	// CPU_FEATURE_FLAGS sets that pick each instruction set of the converters.
+	struct InstructionSet
+	{
+		const char*	name;
+		DWORD		features;
+	};
+
+	const InstructionSet kDirectInstructionSets[] =
+	{
+		{ "scalar",	0 },
+		{ "sse2",	DirectX::CPU_FEATURE_SSE2 },
+		{ "avx2",	DirectX::CPU_FEATURE_SSE2 | DirectX::CPU_FEATURE_AVX2 },
+	};
+
+	bool IsSupported(const InstructionSet& isa)
+	{
+		return (isa.features & ~DirectX::_GetCPUFeatures()) == 0;
+	}
+
+	const char* FormatName(DXGI_FORMAT format)
+	{
+		switch(format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:		return "R8G8B8A8";
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:	return "R8G8B8A8_SRGB";
+		case DXGI_FORMAT_B8G8R8A8_UNORM:		return "B8G8R8A8";
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:	return "B8G8R8A8_SRGB";
+		case DXGI_FORMAT_B8G8R8X8_UNORM:		return "B8G8R8X8";
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:	return "B8G8R8X8_SRGB";
+		case DXGI_FORMAT_R16G16B16A16_UNORM:	return "R16G16B16A16";
+		case DXGI_FORMAT_R16G16_UNORM:			return "R16G16";
+		case DXGI_FORMAT_R16_UNORM:				return "R16";
+		case DXGI_FORMAT_R8G8_UNORM:			return "R8G8";
+		case DXGI_FORMAT_R8_UNORM:				return "R8";
+		default:								return "?";
+		}
+	}
+
+	// What Convert does for the pair when the registry has no entry: load,
+	// convert and store one scanline through XMVECTOR.
+	void ConvertRowFloat(DXGI_FORMAT inFormat, DXGI_FORMAT outFormat, uint8_t* pDest, const uint8_t* pSource, size_t count, DirectX::XMVECTOR* pScanline)
+	{
+		DirectX::_LoadScanline(pScanline, count, pSource, count * DirectX::BitsPerPixel(inFormat) / 8, inFormat);
+		DirectX::_ConvertScanline(pScanline, count, outFormat, inFormat, DirectX::TEX_FILTER_DEFAULT);
+		DirectX::_StoreScanline(pDest, count * DirectX::BitsPerPixel(outFormat) / 8, outFormat, pScanline, count);
+	}
+
+	// Rows of 1 to 67 texels cover every vector tail; the last row counts up
+	// through all 16-bit (or 8-bit) channel values.
+	const size_t kConvertWidths   = 67;
+	const size_t kConvertLongRow  = 65536;
+
+	size_t VerifyDirectConverter(DXGI_FORMAT inFormat, DXGI_FORMAT outFormat, bool quiet)
+	{
+		const size_t inSize  = DirectX::BitsPerPixel(inFormat) / 8;
+		const size_t outSize = DirectX::BitsPerPixel(outFormat) / 8;
+
+		ScopedAlignedArrayXMVECTOR scanline(static_cast<DirectX::XMVECTOR*>(_aligned_malloc(sizeof(DirectX::XMVECTOR) * kConvertLongRow, 16)));
+		std::vector<uint8_t> source(kConvertLongRow * inSize);
+		std::vector<uint8_t> reference(kConvertLongRow * outSize);
+		std::vector<uint8_t> direct(reference.size() + 64);
+		XorShift random(0xA0761D6478BD642FULL + inFormat * 256 + outFormat);
+
+		printf("%-14s -> %-14s", FormatName(inFormat), FormatName(outFormat));
+		size_t failures = 0;
+		char   detail[128] = "";
+		for(size_t i = 0; i < sizeof(kDirectInstructionSets) / sizeof(kDirectInstructionSets[0]); ++i)
+		{
+			const InstructionSet& isa = kDirectInstructionSets[i];
+			if(!IsSupported(isa))
+			{
+				printf(" %8s", "-");
+				continue;
+			}
+
+			const DirectX::DIRECT_CONVERT_ROW convert = DirectX::_GetDirectConverter(inFormat, outFormat, DirectX::TEX_FILTER_DEFAULT, isa.features);
+			size_t mismatches = 0;
+			for(size_t width = 1; width <= kConvertWidths + 1; ++width)
+			{
+				const bool   longRow = (width > kConvertWidths);
+				const size_t count   = longRow ? kConvertLongRow : width;
+				for(size_t b = 0; b < count * inSize; ++b)
+				{
+					source[b] = static_cast<uint8_t>(random.Next() >> 56);
+				}
+				if(longRow && DirectX::BitsPerColor(inFormat) == 16)
+				{
+					for(size_t w = 0; w < count * inSize / 2; ++w)
+					{
+						const uint16_t value = static_cast<uint16_t>(w);
+						memcpy(&source[w * 2], &value, 2);
+					}
+				}
+				else if(longRow)
+				{
+					for(size_t b = 0; b < count * inSize; ++b)
+					{
+						source[b] = static_cast<uint8_t>(b);
+					}
+				}
+
+				// A guard byte pattern past the row catches over-long stores.
+				memset(direct.data(), 0xCD, direct.size());
+				ConvertRowFloat(inFormat, outFormat, reference.data(), source.data(), count, scanline.get());
+				convert(direct.data(), source.data(), count);
+
+				for(size_t x = 0; x < count; ++x)
+				{
+					if(memcmp(&direct[x * outSize], &reference[x * outSize], outSize) != 0 && mismatches++ == 0 && failures == 0)
+					{
+						sprintf(detail, "  %s, %u texels: texel %u differs from the float path\n", isa.name,
+							static_cast<unsigned>(count), static_cast<unsigned>(x));
+					}
+				}
+				for(size_t b = count * outSize; b < count * outSize + 64; ++b)
+				{
+					if(direct[b] != 0xCD && mismatches++ == 0 && failures == 0)
+					{
+						sprintf(detail, "  %s, %u texels: wrote past the row\n", isa.name, static_cast<unsigned>(count));
+					}
+				}
+			}
+			printf(" %8s", (mismatches == 0) ? "ok" : "differs");
+			failures += mismatches;
+		}
+		printf("\n");
+		if(!quiet)
+		{
+			printf("%s", detail);
+		}
+		return failures;
+	}
+
+	// 64 rows of 1024 texels, as for the inflate kernels.
+	const size_t kConvertBenchWidth  = 1024;
+	const size_t kConvertBenchHeight = 64;
+
+	// ---- Legacy expansions ----
+
+	// Bytes whose end touches an inaccessible page, so a kernel that reads or
+	// writes past the end of its row faults instead of passing by luck.
+	class GuardedBuffer
+	{
+	public:
+		explicit GuardedBuffer(size_t size) : m_pBase(NULL), m_mapSize(0)
+		{
+#if defined(_WIN32)
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			const size_t page = info.dwPageSize;
+#else
+			const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+			const size_t dataSize = (size + page - 1) / page * page;
+			m_mapSize = dataSize + page;
+#if defined(_WIN32)
+			m_pBase = static_cast<uint8_t*>(VirtualAlloc(NULL, m_mapSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+			DWORD oldProtect;
+			if(m_pBase && !VirtualProtect(m_pBase + dataSize, page, PAGE_NOACCESS, &oldProtect))
+			{
+				VirtualFree(m_pBase, 0, MEM_RELEASE);
+				m_pBase = NULL;
+			}
+#else
+			void* pBase = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			m_pBase = (pBase == MAP_FAILED) ? NULL : static_cast<uint8_t*>(pBase);
+			if(m_pBase && mprotect(m_pBase + dataSize, page, PROT_NONE) != 0)
+			{
+				munmap(m_pBase, m_mapSize);
+				m_pBase = NULL;
+			}
+#endif
+			m_pEnd = m_pBase ? m_pBase + dataSize : NULL;
+		}
+
+		~GuardedBuffer()
+		{
+			if(m_pBase)
+			{
+#if defined(_WIN32)
+				VirtualFree(m_pBase, 0, MEM_RELEASE);
+#else
+				munmap(m_pBase, m_mapSize);
+#endif
+			}
+		}
+
+		// The last size bytes before the guard page.
+		uint8_t* Tail(size_t size) const { return m_pEnd - size; }
+		bool     IsValid() const         { return m_pBase != NULL; }
+
+	private:
+		uint8_t*	m_pBase;
+		uint8_t*	m_pEnd;
+		size_t		m_mapSize;
+
+		GuardedBuffer(const GuardedBuffer&);
+		GuardedBuffer& operator=(const GuardedBuffer&);
+	};
+
+	struct LegacyCase
+	{
+		const char*				name;
+		DirectX::LEGACY_EXPAND	conversion;
+		size_t					inSize;		// Bytes per source texel
+		size_t					outSize;	// Bytes per expanded texel
+	};
+
+	const LegacyCase kLegacyCases[] =
+	{
+		{ "R8G8B8",				DirectX::LEGACY_EXPAND_R8G8B8,			3, 4 },
+		{ "R3G3B2",				DirectX::LEGACY_EXPAND_R3G3B2,			1, 4 },
+		{ "R3G3B2 -> 565",		DirectX::LEGACY_EXPAND_R3G3B2_TO_565,	1, 2 },
+		{ "A8R3G3B2",			DirectX::LEGACY_EXPAND_A8R3G3B2,		2, 4 },
+		{ "P8",					DirectX::LEGACY_EXPAND_P8,				1, 4 },
+		{ "A8P8",				DirectX::LEGACY_EXPAND_A8P8,			2, 4 },
+		{ "A4L4",				DirectX::LEGACY_EXPAND_A4L4,			1, 4 },
+		{ "A4L4 -> 4444",		DirectX::LEGACY_EXPAND_A4L4_TO_4444,	1, 2 },
+		{ "L8",					DirectX::LEGACY_EXPAND_L8,				1, 4 },
+		{ "L16",				DirectX::LEGACY_EXPAND_L16,				2, 8 },
+		{ "A8L8",				DirectX::LEGACY_EXPAND_A8L8,			2, 4 },
+		{ "B5G6R5",				DirectX::LEGACY_EXPAND_565,				2, 4 },
+		{ "B5G5R5A1",			DirectX::LEGACY_EXPAND_5551,			2, 4 },
+		{ "B4G4R4A4",			DirectX::LEGACY_EXPAND_4444,			2, 4 },
+	};
+
+	// The R8G8B8 kernels pick SSSE3 on their own, so it gets a column.
+	const InstructionSet kLegacyInstructionSets[] =
+	{
+		{ "scalar",	0 },
+		{ "sse2",	DirectX::CPU_FEATURE_SSE2 },
+		{ "ssse3",	DirectX::CPU_FEATURE_SSE2 | DirectX::CPU_FEATURE_SSSE3 },
+		{ "avx2",	DirectX::CPU_FEATURE_SSE2 | DirectX::CPU_FEATURE_SSSE3 | DirectX::CPU_FEATURE_AVX2 },
+	};
+
+	// Rows of 1 to 65 texels, then one row holding every 8-bit or 16-bit
+	// source value (random texels for the 24-bit R8G8B8).
+	const size_t kLegacyWidths  = 65;
+	const size_t kLegacyLongRow = 65536;
+
+	size_t VerifyLegacyCase(const LegacyCase& test, const uint32_t* pal8, bool quiet)
+	{
+		GuardedBuffer source(kLegacyLongRow * test.inSize);
+		GuardedBuffer dest(kLegacyLongRow * test.outSize);
+		std::vector<uint8_t> input(kLegacyLongRow * test.inSize);
+		std::vector<uint8_t> reference(kLegacyLongRow * test.outSize);
+		if(!source.IsValid() || !dest.IsValid())
+		{
+			printf("%-16s failed to map guarded rows\n", test.name);
+			return 1;
+		}
+
+		printf("%-16s", test.name);
+		size_t failures = 0;
+		char   detail[128] = "";
+		for(size_t i = 0; i < sizeof(kLegacyInstructionSets) / sizeof(kLegacyInstructionSets[0]); ++i)
+		{
+			const InstructionSet& isa = kLegacyInstructionSets[i];
+			if(!IsSupported(isa))
+			{
+				printf(" %8s", "-");
+				continue;
+			}
+
+			XorShift random(0x8EBC6AF09C88C6E3ULL + test.conversion);
+			size_t mismatches = 0;
+			for(size_t width = 1; width <= kLegacyWidths + 1; ++width)
+			{
+				const bool   longRow = (width > kLegacyWidths);
+				const size_t count   = longRow ? ((test.inSize == 1) ? 256 : kLegacyLongRow) : width;
+				for(size_t b = 0; b < count * test.inSize; ++b)
+				{
+					input[b] = static_cast<uint8_t>(random.Next() >> 56);
+				}
+				if(longRow && test.inSize <= 2)
+				{
+					for(size_t x = 0; x < count; ++x)
+					{
+						input[x * test.inSize] = static_cast<uint8_t>(x);
+						if(test.inSize == 2)
+						{
+							input[x * 2 + 1] = static_cast<uint8_t>(x >> 8);
+						}
+					}
+				}
+
+				for(int setAlpha = 0; setAlpha < 2; ++setAlpha)
+				{
+					uint8_t* pSource = source.Tail(count * test.inSize);
+					uint8_t* pDest   = dest.Tail(count * test.outSize);
+					memcpy(pSource, input.data(), count * test.inSize);
+					DirectX::_LegacyExpandRow(test.conversion, reference.data(), pSource, count, pal8, setAlpha != 0, 0);
+					DirectX::_LegacyExpandRow(test.conversion, pDest, pSource, count, pal8, setAlpha != 0, isa.features);
+
+					for(size_t x = 0; x < count; ++x)
+					{
+						if(memcmp(pDest + x * test.outSize, &reference[x * test.outSize], test.outSize) != 0 && mismatches++ == 0 && failures == 0)
+						{
+							sprintf(detail, "  %s, %u texels%s: texel %u differs from scalar\n", isa.name, static_cast<unsigned>(count),
+								setAlpha ? ", setAlpha" : "", static_cast<unsigned>(x));
+						}
+					}
+				}
+			}
+			printf(" %8s", (mismatches == 0) ? "ok" : "differs");
+			failures += mismatches;
+		}
+		printf("\n");
+		if(!quiet)
+		{
+			printf("%s", detail);
+		}
+		return failures;
+	}
+
+} // unnamed namespace
+
+size_t VerifyBCDecoders(bool quiet)
+{
+	size_t failures = 0;
+	for(size_t i = 0; i < sizeof(kDecoderCases) / sizeof(kDecoderCases[0]); ++i)
+	{
+		failures += VerifyDecoder(kDecoderCases[i], quiet);
+	}
+	return failures;
+}
+
+size_t BenchmarkBC7(bool quiet)
+{
+	printf("BC7 decode, %u random blocks per mode, Mblocks/s (best of 5)\n", static_cast<unsigned>(kBC7BlocksPerMode));
+	printf("mode      float    integer  speedup  mismatches\n");
+
+	size_t failures = 0;
+	std::vector<uint8_t>  blocks;
+	std::vector<uint32_t> floatTexels(kBC7BlocksPerMode * NUM_PIXELS_PER_BLOCK);
+	std::vector<uint32_t> integerTexels(floatTexels.size());
+	for(unsigned mode = 0; mode < 8; ++mode)
+	{
+		MakeBC7Blocks(mode, blocks);
+
+		const double floatSeconds   = TimeBest([&]() { DecodeBC7Blocks<DecodeBC7Float>(blocks, floatTexels); });
+		const double integerSeconds = TimeBest([&]() { DecodeBC7Blocks<DecodeBC7Integer>(blocks, integerTexels); });
+
+		size_t mismatches = 0;
+		for(size_t i = 0; i < floatTexels.size(); ++i)
+		{
+			if(floatTexels[i] != integerTexels[i])
+			{
+				if(++mismatches <= 4 && !quiet)
+				{
+					printf("  block %u texel %u: float %08X, integer %08X\n",
+						static_cast<unsigned>(i / NUM_PIXELS_PER_BLOCK), static_cast<unsigned>(i % NUM_PIXELS_PER_BLOCK),
+						floatTexels[i], integerTexels[i]);
+				}
+			}
+		}
+		failures += mismatches;
+
+		printf("%4u %10.2f %10.2f %7.2fx %11u\n", mode,
+			kBC7BlocksPerMode / floatSeconds / 1e6, kBC7BlocksPerMode / integerSeconds / 1e6,
+			floatSeconds / integerSeconds, static_cast<unsigned>(mismatches));
+	}
+	return failures;
+}
+
+size_t BenchmarkInflateRows(bool quiet)
+{
+	const size_t isaCount = sizeof(kInstructionSetNames) / sizeof(kInstructionSetNames[0]);
+
+	// GetInflateRowKernels(isa) falls back below the CPU's best set, so a set
+	// is usable only when it resolves to kernels of its own.
+	bool supported[isaCount];
+	for(size_t isa = 0; isa < isaCount; ++isa)
+	{
+		const InflateRowKernels& kernels = GetInflateRowKernels(static_cast<InflateInstructionSet>(isa));
+		supported[isa] = (strcmp(kernels.name, kInstructionSetNames[isa]) == 0);
+	}
+
+	printf("pixel_inflate, %ux%u pixels, GB/s of BGRA output (best of 5)\n",
+		static_cast<unsigned>(kInflateWidth), static_cast<unsigned>(kInflateHeight));
+	printf("%-20s", "format");
+	for(size_t isa = 0; isa < isaCount; ++isa)
+	{
+		printf(" %10s", kInstructionSetNames[isa]);
+	}
+	printf("\n");
+
+	size_t failures = 0;
+	std::vector<uint8_t> source;
+	std::vector<uint8_t> reference(kInflateWidth * kInflateHeight * 4);
+	std::vector<uint8_t> bgra(reference.size());
+	for(size_t c = 0; c < sizeof(kInflateCases) / sizeof(kInflateCases[0]); ++c)
+	{
+		const InflateCase& test = kInflateCases[c];
+		MakeInflateSource(test, source);
+		InflateImage(GetInflateRowKernels(INFLATE_ISA_SCALAR).*test.kernel, test, source, reference);
+
+		printf("%-20s", test.name);
+		size_t mismatches = 0;
+		size_t firstIsa   = 0;
+		size_t firstPixel = 0;
+		for(size_t isa = 0; isa < isaCount; ++isa)
+		{
+			if(!supported[isa])
+			{
+				printf(" %10s", "-");
+				continue;
+			}
+
+			const InflateRowFunction kernel = GetInflateRowKernels(static_cast<InflateInstructionSet>(isa)).*test.kernel;
+			const double seconds = TimeBest([&]() { InflateImage(kernel, test, source, bgra); });
+			printf(" %10.2f", bgra.size() / seconds / 1e9);
+
+			for(size_t i = 0; i < bgra.size(); i += 4)
+			{
+				if(memcmp(&bgra[i], &reference[i], 4) != 0 && mismatches++ == 0)
+				{
+					firstIsa   = isa;
+					firstPixel = i / 4;
+				}
+			}
+		}
+		printf("\n");
+
+		if(mismatches != 0 && !quiet)
+		{
+			// bgra holds the last set's output; redo the one that differed first.
+			InflateImage(GetInflateRowKernels(static_cast<InflateInstructionSet>(firstIsa)).*test.kernel, test, source, bgra);
+			const uint8_t* pGot      = &bgra[firstPixel * 4];
+			const uint8_t* pExpected = &reference[firstPixel * 4];
+			printf("  %u pixels differ from scalar, first %s pixel %u: %02X %02X %02X %02X, scalar %02X %02X %02X %02X\n",
+				static_cast<unsigned>(mismatches), kInstructionSetNames[firstIsa], static_cast<unsigned>(firstPixel),
+				pGot[0], pGot[1], pGot[2], pGot[3], pExpected[0], pExpected[1], pExpected[2], pExpected[3]);
+		}
+		failures += mismatches;
+	}
+	return failures;
+}
+
+size_t VerifyParallelDecompress(bool quiet)
+{
+#if defined(_OPENMP)
+	// Enough threads to cut the work into concurrent bands even on one core.
+	omp_set_num_threads(4);
+#endif
+
+	size_t failures = 0;
+	for(size_t c = 0; c < sizeof(kDecompressCases) / sizeof(kDecompressCases[0]); ++c)
+	{
+		for(size_t i = 0; i < sizeof(kDecompressShapes) / sizeof(kDecompressShapes[0]); ++i)
+		{
+			failures += VerifyDecompressCase(kDecompressCases[c], kDecompressShapes[i], quiet);
+		}
+	}
+	printf("parallel Decompress: %u mismatched runs\n", static_cast<unsigned>(failures));
+	return failures;
+}
+
+size_t VerifyDirectConverters(bool quiet)
+{
+	printf("Direct converters against the float path, widths 1-%u and %u\n",
+		static_cast<unsigned>(kConvertWidths), static_cast<unsigned>(kConvertLongRow));
+	printf("%-32s", "pair");
+	for(size_t i = 0; i < sizeof(kDirectInstructionSets) / sizeof(kDirectInstructionSets[0]); ++i)
+	{
+		printf(" %8s", kDirectInstructionSets[i].name);
+	}
+	printf("\n");
+
+	size_t failures = 0;
+	DXGI_FORMAT inFormat;
+	DXGI_FORMAT outFormat;
+	for(size_t index = 0; DirectX::_GetDirectConverterPair(index, inFormat, outFormat); ++index)
+	{
+		failures += VerifyDirectConverter(inFormat, outFormat, quiet);
+	}
+	return failures;
+}
+
+size_t BenchmarkDirectConverters(bool quiet)
+{
+	size_t failures = 0;
+	printf("Direct converters, %ux%u texels, Mtexels/s (best of 5)\n",
+		static_cast<unsigned>(kConvertBenchWidth), static_cast<unsigned>(kConvertBenchHeight));
+	printf("%-32s %8s", "pair", "float");
+	for(size_t i = 0; i < sizeof(kDirectInstructionSets) / sizeof(kDirectInstructionSets[0]); ++i)
+	{
+		printf(" %8s", kDirectInstructionSets[i].name);
+	}
+	printf(" %8s\n", "speedup");
+
+	const size_t texels = kConvertBenchWidth * kConvertBenchHeight;
+	ScopedAlignedArrayXMVECTOR scanline(static_cast<DirectX::XMVECTOR*>(_aligned_malloc(sizeof(DirectX::XMVECTOR) * kConvertBenchWidth, 16)));
+
+	DXGI_FORMAT inFormat;
+	DXGI_FORMAT outFormat;
+	for(size_t index = 0; DirectX::_GetDirectConverterPair(index, inFormat, outFormat); ++index)
+	{
+		const size_t inPitch  = kConvertBenchWidth * DirectX::BitsPerPixel(inFormat) / 8;
+		const size_t outPitch = kConvertBenchWidth * DirectX::BitsPerPixel(outFormat) / 8;
+		std::vector<uint8_t> source(inPitch * kConvertBenchHeight);
+		std::vector<uint8_t> reference(outPitch * kConvertBenchHeight);
+		std::vector<uint8_t> dest(reference.size());
+		XorShift random(0xE7037ED1A0B428DBULL + index);
+		for(size_t b = 0; b < source.size(); ++b)
+		{
+			source[b] = static_cast<uint8_t>(random.Next() >> 56);
+		}
+
+		const double floatSeconds = TimeBest([&]()
+		{
+			for(size_t y = 0; y < kConvertBenchHeight; ++y)
+			{
+				ConvertRowFloat(inFormat, outFormat, &reference[y * outPitch], &source[y * inPitch], kConvertBenchWidth, scanline.get());
+			}
+		});
+		printf("%-14s -> %-14s %8.1f", FormatName(inFormat), FormatName(outFormat), texels / floatSeconds / 1e6);
+
+		double bestSeconds = floatSeconds;
+		size_t mismatches  = 0;
+		for(size_t i = 0; i < sizeof(kDirectInstructionSets) / sizeof(kDirectInstructionSets[0]); ++i)
+		{
+			if(!IsSupported(kDirectInstructionSets[i]))
+			{
+				printf(" %8s", "-");
+				continue;
+			}
+
+			const DirectX::DIRECT_CONVERT_ROW convert = DirectX::_GetDirectConverter(inFormat, outFormat, DirectX::TEX_FILTER_DEFAULT, kDirectInstructionSets[i].features);
+			const double seconds = TimeBest([&]()
+			{
+				for(size_t y = 0; y < kConvertBenchHeight; ++y)
+				{
+					convert(&dest[y * outPitch], &source[y * inPitch], kConvertBenchWidth);
+				}
+			});
+			printf(" %8.1f", texels / seconds / 1e6);
+			bestSeconds = std::min(bestSeconds, seconds);
+			if(dest != reference)
+			{
+				++mismatches;
+			}
+		}
+		printf(" %7.1fx\n", floatSeconds / bestSeconds);
+
+		if(mismatches != 0 && !quiet)
+		{
+			printf("  %u instruction sets differ from the float path\n", static_cast<unsigned>(mismatches));
+		}
+		failures += mismatches;
+	}
+	return failures;
+}
+
+size_t VerifyLegacyExpansions(bool quiet)
+{
+	printf("Legacy expansions against scalar, widths 1-%u and every source value, guarded rows\n",
+		static_cast<unsigned>(kLegacyWidths));
+	printf("%-16s", "conversion");
+	for(size_t i = 0; i < sizeof(kLegacyInstructionSets) / sizeof(kLegacyInstructionSets[0]); ++i)
+	{
+		printf(" %8s", kLegacyInstructionSets[i].name);
+	}
+	printf("\n");
+
+	// Random palette with random alpha, as a P8 / A8P8 file would carry.
+	uint32_t pal8[256];
+	XorShift random(0x94D049BB133111EBULL);
+	for(size_t i = 0; i < 256; ++i)
+	{
+		pal8[i] = static_cast<uint32_t>(random.Next() >> 32);
+	}
+
+	size_t failures = 0;
+	for(size_t c = 0; c < sizeof(kLegacyCases) / sizeof(kLegacyCases[0]); ++c)
+	{
+		failures += VerifyLegacyCase(kLegacyCases[c], pal8, quiet);
+	}
+	return failures;
+}
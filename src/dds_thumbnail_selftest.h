@@ -0,0 +1,42 @@
+// ----------------------------------------------------------------------------
+// dds_thumbnail_selftest.h
+// ----------------------------------------------------------------------------
+// Description : Self-checks and micro-benchmarks run by dds_thumbnail_cli
+//               (and by ctest through it). Each returns the number of
+//               failures and prints one line per case to stdout.
+#pragma once
+#include <stddef.h>
+
+// Decodes every BC1-BC5 endpoint pair and index through the integer row
+// decoders and through the XMVECTOR pipeline, and compares the texels.
+size_t VerifyBCDecoders(bool quiet);
+
+// Decompresses random blocks of several sizes, array lengths and mip chains
+// through the multithreaded Decompress overloads and through the serial ones,
+// and compares the results byte for byte.
+size_t VerifyParallelDecompress(bool quiet);
+
+// Runs every registered direct Convert pair at each instruction set the CPU
+// supports over rows of 1-67 texels and one long row through every channel
+// value, against load/convert/store through XMVECTOR with the registry out
+// of the way. Also checks that nothing is written past the row.
+size_t VerifyDirectConverters(bool quiet);
+
+// Runs every LEGACY_EXPAND conversion at each instruction set the CPU
+// supports against the scalar code, over rows of 1-65 texels and one row
+// holding every 8-bit or 16-bit source value. The rows end at an
+// inaccessible page, so reading or writing past them faults.
+size_t VerifyLegacyExpansions(bool quiet);
+
+// Blocks per second of each BC7 mode through D3DX_BC7::Decode plus the
+// XMStoreUByteN4 store the float path ends in, against D3DXDecodeBC7LDR.
+// Also counts texels where the two disagree.
+size_t BenchmarkBC7(bool quiet);
+
+// Output GB/s of every pixel_inflate row kernel under each instruction set
+// the CPU supports. Counts pixels that differ from the scalar kernels.
+size_t BenchmarkInflateRows(bool quiet);
+
+// Texels per second of each registered direct Convert pair through the
+// float pipeline and through each instruction set of its direct converter.
+size_t BenchmarkDirectConverters(bool quiet);
@@ -6,6 +6,8 @@
 #include <ShlObj.h>
 #include "ClassFactory.h"
 #include "Reg.h"
+#include "thumbnail_stats.h"
+#include "./DirectXTex/DirectXTex.h"
 
 const CLSID CLSID_dds_thumbnail_provider =
 { 0xda0c8aa7, 0x9fb, 0x4790, { 0x81, 0xc5, 0xdd, 0x69, 0xe2, 0xe0, 0x76, 0xd7 } };
@@ -24,11 +26,26 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
 	{
 	case DLL_PROCESS_ATTACH:
 		g_hInst = hModule;
+		// Per-thread image pools and scratch buffers are freed by their
+		// fiber-local storage callbacks when a thread exits, not here.
 		DisableThreadLibraryCalls(hModule);
 		break;
 	case DLL_THREAD_ATTACH:
 	case DLL_THREAD_DETACH:
+		break;
 	case DLL_PROCESS_DETACH:
+		// Aggregated per-format stats, when DDS_THUMBNAIL_STATS enabled them.
+		// Skipped at process exit, where other threads are already gone.
+		if (lpReserved == NULL && IsThumbnailStatsEnabled())
+		{
+			OutputDebugStringA(DumpThumbnailStats().c_str());
+		}
+		// Unloaded while Explorer keeps running: drop the pixel buffers
+		// cached by every live thread that rendered a thumbnail.
+		if (lpReserved == NULL)
+		{
+			DirectX::ReleaseImagePools();
+		}
 		break;
 	}
 	return TRUE;
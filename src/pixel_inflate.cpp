@@ -0,0 +1,573 @@
+// ----------------------------------------------------------------------------
+// pixel_inflate.cpp
+// ----------------------------------------------------------------------------
+#include "pixel_inflate.h"
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define INFLATE_X86 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define INFLATE_X86 0
+#endif
+
+// MSVC emits any intrinsic without /arch; GCC/Clang need a per-function target.
+#if defined(_MSC_VER) || !INFLATE_X86
+#define INFLATE_TARGET_SSSE3
+#define INFLATE_TARGET_AVX2
+#define INFLATE_TARGET_F16C
+#else
+#define INFLATE_TARGET_SSSE3	__attribute__((target("ssse3")))
+#define INFLATE_TARGET_AVX2		__attribute__((target("avx2")))
+#define INFLATE_TARGET_F16C		__attribute__((target("f16c")))
+#endif
+
+namespace
+{
+	// ------------------------------------------------------------------------
+	// Scalar
+	// ------------------------------------------------------------------------
+	void InflateRow_RGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		for(size_t x = 0; x < count; ++x, pDst += 4, pSrc += 4)
+		{
+			pDst[0] = pSrc[2];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[0];
+			pDst[3] = pSrc[3];
+		}
+	}
+
+	void InflateRow_BGRA8(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		memcpy(pDst, pSrc, count * 4);
+	}
+
+	void InflateRow_BGRX8_Scalar(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		for(size_t x = 0; x < count; ++x, pDst += 4, pSrc += 4)
+		{
+			pDst[0] = pSrc[0];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[2];
+			pDst[3] = 255;
+		}
+	}
+
+	void InflateRow_R8_Scalar(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		for(size_t x = 0; x < count; ++x, pDst += 4, pSrc += 1)
+		{
+			pDst[0] = 0;
+			pDst[1] = 0;
+			pDst[2] = pSrc[0];
+			pDst[3] = 255;
+		}
+	}
+
+	void InflateRow_R8G8_Scalar(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		for(size_t x = 0; x < count; ++x, pDst += 4, pSrc += 2)
+		{
+			pDst[0] = 0;
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[0];
+			pDst[3] = 255;
+		}
+	}
+
+	// Clamps to [0,1] (NaN -> 0) and truncates, matching the SIMD paths bit for bit.
+	inline uint8_t FloatToUnorm8(float f)
+	{
+		if(!(f > 0.0f))
+		{
+			return 0;
+		}
+		if(f >= 1.0f)
+		{
+			return 255;
+		}
+		return static_cast<uint8_t>(f * 255.0f);
+	}
+
+	float HalfToFloat(uint16_t h)
+	{
+		uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		uint32_t exp  = (h >> 10) & 0x1f;
+		uint32_t mant = h & 0x3ff;
+		uint32_t bits;
+
+		if(exp == 31)
+		{	// Infinity / NaN
+			bits = sign | 0x7F800000 | (mant << 13);
+		}
+		else if(exp != 0)
+		{
+			bits = sign | ((exp + 112) << 23) | (mant << 13);
+		}
+		else if(mant != 0)
+		{	// Denormal: renormalize
+			exp = 1;
+			while(!(mant & 0x400))
+			{
+				mant <<= 1;
+				--exp;
+			}
+			bits = sign | ((exp + 112) << 23) | ((mant & 0x3ff) << 13);
+		}
+		else
+		{
+			bits = sign;
+		}
+
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	// Every half maps to one UNORM8 value, so the scalar path is a single lookup.
+	struct HalfToUnorm8Table
+	{
+		uint8_t	value[65536];
+
+		HalfToUnorm8Table()
+		{
+			for(uint32_t h = 0; h < 65536; ++h)
+			{
+				value[h] = FloatToUnorm8(HalfToFloat(static_cast<uint16_t>(h)));
+			}
+		}
+	};
+
+	const HalfToUnorm8Table s_halfToUnorm8;
+
+	void InflateRow_RGBA32F_Scalar(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const float* pf = reinterpret_cast<const float*>(pSrc);
+		for(size_t x = 0; x < count; ++x, pDst += 4, pf += 4)
+		{
+			pDst[0] = FloatToUnorm8(pf[2]);
+			pDst[1] = FloatToUnorm8(pf[1]);
+			pDst[2] = FloatToUnorm8(pf[0]);
+			pDst[3] = 255;
+		}
+	}
+
+	void InflateRow_RG32F_Scalar(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const float* pf = reinterpret_cast<const float*>(pSrc);
+		for(size_t x = 0; x < count; ++x, pDst += 4, pf += 2)
+		{
+			pDst[0] = 0;
+			pDst[1] = FloatToUnorm8(pf[1]);
+			pDst[2] = FloatToUnorm8(pf[0]);
+			pDst[3] = 255;
+		}
+	}
+
+	void InflateRow_RGBA16F_Table(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const uint16_t* ph = reinterpret_cast<const uint16_t*>(pSrc);
+		const uint8_t* table = s_halfToUnorm8.value;
+		for(size_t x = 0; x < count; ++x, pDst += 4, ph += 4)
+		{
+			pDst[0] = table[ph[2]];
+			pDst[1] = table[ph[1]];
+			pDst[2] = table[ph[0]];
+			pDst[3] = 255;
+		}
+	}
+
+	void InflateRow_RG16F_Table(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const uint16_t* ph = reinterpret_cast<const uint16_t*>(pSrc);
+		const uint8_t* table = s_halfToUnorm8.value;
+		for(size_t x = 0; x < count; ++x, pDst += 4, ph += 2)
+		{
+			pDst[0] = 0;
+			pDst[1] = table[ph[1]];
+			pDst[2] = table[ph[0]];
+			pDst[3] = 255;
+		}
+	}
+
+#if INFLATE_X86
+	// ------------------------------------------------------------------------
+	// SSE2 (baseline on x64 and on the Win32 build)
+	// ------------------------------------------------------------------------
+	// 4 RGBA8 pixels -> BGRA8
+	inline __m128i SwizzleRGBA8_SSE2(__m128i v)
+	{
+		const __m128i maskAG = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+		const __m128i maskRB = _mm_set1_epi32(0x00FF00FF);
+
+		__m128i ag = _mm_and_si128(v, maskAG);
+		__m128i rb = _mm_and_si128(v, maskRB);
+		rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+		return _mm_or_si128(ag, rb);
+	}
+
+	// 8 R8G8 pixels -> 8 BGRA8 pixels (32 bytes)
+	inline void ExpandR8G8_SSE2(uint8_t* pDst, __m128i v)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		const __m128i zero  = _mm_setzero_si128();
+
+		// Swap to (G, R) words, widen to dwords and shift into bytes 1..2
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		__m128i lo = _mm_slli_epi32(_mm_unpacklo_epi16(v, zero), 8);
+		__m128i hi = _mm_slli_epi32(_mm_unpackhi_epi16(v, zero), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst +  0), _mm_or_si128(lo, alpha));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 16), _mm_or_si128(hi, alpha));
+	}
+
+	// Clamp to [0,1] (NaN -> 0), scale and truncate
+	inline __m128i FloatToUnorm8x4_SSE2(__m128 v)
+	{
+		const __m128 zero  = _mm_setzero_ps();
+		const __m128 one   = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(255.0f);
+
+		v = _mm_min_ps(_mm_max_ps(v, zero), one);
+		return _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+	}
+
+	// 4 vectors of 4 floats -> 16 UNORM8 bytes in source order
+	inline __m128i PackUnorm8x16_SSE2(__m128 v0, __m128 v1, __m128 v2, __m128 v3)
+	{
+		__m128i lo = _mm_packs_epi32(FloatToUnorm8x4_SSE2(v0), FloatToUnorm8x4_SSE2(v1));
+		__m128i hi = _mm_packs_epi32(FloatToUnorm8x4_SSE2(v2), FloatToUnorm8x4_SSE2(v3));
+		return _mm_packus_epi16(lo, hi);
+	}
+
+	void InflateRow_RGBA8_SSE2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		size_t x = 0;
+		for(; x + 4 <= count; x += 4, pDst += 16, pSrc += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), SwizzleRGBA8_SSE2(v));
+		}
+		InflateRow_RGBA8_Scalar(pDst, pSrc, count - x);
+	}
+
+	void InflateRow_BGRX8_SSE2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t x = 0;
+		for(; x + 4 <= count; x += 4, pDst += 16, pSrc += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_or_si128(v, alpha));
+		}
+		InflateRow_BGRX8_Scalar(pDst, pSrc, count - x);
+	}
+
+	void InflateRow_R8_SSE2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+		const __m128i zero = _mm_setzero_si128();
+
+		size_t x = 0;
+		for(; x + 16 <= count; x += 16, pDst += 64, pSrc += 16)
+		{
+			// (R, 255) words, then (0, 0, R, 255) dwords
+			__m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			__m128i lo = _mm_unpacklo_epi8(v, ones);
+			__m128i hi = _mm_unpackhi_epi8(v, ones);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst +  0), _mm_unpacklo_epi16(zero, lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 16), _mm_unpackhi_epi16(zero, lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 32), _mm_unpacklo_epi16(zero, hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 48), _mm_unpackhi_epi16(zero, hi));
+		}
+		InflateRow_R8_Scalar(pDst, pSrc, count - x);
+	}
+
+	void InflateRow_R8G8_SSE2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, pSrc += 16)
+		{
+			ExpandR8G8_SSE2(pDst, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)));
+		}
+		InflateRow_R8G8_Scalar(pDst, pSrc, count - x);
+	}
+
+	void InflateRow_RGBA32F_SSE2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		const float* pf = reinterpret_cast<const float*>(pSrc);
+
+		size_t x = 0;
+		for(; x + 4 <= count; x += 4, pDst += 16, pf += 16)
+		{
+			__m128i v = PackUnorm8x16_SSE2(_mm_loadu_ps(pf), _mm_loadu_ps(pf + 4), _mm_loadu_ps(pf + 8), _mm_loadu_ps(pf + 12));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_or_si128(SwizzleRGBA8_SSE2(v), alpha));
+		}
+		InflateRow_RGBA32F_Scalar(pDst, reinterpret_cast<const uint8_t*>(pf), count - x);
+	}
+
+	void InflateRow_RG32F_SSE2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const float* pf = reinterpret_cast<const float*>(pSrc);
+
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, pf += 16)
+		{
+			ExpandR8G8_SSE2(pDst, PackUnorm8x16_SSE2(_mm_loadu_ps(pf), _mm_loadu_ps(pf + 4), _mm_loadu_ps(pf + 8), _mm_loadu_ps(pf + 12)));
+		}
+		InflateRow_RG32F_Scalar(pDst, reinterpret_cast<const uint8_t*>(pf), count - x);
+	}
+
+	// ------------------------------------------------------------------------
+	// F16C (vcvtph2ps)
+	// ------------------------------------------------------------------------
+	INFLATE_TARGET_F16C
+	inline __m128 LoadHalf4_F16C(const uint16_t* ph)
+	{
+		return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ph)));
+	}
+
+	INFLATE_TARGET_F16C
+	void InflateRow_RGBA16F_F16C(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		const uint16_t* ph = reinterpret_cast<const uint16_t*>(pSrc);
+
+		size_t x = 0;
+		for(; x + 4 <= count; x += 4, pDst += 16, ph += 16)
+		{
+			__m128i v = PackUnorm8x16_SSE2(LoadHalf4_F16C(ph), LoadHalf4_F16C(ph + 4), LoadHalf4_F16C(ph + 8), LoadHalf4_F16C(ph + 12));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_or_si128(SwizzleRGBA8_SSE2(v), alpha));
+		}
+		InflateRow_RGBA16F_Table(pDst, reinterpret_cast<const uint8_t*>(ph), count - x);
+	}
+
+	INFLATE_TARGET_F16C
+	void InflateRow_RG16F_F16C(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const uint16_t* ph = reinterpret_cast<const uint16_t*>(pSrc);
+
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, ph += 16)
+		{
+			ExpandR8G8_SSE2(pDst, PackUnorm8x16_SSE2(LoadHalf4_F16C(ph), LoadHalf4_F16C(ph + 4), LoadHalf4_F16C(ph + 8), LoadHalf4_F16C(ph + 12)));
+		}
+		InflateRow_RG16F_Table(pDst, reinterpret_cast<const uint8_t*>(ph), count - x);
+	}
+
+	// ------------------------------------------------------------------------
+	// SSSE3 (pshufb)
+	// ------------------------------------------------------------------------
+	INFLATE_TARGET_SSSE3
+	void InflateRow_RGBA8_SSSE3(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t x = 0;
+		for(; x + 4 <= count; x += 4, pDst += 16, pSrc += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_shuffle_epi8(v, shuffle));
+		}
+		InflateRow_RGBA8_Scalar(pDst, pSrc, count - x);
+	}
+
+	INFLATE_TARGET_SSSE3
+	void InflateRow_R8_SSSE3(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		const __m128i shuffle0 = _mm_setr_epi8(-1, -1,  0, -1, -1, -1,  1, -1, -1, -1,  2, -1, -1, -1,  3, -1);
+		const __m128i shuffle1 = _mm_setr_epi8(-1, -1,  4, -1, -1, -1,  5, -1, -1, -1,  6, -1, -1, -1,  7, -1);
+		const __m128i shuffle2 = _mm_setr_epi8(-1, -1,  8, -1, -1, -1,  9, -1, -1, -1, 10, -1, -1, -1, 11, -1);
+		const __m128i shuffle3 = _mm_setr_epi8(-1, -1, 12, -1, -1, -1, 13, -1, -1, -1, 14, -1, -1, -1, 15, -1);
+
+		size_t x = 0;
+		for(; x + 16 <= count; x += 16, pDst += 64, pSrc += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst +  0), _mm_or_si128(_mm_shuffle_epi8(v, shuffle0), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 16), _mm_or_si128(_mm_shuffle_epi8(v, shuffle1), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 32), _mm_or_si128(_mm_shuffle_epi8(v, shuffle2), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 48), _mm_or_si128(_mm_shuffle_epi8(v, shuffle3), alpha));
+		}
+		InflateRow_R8_Scalar(pDst, pSrc, count - x);
+	}
+
+	INFLATE_TARGET_SSSE3
+	void InflateRow_R8G8_SSSE3(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		const __m128i shuffle0 = _mm_setr_epi8(-1,  1,  0, -1, -1,  3,  2, -1, -1,  5,  4, -1, -1,  7,  6, -1);
+		const __m128i shuffle1 = _mm_setr_epi8(-1,  9,  8, -1, -1, 11, 10, -1, -1, 13, 12, -1, -1, 15, 14, -1);
+
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, pSrc += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst +  0), _mm_or_si128(_mm_shuffle_epi8(v, shuffle0), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 16), _mm_or_si128(_mm_shuffle_epi8(v, shuffle1), alpha));
+		}
+		InflateRow_R8G8_Scalar(pDst, pSrc, count - x);
+	}
+
+	// ------------------------------------------------------------------------
+	// AVX2
+	// ------------------------------------------------------------------------
+	INFLATE_TARGET_AVX2
+	void InflateRow_RGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		                                         2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, pSrc += 32)
+		{
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst), _mm256_shuffle_epi8(v, shuffle));
+		}
+		InflateRow_RGBA8_SSSE3(pDst, pSrc, count - x);
+	}
+
+	INFLATE_TARGET_AVX2
+	void InflateRow_BGRX8_AVX2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, pSrc += 32)
+		{
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst), _mm256_or_si256(v, alpha));
+		}
+		InflateRow_BGRX8_SSE2(pDst, pSrc, count - x);
+	}
+
+	INFLATE_TARGET_AVX2
+	void InflateRow_R8_AVX2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t x = 0;
+		for(; x + 16 <= count; x += 16, pDst += 64, pSrc += 16)
+		{
+			__m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			__m256i lo = _mm256_slli_epi32(_mm256_cvtepu8_epi32(v), 16);
+			__m256i hi = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)), 16);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst +  0), _mm256_or_si256(lo, alpha));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + 32), _mm256_or_si256(hi, alpha));
+		}
+		InflateRow_R8_SSSE3(pDst, pSrc, count - x);
+	}
+
+	INFLATE_TARGET_AVX2
+	void InflateRow_R8G8_AVX2(uint8_t* pDst, const uint8_t* pSrc, size_t count)
+	{
+		const __m256i alpha   = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+		const __m256i shuffle = _mm256_setr_epi8(-1, 1, 0, -1, -1, 5, 4, -1, -1,  9,  8, -1, -1, 13, 12, -1,
+		                                         -1, 1, 0, -1, -1, 5, 4, -1, -1,  9,  8, -1, -1, 13, 12, -1);
+
+		size_t x = 0;
+		for(; x + 8 <= count; x += 8, pDst += 32, pSrc += 16)
+		{
+			// Widen each (R, G) pair to a dword, then place G/R in bytes 1/2
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			__m256i w = _mm256_cvtepu16_epi32(v);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst), _mm256_or_si256(_mm256_shuffle_epi8(w, shuffle), alpha));
+		}
+		InflateRow_R8G8_SSSE3(pDst, pSrc, count - x);
+	}
+#endif // INFLATE_X86
+
+	// ------------------------------------------------------------------------
+	// Dispatch
+	// ------------------------------------------------------------------------
+	const InflateRowKernels s_kernels[] =
+	{
+		{
+			InflateRow_RGBA8_Scalar, InflateRow_BGRA8, InflateRow_BGRX8_Scalar, InflateRow_R8_Scalar, InflateRow_R8G8_Scalar,
+			InflateRow_RGBA32F_Scalar, InflateRow_RG32F_Scalar, InflateRow_RGBA16F_Table, InflateRow_RG16F_Table,
+			"scalar"
+		},
+#if INFLATE_X86
+		{
+			InflateRow_RGBA8_SSE2, InflateRow_BGRA8, InflateRow_BGRX8_SSE2, InflateRow_R8_SSE2, InflateRow_R8G8_SSE2,
+			InflateRow_RGBA32F_SSE2, InflateRow_RG32F_SSE2, InflateRow_RGBA16F_Table, InflateRow_RG16F_Table,
+			"sse2"
+		},
+		{
+			InflateRow_RGBA8_SSSE3, InflateRow_BGRA8, InflateRow_BGRX8_SSE2, InflateRow_R8_SSSE3, InflateRow_R8G8_SSSE3,
+			InflateRow_RGBA32F_SSE2, InflateRow_RG32F_SSE2, InflateRow_RGBA16F_Table, InflateRow_RG16F_Table,
+			"ssse3"
+		},
+		{
+			InflateRow_RGBA8_AVX2, InflateRow_BGRA8, InflateRow_BGRX8_AVX2, InflateRow_R8_AVX2, InflateRow_R8G8_AVX2,
+			InflateRow_RGBA32F_SSE2, InflateRow_RG32F_SSE2, InflateRow_RGBA16F_F16C, InflateRow_RG16F_F16C,
+			"avx2+f16c"
+		},
+#endif
+	};
+
+	InflateInstructionSet DetectInstructionSet()
+	{
+#if INFLATE_X86
+		unsigned int info[4] = { 0, 0, 0, 0 };	// EAX, EBX, ECX, EDX
+#if defined(_MSC_VER)
+		__cpuid(reinterpret_cast<int*>(info), 0);
+		const unsigned int maxLeaf = info[0];
+		__cpuid(reinterpret_cast<int*>(info), 1);
+#else
+		const unsigned int maxLeaf = __get_cpuid_max(0, NULL);
+		__get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+#endif
+		const bool sse2    = (info[3] & (1u << 26)) != 0;
+		const bool ssse3   = (info[2] & (1u <<  9)) != 0;
+		const bool osxsave = (info[2] & (1u << 27)) != 0;
+		const bool avx     = (info[2] & (1u << 28)) != 0;
+		const bool f16c    = (info[2] & (1u << 29)) != 0;
+
+		bool avx2 = false;
+		if(maxLeaf >= 7 && osxsave && avx)
+		{
+			// The OS must save the YMM state as well.
+#if defined(_MSC_VER)
+			const unsigned long long xcr0 = _xgetbv(0);
+			__cpuidex(reinterpret_cast<int*>(info), 7, 0);
+#else
+			unsigned int xcr0lo = 0, xcr0hi = 0;
+			__asm__ __volatile__("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+			const unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0hi) << 32) | xcr0lo;
+			__cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#endif
+			avx2 = ((xcr0 & 6) == 6) && (info[1] & (1u << 5)) != 0;
+		}
+
+		if(avx2 && f16c && ssse3) { return INFLATE_ISA_AVX2; }
+		if(ssse3)                 { return INFLATE_ISA_SSSE3; }
+		if(sse2)                  { return INFLATE_ISA_SSE2;  }
+#endif
+		return INFLATE_ISA_SCALAR;
+	}
+
+	// Resolved while the module loads, before any provider thread runs.
+	const InflateInstructionSet s_supported = DetectInstructionSet();
+
+} // unnamed namespace
+
+const InflateRowKernels& GetInflateRowKernels()
+{
+	return s_kernels[s_supported];
+}
+
+const InflateRowKernels& GetInflateRowKernels(InflateInstructionSet isa)
+{
+	return s_kernels[(isa < s_supported) ? isa : s_supported];
+}
@@ -0,0 +1,41 @@
+// ----------------------------------------------------------------------------
+// pixel_inflate.h
+// ----------------------------------------------------------------------------
+// Description : Scanline kernels that expand decoded pixels into 32bpp BGRA
+//               (DIB byte order). SSE2 / SSSE3 / AVX2 (+F16C) variants are
+//               picked at load time from CPUID, with a scalar fallback.
+//               Float inputs are clamped to [0,1] and truncated to 8 bits.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Converts 'count' pixels from pSrc into 4-byte BGRA pixels at pDst.
+typedef void (*InflateRowFunction)(uint8_t* pDst, const uint8_t* pSrc, size_t count);
+
+struct InflateRowKernels
+{
+	InflateRowFunction	rgba8;	// R8G8B8A8 -> BGRA (swizzle)
+	InflateRowFunction	bgra8;	// B8G8R8A8 -> BGRA (copy)
+	InflateRowFunction	bgrx8;	// B8G8R8X8 -> BGRA (alpha forced to 255)
+	InflateRowFunction	r8;		// R8       -> (0, 0, R, 255)
+	InflateRowFunction	r8g8;	// R8G8     -> (0, G, R, 255)
+	InflateRowFunction	rgba32f;// R32G32B32A32_FLOAT -> BGRA (clamped to [0,1], alpha 255)
+	InflateRowFunction	rg32f;	// R32G32_FLOAT       -> (0, G, R, 255)
+	InflateRowFunction	rgba16f;// R16G16B16A16_FLOAT -> BGRA (clamped to [0,1], alpha 255)
+	InflateRowFunction	rg16f;	// R16G16_FLOAT       -> (0, G, R, 255)
+	const char*			name;	// Instruction set of the selected kernels
+};
+
+enum InflateInstructionSet
+{
+	INFLATE_ISA_SCALAR = 0,
+	INFLATE_ISA_SSE2,
+	INFLATE_ISA_SSSE3,
+	INFLATE_ISA_AVX2,	// Also requires F16C
+};
+
+// Best kernels supported by the running CPU.
+const InflateRowKernels& GetInflateRowKernels();
+
+// Kernels for a specific instruction set (falls back to the best supported one below it).
+const InflateRowKernels& GetInflateRowKernels(InflateInstructionSet isa);
@@ -0,0 +1,489 @@
+// ----------------------------------------------------------------------------
+// thumbnail_cache.cpp
+// ----------------------------------------------------------------------------
+#include "thumbnail_cache.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const uint32_t kPackMagic    = 0x50435444;	// 'DTCP'
+	const uint32_t kPackVersion  = 2;			// 2: entries carry the file's mtime
+	const uint32_t kMaxProbe     = 8;			// Slots searched per key
+	const uint32_t kMinSlots     = 256;
+	const uint32_t kMaxSlots     = 65536;
+	const uint64_t kBytesPerSlot = 16384;		// Roughly one 64x64 thumbnail
+	const uint64_t kMinData      = 65536;
+
+	uint32_t HashKey(const ThumbnailCacheKey& key)
+	{
+		uint64_t h = key.fingerprint;
+		h ^= key.fileSize * 0x9E3779B97F4A7C15ULL;
+		h ^= key.lastWriteTime * 0x165667B19E3779F9ULL;
+		h ^= static_cast<uint64_t>(key.cx) * 0xC2B2AE3D27D4EB4FULL;
+		h ^= h >> 29;
+		return static_cast<uint32_t>(h ^ (h >> 32));
+	}
+
+	uint32_t SlotCountForBudget(uint64_t budget)
+	{
+		uint64_t want  = budget / kBytesPerSlot;
+		uint32_t slots = kMinSlots;
+		while(slots < kMaxSlots && slots * 2 <= want)
+		{
+			slots *= 2;
+		}
+		return slots;
+	}
+
+	// Pack layout: PackHeader | PackEntry[slotCount] | data ring[dataCapacity]
+	struct PackHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	slotCount;
+		uint32_t	reserved;
+		uint64_t	dataCapacity;
+		uint64_t	writeCursor;	// Total bytes ever appended (logical ring position)
+		uint8_t		padding[32];
+	};
+
+	struct PackEntry
+	{
+		uint64_t	fingerprint;
+		uint64_t	fileSize;
+		uint64_t	lastWriteTime;
+		uint64_t	position;		// Logical ring position of the pixels
+		uint32_t	cx;
+		uint32_t	size;			// 0 = empty slot
+	};
+
+	static_assert(sizeof(PackHeader) == 64, "PackHeader layout is part of the file format");
+	static_assert(sizeof(PackEntry)  == 40, "PackEntry layout is part of the file format");
+
+	PackHeader* Header(uint8_t* pView)
+	{
+		return reinterpret_cast<PackHeader*>(pView);
+	}
+
+	PackEntry* Entries(uint8_t* pView)
+	{
+		return reinterpret_cast<PackEntry*>(pView + sizeof(PackHeader));
+	}
+
+	uint8_t* Data(uint8_t* pView)
+	{
+		return pView + sizeof(PackHeader) + static_cast<size_t>(Header(pView)->slotCount) * sizeof(PackEntry);
+	}
+
+	// Data stays intact until the ring has wrapped past it.
+	bool IsLive(const PackEntry& entry, uint64_t writeCursor, uint64_t capacity)
+	{
+		return entry.size != 0 && writeCursor - entry.position <= capacity;
+	}
+
+	// The layout a view of viewSize bytes must carry. Anything else is a pack
+	// from another version, torn by a crash or edited by hand. The cursor is
+	// bounded so Insert can never wrap it.
+	bool IsValidHeader(const PackHeader* h, uint64_t viewSize)
+	{
+		const uint32_t slotCount = SlotCountForBudget(viewSize);
+		const uint64_t dataStart = sizeof(PackHeader) + static_cast<uint64_t>(slotCount) * sizeof(PackEntry);
+		return h->magic == kPackMagic && h->version == kPackVersion
+			&& h->slotCount == slotCount && h->dataCapacity == viewSize - dataStart
+			&& h->writeCursor <= UINT64_MAX - 2 * h->dataCapacity;
+	}
+
+	bool Matches(const PackEntry& entry, const ThumbnailCacheKey& key)
+	{
+		return entry.fingerprint == key.fingerprint && entry.fileSize == key.fileSize
+			&& entry.lastWriteTime == key.lastWriteTime && entry.cx == key.cx;
+	}
+
+} // unnamed namespace
+
+ThumbnailCache::ThumbnailCache()
+#if defined(_WIN32)
+	: m_hFile   (INVALID_HANDLE_VALUE)
+	, m_hMapping(NULL)
+#else
+	: m_fd      (-1)
+#endif
+	, m_pView   (NULL)
+	, m_viewSize(0)
+{
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+bool ThumbnailCache::Open(const char* szFile, uint64_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Close();
+
+	m_hFile = CreateFileA(szFile, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	return MapFile(budget);
+}
+
+bool ThumbnailCache::Open(const wchar_t* szFile, uint64_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Close();
+
+	m_hFile = CreateFileW(szFile, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	return MapFile(budget);
+}
+
+void ThumbnailCache::Close()
+{
+	if(m_pView)
+	{
+		UnmapViewOfFile(m_pView);
+		m_pView = NULL;
+	}
+	if(m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+	if(m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_viewSize = 0;
+}
+
+bool ThumbnailCache::LockPack()
+{
+	// Lock a byte far past the end so mapped access is never blocked.
+	OVERLAPPED ov;
+	ZeroMemory(&ov, sizeof(ov));
+	ov.OffsetHigh = 0x40000000;
+	return LockFileEx(m_hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov) != FALSE;
+}
+
+void ThumbnailCache::UnlockPack()
+{
+	OVERLAPPED ov;
+	ZeroMemory(&ov, sizeof(ov));
+	ov.OffsetHigh = 0x40000000;
+	UnlockFileEx(m_hFile, 0, 1, 0, &ov);
+}
+#else
+bool ThumbnailCache::Open(const char* szFile, uint64_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Close();
+
+	m_fd = open(szFile, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if(m_fd >= 0 && !ReplacePack(szFile, budget))
+	{
+		Close();
+		return false;
+	}
+	return MapFile(budget);
+}
+
+// Another process may still have the pack mapped, and truncating it under
+// that view raises SIGBUS there. So a pack of another size is never resized
+// in place. A new, empty one is built next to it and renamed over it, and
+// older mappings keep the old file until they close.
+bool ThumbnailCache::ReplacePack(const char* szFile, uint64_t budget)
+{
+	if(!LockPack())
+	{
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(m_fd, &st) != 0)
+	{
+		UnlockPack();
+		return false;
+	}
+	if(st.st_size == 0 || static_cast<uint64_t>(st.st_size) == budget)
+	{
+		UnlockPack();
+		return true;
+	}
+
+	std::string temp(szFile);
+	temp += ".XXXXXX";
+	const int fd = mkostemp(&temp[0], O_CLOEXEC);
+	if(fd < 0)
+	{
+		UnlockPack();
+		return false;
+	}
+	if(fchmod(fd, 0644) != 0 || ftruncate(fd, static_cast<off_t>(budget)) != 0 || rename(temp.c_str(), szFile) != 0)
+	{
+		unlink(temp.c_str());
+		close(fd);
+		UnlockPack();
+		return false;
+	}
+
+	UnlockPack();
+	close(m_fd);
+	m_fd = fd;
+	return true;
+}
+
+void ThumbnailCache::Close()
+{
+	if(m_pView)
+	{
+		munmap(m_pView, static_cast<size_t>(m_viewSize));
+		m_pView = NULL;
+	}
+	if(m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+	m_viewSize = 0;
+}
+
+bool ThumbnailCache::LockPack()
+{
+	return flock(m_fd, LOCK_EX) == 0;
+}
+
+void ThumbnailCache::UnlockPack()
+{
+	flock(m_fd, LOCK_UN);
+}
+#endif
+
+bool ThumbnailCache::MapFile(uint64_t budget)
+{
+#if defined(_WIN32)
+	if(m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+#else
+	if(m_fd < 0)
+	{
+		return false;
+	}
+#endif
+
+	const uint32_t slotCount = SlotCountForBudget(budget);
+	const uint64_t dataStart = sizeof(PackHeader) + static_cast<uint64_t>(slotCount) * sizeof(PackEntry);
+	if(budget > SIZE_MAX || budget < dataStart + kMinData)
+	{
+		Close();
+		return false;
+	}
+	const uint64_t dataCapacity = budget - dataStart;
+
+	if(!LockPack())
+	{
+		Close();
+		return false;
+	}
+
+	// Size the file to the budget; a size change means the old pack is unusable.
+	bool sized = false;
+	bool reset = false;
+#if defined(_WIN32)
+	LARGE_INTEGER fileSize;
+	if(GetFileSizeEx(m_hFile, &fileSize))
+	{
+		sized = (static_cast<uint64_t>(fileSize.QuadPart) == budget);
+		if(!sized)
+		{
+			LARGE_INTEGER zero;
+			LARGE_INTEGER end;
+			zero.QuadPart = 0;
+			end.QuadPart  = static_cast<LONGLONG>(budget);
+			sized = SetFilePointerEx(m_hFile, zero, NULL, FILE_BEGIN) && SetEndOfFile(m_hFile)
+				 && SetFilePointerEx(m_hFile, end,  NULL, FILE_BEGIN) && SetEndOfFile(m_hFile);
+			reset = true;
+		}
+	}
+	if(sized)
+	{
+		m_hMapping = CreateFileMappingW(m_hFile, NULL, PAGE_READWRITE,
+			static_cast<DWORD>(budget >> 32), static_cast<DWORD>(budget), NULL);
+		if(m_hMapping)
+		{
+			m_pView = static_cast<uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(budget)));
+		}
+	}
+#else
+	struct stat st;
+	if(fstat(m_fd, &st) == 0)
+	{
+		// Only a file nobody has sized yet is grown here; ReplacePack took
+		// care of packs of another size.
+		sized = (static_cast<uint64_t>(st.st_size) == budget);
+		if(!sized && st.st_size == 0)
+		{
+			sized = ftruncate(m_fd, static_cast<off_t>(budget)) == 0;
+			reset = true;
+		}
+	}
+	if(sized)
+	{
+		void* pView = mmap(NULL, static_cast<size_t>(budget), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		m_pView = (pView == MAP_FAILED) ? NULL : static_cast<uint8_t*>(pView);
+	}
+#endif
+
+	if(m_pView)
+	{
+		m_viewSize = budget;
+
+		PackHeader* h = Header(m_pView);
+		if(reset || !IsValidHeader(h, budget))
+		{
+			memset(m_pView, 0, static_cast<size_t>(dataStart));
+			h->magic        = kPackMagic;
+			h->version      = kPackVersion;
+			h->slotCount    = slotCount;
+			h->dataCapacity = dataCapacity;
+			h->writeCursor  = 0;
+		}
+	}
+
+	UnlockPack();
+
+	if(!m_pView)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool ThumbnailCache::Lookup(const ThumbnailCacheKey& key, void* pDestination, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_pView || !LockPack())
+	{
+		return false;
+	}
+
+	const PackHeader* h = Header(m_pView);
+	if(!IsValidHeader(h, m_viewSize))
+	{
+		UnlockPack();
+		return false;
+	}
+
+	const PackEntry* slots = Entries(m_pView);
+	const uint32_t   mask  = h->slotCount - 1;
+	const uint32_t   home  = HashKey(key);
+
+	// Entries are not trusted either: one whose data would run past the ring
+	// is a miss rather than a read past the view.
+	bool hit = false;
+	for(uint32_t i = 0; i < kMaxProbe; ++i)
+	{
+		const PackEntry& entry  = slots[(home + i) & mask];
+		const uint64_t   offset = entry.position % h->dataCapacity;
+		if(Matches(entry, key) && entry.size == size && IsLive(entry, h->writeCursor, h->dataCapacity)
+			&& size <= h->dataCapacity - offset)
+		{
+			memcpy(pDestination, Data(m_pView) + offset, size);
+			hit = true;
+			break;
+		}
+	}
+
+	UnlockPack();
+	return hit;
+}
+
+bool ThumbnailCache::Insert(const ThumbnailCacheKey& key, const void* pSource, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_pView || size == 0 || size > UINT32_MAX || !LockPack())
+	{
+		return false;
+	}
+
+	PackHeader* h = Header(m_pView);
+	if(!IsValidHeader(h, m_viewSize) || size > h->dataCapacity)
+	{
+		UnlockPack();
+		return false;
+	}
+
+	// Append; a thumbnail never straddles the end of the ring.
+	uint64_t position = h->writeCursor;
+	uint64_t offset   = position % h->dataCapacity;
+	if(offset + size > h->dataCapacity)
+	{
+		position += h->dataCapacity - offset;
+		offset    = 0;
+	}
+	h->writeCursor = position + size;
+	memcpy(Data(m_pView) + offset, pSource, size);
+
+	// Reuse the key's slot, else a dead one, else the oldest in the probe window.
+	PackEntry*     slots  = Entries(m_pView);
+	const uint32_t mask   = h->slotCount - 1;
+	const uint32_t home   = HashKey(key);
+	PackEntry*     victim = NULL;
+	for(uint32_t i = 0; i < kMaxProbe; ++i)
+	{
+		PackEntry& entry = slots[(home + i) & mask];
+		if(Matches(entry, key))
+		{
+			victim = &entry;
+			break;
+		}
+		if(!IsLive(entry, h->writeCursor, h->dataCapacity))
+		{
+			if(!victim || IsLive(*victim, h->writeCursor, h->dataCapacity))
+			{
+				victim = &entry;
+			}
+		}
+		else if(!victim || (IsLive(*victim, h->writeCursor, h->dataCapacity) && entry.position < victim->position))
+		{
+			victim = &entry;
+		}
+	}
+
+	victim->fingerprint   = key.fingerprint;
+	victim->fileSize      = key.fileSize;
+	victim->lastWriteTime = key.lastWriteTime;
+	victim->position      = position;
+	victim->cx            = key.cx;
+	victim->size          = static_cast<uint32_t>(size);
+
+	UnlockPack();
+	return true;
+}
+
+uint64_t ThumbnailCache::Fingerprint(const void* pData, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(pData);
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for(size_t i = 0; i < size; ++i)
+	{
+		h ^= p[i];
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
@@ -0,0 +1,72 @@
+// ----------------------------------------------------------------------------
+// thumbnail_cache.h
+// ----------------------------------------------------------------------------
+// Description : Persistent cache of finished BGRA8 thumbnails.
+//               One memory-mapped pack file holds a fixed open-addressed
+//               index followed by an append-only data ring; the oldest
+//               thumbnails are overwritten once the size budget is used up.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+struct ThumbnailCacheKey
+{
+	uint64_t	fingerprint;	// Hash of the DDS header and first block row
+	uint64_t	fileSize;
+	uint64_t	lastWriteTime;	// FILETIME units; 0 when the source has none
+	uint32_t	cx;				// Thumbnail edge length in pixels
+};
+
+class ThumbnailCache
+{
+public:
+	 ThumbnailCache();
+	~ThumbnailCache();
+
+	// Opens or creates the pack file. budget is the total file size in bytes;
+	// a pack created with a different budget is discarded and rebuilt (on
+	// POSIX as a new file renamed over it, so live mappings stay valid).
+	bool Open(const char* szFile, uint64_t budget);
+#if defined(_WIN32)
+	bool Open(const wchar_t* szFile, uint64_t budget);
+#endif
+	void Close();
+
+	bool IsOpen() const { return m_pView != NULL; }
+
+	// Copies a cached thumbnail of exactly size bytes into pDestination.
+	bool Lookup(const ThumbnailCacheKey& key, void* pDestination, size_t size);
+
+	// Appends a thumbnail, evicting the oldest data if the ring is full.
+	bool Insert(const ThumbnailCacheKey& key, const void* pSource, size_t size);
+
+	// 64-bit FNV-1a, used to fingerprint the leading bytes of a file.
+	static uint64_t Fingerprint(const void* pData, size_t size);
+
+private:
+	std::mutex	m_mutex;			// Serializes threads; the file lock serializes processes
+#if defined(_WIN32)
+	HANDLE		m_hFile;
+	HANDLE		m_hMapping;
+#else
+	int			m_fd;
+#endif
+	uint8_t*	m_pView;
+	uint64_t	m_viewSize;
+
+	bool MapFile(uint64_t budget);
+#if !defined(_WIN32)
+	bool ReplacePack(const char* szFile, uint64_t budget);
+#endif
+	bool LockPack();
+	void UnlockPack();
+
+	ThumbnailCache(const ThumbnailCache&);
+	ThumbnailCache& operator=(const ThumbnailCache&);
+
+}; // class ThumbnailCache
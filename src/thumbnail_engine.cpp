@@ -0,0 +1,633 @@
+// ----------------------------------------------------------------------------
+// thumbnail_engine.cpp
+// ----------------------------------------------------------------------------
+#include "thumbnail_engine.h"
+#include <algorithm>
+
+#include "./DirectXTex/DirectXTex.h"
+#include "./DirectXTex/DDS.h"
+#include "dds_read_stream.h"
+#include "pixel_inflate.h"
+#include "scope_exit.h"
+#include "thumbnail_cache.h"
+#include "thumbnail_stats.h"
+
+namespace
+{
+	// Largest thumbnail built from per-block averages.
+	const uint32_t kBlockPreviewMaxSize = 96;
+
+	// Is BC format?
+	bool bcFormat(DXGI_FORMAT fmt)
+	{
+		DXGI_FORMAT bcs[] =
+		{
+			DXGI_FORMAT_BC1_TYPELESS,
+			DXGI_FORMAT_BC1_UNORM,
+			DXGI_FORMAT_BC1_UNORM_SRGB,
+			DXGI_FORMAT_BC2_TYPELESS,
+			DXGI_FORMAT_BC2_UNORM,
+			DXGI_FORMAT_BC2_UNORM_SRGB,
+			DXGI_FORMAT_BC3_TYPELESS,
+			DXGI_FORMAT_BC3_UNORM,
+			DXGI_FORMAT_BC3_UNORM_SRGB,
+			DXGI_FORMAT_BC4_TYPELESS,
+			DXGI_FORMAT_BC4_UNORM,
+			DXGI_FORMAT_BC4_SNORM,
+			DXGI_FORMAT_BC5_TYPELESS,
+			DXGI_FORMAT_BC5_UNORM,
+			DXGI_FORMAT_BC5_SNORM,
+			DXGI_FORMAT_BC6H_TYPELESS,
+			DXGI_FORMAT_BC6H_UF16,
+			DXGI_FORMAT_BC6H_SF16,
+			DXGI_FORMAT_BC7_TYPELESS,
+			DXGI_FORMAT_BC7_UNORM,
+			DXGI_FORMAT_BC7_UNORM_SRGB,
+		};
+
+		for(size_t i=0; i<(sizeof(bcs)/sizeof(DXGI_FORMAT)); ++i)
+		{
+			if(bcs[i] == fmt)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool bc6hFormat(DXGI_FORMAT fmt)
+	{
+		return fmt == DXGI_FORMAT_BC6H_TYPELESS || fmt == DXGI_FORMAT_BC6H_UF16 || fmt == DXGI_FORMAT_BC6H_SF16;
+	}
+
+	// Picks the smallest mip level that still covers cx x cx, so the decode
+	// and filter cost follows the thumbnail size rather than the source size.
+	size_t SelectThumbnailMip(const DirectX::TexMetadata& metaData, uint32_t cx)
+	{
+		size_t mip = 0;
+		size_t w   = metaData.width;
+		size_t h   = metaData.height;
+
+		while (mip + 1 < metaData.mipLevels)
+		{
+			size_t nw = (w > 1) ? (w >> 1) : 1;
+			size_t nh = (h > 1) ? (h >> 1) : 1;
+			if (nw < cx || nh < cx)
+			{
+				break;
+			}
+			w = nw;
+			h = nh;
+			++mip;
+		}
+		return mip;
+	}
+
+	// Row kernel that expands 'fmt' into BGRA8, or NULL if unsupported.
+	InflateRowFunction SelectInflateRow(DXGI_FORMAT fmt)
+	{
+		const InflateRowKernels& kernels = GetInflateRowKernels();
+
+		struct InflatePixelFunctions
+		{
+			DXGI_FORMAT			format;
+			InflateRowFunction	func;
+		} inflateFunctions[] =
+		{
+			{ DXGI_FORMAT_R8G8B8A8_UNORM,         kernels.rgba8   },
+			{ DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    kernels.rgba8   },
+			{ DXGI_FORMAT_R8G8B8A8_UINT,          kernels.rgba8   },
+			{ DXGI_FORMAT_R8G8B8A8_SNORM,         kernels.rgba8   },
+			{ DXGI_FORMAT_R8G8B8A8_SINT,          kernels.rgba8   },
+			{ DXGI_FORMAT_R8G8B8A8_TYPELESS,      kernels.rgba8   },
+
+			{ DXGI_FORMAT_B8G8R8A8_TYPELESS,      kernels.bgra8   },
+			{ DXGI_FORMAT_B8G8R8A8_UNORM,         kernels.bgra8   },
+			{ DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    kernels.bgra8   },
+
+			{ DXGI_FORMAT_B8G8R8X8_TYPELESS,      kernels.bgrx8   },
+			{ DXGI_FORMAT_B8G8R8X8_UNORM,         kernels.bgrx8   },
+			{ DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    kernels.bgrx8   },
+
+			{ DXGI_FORMAT_R8_UNORM,               kernels.r8      },
+			{ DXGI_FORMAT_R8_SNORM,               kernels.r8      },
+
+			{ DXGI_FORMAT_R8G8_TYPELESS,          kernels.r8g8    },
+			{ DXGI_FORMAT_R8G8_UNORM,             kernels.r8g8    },
+			{ DXGI_FORMAT_R8G8_SNORM,             kernels.r8g8    },
+			{ DXGI_FORMAT_R8G8_UINT,              kernels.r8g8    },
+			{ DXGI_FORMAT_R8G8_SINT,              kernels.r8g8    },
+
+			{ DXGI_FORMAT_R32G32B32A32_FLOAT,     kernels.rgba32f },
+			{ DXGI_FORMAT_R32G32_FLOAT,           kernels.rg32f   },
+
+			{ DXGI_FORMAT_R16G16B16A16_FLOAT,     kernels.rgba16f },
+			{ DXGI_FORMAT_R16G16_FLOAT,           kernels.rg16f   },
+		};
+		size_t n = sizeof(inflateFunctions) / sizeof(InflatePixelFunctions);
+
+		for(size_t x=0; x<n; ++x)
+		{
+			if(inflateFunctions[x].format == fmt)
+			{
+				return inflateFunctions[x].func;
+			}
+		}
+		return NULL;
+	}
+
+	// Routes the ScratchImage / Blob buffers of one call through the thread's
+	// image pool, so repeated calls recycle them instead of hitting the heap.
+	// Declare it before any ScratchImage so they are all freed into the pool first.
+	class PooledAllocationScope
+	{
+	public:
+		explicit PooledAllocationScope(ThumbnailCallStats* pStats)
+			: m_pStats   (pStats)
+			, m_pPool    (DirectX::GetThreadImagePool())
+			, m_pPrevious(DirectX::GetThreadImageAllocator())
+		{
+			if(m_pPool)
+			{
+				m_start = m_pPool->GetStats();
+				DirectX::SetThreadImageAllocator(m_pPool);
+			}
+		}
+		~PooledAllocationScope()
+		{
+			DirectX::SetThreadImageAllocator(m_pPrevious);
+			if(m_pPool && m_pStats)
+			{
+				const DirectX::ImagePoolStats end = m_pPool->GetStats();
+				m_pStats->poolAllocations  += end.allocations - m_start.allocations;
+				m_pStats->poolHits         += end.hits - m_start.hits;
+				m_pStats->poolRetainedBytes = end.retainedBytes;
+			}
+		}
+
+	private:
+		ThumbnailCallStats*			m_pStats;
+		DirectX::ImagePool*			m_pPool;
+		DirectX::IImageAllocator*	m_pPrevious;
+		DirectX::ImagePoolStats		m_start;
+
+		PooledAllocationScope(const PooledAllocationScope&);
+		PooledAllocationScope& operator=(const PooledAllocationScope&);
+	};
+
+	void AddAllocation(ThumbnailCallStats* pStats, const DirectX::ScratchImage& scratchImage)
+	{
+		if(pStats)
+		{
+			pStats->bytesAllocated += scratchImage.GetPixelsSize();
+		}
+	}
+
+	// Expands a cx x cx image into the BGRA8 destination.
+	HRESULT Inflate(const DirectX::Image& image, const DirectX::Image& dest, ThumbnailCallStats* pStats)
+	{
+		ThumbnailStageTimer timer(pStats, kStageInflate);
+
+		const InflateRowFunction inflateRow = SelectInflateRow(image.format);
+		if(!inflateRow)
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		}
+
+		const int cy = (int)dest.height;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int y = 0; y < cy; ++y)
+		{
+			inflateRow(&dest.pixels[y * dest.rowPitch], &image.pixels[y * image.rowPitch], dest.width);
+		}
+		return S_OK;
+	}
+
+	HRESULT ResizeAndInflate(const DirectX::Image& image, const DirectX::Image& dest, ThumbnailCallStats* pStats)
+	{
+		if(image.width == dest.width && image.height == dest.height)
+		{
+			return Inflate(image, dest, pStats);
+		}
+
+		DirectX::ScratchImage resizedImage;
+		{
+			ThumbnailStageTimer timer(pStats, kStageResize);
+			HRESULT hr = DirectX::Resize(image, dest.width, dest.height, DirectX::TEX_FILTER_DEFAULT, resizedImage);
+			if(FAILED(hr))
+			{
+				return hr;
+			}
+		}
+		AddAllocation(pStats, resizedImage);
+		return Inflate(*resizedImage.GetImage(0, 0, 0), dest, pStats);
+	}
+
+	// Decodes / filters 'image' (any supported format, any size) into dest.
+	HRESULT RenderImage(const DirectX::Image& image, const DirectX::Image& dest, ThumbnailCallStats* pStats)
+	{
+		if(!bcFormat(image.format))
+		{
+			return ResizeAndInflate(image, dest, pStats);
+		}
+
+		HRESULT hr;
+		DirectX::ScratchImage decompressedImage;
+		{
+			ThumbnailStageTimer timer(pStats, kStageDecompress);
+
+			const size_t cx = dest.width;
+			if(cx <= kBlockPreviewMaxSize && image.width >= cx * 4 && image.height >= cx * 4)
+			{
+				// Small icons: one texel per block from the endpoints, then resize.
+				hr = DirectX::DecompressBlockAverage(image, DXGI_FORMAT_UNKNOWN, decompressedImage);
+			}
+			else if(image.width >= cx && image.height >= cx)
+			{
+				// Downscale while decoding, straight into the destination.
+				return DirectX::DecompressAndResize(image, DirectX::TEX_FILTER_BOX, dest);
+			}
+			else
+			{
+				// BC6H decodes straight to halves; the rgba16f inflate row does the tone-map.
+				hr = DirectX::Decompress(image, bc6hFormat(image.format) ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_UNKNOWN, decompressedImage);
+			}
+		}
+		if(FAILED(hr))
+		{
+			return hr;
+		}
+		AddAllocation(pStats, decompressedImage);
+		return ResizeAndInflate(*decompressedImage.GetImage(0, 0, 0), dest, pStats);
+	}
+
+	// Top-down BGRA8 view of a cx x cx buffer.
+	DirectX::Image BGRA8View(uint32_t cx, uint8_t* pPixels)
+	{
+		DirectX::Image view;
+		view.width      = cx;
+		view.height     = cx;
+		view.format     = DXGI_FORMAT_B8G8R8A8_UNORM;
+		view.rowPitch   = 4 * static_cast<size_t>(cx);
+		view.slicePitch = view.rowPitch * cx;
+		view.pixels     = pPixels;
+		return view;
+	}
+
+	// Presents a ThumbnailReadStream to the DirectXTex stream loaders.
+	class DDSReadStreamAdapter : public DirectX::DDSReadStream
+	{
+	public:
+		explicit DDSReadStreamAdapter(ThumbnailReadStream& source) : m_source(source) {}
+
+		virtual HRESULT Read(void* pDestination, size_t size, size_t& bytesRead) override
+		{
+			return m_source.Read(pDestination, size, bytesRead);
+		}
+		virtual HRESULT Seek(uint64_t position) override
+		{
+			return m_source.Seek(position);
+		}
+		virtual HRESULT GetSize(uint64_t& size) override
+		{
+			return m_source.GetSize(size);
+		}
+
+		int32_t GetLastWriteTime(uint64_t& time)
+		{
+			return m_source.GetLastWriteTime(time);
+		}
+		const void* GetMappedView()
+		{
+			return m_source.GetMappedView();
+		}
+
+	private:
+		ThumbnailReadStream& m_source;
+
+		DDSReadStreamAdapter(const DDSReadStreamAdapter&);
+		DDSReadStreamAdapter& operator=(const DDSReadStreamAdapter&);
+	};
+
+	// Hashes the header and the first block row of the top mip.
+	bool FingerprintDDS(DirectX::DDSReadStream& stream, uint64_t fileSize, const DirectX::TexMetadata& metaData, uint64_t& fingerprint)
+	{
+		size_t rowPitch, slicePitch;
+		DirectX::ComputePitch(metaData.format, metaData.width, metaData.height, rowPitch, slicePitch);
+
+		uint64_t bytes = sizeof(uint32_t) + sizeof(DirectX::DDS_HEADER) + sizeof(DirectX::DDS_HEADER_DXT10) + rowPitch;
+		if(bytes > fileSize)
+		{
+			bytes = fileSize;
+		}
+
+		std::vector<uint8_t> buffer(static_cast<size_t>(bytes));
+		if(FAILED(stream.Seek(0)))
+		{
+			return false;
+		}
+		for(size_t total = 0; total < buffer.size(); )
+		{
+			size_t bytesRead = 0;
+			if(FAILED(stream.Read(&buffer[total], buffer.size() - total, bytesRead)) || bytesRead == 0)
+			{
+				return false;
+			}
+			total += bytesRead;
+		}
+
+		fingerprint = ThumbnailCache::Fingerprint(buffer.data(), buffer.size());
+		return true;
+	}
+
+	// Reads the header and, with a cache, the key shared by every size. The
+	// fingerprint only covers the start of the file, so the mtime is what
+	// tells an edit further down apart.
+	HRESULT PrepareSource(DDSReadStreamAdapter& stream, ThumbnailCache* pCache,
+						  DirectX::TexMetadata& metaData, ThumbnailCacheKey& cacheKey, bool& cacheable,
+						  ThumbnailCallStats* pStats)
+	{
+		ThumbnailStageTimer timer(pStats, kStageOpen);
+		cacheable = false;
+
+		uint64_t fileSize = 0;
+		HRESULT hr = stream.GetSize(fileSize);
+		if(FAILED(hr))
+		{
+			return hr;
+		}
+		if(fileSize == 0)
+		{
+			return E_FAIL;
+		}
+
+		hr = DirectX::GetMetadataFromDDSStream(stream, DirectX::DDS_FLAGS_NONE, metaData);
+		if(FAILED(hr))
+		{
+			return hr;
+		}
+		if(pStats)
+		{
+			pStats->format    = static_cast<uint32_t>(metaData.format);
+			pStats->srcWidth  = static_cast<uint32_t>(metaData.width);
+			pStats->srcHeight = static_cast<uint32_t>(metaData.height);
+		}
+
+		if(pCache)
+		{
+			cacheKey.fileSize = fileSize;
+			cacheKey.cx       = 0;
+			if(FAILED(stream.GetLastWriteTime(cacheKey.lastWriteTime)))
+			{
+				cacheKey.lastWriteTime = 0;
+			}
+			cacheable = FingerprintDDS(stream, fileSize, metaData, cacheKey.fingerprint);
+		}
+		return S_OK;
+	}
+
+	// Loads one mip of the first item, timed and counted. A mapped source is
+	// loaded straight from its view, with only that mip's pages hinted in;
+	// its bytes bypass the counting stream, so the copy is counted here.
+	HRESULT LoadMip(DDSReadStreamAdapter& stream, size_t mip, DirectX::TexMetadata& metaData,
+					DirectX::ScratchImage& scratchImage, ThumbnailCallStats* pStats)
+	{
+		const void* pView = stream.GetMappedView();
+		uint64_t    fileSize = 0;
+		if(pView && (FAILED(stream.GetSize(fileSize)) || fileSize > SIZE_MAX))
+		{
+			pView = NULL;
+		}
+
+		HRESULT hr;
+		{
+			ThumbnailStageTimer timer(pStats, kStageLoad);
+			if(pView)
+			{
+				hr = DirectX::LoadFromDDSMemory(pView, static_cast<size_t>(fileSize), DirectX::DDS_FLAGS_MEMORY_MAPPED,
+												mip, 1, 0, 1, &metaData, scratchImage);
+			}
+			else
+			{
+				hr = DirectX::LoadFromDDSStream(stream, DirectX::DDS_FLAGS_NONE, mip, 1, 0, 1, &metaData, scratchImage);
+			}
+		}
+		if(SUCCEEDED(hr) && pStats)
+		{
+			pStats->mip = static_cast<uint32_t>(mip);
+			if(pView)
+			{
+				pStats->bytesRead += scratchImage.GetPixelsSize();
+			}
+			AddAllocation(pStats, scratchImage);
+		}
+		return hr;
+	}
+
+} // unnamed namespace
+
+int32_t RenderThumbnail(ThumbnailReadStream& stream, uint32_t cx, uint8_t* pDestination,
+						ThumbnailCache* pCache, ThumbnailCallStats* pStats)
+{
+	if(!pDestination)
+	{
+		return E_POINTER;
+	}
+	if(cx == 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	PooledAllocationScope pooled(pStats);
+
+	// Reads are counted only while stats are being recorded.
+	CountingReadStream countingStream(stream);
+	DDSReadStreamAdapter source(pStats ? static_cast<ThumbnailReadStream&>(countingStream) : stream);
+	SCOPE_EXIT(if(pStats) { pStats->bytesRead += countingStream.GetBytesRead(); });
+
+	if(pStats)
+	{
+		pStats->dstWidth  = cx;
+		pStats->dstHeight = cx;
+	}
+
+	DirectX::TexMetadata   metaData;
+	ThumbnailCacheKey      cacheKey;
+	bool                   cacheable;
+
+	HRESULT hr = PrepareSource(source, pCache, metaData, cacheKey, cacheable, pStats);
+	if(FAILED(hr))
+	{
+		return hr;
+	}
+
+	const size_t size = 4 * static_cast<size_t>(cx) * cx;
+	cacheKey.cx = cx;
+	if(cacheable)
+	{
+		ThumbnailStageTimer timer(pStats, kStageCacheLookup);
+		if(pCache->Lookup(cacheKey, pDestination, size))
+		{
+			if(pStats)
+			{
+				pStats->cacheHit = true;
+			}
+			return S_OK;
+		}
+	}
+
+	// Only the selected mip of the first item is read and copied.
+	DirectX::ScratchImage scratchImage;
+	hr = LoadMip(source, SelectThumbnailMip(metaData, cx), metaData, scratchImage, pStats);
+	if(FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = RenderImage(*scratchImage.GetImage(0, 0, 0), BGRA8View(cx, pDestination), pStats);
+	if(SUCCEEDED(hr) && cacheable)
+	{
+		ThumbnailStageTimer timer(pStats, kStageCacheInsert);
+		pCache->Insert(cacheKey, pDestination, size);
+	}
+	return hr;
+}
+
+int32_t RenderThumbnails(ThumbnailReadStream& stream, const uint32_t* sizes, size_t count,
+						 ThumbnailImage* thumbnails, ThumbnailCache* pCache, ThumbnailCallStats* pStats)
+{
+	if(!sizes || !thumbnails)
+	{
+		return E_POINTER;
+	}
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(sizes[i] == 0)
+		{
+			return E_INVALIDARG;
+		}
+	}
+
+	PooledAllocationScope pooled(pStats);
+
+	CountingReadStream countingStream(stream);
+	DDSReadStreamAdapter source(pStats ? static_cast<ThumbnailReadStream&>(countingStream) : stream);
+	SCOPE_EXIT(if(pStats) { pStats->bytesRead += countingStream.GetBytesRead(); });
+
+	DirectX::TexMetadata   metaData;
+	ThumbnailCacheKey      cacheKey;
+	bool                   cacheable;
+
+	HRESULT hr = PrepareSource(source, pCache, metaData, cacheKey, cacheable, pStats);
+	if(FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Serve what the cache has; the rest are rendered largest first.
+	std::vector<size_t> pending;
+	for(size_t i = 0; i < count; ++i)
+	{
+		ThumbnailImage& thumb = thumbnails[i];
+		thumb.cx = sizes[i];
+		thumb.hr = E_PENDING;
+		thumb.pixels.resize(4 * static_cast<size_t>(thumb.cx) * thumb.cx);
+
+		if(pStats && thumb.cx > pStats->dstWidth)
+		{
+			pStats->dstWidth  = thumb.cx;
+			pStats->dstHeight = thumb.cx;
+		}
+
+		cacheKey.cx = thumb.cx;
+		ThumbnailStageTimer timer(pStats, kStageCacheLookup);
+		if(cacheable && pCache->Lookup(cacheKey, thumb.pixels.data(), thumb.pixels.size()))
+		{
+			thumb.hr = S_OK;
+		}
+		else
+		{
+			pending.push_back(i);
+		}
+	}
+	if(pending.empty())
+	{
+		if(pStats)
+		{
+			pStats->cacheHit = (count != 0);
+		}
+		return S_OK;
+	}
+
+	std::stable_sort(pending.begin(), pending.end(), [&](size_t a, size_t b)
+	{
+		return sizes[a] > sizes[b];
+	});
+
+	// One read of the mip that covers the largest size.
+	DirectX::ScratchImage scratchImage;
+	hr = LoadMip(source, SelectThumbnailMip(metaData, sizes[pending[0]]), metaData, scratchImage, pStats);
+	if(FAILED(hr))
+	{
+		for(size_t i = 0; i < pending.size(); ++i)
+		{
+			thumbnails[pending[i]].hr = hr;
+		}
+		return hr;
+	}
+
+	const DirectX::Image& mipImage = *scratchImage.GetImage(0, 0, 0);
+	const ThumbnailImage* previous = NULL;
+	HRESULT result = S_OK;
+
+	for(size_t i = 0; i < pending.size(); ++i)
+	{
+		ThumbnailImage& thumb = thumbnails[pending[i]];
+		DirectX::Image  dest  = BGRA8View(thumb.cx, thumb.pixels.data());
+
+		if(previous && previous->cx == thumb.cx)
+		{
+			thumb.pixels = previous->pixels;
+			thumb.hr     = S_OK;
+			continue;
+		}
+
+		// Filter down from the last output unless that was itself upscaled.
+		if(previous && previous->cx <= mipImage.width && previous->cx <= mipImage.height)
+		{
+			thumb.hr = RenderImage(BGRA8View(previous->cx, const_cast<uint8_t*>(previous->pixels.data())), dest, pStats);
+		}
+		else
+		{
+			thumb.hr = RenderImage(mipImage, dest, pStats);
+		}
+
+		if(FAILED(thumb.hr))
+		{
+			if(SUCCEEDED(result))
+			{
+				result = thumb.hr;
+			}
+			continue;
+		}
+
+		if(cacheable)
+		{
+			ThumbnailStageTimer timer(pStats, kStageCacheInsert);
+			cacheKey.cx = thumb.cx;
+			pCache->Insert(cacheKey, thumb.pixels.data(), thumb.pixels.size());
+		}
+		previous = &thumb;
+	}
+
+	return result;
+}
+
+void ReleaseThumbnailThreadResources()
+{
+	DirectX::ReleaseThreadImagePool();
+	DirectX::ReleaseScratchWorkspace();
+}
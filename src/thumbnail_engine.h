@@ -0,0 +1,41 @@
+// ----------------------------------------------------------------------------
+// thumbnail_engine.h
+// ----------------------------------------------------------------------------
+// Description : DDS -> square top-down BGRA8 thumbnail pipeline
+//               (mip select, decode, resize, inflate), independent of
+//               HBITMAP / IStream so tools can drive it directly. Results
+//               are HRESULT values carried in int32_t; the header pulls in
+//               no Windows or DirectXTex types.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class ThumbnailReadStream;
+class ThumbnailCache;
+struct ThumbnailCallStats;
+
+struct ThumbnailImage
+{
+	uint32_t				cx;
+	int32_t					hr;		// HRESULT
+	std::vector<uint8_t>	pixels;	// cx * cx * 4 bytes, top-down BGRA8
+};
+
+// Renders one cx x cx thumbnail into pDestination (row pitch 4 * cx).
+// pCache is optional; hits skip the decode entirely. pStats, if given, gets
+// the stage times, sizes and byte counts of this call added to it.
+int32_t RenderThumbnail(ThumbnailReadStream& stream, uint32_t cx, uint8_t* pDestination,
+						ThumbnailCache* pCache = NULL, ThumbnailCallStats* pStats = NULL);
+
+// Renders several sizes from a single read and decode. The largest size is
+// decoded from its mip and each result is then filtered down into the next
+// smaller size. Results come back in the order of 'sizes'; the return value
+// is the first failure, if any.
+int32_t RenderThumbnails(ThumbnailReadStream& stream, const uint32_t* sizes, size_t count,
+						 ThumbnailImage* thumbnails, ThumbnailCache* pCache = NULL,
+						 ThumbnailCallStats* pStats = NULL);
+
+// Frees the image pool and scratch buffers the calling thread keeps between
+// renders. Worker threads call it before they exit.
+void ReleaseThumbnailThreadResources();
@@ -0,0 +1,254 @@
+// ----------------------------------------------------------------------------
+// thumbnail_stats.cpp
+// ----------------------------------------------------------------------------
+#include "thumbnail_stats.h"
+#include <atomic>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+namespace
+{
+	const char* const kStageNames[kStageCount] =
+	{
+		"open", "cache_lookup", "load", "decompress", "resize", "inflate", "cache_insert", "dib",
+	};
+
+	const uint32_t kFormatSlots    = 192;	// DXGI formats; the last slot collects the rest
+	const uint32_t kLatencyBuckets = 24;	// log2(us): up to ~8 s
+
+	struct FormatAggregate
+	{
+		uint64_t	calls;
+		uint64_t	failures;
+		uint64_t	cacheHits;
+		uint64_t	bytesRead;
+		uint64_t	bytesAllocated;
+		uint64_t	poolAllocations;
+		uint64_t	poolHits;
+		uint64_t	poolRetainedPeak;
+		uint64_t	totalMicroseconds;
+		uint64_t	stageMicroseconds[kStageCount];
+		uint64_t	latency[kLatencyBuckets];
+	};
+
+	std::atomic<bool>						g_enabled(false);
+	std::atomic<ThumbnailStatsLogFunction>	g_log(NULL);
+	std::mutex								g_aggregateMutex;
+	FormatAggregate							g_aggregates[kFormatSlots];
+
+#if defined(_WIN32)
+	// VS2013's chrono clocks are only as fine as the system timer.
+	LARGE_INTEGER QueryFrequency()
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return frequency;
+	}
+	const LARGE_INTEGER g_frequency = QueryFrequency();
+#endif
+
+	uint64_t QueryPeakWorkingSet()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return counters.PeakWorkingSetSize;
+		}
+		return 0;
+#else
+		struct rusage usage;
+		if(getrusage(RUSAGE_SELF, &usage) == 0)
+		{
+			return static_cast<uint64_t>(usage.ru_maxrss) * 1024;	// KiB on Linux
+		}
+		return 0;
+#endif
+	}
+
+	uint32_t LatencyBucket(uint64_t microseconds)
+	{
+		uint32_t bucket = 0;
+		while(bucket + 1 < kLatencyBuckets && (1ULL << bucket) <= microseconds)
+		{
+			++bucket;
+		}
+		return bucket;
+	}
+
+	void Append(std::string& text, const char* format, ...)
+	{
+		char buffer[256];
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		if(length > 0)
+		{
+			text.append(buffer, (length < (int)sizeof(buffer)) ? length : sizeof(buffer) - 1);
+		}
+	}
+
+} // unnamed namespace
+
+void SetThumbnailStatsEnabled(bool enabled)
+{
+	g_enabled = enabled;
+}
+
+bool IsThumbnailStatsEnabled()
+{
+	return g_enabled;
+}
+
+void SetThumbnailStatsLog(ThumbnailStatsLogFunction log)
+{
+	g_log = log;
+}
+
+uint64_t ThumbnailStatsTicks()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	const uint64_t ticks     = static_cast<uint64_t>(counter.QuadPart);
+	const uint64_t frequency = static_cast<uint64_t>(g_frequency.QuadPart);
+	return (ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 / frequency;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<uint64_t>(now.tv_sec) * 1000000 + static_cast<uint64_t>(now.tv_nsec) / 1000;
+#endif
+}
+
+void BeginThumbnailCall(ThumbnailCallStats& stats, const char* operation)
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.operation  = operation;
+	stats.startTicks = ThumbnailStatsTicks();
+}
+
+void EndThumbnailCall(ThumbnailCallStats& stats, int32_t result)
+{
+	stats.result            = result;
+	stats.totalMicroseconds = ThumbnailStatsTicks() - stats.startTicks;
+	stats.peakWorkingSet    = QueryPeakWorkingSet();
+
+	{
+		std::lock_guard<std::mutex> lock(g_aggregateMutex);
+		FormatAggregate& aggregate = g_aggregates[(stats.format < kFormatSlots) ? stats.format : kFormatSlots - 1];
+		aggregate.calls++;
+		aggregate.failures          += (result < 0) ? 1 : 0;
+		aggregate.cacheHits         += stats.cacheHit ? 1 : 0;
+		aggregate.bytesRead         += stats.bytesRead;
+		aggregate.bytesAllocated    += stats.bytesAllocated;
+		aggregate.poolAllocations   += stats.poolAllocations;
+		aggregate.poolHits          += stats.poolHits;
+		if(stats.poolRetainedBytes > aggregate.poolRetainedPeak)
+		{
+			aggregate.poolRetainedPeak = stats.poolRetainedBytes;
+		}
+		aggregate.totalMicroseconds += stats.totalMicroseconds;
+		for(int s = 0; s < kStageCount; ++s)
+		{
+			aggregate.stageMicroseconds[s] += stats.stageMicroseconds[s];
+		}
+		aggregate.latency[LatencyBucket(stats.totalMicroseconds)]++;
+	}
+
+	ThumbnailStatsLogFunction log = g_log;
+	if(!log)
+	{
+		return;
+	}
+
+	std::string line;
+	Append(line, "dds_thumbnail op=%s hr=0x%08X fmt=%u src=%ux%u mip=%u dst=%ux%u cache=%s",
+		stats.operation ? stats.operation : "-", static_cast<uint32_t>(stats.result), stats.format,
+		stats.srcWidth, stats.srcHeight, stats.mip, stats.dstWidth, stats.dstHeight,
+		stats.cacheHit ? "hit" : "miss");
+	Append(line, " read=%llu alloc=%llu peak_ws=%llu total_us=%llu",
+		static_cast<unsigned long long>(stats.bytesRead), static_cast<unsigned long long>(stats.bytesAllocated),
+		static_cast<unsigned long long>(stats.peakWorkingSet), static_cast<unsigned long long>(stats.totalMicroseconds));
+	if(stats.poolAllocations != 0)
+	{
+		Append(line, " pool_hits=%llu/%llu pool_retained=%llu",
+			static_cast<unsigned long long>(stats.poolHits), static_cast<unsigned long long>(stats.poolAllocations),
+			static_cast<unsigned long long>(stats.poolRetainedBytes));
+	}
+	for(int s = 0; s < kStageCount; ++s)
+	{
+		if(stats.stageMicroseconds[s] != 0)
+		{
+			Append(line, " %s_us=%llu", kStageNames[s], static_cast<unsigned long long>(stats.stageMicroseconds[s]));
+		}
+	}
+	line += '\n';
+	log(line.c_str());
+}
+
+std::string DumpThumbnailStats()
+{
+	std::string text;
+	std::lock_guard<std::mutex> lock(g_aggregateMutex);
+
+	for(uint32_t f = 0; f < kFormatSlots; ++f)
+	{
+		const FormatAggregate& aggregate = g_aggregates[f];
+		if(aggregate.calls == 0)
+		{
+			continue;
+		}
+
+		// Averages per call; the histogram lists the upper bound of each log2 bucket.
+		const uint64_t calls = aggregate.calls;
+		Append(text, "fmt=%u%s calls=%llu failed=%llu cache_hits=%llu read=%llu alloc=%llu avg_us=%llu",
+			f, (f == kFormatSlots - 1) ? "+" : "",
+			static_cast<unsigned long long>(calls), static_cast<unsigned long long>(aggregate.failures),
+			static_cast<unsigned long long>(aggregate.cacheHits), static_cast<unsigned long long>(aggregate.bytesRead),
+			static_cast<unsigned long long>(aggregate.bytesAllocated),
+			static_cast<unsigned long long>(aggregate.totalMicroseconds / calls));
+		if(aggregate.poolAllocations != 0)
+		{
+			// Hit rate in whole percent; retained is the largest seen at the end of a call.
+			Append(text, " pool_hit_pct=%llu pool_retained_max=%llu",
+				static_cast<unsigned long long>(aggregate.poolHits * 100 / aggregate.poolAllocations),
+				static_cast<unsigned long long>(aggregate.poolRetainedPeak));
+		}
+		for(int s = 0; s < kStageCount; ++s)
+		{
+			if(aggregate.stageMicroseconds[s] != 0)
+			{
+				Append(text, " %s_us=%llu", kStageNames[s], static_cast<unsigned long long>(aggregate.stageMicroseconds[s] / calls));
+			}
+		}
+		text += " latency_us=";
+		for(uint32_t b = 0; b < kLatencyBuckets; ++b)
+		{
+			if(aggregate.latency[b] != 0)
+			{
+				Append(text, (b + 1 < kLatencyBuckets) ? "<%llu:%llu," : ">=%llu:%llu,",
+					1ULL << ((b + 1 < kLatencyBuckets) ? b : b - 1), static_cast<unsigned long long>(aggregate.latency[b]));
+			}
+		}
+		text[text.size() - 1] = '\n';
+	}
+	return text;
+}
+
+void ResetThumbnailStats()
+{
+	std::lock_guard<std::mutex> lock(g_aggregateMutex);
+	memset(g_aggregates, 0, sizeof(g_aggregates));
+}
@@ -0,0 +1,91 @@
+// ----------------------------------------------------------------------------
+// thumbnail_stats.h
+// ----------------------------------------------------------------------------
+// Description : Per-call stage timers and counters for the thumbnail and
+//               info tip paths, aggregated per DXGI format in process.
+//               Always compiled; recording is switched on at run time.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+enum ThumbnailStage
+{
+	kStageOpen,			// Stream size and DDS header
+	kStageCacheLookup,
+	kStageLoad,			// Reading and copying the selected mip
+	kStageDecompress,	// BC decode (including decode-and-filter)
+	kStageResize,
+	kStageInflate,		// Conversion to BGRA8
+	kStageCacheInsert,
+	kStageDIB,			// DIB creation / fill
+	kStageCount
+};
+
+struct ThumbnailCallStats
+{
+	const char*	operation;			// "thumbnail", "infotip", ...
+	int32_t		result;				// HRESULT
+	uint32_t	format;				// DXGI_FORMAT of the source
+	uint32_t	srcWidth;
+	uint32_t	srcHeight;
+	uint32_t	mip;				// Mip level the thumbnail was built from
+	uint32_t	dstWidth;
+	uint32_t	dstHeight;
+	bool		cacheHit;
+	uint64_t	bytesRead;
+	uint64_t	bytesAllocated;		// Pixel buffers allocated by the pipeline
+	uint64_t	poolAllocations;	// Pixel buffers requested from the thread's image pool
+	uint64_t	poolHits;			// ... and served from its cache
+	uint64_t	poolRetainedBytes;	// Cached by the thread's pool at the end of the call
+	uint64_t	peakWorkingSet;		// Process peak at the end of the call
+	uint64_t	startTicks;
+	uint64_t	totalMicroseconds;
+	uint64_t	stageMicroseconds[kStageCount];
+};
+
+// Recording is off until enabled; callers pass NULL stats while it is off.
+void SetThumbnailStatsEnabled(bool enabled);
+bool IsThumbnailStatsEnabled();
+
+// Receives one "key=value" line per finished call; NULL disables the log.
+typedef void (*ThumbnailStatsLogFunction)(const char* line);
+void SetThumbnailStatsLog(ThumbnailStatsLogFunction log);
+
+void BeginThumbnailCall(ThumbnailCallStats& stats, const char* operation);
+void EndThumbnailCall(ThumbnailCallStats& stats, int32_t result);
+
+// Per-format aggregates of every finished call, one line per format.
+std::string DumpThumbnailStats();
+void ResetThumbnailStats();
+
+// Monotonic microseconds.
+uint64_t ThumbnailStatsTicks();
+
+// Adds the lifetime of the scope to one stage; does nothing for NULL stats.
+class ThumbnailStageTimer
+{
+public:
+	ThumbnailStageTimer(ThumbnailCallStats* pStats, ThumbnailStage stage)
+		: m_pStats(pStats)
+		, m_stage (stage)
+		, m_start (pStats ? ThumbnailStatsTicks() : 0)
+	{
+	}
+	~ThumbnailStageTimer()
+	{
+		if(m_pStats)
+		{
+			m_pStats->stageMicroseconds[m_stage] += ThumbnailStatsTicks() - m_start;
+		}
+	}
+
+private:
+	ThumbnailCallStats*	m_pStats;
+	ThumbnailStage		m_stage;
+	uint64_t			m_start;
+
+	ThumbnailStageTimer(const ThumbnailStageTimer&);
+	ThumbnailStageTimer& operator=(const ThumbnailStageTimer&);
+
+}; // class ThumbnailStageTimer
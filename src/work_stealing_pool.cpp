@@ -0,0 +1,167 @@
+// ----------------------------------------------------------------------------
+// work_stealing_pool.cpp
+// ----------------------------------------------------------------------------
+#include "work_stealing_pool.h"
+
+// VS2013 has no thread_local.
+#if defined(_MSC_VER)
+#define POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define POOL_THREAD_LOCAL __thread
+#endif
+
+namespace
+{
+	// Identifies the pool and deque of the calling worker thread.
+	POOL_THREAD_LOCAL const WorkStealingPool*	t_pPool  = NULL;
+	POOL_THREAD_LOCAL unsigned					t_worker = 0;
+
+} // unnamed namespace
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount, const Task& threadInit, const Task& threadExit)
+	: m_threadInit(threadInit)
+	, m_threadExit(threadExit)
+	, m_queued(0)
+	, m_pending(0)
+	, m_nextWorker(0)
+	, m_stop(false)
+{
+	if(threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		if(threadCount == 0)
+		{
+			threadCount = 1;
+		}
+	}
+
+	m_workers.reserve(threadCount);
+	for(unsigned i = 0; i < threadCount; ++i)
+	{
+		m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+	}
+	m_threads.reserve(threadCount);
+	for(unsigned i = 0; i < threadCount; ++i)
+	{
+		m_threads.push_back(std::thread(&WorkStealingPool::WorkerMain, this, i));
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+		m_stop = true;
+	}
+	m_workAvailable.notify_all();
+	for(size_t i = 0; i < m_threads.size(); ++i)
+	{
+		m_threads[i].join();
+	}
+}
+
+void WorkStealingPool::Submit(Task task)
+{
+	unsigned index = (t_pPool == this) ? t_worker
+									   : m_nextWorker++ % static_cast<unsigned>(m_workers.size());
+
+	m_pending++;
+	{
+		Worker& worker = *m_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	{
+		// Publish under the state mutex so a worker about to sleep cannot miss it.
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+		m_queued++;
+	}
+	m_workAvailable.notify_one();
+}
+
+void WorkStealingPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_stateMutex);
+	while(m_pending != 0)
+	{
+		m_allDone.wait(lock);
+	}
+}
+
+bool WorkStealingPool::PopLocal(unsigned index, Task& task)
+{
+	Worker& worker = *m_workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if(worker.tasks.empty())
+	{
+		return false;
+	}
+	// Newest first: its data is most likely still in cache.
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::Steal(unsigned index, Task& task)
+{
+	const unsigned count = static_cast<unsigned>(m_workers.size());
+	for(unsigned i = 1; i < count; ++i)
+	{
+		Worker& victim = *m_workers[(index + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.tasks.empty())
+		{
+			// Oldest first: usually the largest remaining piece of work
+			// (e.g. a whole directory rather than a single file).
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::WorkerMain(unsigned index)
+{
+	t_pPool  = this;
+	t_worker = index;
+	if(m_threadInit)
+	{
+		m_threadInit();
+	}
+
+	for(;;)
+	{
+		Task task;
+		if(PopLocal(index, task) || Steal(index, task))
+		{
+			m_queued--;
+			task();
+			task = Task();
+
+			if(--m_pending == 0)
+			{
+				std::lock_guard<std::mutex> lock(m_stateMutex);
+				m_allDone.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_stateMutex);
+		while(!m_stop && m_queued == 0)
+		{
+			m_workAvailable.wait(lock);
+		}
+		if(m_stop && m_queued == 0)
+		{
+			break;
+		}
+	}
+
+	if(m_threadExit)
+	{
+		m_threadExit();
+	}
+	t_pPool = NULL;
+}
@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------------
+// work_stealing_pool.h
+// ----------------------------------------------------------------------------
+// Description : Fixed-size thread pool with one task deque per worker.
+//               Workers run their own newest task first and steal the
+//               oldest task of another worker when they run dry.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	// threadCount 0 means one worker per hardware thread. threadInit and
+	// threadExit run on every worker (e.g. COM or OpenMP setup).
+	explicit WorkStealingPool(unsigned threadCount = 0,
+							  const Task& threadInit = Task(), const Task& threadExit = Task());
+	~WorkStealingPool();
+
+	// Queues a task. Called from a worker, the task goes to that worker's own
+	// deque; otherwise the workers are fed round-robin.
+	void Submit(Task task);
+
+	// Blocks until every submitted task, including tasks submitted by tasks,
+	// has finished.
+	void Wait();
+
+	unsigned GetThreadCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+private:
+	struct Worker
+	{
+		std::mutex			mutex;
+		std::deque<Task>	tasks;
+	};
+
+	std::vector<std::unique_ptr<Worker>>	m_workers;
+	std::vector<std::thread>				m_threads;
+	Task									m_threadInit;
+	Task									m_threadExit;
+
+	std::mutex					m_stateMutex;
+	std::condition_variable		m_workAvailable;
+	std::condition_variable		m_allDone;
+	std::atomic<size_t>			m_queued;		// Tasks sitting in a deque
+	std::atomic<size_t>			m_pending;		// Tasks submitted and not yet finished
+	std::atomic<unsigned>		m_nextWorker;
+	bool						m_stop;
+
+	void WorkerMain(unsigned index);
+	bool PopLocal(unsigned index, Task& task);
+	bool Steal(unsigned index, Task& task);
+
+	WorkStealingPool(const WorkStealingPool&);
+	WorkStealingPool& operator=(const WorkStealingPool&);
+
+}; // class WorkStealingPool